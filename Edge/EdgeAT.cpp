@@ -0,0 +1,324 @@
+#include "EdgeAT.h"
+
+/*
+ * Commands wait in a ring and go out one command line at a time, the modem
+ * does not take another line before the final result of the last one.
+ * Consecutive AT_BATCH queries share a line ("AT+CSQ;+CREG?;+COPS?") and
+ * come back as one information line each and a single OK, so a status poll
+ * costs one round trip instead of several. Lines are matched to the
+ * commands in flight by prefix, anything they do not claim goes to the URC
+ * table, so a URC arriving mid-command is dispatched rather than lost.
+ */
+
+static void copyReply(char* dst, const char* src, size_t len) {
+    if (len > AT_REPLY_SIZE - 1) len = AT_REPLY_SIZE - 1;
+    memcpy(dst, src, len);
+    dst[len] = '\0';
+}
+
+EdgeAT::EdgeAT() {
+    serial = nullptr;
+    head = 0;
+    count = 0;
+    inFlight = 0;
+    epoch = 0;
+    sentAt = 0;
+    flightTimeout = 0;
+
+    waitPrompt = false;
+    txData = nullptr;
+    txLen = 0;
+    txSent = 0;
+
+    lineLen = 0;
+    lineOverflow = false;
+    reply[0] = '\0';
+    urcCount = 0;
+
+    commandsCompleted = 0;
+    linesSent = 0;
+    bytesReceived = 0;
+    timeouts = 0;
+    urcsDispatched = 0;
+    linesDropped = 0;
+}
+
+void EdgeAT::begin(HardwareSerial* port) {
+    serial = port;
+    clear();
+}
+
+bool EdgeAT::send(const char* command, unsigned long timeout, AtCallback callback, void* context,
+                  uint8_t flags) {
+    return enqueue(command, nullptr, 0, timeout, callback, context, flags);
+}
+
+bool EdgeAT::sendData(const char* command, const uint8_t* data, size_t len, unsigned long timeout,
+                      AtCallback callback, void* context) {
+    // The prompt belongs to one command, so it never shares a line
+    return enqueue(command, data, len, timeout, callback, context, 0);
+}
+
+bool EdgeAT::enqueue(const char* command, const uint8_t* data, size_t len, unsigned long timeout,
+                     AtCallback callback, void* context, uint8_t flags) {
+    const size_t commandLen = strlen(command);
+    if (count >= AT_QUEUE_SIZE || commandLen >= AT_COMMAND_SIZE) return false;
+
+    AtSlot& slot = queue[(head + count) % AT_QUEUE_SIZE];
+    memcpy(slot.command, command, commandLen + 1);
+
+    // Queries and actions ("+CREG?", "+CSQ") answer with a "+CREG:" line.
+    // Set commands mostly answer with OK alone, and "+SMSUB=..." must not
+    // swallow an incoming "+SMSUB:" message.
+    slot.expectLen = 0;
+    if (command[0] == '+' && !strchr(command, '=')) {
+        size_t end = 1;
+        while (end < commandLen && isAlphaNumeric(command[end])) end++;
+        if (end + 2 <= sizeof(slot.expect)) {
+            memcpy(slot.expect, command, end);
+            slot.expect[end] = ':';
+            slot.expect[end + 1] = '\0';
+            slot.expectLen = end + 1;
+        }
+    }
+
+    slot.reply[0] = '\0';
+    slot.timeout = timeout;
+    slot.callback = callback;
+    slot.context = context;
+    slot.data = data;
+    slot.dataLen = len;
+    slot.flags = flags;
+    count++;
+    return true;
+}
+
+bool EdgeAT::onUrc(const char* prefix, AtUrcHandler handler, void* context) {
+    if (urcCount >= AT_MAX_URCS) return false;
+    AtUrc& urc = urcs[urcCount++];
+    urc.prefix = prefix;
+    urc.prefixLen = strlen(prefix);
+    urc.handler = handler;
+    urc.context = context;
+    return true;
+}
+
+void EdgeAT::clear() {
+    epoch++;    // Stops complete() if a callback clears the queue
+    head = 0;
+    count = 0;
+    inFlight = 0;
+    waitPrompt = false;
+    txData = nullptr;
+    lineLen = 0;
+    lineOverflow = false;
+}
+
+void EdgeAT::poll() {
+    if (!serial) return;
+
+    writeData();
+
+    // Read in chunks, bounded so a chatty modem cannot stretch one call
+    uint8_t buf[64];
+    size_t budget = AT_POLL_BUDGET;
+    while (budget) {
+        const int avail = serial->available();
+        if (avail <= 0) break;
+        size_t n = (size_t)avail;
+        if (n > sizeof(buf)) n = sizeof(buf);
+        if (n > budget) n = budget;
+        n = serial->read(buf, n);
+        if (n == 0) break;
+        bytesReceived += n;
+        budget -= n;
+        parse(buf, n);
+    }
+
+    const unsigned long now = millis();
+    if (inFlight && now - sentAt > flightTimeout) {
+        complete(AT_TIMEOUT);
+    }
+
+    // The next line goes out in the same poll that finished the last one
+    if (!inFlight && count) {
+        transmit(now);
+    }
+}
+
+void EdgeAT::transmit(unsigned long now) {
+    const AtSlot& first = queue[head];
+    uint8_t n = 1;
+    size_t lineTotal = 2 + strlen(first.command);
+    unsigned long timeout = first.timeout;
+
+    serial->write((const uint8_t*)"AT", 2);
+    serial->write((const uint8_t*)first.command, lineTotal - 2);
+
+    if (first.flags & AT_BATCH) {
+        while (n < count && n < AT_BATCH_MAX) {
+            const AtSlot& next = queue[(head + n) % AT_QUEUE_SIZE];
+            const size_t len = strlen(next.command);
+            if (!(next.flags & AT_BATCH) || lineTotal + 1 + len > AT_MAX_COMMAND_LINE) break;
+            serial->write((const uint8_t*)";", 1);
+            serial->write((const uint8_t*)next.command, len);
+            lineTotal += 1 + len;
+            timeout += next.timeout;
+            n++;
+        }
+    }
+    serial->write((const uint8_t*)"\r\n", 2);
+
+    inFlight = n;
+    sentAt = now;
+    flightTimeout = timeout;
+    linesSent++;
+
+    if (first.data) {
+        waitPrompt = true;
+        txData = first.data;
+        txLen = first.dataLen;
+        txSent = 0;
+    }
+}
+
+void EdgeAT::writeData() {
+    // Only as much as the UART takes, the rest goes on the next poll
+    if (!txData || waitPrompt || txSent >= txLen) return;
+    const int room = serial->availableForWrite();
+    if (room <= 0) return;
+    size_t n = txLen - txSent;
+    if (n > (size_t)room) n = room;
+    serial->write(txData + txSent, n);
+    txSent += n;
+}
+
+void EdgeAT::parse(const uint8_t* buf, size_t len) {
+    while (len) {
+        // The data prompt is "> " with no line ending
+        if (waitPrompt && lineLen == 0 && *buf == '>') {
+            waitPrompt = false;
+            buf++;
+            len--;
+            writeData();
+            continue;
+        }
+
+        const uint8_t* nl = (const uint8_t*)memchr(buf, '\n', len);
+        const size_t seg = nl ? (size_t)(nl - buf) : len;
+
+        const size_t room = sizeof(line) - 1 - lineLen;
+        if (seg > room) {
+            lineOverflow = true;
+        }
+        const size_t take = (seg < room) ? seg : room;
+        memcpy(line + lineLen, buf, take);
+        lineLen += take;
+
+        if (!nl) break;
+        dispatch();
+        buf += seg + 1;
+        len -= seg + 1;
+    }
+}
+
+void EdgeAT::dispatch() {
+    while (lineLen && (line[lineLen - 1] == '\r' || line[lineLen - 1] == ' ')) {
+        lineLen--;
+    }
+    line[lineLen] = '\0';
+    const size_t len = lineLen;
+    const bool overflow = lineOverflow;
+    lineLen = 0;
+    lineOverflow = false;
+
+    if (len == 0) return;
+    if (overflow) {
+        linesDropped++;
+        return;
+    }
+
+    if (inFlight) {
+        if (!strcmp(line, "OK")) {
+            complete(AT_OK);
+            return;
+        }
+        if (!strcmp(line, "ERROR") || !strncmp(line, "+CME ERROR", 10) ||
+            !strncmp(line, "+CMS ERROR", 10)) {
+            complete(AT_ERROR);
+            return;
+        }
+        for (uint8_t i = 0; i < inFlight; i++) {
+            AtSlot& slot = queue[(head + i) % AT_QUEUE_SIZE];
+            if (slot.expectLen && !slot.reply[0] && !strncmp(line, slot.expect, slot.expectLen)) {
+                copyReply(slot.reply, line, len);
+                return;
+            }
+        }
+    }
+
+    for (uint8_t i = 0; i < urcCount; i++) {
+        if (!strncmp(line, urcs[i].prefix, urcs[i].prefixLen)) {
+            urcsDispatched++;
+            urcs[i].handler(urcs[i].context, line);
+            return;
+        }
+    }
+
+    // Bare information lines (IMEI, IMSI), skipping the echo before ATE0
+    if (inFlight && line[0] != '+' && strncmp(line, "AT", 2)) {
+        for (uint8_t i = 0; i < inFlight; i++) {
+            AtSlot& slot = queue[(head + i) % AT_QUEUE_SIZE];
+            if (!slot.reply[0]) {
+                copyReply(slot.reply, line, len);
+                return;
+            }
+        }
+    }
+
+    linesDropped++;
+}
+
+void EdgeAT::complete(AtResult result) {
+    const uint8_t n = inFlight;
+    inFlight = 0;
+    waitPrompt = false;
+    txData = nullptr;
+    if (result == AT_TIMEOUT) {
+        timeouts++;
+    }
+
+    // An ERROR on a shared line stops the modem at the failing query: the
+    // ones before it answered, the ones after it never ran
+    bool failed = false;
+    const uint8_t started = epoch;
+    for (uint8_t i = 0; i < n && count && epoch == started; i++) {
+        AtSlot& slot = queue[head];
+        AtResult r = result;
+        if (result == AT_ERROR && n > 1) {
+            if (slot.reply[0]) {
+                r = AT_OK;
+            } else if (failed) {
+                // Retry the rest one per line
+                for (uint8_t j = 0; j < n - i && j < count; j++) {
+                    queue[(head + j) % AT_QUEUE_SIZE].flags &= ~AT_BATCH;
+                }
+                break;
+            } else {
+                failed = true;
+            }
+        }
+
+        // Free the slot first, the callback may queue the next command
+        strcpy(reply, slot.reply);
+        const AtCallback callback = slot.callback;
+        void* const context = slot.context;
+        head = (head + 1) % AT_QUEUE_SIZE;
+        count--;
+        commandsCompleted++;
+
+        if (callback) {
+            callback(context, r, reply);
+        }
+    }
+}
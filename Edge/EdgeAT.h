@@ -0,0 +1,121 @@
+#ifndef EDGE_AT_H
+#define EDGE_AT_H
+
+#include <Arduino.h>
+#include "edge_board_def.h"
+
+// Result of one command, as passed to its callback
+enum AtResult {
+    AT_IDLE,
+    AT_PENDING,
+    AT_OK,
+    AT_ERROR,
+    AT_TIMEOUT
+};
+
+// Command flags
+#define AT_BATCH    0x01    // Query that may share a command line with its neighbours
+
+// reply is the command's information line ("+CSQ: 18,99", an IMEI), or empty
+typedef void (*AtCallback)(void* context, AtResult result, const char* reply);
+typedef void (*AtUrcHandler)(void* context, const char* line);
+
+class EdgeAT {
+private:
+    struct AtSlot {
+        char command[AT_COMMAND_SIZE];
+        char expect[16];    // Prefix of the information line, e.g. "+CREG:"
+        uint8_t expectLen;
+        char reply[AT_REPLY_SIZE];
+        unsigned long timeout;
+        AtCallback callback;
+        void* context;
+        const uint8_t* data;    // Sent after the '>' prompt
+        size_t dataLen;
+        uint8_t flags;
+    };
+
+    struct AtUrc {
+        const char* prefix;
+        uint8_t prefixLen;
+        AtUrcHandler handler;
+        void* context;
+    };
+
+    HardwareSerial* serial;
+
+    // Commands in order, the first inFlight of them are on the wire
+    AtSlot queue[AT_QUEUE_SIZE];
+    uint8_t head;
+    uint8_t count;
+    uint8_t inFlight;
+    uint8_t epoch;
+    unsigned long sentAt;
+    unsigned long flightTimeout;
+
+    // Payload of the command in flight
+    bool waitPrompt;
+    const uint8_t* txData;
+    size_t txLen;
+    size_t txSent;
+
+    char line[AT_LINE_BUFFER];
+    size_t lineLen;
+    bool lineOverflow;
+    char reply[AT_REPLY_SIZE];
+
+    AtUrc urcs[AT_MAX_URCS];
+    uint8_t urcCount;
+
+    // Statistics
+    unsigned long commandsCompleted;
+    unsigned long linesSent;
+    unsigned long bytesReceived;
+    unsigned long timeouts;
+    unsigned long urcsDispatched;
+    unsigned long linesDropped;
+
+public:
+    EdgeAT();
+
+    void begin(HardwareSerial* port);
+
+    // Queue a command, "+CSQ" is sent as "AT+CSQ". Returns false if the queue is full.
+    bool send(const char* command, unsigned long timeout, AtCallback callback, void* context,
+              uint8_t flags = 0);
+    // Queue a command that answers with '>' and then takes len bytes of data.
+    // data must stay valid until the callback runs.
+    bool sendData(const char* command, const uint8_t* data, size_t len, unsigned long timeout,
+                  AtCallback callback, void* context);
+
+    // Lines starting with prefix that no command in flight claims
+    bool onUrc(const char* prefix, AtUrcHandler handler, void* context);
+
+    // Reads and dispatches whatever the modem sent, never waits for it
+    void poll();
+
+    // Drop every queued command without calling back, e.g. after a modem reset
+    void clear();
+
+    bool idle() { return count == 0; }
+    uint8_t pending() { return count; }
+
+    // Statistics
+    unsigned long getCommandsCompleted() { return commandsCompleted; }
+    unsigned long getLinesSent() { return linesSent; }
+    unsigned long getBytesReceived() { return bytesReceived; }
+    unsigned long getTimeouts() { return timeouts; }
+    unsigned long getUrcsDispatched() { return urcsDispatched; }
+    unsigned long getLinesDropped() { return linesDropped; }
+
+private:
+    bool enqueue(const char* command, const uint8_t* data, size_t len, unsigned long timeout,
+                 AtCallback callback, void* context, uint8_t flags);
+    void transmit(unsigned long now);
+    void writeData();
+    void parse(const uint8_t* buf, size_t len);
+    void dispatch();
+    void complete(AtResult result);
+};
+
+#endif // EDGE_AT_H
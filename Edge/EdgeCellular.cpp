@@ -0,0 +1,941 @@
+#include "EdgeCellular.h"
+
+/*
+ * The SIM7000G is driven through EdgeAT: the state machine has one command
+ * of its own queued at a time, loop() picks up its result once the reply
+ * arrives. MQTT runs on the modem (AT+SMCONF/SMCONN/SMPUB), so connecting
+ * or publishing never holds the caller for a socket timeout. Each state has
+ * a timeout, a failed state is retried after a jittered exponential backoff.
+ */
+
+static const unsigned long stateTimeouts[] = {
+    0,                      // CELL_OFF
+    CELL_POWER_ON_TIMEOUT,
+    CELL_REGISTER_TIMEOUT,
+    CELL_ATTACH_TIMEOUT,
+    CELL_MQTT_TIMEOUT,
+    0,                      // CELL_CONNECTED
+    0                       // CELL_BACKOFF
+};
+
+EdgeCellular::EdgeCellular(const String& deviceId) {
+    serialAT = nullptr;
+    initialized = false;
+    networkConnected = false;
+    gprsConnected = false;
+    mqttConnected = false;
+    mqttPort = 1883;
+    this->deviceId = deviceId;
+
+    state = CELL_OFF;
+    resumeState = CELL_OFF;
+    stateStart = 0;
+    nextPoll = 0;
+    backoffUntil = 0;
+    step = 0;
+    resetPending = false;
+
+    atState = AT_IDLE;
+
+    mqttLost = false;
+    bearerLost = false;
+    modemDown = false;
+    modemSilent = false;
+    healthPending = false;
+    healthRegistered = 0;
+
+    outHead = 0;
+    outCount = 0;
+    publishing = false;
+    subscriptionCount = 0;
+    subscribed = 0;
+
+    signalQuality = 99;
+
+    messagesPublished = 0;
+    messagesReceived = 0;
+    lastMessageTime = 0;
+    connectionStartTime = 0;
+    totalConnectedTime = 0;
+
+    messageCallback = nullptr;
+    publishedCallback = nullptr;
+
+    timeCallback = nullptr;
+    ntpSyncedAt = 0;
+    ntpRetryAt = 0;
+    timeQueryAt = 0;
+    timeQuerySentAt = 0;
+    timeQueryPending = false;
+
+    retryCount = 0;
+    lastRetryTime = 0;
+}
+
+EdgeCellular::~EdgeCellular() {
+    end();
+}
+
+bool EdgeCellular::begin(const String& apn, const String& user, const String& pass) {
+    Serial.println("Initializing Edge cellular...");
+
+    apnName = apn;
+    apnUser = user;
+    apnPass = pass;
+
+    pinMode(MODEM_PWRKEY, OUTPUT);
+    pinMode(MODEM_POWER_ON, OUTPUT);
+    digitalWrite(MODEM_POWER_ON, HIGH);
+    digitalWrite(MODEM_PWRKEY, LOW);
+
+    serialAT = &Serial1;
+    serialAT->begin(115200, SERIAL_8N1, MODEM_RX, MODEM_TX);
+
+    at.begin(serialAT);
+    at.onUrc("+SMSUB: ", onMessageUrc, this);
+    at.onUrc("+SMSTATE: 0", onSessionLostUrc, this);
+    at.onUrc("+APP PDP: DEACTIVE", onBearerLostUrc, this);
+    at.onUrc("NORMAL POWER DOWN", onPowerDownUrc, this);
+    at.onUrc("+CNTP: ", onNtpUrc, this);
+
+    initialized = true;
+    retryCount = 0;
+    enterState(CELL_POWER_ON, millis());
+    return true;
+}
+
+void EdgeCellular::end() {
+    if (initialized) {
+        powerOff();
+        initialized = false;
+    }
+}
+
+bool EdgeCellular::connectNetwork() {
+    if (!initialized) return false;
+    if (state == CELL_OFF) {
+        enterState(CELL_POWER_ON, millis());
+    }
+    return true;
+}
+
+bool EdgeCellular::connectGPRS() {
+    return connectNetwork();
+}
+
+bool EdgeCellular::disconnectGPRS() {
+    if (!initialized || atState == AT_PENDING) return false;
+    updateConnectionTime(millis());
+    sendAT("+CNACT=0");
+    gprsConnected = false;
+    mqttConnected = false;
+    enterState(CELL_OFF, millis());
+    return true;
+}
+
+bool EdgeCellular::connectMQTT(const String& broker, int port) {
+    if (broker.length() == 0) return false;
+    mqttBroker = broker;
+    mqttPort = port;
+    return connectNetwork();
+}
+
+bool EdgeCellular::disconnectMQTT() {
+    if (!mqttConnected || atState == AT_PENDING) return false;
+    updateConnectionTime(millis());
+    sendAT("+SMDISC");
+    mqttConnected = false;
+    mqttBroker = "";
+    enterState(CELL_MQTT_CONNECT, millis());
+    return true;
+}
+
+void EdgeCellular::loop() {
+    if (!initialized) return;
+
+    const unsigned long now = millis();
+    const AtResult r = pollAT();
+
+    const unsigned long timeout = stateTimeouts[state];
+    if (timeout && now - stateStart > timeout) {
+        const CellularState resume = (state == CELL_POWER_ON) ? CELL_POWER_ON :
+                                     (state == CELL_MQTT_CONNECT) ? CELL_ATTACH : CELL_REGISTER;
+        fail("state timed out", resume, now);
+        return;
+    }
+
+    if (modemDown && state != CELL_OFF && state != CELL_POWER_ON) {
+        modemDown = false;
+        fail("modem powered down", CELL_POWER_ON, now);
+        return;
+    }
+
+    // Once it has answered, silence means the modem hung or lost power.
+    // SMCONN waits on the broker, so MQTT connect handles its own timeouts.
+    if ((r == AT_TIMEOUT || modemSilent) &&
+        (state == CELL_REGISTER || state == CELL_ATTACH || state == CELL_CONNECTED)) {
+        modemSilent = false;
+        fail("modem not responding", CELL_POWER_ON, now);
+        return;
+    }
+
+    switch (state) {
+    case CELL_OFF:
+        break;
+    case CELL_POWER_ON:
+        runPowerOn(r, now);
+        break;
+    case CELL_REGISTER:
+        runRegister(r, now);
+        break;
+    case CELL_ATTACH:
+        runAttach(r, now);
+        break;
+    case CELL_MQTT_CONNECT:
+        runMqttConnect(r, now);
+        break;
+    case CELL_CONNECTED:
+        runConnected(r, now);
+        break;
+    case CELL_BACKOFF:
+        if ((long)(now - backoffUntil) >= 0 && atState != AT_PENDING) {
+            enterState(resumeState, now);
+        }
+        break;
+    }
+}
+
+const char* EdgeCellular::getStateName() {
+    static const char* const names[] = {
+        "OFF", "POWER_ON", "REGISTER", "ATTACH", "MQTT_CONNECT", "CONNECTED", "BACKOFF"
+    };
+    return names[state];
+}
+
+void EdgeCellular::enterState(CellularState next, unsigned long now) {
+    state = next;
+    stateStart = now;
+    nextPoll = now;
+    step = 0;
+}
+
+void EdgeCellular::fail(const char* reason, CellularState resume, unsigned long now) {
+    if (state == CELL_CONNECTED) {
+        updateConnectionTime(now);
+    }
+    if (retryCount < 255) {
+        retryCount++;
+    }
+    lastRetryTime = now;
+
+    // Some failures only a modem restart clears
+    if (retryCount % CELL_RESET_AFTER == 0) {
+        resume = CELL_POWER_ON;
+        resetPending = true;
+    }
+
+    mqttConnected = false;
+    publishing = false;
+    if (resume == CELL_POWER_ON) {
+        // Nothing queued for the old modem session is worth sending
+        at.clear();
+        atState = AT_IDLE;
+        healthPending = false;
+        // The modem's clock does not survive a restart
+        ntpSyncedAt = 0;
+        timeQueryPending = false;
+    }
+    if (resume <= CELL_ATTACH) {
+        gprsConnected = false;
+    }
+    if (resume <= CELL_REGISTER) {
+        networkConnected = false;
+    }
+
+    // Equal jitter: half the delay fixed, half random, so a fleet that
+    // lost the network together does not come back in lockstep
+    const uint8_t shift = (retryCount > 16) ? 16 : retryCount - 1;
+    unsigned long delayMs = (unsigned long)CELL_BACKOFF_BASE << shift;
+    if (delayMs > CELL_BACKOFF_MAX) {
+        delayMs = CELL_BACKOFF_MAX;
+    }
+    delayMs = delayMs / 2 + random(delayMs / 2 + 1);
+
+    Serial.printf("Cellular: %s in %s, retry %u in %lu ms\n",
+                  reason, getStateName(), retryCount, delayMs);
+
+    resumeState = resume;
+    backoffUntil = now + delayMs;
+    enterState(CELL_BACKOFF, now);
+}
+
+void EdgeCellular::runPowerOn(AtResult r, unsigned long now) {
+    switch (step) {
+    case 0:     // Is it already on?
+        if (sendAT("", 500)) step = 1;
+        break;
+    case 1:
+        if (r == AT_OK) {
+            if (resetPending) {
+                resetPending = false;
+                sendAT("+CFUN=1,1", 10000);
+                nextPoll = now + 5000;
+                step = 4;
+            } else {
+                sendAT("E0");
+                step = 5;
+            }
+        } else if (r == AT_TIMEOUT || r == AT_ERROR) {
+            digitalWrite(MODEM_PWRKEY, HIGH);
+            nextPoll = now + 1000;
+            step = 2;
+        }
+        break;
+    case 2:     // Release PWRKEY after a 1 s pulse, then let it boot
+        if ((long)(now - nextPoll) >= 0) {
+            digitalWrite(MODEM_PWRKEY, LOW);
+            nextPoll = now + 3000;
+            step = 3;
+        }
+        break;
+    case 3:     // Probe every 500 ms until it answers
+    case 4:
+        if (atState != AT_PENDING && (long)(now - nextPoll) >= 0 && sendAT("", 500)) {
+            nextPoll = now + 500;
+            step = 6;
+        }
+        break;
+    case 6:
+        if (r == AT_OK) {
+            sendAT("E0");
+            step = 5;
+        } else if (r != AT_PENDING && r != AT_IDLE) {
+            step = 3;
+        }
+        break;
+    case 5:
+        if (r == AT_OK || r == AT_ERROR) {
+            sendAT("+GSN");
+            step = 7;
+        } else if (r == AT_TIMEOUT) {
+            step = 3;
+        }
+        break;
+    case 7:
+        if (r == AT_OK) {
+            imei = atReply;
+            sendAT("+CIMI");
+            step = 8;
+        } else if (r == AT_ERROR || r == AT_TIMEOUT) {
+            sendAT("+CIMI");
+            step = 8;
+        }
+        break;
+    case 8:
+        if (r == AT_OK) {
+            imsi = atReply;
+        }
+        if (r != AT_PENDING && r != AT_IDLE) {
+            modemDown = false;
+            Serial.println("Modem ready, IMEI " + imei);
+            enterState(CELL_REGISTER, now);
+        }
+        break;
+    }
+}
+
+int EdgeCellular::registrationStatus(const String& reply) {
+    // +CREG: <n>,<stat>[,...]
+    const int comma = reply.indexOf(',');
+    return (comma < 0) ? -1 : reply.substring(comma + 1).toInt();
+}
+
+void EdgeCellular::runRegister(AtResult r, unsigned long now) {
+    switch (step) {
+    case 0:     // LTE (CAT-M / NB-IoT) first, then 2G
+        if ((long)(now - nextPoll) >= 0 && sendAT("+CEREG?")) {
+            nextPoll = now + CELL_POLL_INTERVAL;
+            step = 1;
+        }
+        break;
+    case 1:
+    case 2: {
+        if (r == AT_PENDING || r == AT_IDLE) break;
+        const int stat = (r == AT_OK) ? registrationStatus(atReply) : -1;
+        if (stat == 1 || stat == 5) {
+            networkConnected = true;
+            sendAT("+COPS?");
+            step = 3;
+        } else if (stat == 3) {
+            fail("registration denied", CELL_REGISTER, now);
+        } else if (step == 1) {
+            sendAT("+CREG?");
+            step = 2;
+        } else {
+            step = 0;
+        }
+        break;
+    }
+    case 3:
+        if (r == AT_OK) {
+            // +COPS: 0,0,"Operator",7
+            const int q = atReply.indexOf('"');
+            operatorName = (q < 0) ? "" : atReply.substring(q + 1, atReply.indexOf('"', q + 1));
+        }
+        if (r != AT_PENDING && r != AT_IDLE) {
+            Serial.println("Network registered: " + operatorName);
+            enterState(CELL_ATTACH, now);
+        }
+        break;
+    }
+}
+
+void EdgeCellular::runAttach(AtResult r, unsigned long now) {
+    switch (step) {
+    case 0:     // The bearer may have survived whatever sent us here
+        if (sendAT("+CNACT?")) step = 1;
+        break;
+    case 1:
+        if (r == AT_OK && atReply.startsWith("+CNACT: 1")) {
+            step = 5;
+        } else if (r != AT_PENDING && r != AT_IDLE) {
+            sendAT("+CSTT=\"" + apnName + "\",\"" + apnUser + "\",\"" + apnPass + "\"");
+            step = 2;
+        }
+        break;
+    case 2:     // CSTT fails harmlessly when already set
+        if (r != AT_PENDING && r != AT_IDLE) {
+            sendAT("+CNACT=1,\"" + apnName + "\"", 10000);
+            step = 3;
+        }
+        break;
+    case 3:
+        if (r == AT_OK) {
+            nextPoll = now + CELL_POLL_INTERVAL;
+            step = 4;
+        } else if (r == AT_ERROR || r == AT_TIMEOUT) {
+            fail("bearer activation rejected", CELL_ATTACH, now);
+        }
+        break;
+    case 4:     // Poll until an address is assigned
+        if (r == AT_OK && atReply.startsWith("+CNACT: 1")) {
+            step = 5;
+        } else if (atState != AT_PENDING && (long)(now - nextPoll) >= 0 && sendAT("+CNACT?")) {
+            nextPoll = now + CELL_POLL_INTERVAL;
+        }
+        break;
+    }
+
+    if (step == 5) {
+        gprsConnected = true;
+        bearerLost = false;
+        Serial.println("GPRS connected");
+        enterState(CELL_MQTT_CONNECT, now);
+    }
+}
+
+void EdgeCellular::runMqttConnect(AtResult r, unsigned long now) {
+    if (mqttBroker.length() == 0) {
+        // Nothing to connect to yet, the link stays up
+        stateStart = now;
+        return;
+    }
+    if (bearerLost) {
+        fail("bearer lost", CELL_ATTACH, now);
+        return;
+    }
+    if ((r == AT_ERROR && step != 1) || r == AT_TIMEOUT) {
+        fail(step == 6 ? "MQTT connect failed" : "MQTT setup failed", CELL_ATTACH, now);
+        return;
+    }
+    const bool done = (r == AT_OK || r == AT_ERROR);
+
+    switch (step) {
+    case 0:     // Drop a session left over on the modem, errors if there is none
+        if (sendAT("+SMDISC")) step = 1;
+        break;
+    case 1:
+        if (done) {
+            sendAT("+SMCONF=\"URL\",\"" + mqttBroker + "\"," + String(mqttPort));
+            step = 2;
+        }
+        break;
+    case 2:
+        if (done) {
+            sendAT("+SMCONF=\"CLIENTID\",\"" + deviceId + "\"");
+            step = 3;
+        }
+        break;
+    case 3:
+        if (done) {
+            sendAT("+SMCONF=\"KEEPTIME\",60");
+            step = 4;
+        }
+        break;
+    case 4:
+        if (done) {
+            sendAT("+SMCONF=\"CLEANSS\",1");
+            step = 5;
+        }
+        break;
+    case 5:
+        if (done) {
+            sendAT("+SMCONN", CELL_MQTT_TIMEOUT);
+            step = 6;
+        }
+        break;
+    case 6:
+        if (done) {
+            subscribed = 0;
+            mqttLost = false;
+            step = 7;
+        }
+        break;
+    }
+
+    if (step == 7 && atState != AT_PENDING) {
+        if (subscribed < subscriptionCount) {
+            sendAT("+SMSUB=\"" + subscriptions[subscribed++] + "\",1");
+            return;
+        }
+        mqttConnected = true;
+        connectionStartTime = now;
+        retryCount = 0;
+        Serial.println("MQTT connected");
+        enterState(CELL_CONNECTED, now);
+        nextPoll = now + CELL_HEALTH_INTERVAL;
+    }
+}
+
+void EdgeCellular::runConnected(AtResult r, unsigned long now) {
+    if (bearerLost) {
+        fail("bearer lost", CELL_ATTACH, now);
+        return;
+    }
+    if (mqttLost) {
+        fail("MQTT session lost", CELL_ATTACH, now);
+        return;
+    }
+    if (!networkConnected) {
+        fail("network lost", CELL_REGISTER, now);
+        return;
+    }
+
+    // Result of the last publish
+    if (publishing && r != AT_PENDING && r != AT_IDLE) {
+        publishing = false;
+        if (r == AT_OK) {
+            OutMessage& m = outbox[outHead];
+            if (m.traced && publishedCallback) {
+                m.trace.ackedAt = now;
+                publishedCallback(m.trace);
+            }
+            m.topic = "";
+            m.payload = "";
+            outHead = (outHead + 1) % CELL_OUTBOX_SIZE;
+            outCount--;
+            messagesPublished++;
+            lastMessageTime = now;
+        } else {
+            // Keep the message and find out whether the session is still there
+            nextPoll = now;
+        }
+    }
+
+    // Signal, registration, operator and session state share one command line
+    if ((long)(now - nextPoll) >= 0 && !healthPending) {
+        nextPoll = now + CELL_HEALTH_INTERVAL;
+        healthPending = true;
+        healthRegistered = 0;
+        at.send("+CSQ", CELL_AT_TIMEOUT, onSignal, this, AT_BATCH);
+        at.send("+CEREG?", CELL_AT_TIMEOUT, onRegistration, this, AT_BATCH);
+        at.send("+CREG?", CELL_AT_TIMEOUT, onRegistration, this, AT_BATCH);
+        at.send("+COPS?", CELL_AT_TIMEOUT, onOperator, this, AT_BATCH);
+        at.send("+SMSTATE?", CELL_AT_TIMEOUT, onSessionState, this, AT_BATCH);
+    }
+
+    runNetworkTime(now);
+
+    if (atState == AT_PENDING) return;
+
+    // Subscriptions added while connected
+    if (subscribed < subscriptionCount) {
+        sendAT("+SMSUB=\"" + subscriptions[subscribed++] + "\",1");
+        return;
+    }
+
+    if (outCount) {
+        OutMessage& m = outbox[outHead];
+        if (sendAT("+SMPUB=\"" + m.topic + "\"," + String(m.payload.length()) + ",1," +
+                   (m.retain ? "1" : "0"), 10000, m.payload.c_str(), m.payload.length())) {
+            publishing = true;
+            m.trace.sentAt = now;
+        }
+    }
+}
+
+void EdgeCellular::runNetworkTime(unsigned long now) {
+    if (!timeCallback) return;
+
+    // The result arrives later as +CNTP: <code>
+    if ((ntpSyncedAt == 0 || now - ntpSyncedAt >= CELL_NTP_INTERVAL) && (long)(now - ntpRetryAt) >= 0 &&
+        at.pending() + 2 <= AT_QUEUE_SIZE) {
+        at.send("+CNTP=\"" CELL_NTP_SERVER "\",0", CELL_AT_TIMEOUT, nullptr, nullptr);
+        at.send("+CNTP", CELL_AT_TIMEOUT, nullptr, nullptr);
+        ntpRetryAt = now + CELL_NTP_RETRY;
+    }
+
+    // Sent at once rather than on the next poll, so sentAt is when it left
+    if (ntpSyncedAt && !timeQueryPending && (long)(now - timeQueryAt) >= 0 && at.idle() &&
+        at.send("+CCLK?", CELL_AT_TIMEOUT, onClock, this)) {
+        timeQueryPending = true;
+        timeQuerySentAt = now;
+        at.poll();
+    }
+}
+
+bool EdgeCellular::sendAT(const String& command, unsigned long timeout, const char* data, size_t len) {
+    if (!serialAT || atState == AT_PENDING) return false;
+
+    const bool queued = data ?
+        at.sendData(command.c_str(), (const uint8_t*)data, len, timeout, onCommandDone, this) :
+        at.send(command.c_str(), timeout, onCommandDone, this);
+    if (!queued) return false;
+
+    atReply = "";
+    atState = AT_PENDING;
+    return true;
+}
+
+void EdgeCellular::onCommandDone(void* context, AtResult result, const char* reply) {
+    EdgeCellular* self = (EdgeCellular*)context;
+    self->atReply = reply;
+    self->atState = result;
+}
+
+AtResult EdgeCellular::pollAT() {
+    at.poll();
+
+    // A result is reported once, then the state machine may send again
+    const AtResult r = atState;
+    if (r != AT_PENDING) {
+        atState = AT_IDLE;
+    }
+    return r;
+}
+
+void EdgeCellular::onSignal(void* context, AtResult result, const char* reply) {
+    EdgeCellular* self = (EdgeCellular*)context;
+    if (result == AT_TIMEOUT) {
+        self->modemSilent = true;
+    } else if (result == AT_OK) {
+        // +CSQ: <rssi>,<ber>
+        self->signalQuality = atoi(reply + 6);
+    }
+}
+
+void EdgeCellular::onRegistration(void* context, AtResult result, const char* reply) {
+    EdgeCellular* self = (EdgeCellular*)context;
+    const int stat = (result == AT_OK) ? registrationStatus(reply) : -1;
+    if (stat == 1 || stat == 5) {
+        self->healthRegistered++;
+    }
+}
+
+void EdgeCellular::onOperator(void* context, AtResult result, const char* reply) {
+    EdgeCellular* self = (EdgeCellular*)context;
+    // +COPS: 0,0,"Operator",7
+    const char* name = (result == AT_OK) ? strchr(reply, '"') : nullptr;
+    const char* end = name ? strchr(name + 1, '"') : nullptr;
+    if (end) {
+        self->operatorName = "";
+        self->operatorName.concat(name + 1, end - name - 1);
+    }
+}
+
+void EdgeCellular::onSessionState(void* context, AtResult result, const char* reply) {
+    EdgeCellular* self = (EdgeCellular*)context;
+    self->healthPending = false;
+    if (result != AT_OK) return;
+    if (!strncmp(reply, "+SMSTATE: 0", 11)) {
+        self->mqttLost = true;
+    }
+    // Registered on neither LTE nor 2G
+    if (self->healthRegistered == 0) {
+        self->networkConnected = false;
+    }
+}
+
+// Days since 1970-01-01 of a proleptic Gregorian date
+static long daysFromCivil(int year, int month, int day) {
+    year -= month <= 2;
+    const long era = (year >= 0 ? year : year - 399) / 400;
+    const long yearOfEra = year - era * 400;
+    const long dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const long dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+void EdgeCellular::onClock(void* context, AtResult result, const char* reply) {
+    EdgeCellular* self = (EdgeCellular*)context;
+    const unsigned long receivedAt = millis();
+    self->timeQueryPending = false;
+    if (result != AT_OK) return;
+
+    // +CCLK: "yy/MM/dd,hh:mm:ss+zz", zz in quarter hours east of UTC
+    int year, month, day, hour, minute, second, zone;
+    if (sscanf(reply, "+CCLK: \"%d/%d/%d,%d:%d:%d%d", &year, &month, &day,
+               &hour, &minute, &second, &zone) != 7 || year < 24 || year > 79) {
+        return;
+    }
+    const long seconds = daysFromCivil(2000 + year, month, day) * 86400L +
+                         hour * 3600L + minute * 60L + second - zone * 900L;
+    self->timeCallback((uint32_t)seconds, self->timeQuerySentAt, receivedAt);
+}
+
+void EdgeCellular::onNtpUrc(void* context, const char* line) {
+    EdgeCellular* self = (EdgeCellular*)context;
+    // +CNTP: 1 is success, other codes are errors
+    if (atoi(line + 7) == 1) {
+        self->ntpSyncedAt = millis() | 1;
+        self->timeQueryAt = millis();
+    }
+}
+
+void EdgeCellular::onMessageUrc(void* context, const char* line) {
+    EdgeCellular* self = (EdgeCellular*)context;
+    // "topic","payload" - the payload is not escaped, so it ends at the last quote
+    const char* urc = line + 8;
+    if (*urc != '"') return;
+    const char* topicEnd = strstr(urc + 1, "\",\"");
+    if (!topicEnd) return;
+    const char* payload = topicEnd + 3;
+    size_t payloadLen = strlen(payload);
+    if (payloadLen && payload[payloadLen - 1] == '"') {
+        payloadLen--;
+    }
+
+    self->messagesReceived++;
+    self->lastMessageTime = millis();
+    if (self->messageCallback) {
+        self->messageCallback(urc + 1, topicEnd - urc - 1, (const uint8_t*)payload, payloadLen);
+    }
+}
+
+void EdgeCellular::onSessionLostUrc(void* context, const char* line) {
+    ((EdgeCellular*)context)->mqttLost = true;
+}
+
+void EdgeCellular::onBearerLostUrc(void* context, const char* line) {
+    ((EdgeCellular*)context)->bearerLost = true;
+}
+
+void EdgeCellular::onPowerDownUrc(void* context, const char* line) {
+    ((EdgeCellular*)context)->modemDown = true;
+}
+
+bool EdgeCellular::publish(const String& topic, const String& message, bool retain,
+                           const TraceContext* trace) {
+    if (!mqttConnected || outCount >= CELL_OUTBOX_SIZE || message.length() > AT_LINE_BUFFER - 64) {
+        return false;
+    }
+
+    OutMessage& m = outbox[(outHead + outCount) % CELL_OUTBOX_SIZE];
+    m.topic = topic;
+    m.payload = message;
+    m.retain = retain;
+    m.traced = trace != nullptr;
+    if (trace) {
+        m.trace = *trace;
+        m.trace.queuedAt = millis();
+    }
+    outCount++;
+    return true;
+}
+
+bool EdgeCellular::subscribe(const String& topic) {
+    for (uint8_t i = 0; i < subscriptionCount; i++) {
+        if (subscriptions[i] == topic) return true;
+    }
+    if (subscriptionCount >= CELL_MAX_SUBSCRIPTIONS) return false;
+    // Sent by loop() once connected, and again after every reconnect
+    subscriptions[subscriptionCount++] = topic;
+    return true;
+}
+
+bool EdgeCellular::unsubscribe(const String& topic) {
+    for (uint8_t i = 0; i < subscriptionCount; i++) {
+        if (subscriptions[i] == topic) {
+            for (uint8_t j = i + 1; j < subscriptionCount; j++) {
+                subscriptions[j - 1] = subscriptions[j];
+            }
+            subscriptionCount--;
+            if (subscribed > i) subscribed--;
+            if (mqttConnected) {
+                at.send(("+SMUNSUB=\"" + topic + "\"").c_str(), CELL_AT_TIMEOUT, nullptr, nullptr);
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+void EdgeCellular::setMessageCallback(MessageCallback callback) {
+    messageCallback = callback;
+}
+
+void EdgeCellular::setPublishedCallback(PublishedCallback callback) {
+    publishedCallback = callback;
+}
+
+void EdgeCellular::setTimeCallback(NetworkTimeCallback callback) {
+    timeCallback = callback;
+}
+
+bool EdgeCellular::publishSensorData(const String& nodeData) {
+    return publish(TOPIC_DATA, nodeData);
+}
+
+bool EdgeCellular::publishStatus() {
+    return publish(TOPIC_STATUS, createStatusJson());
+}
+
+bool EdgeCellular::publishAlert(const String& alertType, const String& message) {
+    DynamicJsonDocument doc(256);
+    doc["deviceId"] = deviceId;
+    doc["type"] = alertType;
+    doc["message"] = message;
+    doc["timestamp"] = millis();
+
+    String payload;
+    serializeJson(doc, payload);
+    return publish(TOPIC_ALERT, payload);
+}
+
+bool EdgeCellular::publishHeartbeat() {
+    DynamicJsonDocument doc(128);
+    doc["deviceId"] = deviceId;
+    doc["uptime"] = millis();
+    doc["csq"] = signalQuality;
+
+    String payload;
+    serializeJson(doc, payload);
+    return publish(TOPIC_HEARTBEAT, payload);
+}
+
+String EdgeCellular::getNetworkInfo() {
+    return operatorName + " CSQ " + String(signalQuality);
+}
+
+String EdgeCellular::getSignalQuality() {
+    return String(signalQuality);
+}
+
+int EdgeCellular::getSignalStrength() {
+    // CSQ 0..31 maps to -113..-51 dBm, 99 is unknown
+    return (signalQuality >= 0 && signalQuality <= 31) ? -113 + 2 * signalQuality : 0;
+}
+
+String EdgeCellular::getIMEI() {
+    return imei;
+}
+
+String EdgeCellular::getIMSI() {
+    return imsi;
+}
+
+String EdgeCellular::getOperator() {
+    return operatorName;
+}
+
+unsigned long EdgeCellular::getTotalConnectedTime() {
+    if (state == CELL_CONNECTED) {
+        return totalConnectedTime + (millis() - connectionStartTime);
+    }
+    return totalConnectedTime;
+}
+
+void EdgeCellular::updateConnectionTime(unsigned long now) {
+    if (mqttConnected) {
+        totalConnectedTime += now - connectionStartTime;
+        connectionStartTime = now;
+    }
+}
+
+bool EdgeCellular::powerOn() {
+    if (!initialized) return false;
+    enterState(CELL_POWER_ON, millis());
+    return true;
+}
+
+bool EdgeCellular::powerOff() {
+    if (!serialAT) return false;
+    updateConnectionTime(millis());
+    at.clear();
+    atState = AT_IDLE;
+    healthPending = false;
+    sendAT("+CPOWD=1");
+    networkConnected = false;
+    gprsConnected = false;
+    mqttConnected = false;
+    enterState(CELL_OFF, millis());
+    return true;
+}
+
+bool EdgeCellular::restart() {
+    if (!initialized) return false;
+    updateConnectionTime(millis());
+    mqttConnected = false;
+    gprsConnected = false;
+    networkConnected = false;
+    resetPending = true;
+    enterState(CELL_POWER_ON, millis());
+    return true;
+}
+
+bool EdgeCellular::sleep() {
+    // Waking from CSCLK sleep needs the DTR line, which this board does not route
+    return false;
+}
+
+bool EdgeCellular::wakeup() {
+    return false;
+}
+
+void EdgeCellular::printStatus() {
+    Serial.println("=== Edge Cellular Status ===");
+    Serial.printf("State: %s\n", getStateName());
+    Serial.printf("Network: %s, GPRS: %s, MQTT: %s\n",
+                  networkConnected ? "yes" : "no",
+                  gprsConnected ? "yes" : "no",
+                  mqttConnected ? "yes" : "no");
+    Serial.println("Operator: " + operatorName);
+    Serial.printf("Signal: CSQ %d (%d dBm)\n", signalQuality, getSignalStrength());
+    Serial.printf("Messages published: %lu, received: %lu\n", messagesPublished, messagesReceived);
+    Serial.printf("Connected time: %lu s, retries: %u\n", getTotalConnectedTime() / 1000, retryCount);
+}
+
+String EdgeCellular::getStatusString() {
+    return String(getStateName()) + " CSQ:" + String(signalQuality) +
+           " Pub:" + String(messagesPublished) + " Rx:" + String(messagesReceived);
+}
+
+bool EdgeCellular::testConnection() {
+    return state == CELL_CONNECTED;
+}
+
+String EdgeCellular::createStatusJson() {
+    DynamicJsonDocument doc(256);
+    doc["deviceId"] = deviceId;
+    doc["state"] = getStateName();
+    doc["operator"] = operatorName;
+    doc["csq"] = signalQuality;
+    doc["published"] = messagesPublished;
+    doc["received"] = messagesReceived;
+    doc["connectedTime"] = getTotalConnectedTime();
+    doc["retries"] = retryCount;
+
+    String payload;
+    serializeJson(doc, payload);
+    return payload;
+}
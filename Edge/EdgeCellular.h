@@ -2,110 +2,220 @@
 #define EDGE_CELLULAR_H
 
 #include <Arduino.h>
-#include <TinyGsmClient.h>
-#include <PubSubClient.h>
 #include <ArduinoJson.h>
 #include "edge_board_def.h"
+#include "EdgeAT.h"
+
+// Incoming message, topic and payload point into the modem's line buffer and
+// are valid only during the call. Neither is NUL-terminated.
+typedef void (*MessageCallback)(const char* topic, size_t topicLength, const uint8_t* payload, size_t length);
+
+// Whole-second UTC read from the modem's NTP-set clock by a command sent at
+// sentAt and answered at receivedAt (millis())
+typedef void (*NetworkTimeCallback)(uint32_t utcSeconds, unsigned long sentAt, unsigned long receivedAt);
+
+// A traced message the broker acknowledged, with every stage's time filled in
+typedef void (*PublishedCallback)(const TraceContext& trace);
+
+// Link states, loop() moves between them without blocking
+enum CellularState {
+    CELL_OFF,
+    CELL_POWER_ON,      // Probe the modem, pulse PWRKEY if it is silent
+    CELL_REGISTER,      // Poll network registration
+    CELL_ATTACH,        // Bring up the packet data bearer
+    CELL_MQTT_CONNECT,  // Configure and connect the modem's MQTT client
+    CELL_CONNECTED,
+    CELL_BACKOFF        // Wait before retrying the state that failed
+};
 
 class EdgeCellular {
 private:
-    TinyGsm* modem;
-    TinyGsmClient* client;
-    PubSubClient* mqtt;
+    struct OutMessage {
+        String topic;
+        String payload;
+        bool retain;
+        bool traced;
+        TraceContext trace;
+    };
+
     HardwareSerial* serialAT;
-    
+
     bool initialized;
     bool networkConnected;
     bool gprsConnected;
     bool mqttConnected;
-    
+
     String apnName;
     String apnUser;
     String apnPass;
     String mqttBroker;
     int mqttPort;
     String deviceId;
-    
+
+    // State machine
+    CellularState state;
+    CellularState resumeState;
+    unsigned long stateStart;
+    unsigned long nextPoll;
+    unsigned long backoffUntil;
+    uint8_t step;
+    bool resetPending;
+
+    EdgeAT at;
+
+    // The state machine's own command, its result is read once by loop()
+    AtResult atState;
+    String atReply;
+
+    // Raised by URCs and status polls, handled by the state machine
+    bool mqttLost;
+    bool bearerLost;
+    bool modemDown;
+    bool modemSilent;
+    bool healthPending;
+    uint8_t healthRegistered;
+
+    OutMessage outbox[CELL_OUTBOX_SIZE];
+    uint8_t outHead;
+    uint8_t outCount;
+    bool publishing;
+
+    String subscriptions[CELL_MAX_SUBSCRIPTIONS];
+    uint8_t subscriptionCount;
+    uint8_t subscribed;     // Subscriptions sent to the modem this session
+
+    // Cached modem information, refreshed by the state machine
+    String imei;
+    String imsi;
+    String operatorName;
+    int signalQuality;
+
     // Statistics
     unsigned long messagesPublished;
     unsigned long messagesReceived;
     unsigned long lastMessageTime;
     unsigned long connectionStartTime;
     unsigned long totalConnectedTime;
-    
+
     // Callback function pointer
-    void (*messageCallback)(const String& topic, const String& message);
-    
+    MessageCallback messageCallback;
+    PublishedCallback publishedCallback;
+
+    // Network time
+    NetworkTimeCallback timeCallback;
+    unsigned long ntpSyncedAt;      // 0 until the modem's clock is set this session
+    unsigned long ntpRetryAt;
+    unsigned long timeQueryAt;
+    unsigned long timeQuerySentAt;
+    bool timeQueryPending;
+
     // Connection retry
     uint8_t retryCount;
     unsigned long lastRetryTime;
-    
+
 public:
     EdgeCellular(const String& deviceId = "EDGE_001");
     ~EdgeCellular();
-    
-    // Initialization
+
+    // Initialization, returns at once: loop() powers the modem up and connects
     bool begin(const String& apn, const String& user = "", const String& pass = "");
     void end();
     bool isInitialized() { return initialized; }
-    
-    // Network management
+
+    // Network management, these start the state machine rather than wait for it
     bool connectNetwork();
     bool connectGPRS();
     bool disconnectGPRS();
     bool isNetworkConnected() { return networkConnected; }
     bool isGPRSConnected() { return gprsConnected; }
-    
+
     // MQTT management
     bool connectMQTT(const String& broker, int port = 1883);
     bool disconnectMQTT();
     bool isMQTTConnected() { return mqttConnected; }
     void loop(); // Call this in main loop
-    
-    // Message handling
-    bool publish(const String& topic, const String& message, bool retain = false);
+
+    // Link state
+    CellularState getState() { return state; }
+    const char* getStateName();
+
+    // Message handling, publish() queues the message for loop() to send. A
+    // trace given with it is completed as the message goes out and handed
+    // to the published callback once the broker has it.
+    bool publish(const String& topic, const String& message, bool retain = false,
+                 const TraceContext* trace = nullptr);
     bool subscribe(const String& topic);
     bool unsubscribe(const String& topic);
-    void setMessageCallback(void (*callback)(const String& topic, const String& message));
-    
+    void setMessageCallback(MessageCallback callback);
+    void setPublishedCallback(PublishedCallback callback);
+
+    // Network time: the modem's clock is set from NTP once connected, then
+    // read whenever scheduleTimeQuery() asks
+    void setTimeCallback(NetworkTimeCallback callback);
+    void scheduleTimeQuery(unsigned long at) { timeQueryAt = at; }
+
     // Data publishing helpers
     bool publishSensorData(const String& nodeData);
     bool publishStatus();
     bool publishAlert(const String& alertType, const String& message);
     bool publishHeartbeat();
-    
-    // System information
+
+    // System information, as last read from the modem
     String getNetworkInfo();
     String getSignalQuality();
     int getSignalStrength();
     String getIMEI();
     String getIMSI();
     String getOperator();
-    
+
     // Statistics
     unsigned long getMessagesPublished() { return messagesPublished; }
     unsigned long getMessagesReceived() { return messagesReceived; }
     unsigned long getLastMessageTime() { return lastMessageTime; }
-    unsigned long getTotalConnectedTime() { return totalConnectedTime; }
-    
+    unsigned long getTotalConnectedTime();
+    uint8_t getRetryCount() { return retryCount; }
+
     // Power management
     bool powerOn();
     bool powerOff();
     bool restart();
     bool sleep();
     bool wakeup();
-    
+
     // Utility
     void printStatus();
     String getStatusString();
     bool testConnection();
-    
+
 private:
-    void setupModem();
-    void onMqttMessage(char* topic, byte* payload, unsigned int length);
-    bool waitForNetwork(unsigned long timeout = 60000);
-    bool reconnectMQTT();
-    void updateConnectionTime();
+    void enterState(CellularState next, unsigned long now);
+    void fail(const char* reason, CellularState resume, unsigned long now);
+    void runPowerOn(AtResult r, unsigned long now);
+    void runRegister(AtResult r, unsigned long now);
+    void runAttach(AtResult r, unsigned long now);
+    void runMqttConnect(AtResult r, unsigned long now);
+    void runConnected(AtResult r, unsigned long now);
+
+    bool sendAT(const String& command, unsigned long timeout = CELL_AT_TIMEOUT,
+                const char* data = nullptr, size_t len = 0);
+    AtResult pollAT();
+    static int registrationStatus(const String& reply);
+
+    // EdgeAT callbacks
+    static void onCommandDone(void* context, AtResult result, const char* reply);
+    static void onSignal(void* context, AtResult result, const char* reply);
+    static void onRegistration(void* context, AtResult result, const char* reply);
+    static void onOperator(void* context, AtResult result, const char* reply);
+    static void onSessionState(void* context, AtResult result, const char* reply);
+    static void onClock(void* context, AtResult result, const char* reply);
+    static void onNtpUrc(void* context, const char* line);
+    static void onMessageUrc(void* context, const char* line);
+    static void onSessionLostUrc(void* context, const char* line);
+    static void onBearerLostUrc(void* context, const char* line);
+    static void onPowerDownUrc(void* context, const char* line);
+
+    void updateConnectionTime(unsigned long now);
+    void runNetworkTime(unsigned long now);
     String createStatusJson();
 };
 
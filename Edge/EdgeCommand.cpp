@@ -0,0 +1,226 @@
+#include "EdgeCommand.h"
+
+// Command names accepted in the JSON "type" field
+struct CommandName {
+    const char* name;
+    uint8_t length;
+    uint8_t type;
+};
+
+static const CommandName commandNames[] = {
+    { "valve", 5, CMD_VALVE },
+    { "pump",  4, CMD_PUMP },
+};
+
+enum CommandField {
+    FIELD_TYPE,
+    FIELD_NODE,
+    FIELD_TARGET,
+    FIELD_STATE
+};
+
+struct FieldName {
+    const char* name;
+    uint8_t length;
+    uint8_t field;
+};
+
+static const FieldName fieldNames[] = {
+    { "type",   4, FIELD_TYPE },
+    { "nodeId", 6, FIELD_NODE },
+    { "valve",  5, FIELD_TARGET },
+    { "state",  5, FIELD_STATE },
+};
+
+// Read position in a JSON payload
+struct JsonCursor {
+    const uint8_t* p;
+    const uint8_t* end;
+};
+
+static uint8_t crc8(const uint8_t* data, size_t length) {
+    uint8_t crc = 0;
+    while (length--) {
+        crc ^= *data++;
+        for (int i = 0; i < 8; i++) {
+            crc = crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+static int hexDigit(uint8_t c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static bool isJsonSpace(uint8_t c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static void skipSpace(JsonCursor& c) {
+    while (c.p < c.end && isJsonSpace(*c.p)) c.p++;
+}
+
+// Reads a string, the span excludes the quotes and escapes are left as they are
+static bool readString(JsonCursor& c, const uint8_t*& text, size_t& length) {
+    if (c.p >= c.end || *c.p != '"') return false;
+    text = ++c.p;
+    while (c.p < c.end && *c.p != '"') {
+        if (*c.p == '\\') c.p++;
+        c.p++;
+    }
+    if (c.p >= c.end) return false;
+    length = c.p - text;
+    c.p++;
+    return true;
+}
+
+// Moves past one value, nested objects and arrays included, and stops on
+// the ',' or '}' that follows it
+static bool skipValue(JsonCursor& c) {
+    int depth = 0;
+    while (c.p < c.end) {
+        uint8_t ch = *c.p;
+        if (ch == '"') {
+            const uint8_t* text;
+            size_t length;
+            if (!readString(c, text, length)) return false;
+            continue;
+        }
+        if (depth == 0 && (ch == ',' || ch == '}')) return true;
+        if (ch == '{' || ch == '[') depth++;
+        else if ((ch == '}' || ch == ']') && --depth < 0) return false;
+        c.p++;
+    }
+    return false;
+}
+
+// Integer or boolean, booleans read as 0 and 1
+static bool readInteger(const uint8_t* text, size_t length, long& value) {
+    if (length == 4 && memcmp(text, "true", 4) == 0) { value = 1; return true; }
+    if (length == 5 && memcmp(text, "false", 5) == 0) { value = 0; return true; }
+
+    size_t i = 0;
+    bool negative = length && text[0] == '-';
+    if (negative) i++;
+    if (i == length) return false;
+    value = 0;
+    for (; i < length; i++) {
+        if (text[i] < '0' || text[i] > '9' || value > 100000) return false;
+        value = value * 10 + (text[i] - '0');
+    }
+    if (negative) value = -value;
+    return true;
+}
+
+static bool setField(EdgeCommand& cmd, const uint8_t* key, size_t keyLength,
+                     const uint8_t* value, size_t valueLength, bool quoted, bool& haveType) {
+    for (size_t f = 0; f < sizeof(fieldNames) / sizeof(fieldNames[0]); f++) {
+        const FieldName& field = fieldNames[f];
+        if (keyLength != field.length || memcmp(key, field.name, keyLength) != 0) continue;
+
+        if (field.field == FIELD_TYPE) {
+            if (!quoted) return false;
+            for (size_t n = 0; n < sizeof(commandNames) / sizeof(commandNames[0]); n++) {
+                if (valueLength == commandNames[n].length &&
+                    memcmp(value, commandNames[n].name, valueLength) == 0) {
+                    cmd.commandType = commandNames[n].type;
+                    haveType = true;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        long number;
+        if (quoted || !readInteger(value, valueLength, number) || number < 0 || number > 255) {
+            return false;
+        }
+        if (field.field == FIELD_NODE) cmd.nodeId = number;
+        else if (field.field == FIELD_TARGET) cmd.targetDevice = number;
+        else cmd.action = number != 0;
+        return true;
+    }
+    return true;    // Fields of other commands are ignored
+}
+
+static bool parseJson(const uint8_t* payload, size_t length, EdgeCommand& cmd) {
+    JsonCursor c = { payload, payload + length };
+    bool haveType = false;
+
+    skipSpace(c);
+    if (c.p >= c.end || *c.p++ != '{') return false;
+    skipSpace(c);
+    if (c.p < c.end && *c.p == '}') return false;
+
+    while (true) {
+        const uint8_t* key;
+        size_t keyLength;
+        skipSpace(c);
+        if (!readString(c, key, keyLength)) return false;
+        skipSpace(c);
+        if (c.p >= c.end || *c.p++ != ':') return false;
+        skipSpace(c);
+
+        const uint8_t* value = c.p;
+        if (!skipValue(c)) return false;
+        const uint8_t* valueEnd = c.p;
+        while (valueEnd > value && isJsonSpace(valueEnd[-1])) valueEnd--;
+        bool quoted = valueEnd - value >= 2 && value[0] == '"' && valueEnd[-1] == '"';
+        if (quoted) {
+            value++;
+            valueEnd--;
+        }
+        if (!setField(cmd, key, keyLength, value, valueEnd - value, quoted, haveType)) return false;
+
+        if (*c.p++ == '}') break;
+    }
+    return haveType;
+}
+
+static bool parseFrame(const uint8_t* frame, EdgeCommand& cmd) {
+    if (frame[0] != CMD_FRAME_MAGIC || frame[4] > 1) return false;
+    if (crc8(frame, CMD_FRAME_SIZE - 1) != frame[CMD_FRAME_SIZE - 1]) return false;
+
+    cmd.commandType = frame[1];
+    cmd.nodeId = frame[2];
+    cmd.targetDevice = frame[3];
+    cmd.action = frame[4] != 0;
+    return true;
+}
+
+bool parseCommand(const uint8_t* payload, size_t length, EdgeCommand& cmd) {
+    cmd.nodeId = 0;
+    cmd.commandType = 0;
+    cmd.targetDevice = 0;
+    cmd.action = false;
+    cmd.timestamp = millis();
+
+    if (length == CMD_FRAME_SIZE && payload[0] == CMD_FRAME_MAGIC) {
+        return parseFrame(payload, cmd);
+    }
+    if (length == CMD_FRAME_SIZE * 2 && hexDigit(payload[0]) >= 0) {
+        uint8_t frame[CMD_FRAME_SIZE];
+        for (size_t i = 0; i < CMD_FRAME_SIZE; i++) {
+            int high = hexDigit(payload[2 * i]);
+            int low = hexDigit(payload[2 * i + 1]);
+            if (high < 0 || low < 0) return false;
+            frame[i] = (high << 4) | low;
+        }
+        return parseFrame(frame, cmd);
+    }
+    return parseJson(payload, length, cmd);
+}
+
+size_t encodeCommandFrame(const EdgeCommand& cmd, uint8_t* frame) {
+    frame[0] = CMD_FRAME_MAGIC;
+    frame[1] = cmd.commandType;
+    frame[2] = cmd.nodeId;
+    frame[3] = cmd.targetDevice;
+    frame[4] = cmd.action ? 1 : 0;
+    frame[5] = crc8(frame, CMD_FRAME_SIZE - 1);
+    return CMD_FRAME_SIZE;
+}
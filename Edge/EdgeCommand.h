@@ -0,0 +1,34 @@
+#ifndef EDGE_COMMAND_H
+#define EDGE_COMMAND_H
+
+#include <Arduino.h>
+#include "edge_board_def.h"
+
+// Command types, as in EdgeCommand::commandType
+#define CMD_VALVE           0
+#define CMD_PUMP            1
+#define CMD_CONFIG          2
+
+// Binary command frame, sent raw or as 12 hex digits. The modem hands MQTT
+// payloads over as one text line, so on the cellular link the frame must be
+// hex: a raw frame may hold a quote or a line break.
+//
+//   0   CMD_FRAME_MAGIC
+//   1   command type
+//   2   node ID, 0 for the Edge itself
+//   3   target device (valve number)
+//   4   action, 0 off, 1 on
+//   5   CRC-8 (poly 0x07) of bytes 0..4
+#define CMD_FRAME_MAGIC     0xEC
+#define CMD_FRAME_SIZE      6
+
+// Reads one command from an MQTT payload, a flat JSON object such as
+// {"type":"valve","nodeId":3,"valve":2,"state":true} or a binary frame.
+// The payload is read in place, nothing is copied or allocated.
+// Returns false if the payload is malformed or names no known command.
+bool parseCommand(const uint8_t* payload, size_t length, EdgeCommand& cmd);
+
+// Builds a binary frame, returns its size
+size_t encodeCommandFrame(const EdgeCommand& cmd, uint8_t* frame);
+
+#endif // EDGE_COMMAND_H
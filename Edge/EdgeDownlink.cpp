@@ -0,0 +1,102 @@
+#include "EdgeDownlink.h"
+
+EdgeDownlink::EdgeDownlink() {
+    send = nullptr;
+    context = nullptr;
+    memset(nodes, 0, sizeof(nodes));
+    memset(&stats, 0, sizeof(stats));
+}
+
+void EdgeDownlink::begin(DownlinkSend send, void* context) {
+    this->send = send;
+    this->context = context;
+}
+
+EdgeDownlink::NodeQueue* EdgeDownlink::findNode(uint8_t nodeId, bool create) {
+    NodeQueue* free = nullptr;
+    for (int i = 0; i < MAX_NODES; i++) {
+        if (nodes[i].count && nodes[i].nodeId == nodeId) return &nodes[i];
+        if (!nodes[i].count && !free) free = &nodes[i];
+    }
+    if (!create || !free) return nullptr;
+    free->nodeId = nodeId;
+    return free;
+}
+
+bool EdgeDownlink::queue(const EdgeCommand& cmd) {
+    NodeQueue* node = findNode(cmd.nodeId, true);
+    if (!node) {
+        stats.rejected++;
+        return false;
+    }
+
+    // Last command per target wins, it keeps the place of the one it replaces
+    for (uint8_t i = 0; i < node->count; i++) {
+        Entry& entry = node->entries[i];
+        if (entry.commandType == cmd.commandType && entry.targetDevice == cmd.targetDevice) {
+            entry.action = cmd.action;
+            entry.queuedAt = millis();
+            stats.queued++;
+            stats.coalesced++;
+            return true;
+        }
+    }
+
+    if (node->count == DOWNLINK_PER_NODE) {
+        stats.rejected++;
+        return false;
+    }
+    Entry& entry = node->entries[node->count++];
+    entry.commandType = cmd.commandType;
+    entry.targetDevice = cmd.targetDevice;
+    entry.action = cmd.action;
+    entry.queuedAt = millis();
+    stats.queued++;
+    return true;
+}
+
+bool EdgeDownlink::onUplink(uint8_t nodeId) {
+    NodeQueue* node = findNode(nodeId, false);
+    if (!node || !send) return false;
+
+    // At most "CMD,255,255,255,1" plus ";255,255,1" per further entry
+    char frame[20 + DOWNLINK_PER_NODE * 11];
+    int length = snprintf(frame, sizeof(frame), "CMD,%u", nodeId);
+    unsigned long now = millis();
+    for (uint8_t i = 0; i < node->count; i++) {
+        const Entry& entry = node->entries[i];
+        length += snprintf(frame + length, sizeof(frame) - length, "%c%u,%u,%u",
+                           i ? ';' : ',', entry.commandType, entry.targetDevice, entry.action ? 1 : 0);
+
+        unsigned long latency = now - entry.queuedAt;
+        stats.latencySum += latency;
+        if (latency > stats.latencyMax) stats.latencyMax = latency;
+    }
+
+    send(context, frame, length);
+    stats.frames++;
+    stats.delivered += node->count;
+    node->count = 0;
+    return true;
+}
+
+void EdgeDownlink::loop() {
+    unsigned long now = millis();
+    for (int n = 0; n < MAX_NODES; n++) {
+        NodeQueue& node = nodes[n];
+        uint8_t kept = 0;
+        for (uint8_t i = 0; i < node.count; i++) {
+            if (now - node.entries[i].queuedAt >= DOWNLINK_TTL) {
+                stats.expired++;
+                continue;
+            }
+            node.entries[kept++] = node.entries[i];
+        }
+        node.count = kept;
+    }
+}
+
+uint8_t EdgeDownlink::pending(uint8_t nodeId) {
+    NodeQueue* node = findNode(nodeId, false);
+    return node ? node->count : 0;
+}
@@ -0,0 +1,71 @@
+#ifndef EDGE_DOWNLINK_H
+#define EDGE_DOWNLINK_H
+
+#include <Arduino.h>
+#include "edge_board_def.h"
+
+// Transmits one frame to the Nodes
+typedef void (*DownlinkSend)(void* context, const char* frame, size_t length);
+
+struct DownlinkStats {
+    unsigned long queued;
+    unsigned long coalesced;    // Replaced by a newer command for the same target
+    unsigned long delivered;
+    unsigned long expired;      // The Node stayed silent for DOWNLINK_TTL
+    unsigned long rejected;     // Turned away with the queue full
+    unsigned long frames;
+    unsigned long latencySum;   // Queued to sent, ms
+    unsigned long latencyMax;
+};
+
+// Commands for Nodes wait here until the Node's next uplink: a Node sleeps
+// between uplinks and listens only briefly after it transmits. A newer
+// command for the same target replaces the queued one, and everything
+// pending for a Node goes out in one frame:
+//
+//   CMD,<node>,<type>,<target>,<action>[;<type>,<target>,<action>...]
+//
+// A single command is the same frame the Edge sent before queueing. The
+// Node reads it in applyCommandFrame(), valves numbered from 1.
+class EdgeDownlink {
+private:
+    struct Entry {
+        uint8_t commandType;
+        uint8_t targetDevice;
+        bool action;
+        unsigned long queuedAt;
+    };
+
+    struct NodeQueue {
+        uint8_t nodeId;
+        uint8_t count;
+        Entry entries[DOWNLINK_PER_NODE];
+    };
+
+    DownlinkSend send;
+    void* context;
+    NodeQueue nodes[MAX_NODES];
+    DownlinkStats stats;
+
+    NodeQueue* findNode(uint8_t nodeId, bool create);
+
+public:
+    EdgeDownlink();
+
+    void begin(DownlinkSend send, void* context = nullptr);
+
+    // Queue a command, false if the Node's queue is full
+    bool queue(const EdgeCommand& cmd);
+
+    // The Node just transmitted and its receiver is open, send what waits for it.
+    // Call this as soon as the uplink is received.
+    bool onUplink(uint8_t nodeId);
+
+    // Drops commands older than DOWNLINK_TTL, call this in the main loop
+    void loop();
+
+    uint8_t pending(uint8_t nodeId);
+    const DownlinkStats& getStats() { return stats; }
+};
+
+#endif // EDGE_DOWNLINK_H
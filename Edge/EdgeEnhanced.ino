@@ -14,32 +14,66 @@
 #include <SPI.h>
 #include <LoRa.h>
 #include <WiFi.h>
-#include <TinyGsmClient.h>
-#include <PubSubClient.h>
 #include <ArduinoJson.h>
 #include <SD.h>
+#include <rom/crc.h>
 #include "edge_board_def.h"
+#include "EdgeCellular.h"
+#include "EdgeCommand.h"
+#include "EdgeDownlink.h"
+#include "EdgeTime.h"
+#include "EdgeLatency.h"
 
 // Initialize OLED display
 OLED_CLASS_OBJ display(OLED_ADDRESS, OLED_SDA, OLED_SCL);
 
-// Cellular modem and MQTT client
-#define SerialAT Serial1
-TinyGsm modem(SerialAT);
-TinyGsmClient client(modem);
-PubSubClient mqtt(client);
+// Cellular link and MQTT client, driven from loop() without blocking
+EdgeCellular cellular("EDGE_001");
+
+// Commands for Nodes, sent when each Node next listens
+EdgeDownlink downlink;
+
+// UTC from the modem's NTP-set clock, passed on to the Nodes by beacons
+EdgeClock systemClock;
+
+// Where readings spend their time on the way to the broker, reported with the heartbeat
+EdgeLatency latency;
 
 // LoRa SPI configuration
 SPIClass loraRadio(VSPI);
 
 // Global variables
 NodeData receivedData[MAX_NODES];
+unsigned long beaconSentAt[MAX_NODES];
 uint8_t activeNodes = 0;
 unsigned long lastHeartbeat = 0;
 unsigned long lastDataReceived = 0;
 bool cellularConnected = false;
 bool loraInitialized = false;
 
+// Node settings managed from the cloud, replaced only as a whole
+SettingsTable nodeSettings = { { 5000, 10000, 30, 70, 30000, false }, 0 };
+
+// JSON names and short LoRa keys of the NodeSettings fields
+struct SettingField {
+    const char* name;
+    const char* key;
+    uint8_t offset;
+    uint8_t size;
+    uint32_t min;
+    uint32_t max;
+};
+
+const SettingField settingFields[] = {
+    { "sensorIntervalMs", "si", offsetof(NodeSettings, sensorIntervalMs), 4, 1000, 3600000 },
+    { "txIntervalMs",     "tx", offsetof(NodeSettings, txIntervalMs),     4, 1000, 3600000 },
+    { "moistureLow",      "lo", offsetof(NodeSettings, moistureLow),      2, 0, 100 },
+    { "moistureHigh",     "hi", offsetof(NodeSettings, moistureHigh),     2, 0, 100 },
+    { "valveDurationMs",  "vd", offsetof(NodeSettings, valveDurationMs),  4, 1000, 3600000 },
+    { "autoIrrigation",   "ai", offsetof(NodeSettings, autoIrrigation),   1, 0, 1 },
+};
+const uint8_t SETTING_FIELD_COUNT = sizeof(settingFields) / sizeof(settingFields[0]);
+
 // Function prototypes
 void initializeLoRa();
 void initializeCellular();
@@ -48,9 +82,20 @@ void initializeSD();
 void initializeRelays();
 void handleLoRaReceive();
 void handleMQTTMessages();
-void forwardDataToCloud();
-void processCloudCommand(const String& command);
+void forwardDataToCloud(const NodeData& latest);
+void routeMessage(const char* topic, size_t topicLength, const uint8_t* payload, size_t length);
+void processCloudCommand(const char* payload, size_t length);
+void handlePumpCommand(const EdgeCommand& cmd);
+void handleValveCommand(const EdgeCommand& cmd);
 void forwardCommandToNode(const EdgeCommand& cmd);
+void sendDownlinkFrame(void* context, const char* frame, size_t length);
+void onNetworkTime(uint32_t utcSeconds, unsigned long sentAt, unsigned long receivedAt);
+void onPublished(const TraceContext& trace);
+void sendTimeBeacon(uint8_t slot);
+uint64_t sampleTimeOf(const NodeData& data);
+void processCloudConfig(const char* payload, size_t length);
+void forwardSettingsToNodes(const SettingsTable& table, uint8_t defaultsMask, const uint8_t* nodeMasks, uint32_t etag);
+uint32_t settingsEtag(const SettingsTable& table);
 void updateDisplay();
 void logDataToSD(const NodeData& data);
 void sendHeartbeat();
@@ -60,6 +105,29 @@ NodeData parseNodeData(const String& data);
 void controlLocalPump(bool state);
 void controlLocalValve(uint8_t valve, bool state);
 
+// MQTT topics the Edge acts on, matched in place against the modem's line
+struct TopicRoute {
+    const char* topic;
+    uint8_t length;
+    void (*handler)(const char* payload, size_t length);
+};
+
+const TopicRoute topicRoutes[] = {
+    { MQTT_TOPIC_CMD,    sizeof(MQTT_TOPIC_CMD) - 1,    processCloudCommand },
+    { MQTT_TOPIC_CONFIG, sizeof(MQTT_TOPIC_CONFIG) - 1, processCloudConfig },
+};
+
+// Cloud command handlers by EdgeCommand::commandType
+struct CommandRoute {
+    uint8_t type;
+    void (*handler)(const EdgeCommand& cmd);
+};
+
+const CommandRoute commandRoutes[] = {
+    { CMD_VALVE, handleValveCommand },
+    { CMD_PUMP,  handlePumpCommand },
+};
+
 void setup() {
     Serial.begin(115200);
     while (!Serial);
@@ -76,7 +144,7 @@ void setup() {
     display.clear();
     display.drawString(0, 0, "Edge Device Ready");
     display.drawString(0, 16, "LoRa: " + String(loraInitialized ? "OK" : "FAIL"));
-    display.drawString(0, 32, "Cellular: " + String(cellularConnected ? "OK" : "FAIL"));
+    display.drawString(0, 32, "Cellular: starting");
     display.display();
     
     lastHeartbeat = millis();
@@ -91,6 +159,9 @@ void loop() {
     // Handle MQTT communication
     handleMQTTMessages();
     
+    // Expire commands for Nodes that went silent
+    downlink.loop();
+    
     // Send heartbeat periodically
     if (millis() - lastHeartbeat > HEARTBEAT_INTERVAL) {
         sendHeartbeat();
@@ -128,6 +199,9 @@ void initializeLoRa() {
     LoRa.setSyncWord(0x12);       // Sync word for private network
     LoRa.enableCrc();             // Enable CRC
     
+    downlink.begin(sendDownlinkFrame);
+    systemClock.setBeaconAirtime(loraAirtime(TIME_BEACON_SIZE, 12, 125E3, 5));
+    
     loraInitialized = true;
     Serial.println("LoRa initialized successfully");
     Serial.println("Operating as LoRa Receiver");
@@ -140,51 +214,15 @@ void initializeLoRa() {
 void initializeCellular() {
     Serial.println("Initializing SIM7000G...");
     
-    // Power on SIM7000G
-    pinMode(MODEM_PWRKEY, OUTPUT);
-    pinMode(MODEM_POWER_ON, OUTPUT);
-    digitalWrite(MODEM_POWER_ON, HIGH);
-    
-    // Initialize serial communication with modem
-    SerialAT.begin(115200, SERIAL_8N1, MODEM_RX, MODEM_TX);
-    delay(3000);
-    
-    // Restart modem
-    Serial.println("Restarting modem...");
-    modem.restart();
-    
-    // Wait for network registration
-    Serial.println("Waiting for network registration...");
-    while (!modem.waitForNetwork()) {
-        Serial.print(".");
-        delay(1000);
-    }
-    Serial.println("Network registered");
-    
-    // Connect to GPRS
-    Serial.println("Connecting to GPRS...");
-    if (!modem.gprsConnect(APN_NAME, APN_USER, APN_PASS)) {
-        Serial.println("GPRS connection failed");
-        cellularConnected = false;
-        return;
-    }
-    Serial.println("GPRS connected");
-    
-    // Configure MQTT
-    mqtt.setServer(MQTT_BROKER, MQTT_PORT);
-    mqtt.setCallback([](char* topic, byte* payload, unsigned int length) {
-        String message = "";
-        for (unsigned int i = 0; i < length; i++) {
-            message += (char)payload[i];
-        }
-        processCloudCommand(message);
-    });
-    
-    cellularConnected = true;
-    Serial.println("Cellular initialized successfully");
-    
-    // Turn on cellular status LED
-    digitalWrite(LED_CELLULAR_TX, HIGH);
+    // Power-up, registration, GPRS and MQTT all run from handleMQTTMessages()
+    cellular.begin(APN_NAME, APN_USER, APN_PASS);
+    cellular.connectMQTT(MQTT_BROKER, MQTT_PORT);
+    cellular.subscribe(MQTT_TOPIC_CMD);
+    cellular.subscribe(MQTT_TOPIC_STATUS);
+    cellular.subscribe(MQTT_TOPIC_CONFIG);
+    cellular.setMessageCallback(routeMessage);
+    cellular.setTimeCallback(onNetworkTime);
+    cellular.setPublishedCallback(onPublished);
 }
 
 void initializeDisplay() {
@@ -245,6 +283,8 @@ void initializeRelays() {
 void handleLoRaReceive() {
     int packetSize = LoRa.parsePacket();
     if (packetSize) {
+        unsigned long rxAt = millis();
+        
         // Blink LoRa RX LED
         digitalWrite(LED_LORA_RX, LOW);
         delay(50);
@@ -263,27 +303,36 @@ void handleLoRaReceive() {
         // Validate and parse data
         if (validateNodeData(receivedString)) {
             NodeData data = parseNodeData(receivedString);
+            data.timestamp = rxAt;
             
             // Store data
-            bool nodeFound = false;
+            int slot = -1;
             for (int i = 0; i < activeNodes; i++) {
                 if (receivedData[i].nodeId == data.nodeId) {
                     receivedData[i] = data;
-                    nodeFound = true;
+                    slot = i;
                     break;
                 }
             }
             
-            if (!nodeFound && activeNodes < MAX_NODES) {
+            if (slot < 0 && activeNodes < MAX_NODES) {
+                slot = activeNodes;
                 receivedData[activeNodes] = data;
+                beaconSentAt[activeNodes] = 0;
                 activeNodes++;
             }
             
+            // The Node listens right after its uplink, answer before anything else.
+            // Commands take the window, a time beacon waits for the next one.
+            if (!downlink.onUplink(data.nodeId) && slot >= 0) {
+                sendTimeBeacon(slot);
+            }
+            
             // Log to SD card
             logDataToSD(data);
             
             // Forward to cloud
-            forwardDataToCloud();
+            forwardDataToCloud(data);
             
             lastDataReceived = millis();
         } else {
@@ -293,24 +342,19 @@ void handleLoRaReceive() {
 }
 
 void handleMQTTMessages() {
-    if (!mqtt.connected() && cellularConnected) {
-        Serial.println("Reconnecting to MQTT...");
-        if (mqtt.connect("EdgeDevice")) {
-            Serial.println("MQTT connected");
-            mqtt.subscribe(MQTT_TOPIC_CMD);
-            mqtt.subscribe(MQTT_TOPIC_STATUS);
-        } else {
-            Serial.println("MQTT connection failed");
-        }
-    }
-    
-    if (mqtt.connected()) {
-        mqtt.loop();
+    cellular.loop();
+    
+    // Cellular status LED follows the MQTT session
+    bool connected = cellular.isMQTTConnected();
+    if (connected != cellularConnected) {
+        cellularConnected = connected;
+        digitalWrite(LED_CELLULAR_TX, connected ? HIGH : LOW);
+        Serial.println(connected ? "Cellular connected" : "Cellular disconnected");
     }
 }
 
-void forwardDataToCloud() {
-    if (!mqtt.connected()) return;
+void forwardDataToCloud(const NodeData& latest) {
+    if (!cellular.isMQTTConnected()) return;
     
     // Create JSON payload with all node data
     DynamicJsonDocument doc(1024);
@@ -320,6 +364,14 @@ void forwardDataToCloud() {
         JsonObject node = nodes.createNestedObject();
         node["nodeId"] = receivedData[i].nodeId;
         node["timestamp"] = receivedData[i].timestamp;
+        uint64_t sampleTime = sampleTimeOf(receivedData[i]);
+        if (sampleTime) {
+            node["sampleTime"] = sampleTime;
+        }
+        uint64_t rxTime = systemClock.toUtc(receivedData[i].timestamp);
+        if (rxTime) {
+            node["rxTime"] = rxTime;
+        }
         node["temperature"] = receivedData[i].temperature;
         node["humidity"] = receivedData[i].humidity;
         node["batteryLevel"] = receivedData[i].batteryLevel;
@@ -341,8 +393,10 @@ void forwardDataToCloud() {
     String payload;
     serializeJson(doc, payload);
     
-    if (mqtt.publish(MQTT_TOPIC_DATA, payload.c_str())) {
-        Serial.println("Data forwarded to cloud");
+    // The reading that prompted this publish is the one traced
+    TraceContext trace = { latest.sampleTime, latest.timestamp, 0, 0, 0 };
+    if (cellular.publish(MQTT_TOPIC_DATA, payload, false, &trace)) {
+        Serial.println("Data queued for cloud");
         // Blink cellular TX LED
         digitalWrite(LED_CELLULAR_TX, LOW);
         delay(50);
@@ -352,49 +406,295 @@ void forwardDataToCloud() {
     }
 }
 
-void processCloudCommand(const String& command) {
-    Serial.println("Processing cloud command: " + command);
+void routeMessage(const char* topic, size_t topicLength, const uint8_t* payload, size_t length) {
+    for (const TopicRoute& route : topicRoutes) {
+        if (topicLength == route.length && memcmp(topic, route.topic, topicLength) == 0) {
+            route.handler((const char*)payload, length);
+            return;
+        }
+    }
+}
+
+void processCloudCommand(const char* payload, size_t length) {
+    EdgeCommand cmd;
+    if (!parseCommand((const uint8_t*)payload, length, cmd)) {
+        Serial.printf("Rejected cloud command (%u bytes)\n", (unsigned)length);
+        return;
+    }
     
-    DynamicJsonDocument doc(256);
-    deserializeJson(doc, command);
+    Serial.printf("Cloud command %u: node %u, target %u, %s\n",
+                  cmd.commandType, cmd.nodeId, cmd.targetDevice, cmd.action ? "on" : "off");
+    for (const CommandRoute& route : commandRoutes) {
+        if (route.type == cmd.commandType) {
+            route.handler(cmd);
+            return;
+        }
+    }
+    Serial.printf("Unsupported command type %u\n", cmd.commandType);
+}
+
+void handlePumpCommand(const EdgeCommand& cmd) {
+    controlLocalPump(cmd.action);
+}
+
+void handleValveCommand(const EdgeCommand& cmd) {
+    if (cmd.nodeId == 0) {
+        // Local valve control
+        controlLocalValve(cmd.targetDevice, cmd.action);
+    } else {
+        forwardCommandToNode(cmd);
+    }
+}
+
+void forwardCommandToNode(const EdgeCommand& cmd) {
+    // Held until the Node's next uplink, when its receiver is open
+    if (downlink.queue(cmd)) {
+        Serial.printf("Command queued for Node %u, %u pending\n", cmd.nodeId, downlink.pending(cmd.nodeId));
+    } else {
+        Serial.printf("Downlink queue full for Node %u, command dropped\n", cmd.nodeId);
+    }
+}
+
+void onNetworkTime(uint32_t utcSeconds, unsigned long sentAt, unsigned long receivedAt) {
+    systemClock.addReading(utcSeconds, sentAt, receivedAt);
+    cellular.scheduleTimeQuery(systemClock.nextReadingAt(receivedAt));
+}
+
+void onPublished(const TraceContext& trace) {
+    latency.addTrace(trace, systemClock);
+}
+
+void sendTimeBeacon(uint8_t slot) {
+    if (!systemClock.isSynced()) return;
+    // A Node that sent no time has just started, it gets one at once
+    if (beaconSentAt[slot] && receivedData[slot].sampleTime &&
+        millis() - beaconSentAt[slot] < TIME_BEACON_INTERVAL) return;
+    
+    // Stamped for the end of the frame, the transmission starts in endPacket()
+    char frame[24];
+    LoRa.beginPacket();
+    unsigned long txStart = millis();
+    size_t length = systemClock.buildBeacon(frame, sizeof(frame), txStart);
+    LoRa.write((const uint8_t*)frame, length);
+    LoRa.endPacket();
+    systemClock.beaconSent(txStart, millis());
+    beaconSentAt[slot] = txStart | 1;
+    
+    Serial.printf("Time beacon to Node %u: %s\n", receivedData[slot].nodeId, frame);
+}
+
+// The Node's own stamp, else the time the Edge received the sample
+uint64_t sampleTimeOf(const NodeData& data) {
+    return data.sampleTime ? data.sampleTime : systemClock.toUtc(data.timestamp);
+}
+
+void sendDownlinkFrame(void* context, const char* frame, size_t length) {
+    LoRa.beginPacket();
+    LoRa.write((const uint8_t*)frame, length);
+    LoRa.endPacket();
+    
+    Serial.printf("Downlink sent: %.*s\n", (int)length, frame);
+}
+
+uint32_t settingValue(const NodeSettings& settings, const SettingField& field) {
+    const uint8_t* ptr = (const uint8_t*)&settings + field.offset;
+    if (field.size == 4) return *(const uint32_t*)ptr;
+    if (field.size == 2) return *(const uint16_t*)ptr;
+    return *(const bool*)ptr ? 1 : 0;
+}
+
+void setSettingValue(NodeSettings& settings, const SettingField& field, uint32_t value) {
+    uint8_t* ptr = (uint8_t*)&settings + field.offset;
+    if (field.size == 4) *(uint32_t*)ptr = value;
+    else if (field.size == 2) *(uint16_t*)ptr = (uint16_t)value;
+    else *(bool*)ptr = value != 0;
+}
+
+// CRC over field values so struct padding never changes the etag
+uint32_t settingsEtag(const SettingsTable& table) {
+    uint32_t crc = 0;
+    for (int n = -1; n < table.count; n++) {
+        const NodeSettings& settings = n < 0 ? table.defaults : table.nodes[n];
+        uint8_t id = n < 0 ? 0 : table.nodeIds[n];
+        crc = crc32_le(crc, &id, 1);
+        for (uint8_t f = 0; f < SETTING_FIELD_COUNT; f++) {
+            uint32_t value = settingValue(settings, settingFields[f]);
+            crc = crc32_le(crc, (const uint8_t*)&value, sizeof(value));
+        }
+    }
+    return crc;
+}
+
+void publishConfigResult(const char* status, uint32_t etag, const char* error) {
+    if (!cellular.isMQTTConnected()) return;
     
-    String cmdType = doc["type"];
-    uint8_t nodeId = doc["nodeId"];
+    DynamicJsonDocument doc(256);
+    doc["edgeId"] = "EDGE_001";
+    doc["status"] = status;
+    doc["etag"] = String(etag, HEX);
+    if (error != NULL) {
+        doc["error"] = error;
+    }
     
-    if (cmdType == "pump") {
-        bool state = doc["state"];
-        controlLocalPump(state);
-    } else if (cmdType == "valve") {
-        uint8_t valveNum = doc["valve"];
-        bool state = doc["state"];
+    String payload;
+    serializeJson(doc, payload);
+    cellular.publish(MQTT_TOPIC_CONFIG_RESULT, payload);
+}
+
+// Apply one target's members, recording which fields it touched
+const char* applySettingsPatch(SettingsTable& table, JsonObject fields, int slot, uint8_t& mask) {
+    for (JsonPair member : fields) {
+        const SettingField* field = NULL;
+        for (uint8_t f = 0; f < SETTING_FIELD_COUNT; f++) {
+            if (strcmp(member.key().c_str(), settingFields[f].name) == 0) {
+                field = &settingFields[f];
+                mask |= 1 << f;
+                break;
+            }
+        }
+        if (field == NULL) return "unknown field";
         
-        if (nodeId == 0) {
-            // Local valve control
-            controlLocalValve(valveNum, state);
+        JsonVariant value = member.value();
+        uint32_t number;
+        if (field->size == 1 && value.is<bool>()) {
+            number = value.as<bool>() ? 1 : 0;
+        } else if (field->size > 1 && value.is<uint32_t>()) {
+            number = value.as<uint32_t>();
+            if (number < field->min || number > field->max) return "value out of range";
         } else {
-            // Forward to specific node
-            EdgeCommand cmd;
-            cmd.nodeId = nodeId;
-            cmd.commandType = 0; // valve
-            cmd.targetDevice = valveNum;
-            cmd.action = state;
-            cmd.timestamp = millis();
-            
-            forwardCommandToNode(cmd);
+            return "wrong type";
+        }
+        
+        if (slot < 0) {
+            // Wildcard sets the field on every Node, clearing per-node overrides
+            setSettingValue(table.defaults, *field, number);
+            for (uint8_t n = 0; n < table.count; n++) {
+                setSettingValue(table.nodes[n], *field, number);
+            }
+        } else {
+            setSettingValue(table.nodes[slot], *field, number);
         }
     }
+    return NULL;
 }
 
-void forwardCommandToNode(const EdgeCommand& cmd) {
-    // Create command packet for LoRa transmission
-    String packet = "CMD," + String(cmd.nodeId) + "," + String(cmd.commandType) + 
-                   "," + String(cmd.targetDevice) + "," + String(cmd.action ? 1 : 0);
+/*
+ * Cloud config patch: {"etag":"...","nodes":{"*":{...},"3":{...}}}.
+ * The patch is applied to a copy and swapped in only if every member is
+ * valid, so Nodes never receive half of a change. A stale etag means the
+ * sender worked from an outdated view and the patch is refused.
+ */
+void processCloudConfig(const char* payload, size_t length) {
+    uint32_t etag = settingsEtag(nodeSettings);
     
-    LoRa.beginPacket();
-    LoRa.print(packet);
-    LoRa.endPacket();
+    DynamicJsonDocument doc(1024);
+    if (deserializeJson(doc, payload, length) || !doc["nodes"].is<JsonObject>()) {
+        publishConfigResult("rejected", etag, "invalid patch");
+        return;
+    }
+    
+    const char* ifMatch = doc["etag"];
+    if (ifMatch != NULL && strtoul(ifMatch, NULL, 16) != etag) {
+        publishConfigResult("conflict", etag, "stale etag");
+        return;
+    }
+    
+    SettingsTable candidate = nodeSettings;
+    uint8_t defaultsMask = 0;
+    uint8_t nodeMasks[MAX_NODES] = {0};
+    const char* error = NULL;
+    JsonObject nodes = doc["nodes"];
+    
+    // Wildcard first so per-node members in the same patch take precedence
+    if (nodes.containsKey("*")) {
+        if (nodes["*"].is<JsonObject>()) {
+            error = applySettingsPatch(candidate, nodes["*"].as<JsonObject>(), -1, defaultsMask);
+        } else {
+            error = "bad node id";
+        }
+    }
+    for (JsonPair target : nodes) {
+        if (error != NULL) break;
+        if (strcmp(target.key().c_str(), "*") == 0) continue;
+        
+        int nodeId = atoi(target.key().c_str());
+        if (nodeId <= 0 || nodeId > 255 || !target.value().is<JsonObject>()) {
+            error = "bad node id";
+            break;
+        }
+        
+        int slot = -1;
+        for (uint8_t n = 0; n < candidate.count; n++) {
+            if (candidate.nodeIds[n] == nodeId) slot = n;
+        }
+        if (slot < 0) {
+            if (candidate.count >= MAX_NODES) {
+                error = "too many nodes";
+                break;
+            }
+            slot = candidate.count++;
+            candidate.nodeIds[slot] = nodeId;
+            candidate.nodes[slot] = candidate.defaults;
+        }
+        error = applySettingsPatch(candidate, target.value().as<JsonObject>(), slot, nodeMasks[slot]);
+    }
+    
+    for (int n = -1; error == NULL && n < candidate.count; n++) {
+        const NodeSettings& settings = n < 0 ? candidate.defaults : candidate.nodes[n];
+        if (settings.moistureLow >= settings.moistureHigh) error = "moistureLow must be below moistureHigh";
+    }
+    if (error != NULL) {
+        publishConfigResult("rejected", etag, error);
+        return;
+    }
     
-    Serial.println("Command forwarded to Node " + String(cmd.nodeId) + ": " + packet);
+    uint32_t newEtag = settingsEtag(candidate);
+    if (newEtag != etag) {
+        nodeSettings = candidate;
+        forwardSettingsToNodes(nodeSettings, defaultsMask, nodeMasks, newEtag);
+    }
+    publishConfigResult("applied", newEtag, NULL);
+}
+
+/*
+ * Send the touched fields to the Nodes in as few packets as possible:
+ * "CFG,<etag>;*:lo=30,hi=70;3:si=5000". Sections are applied in order, so
+ * the wildcard comes first. A section is never split across packets.
+ */
+void forwardSettingsToNodes(const SettingsTable& table, uint8_t defaultsMask, const uint8_t* nodeMasks, uint32_t etag) {
+    String header = "CFG," + String(etag, HEX);
+    String frame = header;
+    
+    for (int n = -1; n < table.count; n++) {
+        uint8_t mask = n < 0 ? defaultsMask : nodeMasks[n];
+        if (mask == 0) continue;
+        
+        const NodeSettings& settings = n < 0 ? table.defaults : table.nodes[n];
+        String section = ";" + (n < 0 ? String("*") : String(table.nodeIds[n])) + ":";
+        bool first = true;
+        for (uint8_t f = 0; f < SETTING_FIELD_COUNT; f++) {
+            if (!(mask & (1 << f))) continue;
+            if (!first) section += ",";
+            section += String(settingFields[f].key) + "=" + String(settingValue(settings, settingFields[f]));
+            first = false;
+        }
+        
+        if (frame.length() + section.length() > LORA_MAX_FRAME) {
+            LoRa.beginPacket();
+            LoRa.print(frame);
+            LoRa.endPacket();
+            frame = header;
+        }
+        frame += section;
+    }
+    
+    if (frame.length() > header.length()) {
+        LoRa.beginPacket();
+        LoRa.print(frame);
+        LoRa.endPacket();
+    }
+    
+    Serial.println("Settings forwarded to Nodes, etag " + String(etag, HEX));
 }
 
 void updateDisplay() {
@@ -442,15 +742,19 @@ void logDataToSD(const NodeData& data) {
             logEntry += "," + String(data.valveStatus[i] ? 1 : 0);
         }
         
+        char sampleTime[24];
+        snprintf(sampleTime, sizeof(sampleTime), ",%llu", (unsigned long long)sampleTimeOf(data));
+        logEntry += sampleTime;
+        
         dataFile.println(logEntry);
         dataFile.close();
     }
 }
 
 void sendHeartbeat() {
-    if (!mqtt.connected()) return;
+    if (!cellular.isMQTTConnected()) return;
     
-    DynamicJsonDocument doc(256);
+    DynamicJsonDocument doc(1024);
     doc["edgeId"] = "EDGE_001";
     doc["timestamp"] = millis();
     doc["activeNodes"] = activeNodes;
@@ -458,10 +762,29 @@ void sendHeartbeat() {
     doc["cellularStatus"] = cellularConnected;
     doc["freeHeap"] = ESP.getFreeHeap();
     
+    // Per-stage latency over the window, ms, then a fresh window
+    bool report = millis() - latency.getWindowStart() >= LATENCY_REPORT_INTERVAL;
+    if (report) {
+        JsonObject stages = doc.createNestedObject("latency");
+        stages["window"] = millis() - latency.getWindowStart();
+        for (int i = 0; i < STAGE_COUNT; i++) {
+            LatencyStage stage = (LatencyStage)i;
+            LatencySummary summary = latency.summary(stage);
+            if (!summary.count) continue;
+            JsonObject s = stages.createNestedObject(EdgeLatency::stageName(stage));
+            s["n"] = summary.count;
+            s["p50"] = summary.p50;
+            s["p99"] = summary.p99;
+            s["max"] = summary.max;
+        }
+    }
+    
     String payload;
     serializeJson(doc, payload);
     
-    mqtt.publish(MQTT_TOPIC_STATUS, payload.c_str());
+    if (cellular.publish(MQTT_TOPIC_STATUS, payload) && report) {
+        latency.reset();
+    }
 }
 
 void handleSystemStatus() {
@@ -491,11 +814,13 @@ NodeData parseNodeData(const String& data) {
     NodeData nodeData;
     
     // Parse CSV format: nodeId,temp,humidity,battery,moisture1,moisture2,moisture3,moisture4,valve1,valve2,valve3,valve4
+    // and, from Nodes that have the time, the UTC ms they sampled at in hex
     int startIndex = 0;
     int commaIndex = 0;
     int fieldIndex = 0;
+    nodeData.sampleTime = 0;
     
-    while (commaIndex != -1 && fieldIndex < 12) {
+    while (commaIndex != -1 && fieldIndex < 13) {
         commaIndex = data.indexOf(',', startIndex);
         String field = commaIndex != -1 ? data.substring(startIndex, commaIndex) : data.substring(startIndex);
         
@@ -508,6 +833,7 @@ NodeData parseNodeData(const String& data) {
                 nodeData.soilMoisture[fieldIndex - 4] = field.toFloat(); break;
             case 8: case 9: case 10: case 11:
                 nodeData.valveStatus[fieldIndex - 8] = field.toInt() == 1; break;
+            case 12: nodeData.sampleTime = strtoull(field.c_str(), NULL, 16); break;
         }
         
         startIndex = commaIndex + 1;
@@ -0,0 +1,90 @@
+#include "EdgeLatency.h"
+
+static const char* const STAGE_NAMES[STAGE_COUNT] = {
+    "radio", "edge", "queue", "publish", "total"
+};
+
+EdgeLatency::EdgeLatency() {
+    reset();
+}
+
+void EdgeLatency::reset() {
+    memset(stages, 0, sizeof(stages));
+    windowStart = millis();
+}
+
+uint8_t EdgeLatency::bucketOf(unsigned long ms) {
+    if (ms < LATENCY_SUB_BUCKETS) return ms;
+    uint8_t exponent = 31 - __builtin_clz((uint32_t)ms);
+    uint8_t sub = (ms >> (exponent - 3)) & (LATENCY_SUB_BUCKETS - 1);
+    unsigned int bucket = (exponent - 2) * LATENCY_SUB_BUCKETS + sub;
+    return bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1;
+}
+
+unsigned long EdgeLatency::valueOf(uint8_t bucket) {
+    if (bucket < LATENCY_SUB_BUCKETS) return bucket;
+    uint8_t exponent = bucket / LATENCY_SUB_BUCKETS + 2;
+    uint8_t sub = bucket % LATENCY_SUB_BUCKETS;
+    unsigned long width = 1UL << (exponent - 3);
+    // Middle of the bucket
+    return (1UL << exponent) + sub * width + width / 2;
+}
+
+void EdgeLatency::record(LatencyStage stage, unsigned long ms) {
+    Histogram& h = stages[stage];
+    uint16_t& bucket = h.buckets[bucketOf(ms)];
+    if (bucket == 0xFFFF) return;   // Saturated, the window is far too long
+    bucket++;
+    h.count++;
+    if (ms > h.max) h.max = ms;
+}
+
+void EdgeLatency::addTrace(const TraceContext& trace, EdgeClock& clock) {
+    if (!trace.rxAt || !trace.queuedAt || !trace.sentAt || !trace.ackedAt) return;
+
+    record(STAGE_EDGE, trace.queuedAt - trace.rxAt);
+    record(STAGE_QUEUE, trace.sentAt - trace.queuedAt);
+    record(STAGE_PUBLISH, trace.ackedAt - trace.sentAt);
+
+    // A Node clock ahead of ours would make these negative, leave them out
+    if (!trace.sampleTime || !clock.isSynced()) return;
+    uint64_t rxUtc = clock.toUtc(trace.rxAt);
+    uint64_t ackedUtc = clock.toUtc(trace.ackedAt);
+    if (rxUtc >= trace.sampleTime) {
+        record(STAGE_RADIO, rxUtc - trace.sampleTime);
+    }
+    if (ackedUtc >= trace.sampleTime) {
+        record(STAGE_TOTAL, ackedUtc - trace.sampleTime);
+    }
+}
+
+unsigned long EdgeLatency::percentile(LatencyStage stage, uint8_t percent) {
+    Histogram& h = stages[stage];
+    if (!h.count) return 0;
+
+    // Nearest rank: the smallest value with at least percent of the samples at or below it
+    uint32_t rank = ((uint64_t)h.count * percent + 99) / 100;
+    if (rank == 0) rank = 1;
+    uint32_t seen = 0;
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += h.buckets[i];
+        if (seen >= rank) {
+            unsigned long value = valueOf(i);
+            return value < h.max ? value : h.max;
+        }
+    }
+    return h.max;
+}
+
+LatencySummary EdgeLatency::summary(LatencyStage stage) {
+    LatencySummary s;
+    s.count = stages[stage].count;
+    s.p50 = percentile(stage, 50);
+    s.p99 = percentile(stage, 99);
+    s.max = stages[stage].max;
+    return s;
+}
+
+const char* EdgeLatency::stageName(LatencyStage stage) {
+    return stage < STAGE_COUNT ? STAGE_NAMES[stage] : "unknown";
+}
@@ -0,0 +1,64 @@
+#ifndef EDGE_LATENCY_H
+#define EDGE_LATENCY_H
+
+#include <Arduino.h>
+#include "edge_board_def.h"
+#include "EdgeTime.h"
+
+// The stages a reading goes through on its way to the cloud
+enum LatencyStage {
+    STAGE_RADIO,        // Node sample to Edge receive, needs both clocks synced
+    STAGE_EDGE,         // Receive to MQTT outbox: parsing, SD log, JSON
+    STAGE_QUEUE,        // Waiting in the outbox
+    STAGE_PUBLISH,      // AT+SMPUB to the broker's acknowledgement
+    STAGE_TOTAL,        // Node sample to acknowledgement
+    STAGE_COUNT
+};
+
+// Latency histograms per stage, read as percentiles. Buckets are spaced
+// logarithmically, 8 per doubling, so a percentile is exact below 16 ms and
+// within 6.25% of the sampled value from there up to about 4.6 hours.
+// Counts cover one report window and are cleared by reset().
+#define LATENCY_SUB_BUCKETS     8
+#define LATENCY_BUCKETS         (LATENCY_SUB_BUCKETS * 22)
+
+struct LatencySummary {
+    uint32_t count;
+    unsigned long p50;
+    unsigned long p99;
+    unsigned long max;
+};
+
+class EdgeLatency {
+private:
+    struct Histogram {
+        uint16_t buckets[LATENCY_BUCKETS];
+        uint32_t count;
+        unsigned long max;
+    };
+
+    Histogram stages[STAGE_COUNT];
+    unsigned long windowStart;
+
+    static uint8_t bucketOf(unsigned long ms);
+    static unsigned long valueOf(uint8_t bucket);
+
+public:
+    EdgeLatency();
+
+    void record(LatencyStage stage, unsigned long ms);
+
+    // A reading the broker acknowledged. The stages through the Node need
+    // UTC, they are skipped while the clock is not synced.
+    void addTrace(const TraceContext& trace, EdgeClock& clock);
+
+    unsigned long percentile(LatencyStage stage, uint8_t percent);
+    LatencySummary summary(LatencyStage stage);
+
+    unsigned long getWindowStart() { return windowStart; }
+    void reset();
+
+    static const char* stageName(LatencyStage stage);
+};
+
+#endif // EDGE_LATENCY_H
@@ -0,0 +1,85 @@
+#include "EdgeTime.h"
+
+EdgeClock::EdgeClock() {
+    valid = false;
+    refLocal = 0;
+    utcLow = 0;
+    utcHigh = 0;
+    roundTrip = 0;
+    beaconAirtime = 0;
+}
+
+// Moves the reference to local, widening the bounds for the oscillator's drift
+void EdgeClock::rebase(unsigned long local) {
+    long elapsed = (long)(local - refLocal);
+    int64_t drift = (int64_t)labs(elapsed) * CLOCK_DRIFT_PPM / 1000000 + 1;
+    utcLow += elapsed - drift;
+    utcHigh += elapsed + drift;
+    refLocal = local;
+}
+
+void EdgeClock::addReading(uint32_t utcSeconds, unsigned long sentAt, unsigned long receivedAt) {
+    roundTrip = receivedAt - sentAt;
+    int64_t low = (int64_t)utcSeconds * 1000;
+    int64_t high = low + 1000 + roundTrip;
+
+    if (valid) {
+        rebase(receivedAt);
+        // A reading outside the bounds means the network clock was stepped
+        if (low < utcHigh && utcLow < high) {
+            if (low < utcLow) low = utcLow;
+            if (high > utcHigh) high = utcHigh;
+        }
+    }
+    valid = true;
+    refLocal = receivedAt;
+    utcLow = low;
+    utcHigh = high;
+}
+
+unsigned long EdgeClock::nextReadingAt(unsigned long now) {
+    if (!valid) return now;
+
+    // Once the bounds are down to about a round trip, readings only make
+    // up for drift
+    const unsigned long width = utcHigh - utcLow;
+    const bool refining = width > roundTrip + CLOCK_REFINE_MARGIN;
+    const unsigned long earliest = now + (refining ? CLOCK_REFINE_INTERVAL : CLOCK_READING_INTERVAL);
+
+    // The next second boundary after earliest by the middle of the bounds,
+    // aimed at by the middle of the command's round trip
+    int64_t mid = utcLow + (int64_t)width / 2 + (long)(earliest - refLocal);
+    int64_t boundary = (mid / 1000 + 1) * 1000;
+    return earliest + (unsigned long)(boundary - mid) - roundTrip / 2;
+}
+
+unsigned long EdgeClock::getUncertainty() {
+    if (!valid) return ULONG_MAX;
+    long elapsed = (long)(millis() - refLocal);
+    return (utcHigh - utcLow) / 2 + (int64_t)labs(elapsed) * CLOCK_DRIFT_PPM / 1000000;
+}
+
+uint64_t EdgeClock::toUtc(unsigned long localMs) {
+    if (!valid) return 0;
+    return utcLow + (utcHigh - utcLow) / 2 + (long)(localMs - refLocal);
+}
+
+size_t EdgeClock::buildBeacon(char* frame, size_t size, unsigned long txStart) {
+    int length = snprintf(frame, size, "T,%llx", (unsigned long long)toUtc(txStart + beaconAirtime));
+    return length > 0 && (size_t)length < size ? length : 0;
+}
+
+void EdgeClock::beaconSent(unsigned long txStart, unsigned long txEnd) {
+    beaconAirtime = txEnd - txStart;
+}
+
+unsigned long loraAirtime(size_t length, uint8_t spreadingFactor, long bandwidth,
+                          uint8_t codingRate, uint16_t preamble) {
+    // Semtech AN1200.13, low data rate optimization from 16 ms symbols
+    const float symbol = (float)(1UL << spreadingFactor) * 1000 / bandwidth;
+    const int lowRate = symbol >= 16 ? 1 : 0;
+    int bits = 8 * length - 4 * spreadingFactor + 28 + 16;
+    int blocks = bits > 0 ? (bits + 4 * (spreadingFactor - 2 * lowRate) - 1) / (4 * (spreadingFactor - 2 * lowRate)) : 0;
+    float symbols = preamble + 4.25f + 8 + blocks * codingRate;
+    return (unsigned long)(symbols * symbol + 0.5f);
+}
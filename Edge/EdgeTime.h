@@ -0,0 +1,56 @@
+#ifndef EDGE_TIME_H
+#define EDGE_TIME_H
+
+#include <Arduino.h>
+#include "edge_board_def.h"
+
+// UTC for the Edge and its Nodes, kept as bounds on UTC at a millis()
+// reference. The modem's clock only reads whole seconds: second S read by a
+// command sent at local time sentAt and answered at receivedAt puts UTC at
+// receivedAt in [S*1000, S*1000 + 1000 + receivedAt - sentAt). Readings
+// timed for when the bounds expect the second to roll over cut the bounds
+// down to about the command's round trip. Between readings the bounds
+// widen by CLOCK_DRIFT_PPM.
+//
+// Nodes are set by time beacons, "T,<UTC ms in hex>", giving UTC at the end
+// of the frame, which is when the Node's radio reports it received.
+class EdgeClock {
+private:
+    bool valid;
+    unsigned long refLocal;     // millis() the bounds refer to
+    int64_t utcLow;             // UTC ms at refLocal, low bound
+    int64_t utcHigh;            // and high bound, exclusive
+    unsigned long roundTrip;    // Last reading's command round trip
+    unsigned long beaconAirtime;
+
+    void rebase(unsigned long local);
+
+public:
+    EdgeClock();
+
+    // A whole-second network time reading
+    void addReading(uint32_t utcSeconds, unsigned long sentAt, unsigned long receivedAt);
+    // millis() at which the next reading tells the most
+    unsigned long nextReadingAt(unsigned long now);
+
+    bool isValid() { return valid; }
+    // Known to within CLOCK_SYNC_BOUND
+    bool isSynced() { return valid && getUncertainty() <= CLOCK_SYNC_BOUND; }
+    // Half the width of the bounds, ms
+    unsigned long getUncertainty();
+
+    uint64_t toUtc(unsigned long localMs);
+    uint64_t now() { return toUtc(millis()); }
+
+    // Beacon for a frame whose transmission starts at txStart
+    size_t buildBeacon(char* frame, size_t size, unsigned long txStart);
+    // Measured start and end of the transmission, sets the next beacon's airtime
+    void beaconSent(unsigned long txStart, unsigned long txEnd);
+    void setBeaconAirtime(unsigned long ms) { beaconAirtime = ms; }
+};
+
+// Time on air of a LoRa frame with explicit header and CRC, ms
+unsigned long loraAirtime(size_t length, uint8_t spreadingFactor, long bandwidth,
+                          uint8_t codingRate, uint16_t preamble = 8);
+
+#endif // EDGE_TIME_H
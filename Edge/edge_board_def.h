@@ -1,3 +1,6 @@
+#ifndef EDGE_BOARD_DEF_H
+#define EDGE_BOARD_DEF_H
+
 #include <Arduino.h>
 
 // Edge Device Configuration
@@ -156,6 +159,8 @@
 #define MQTT_TOPIC_CMD      "SmartIrrigation/cmd"
 #define MQTT_TOPIC_STATUS   "SmartIrrigation/status"
 #define MQTT_TOPIC_ALERT    "SmartIrrigation/alert"
+#define MQTT_TOPIC_CONFIG   "SmartIrrigation/config"
+#define MQTT_TOPIC_CONFIG_RESULT "SmartIrrigation/config/result"
 
 // Data Structure for Node Communication
 struct NodeData {
@@ -165,7 +170,18 @@ struct NodeData {
     float humidity;
     float batteryLevel;
     bool valveStatus[4];
-    unsigned long timestamp;
+    unsigned long timestamp;    // millis() when received
+    uint64_t sampleTime;        // UTC ms when the Node sampled, 0 if it has no time
+};
+
+// Where a reading's time went, carried with it from the Node's sample to
+// the broker's acknowledgement. Local times are millis(), 0 when not reached.
+struct TraceContext {
+    uint64_t sampleTime;        // UTC ms when the Node sampled, 0 if unknown
+    unsigned long rxAt;         // LoRa frame received by the Edge
+    unsigned long queuedAt;     // Entered the MQTT outbox
+    unsigned long sentAt;       // AT+SMPUB handed to the modem, last attempt
+    unsigned long ackedAt;      // The modem's OK for the QoS 1 publish
 };
 
 struct EdgeCommand {
@@ -183,8 +199,70 @@ struct EdgeCommand {
 #define HEARTBEAT_INTERVAL  60000  // 1 minute
 #define RETRY_ATTEMPTS      3
 #define LORA_PACKET_SIZE    64
+#define LORA_MAX_FRAME      255    // SX127x FIFO limit for one packet
+#define DOWNLINK_PER_NODE   8      // Commands waiting per Node, one per target
+#define DOWNLINK_TTL        900000 // Dropped if the Node stays silent 15 minutes
+
+// Node settings pushed over LoRa, a subset of the Node's node_config_t
+struct NodeSettings {
+    uint32_t sensorIntervalMs;
+    uint32_t txIntervalMs;
+    uint16_t moistureLow;
+    uint16_t moistureHigh;
+    uint32_t valveDurationMs;
+    bool autoIrrigation;
+};
+
+// Settings pushed to each Node, the defaults apply to Nodes without an entry
+struct SettingsTable {
+    NodeSettings defaults;
+    uint8_t count;
+    uint8_t nodeIds[MAX_NODES];
+    NodeSettings nodes[MAX_NODES];
+};
 
 // APN Configuration (customize for your carrier)
 #define APN_NAME            "your.apn.here"
 #define APN_USER            ""
 #define APN_PASS            ""
+
+// Cellular link timing (EdgeCellular), all in ms
+#define CELL_POWER_ON_TIMEOUT   15000   // Modem answers AT after power-up
+#define CELL_REGISTER_TIMEOUT   90000   // Network registration
+#define CELL_ATTACH_TIMEOUT     60000   // Packet data bearer up
+#define CELL_MQTT_TIMEOUT       30000   // MQTT connect and subscribe
+#define CELL_AT_TIMEOUT         2000    // Reply to a single command
+#define CELL_POLL_INTERVAL      1000    // Registration and bearer polling
+#define CELL_HEALTH_INTERVAL    30000   // Signal and MQTT checks while connected
+#define CELL_BACKOFF_BASE       2000    // First retry delay, doubled per failure
+#define CELL_BACKOFF_MAX        300000
+#define CELL_RESET_AFTER        4       // Restart the modem every this many failures in a row
+#define CELL_OUTBOX_SIZE        8
+#define CELL_MAX_SUBSCRIPTIONS  8
+#define CELL_NTP_SERVER         "pool.ntp.org"
+#define CELL_NTP_INTERVAL       21600000 // Modem clock re-synced from NTP
+#define CELL_NTP_RETRY          60000
+
+// Time service (EdgeClock), all in ms
+#define CLOCK_DRIFT_PPM         50      // Worst-case drift of the Edge's oscillator
+#define CLOCK_SYNC_BOUND        100     // Nodes get beacons once UTC is known this well
+#define CLOCK_REFINE_MARGIN     20      // Bounds wider than a round trip plus this are refined
+#define CLOCK_REFINE_INTERVAL   2000    // Between readings while refining
+#define CLOCK_READING_INTERVAL  600000  // Between readings once refined
+#define TIME_BEACON_INTERVAL    3600000 // Beacon to each Node at most this often
+#define TIME_BEACON_SIZE        13      // "T," and 11 hex digits, until 2527
+
+// Latency tracing (EdgeLatency)
+#define LATENCY_REPORT_INTERVAL 900000  // Per-stage p50/p99 in the heartbeat, then reset
+
+// AT command engine (EdgeAT)
+#define AT_QUEUE_SIZE           8       // Commands waiting or in flight
+#define AT_COMMAND_SIZE         128     // Longest command, without the "AT"
+#define AT_REPLY_SIZE           96      // Information line kept per command
+#define AT_LINE_BUFFER          1152    // Longest modem line: +SMSUB with a 1 KB payload
+#define AT_MAX_URCS             8
+#define AT_BATCH_MAX            6       // Queries sharing one command line
+#define AT_MAX_COMMAND_LINE     556     // SIM7000 limit for one command line
+#define AT_POLL_BUDGET          256     // Bytes parsed per poll()
+
+#endif // EDGE_BOARD_DEF_H
@@ -0,0 +1,467 @@
+/*
+ * ET Predictor Component Implementation
+ *
+ * Reference evapotranspiration follows the Hargreaves radiation form
+ * (FAO-56 eq. 50/52): ET0 = 0.0135 * (Tmean + 17.8) * Rs, where Rs is taken
+ * from the light sensor relative to the brightest recent day when available
+ * and from the daily temperature range otherwise. Extraterrestrial radiation
+ * and day length use the FAO-56 solar geometry (eq. 21-25, 34).
+ */
+
+#include "et_predictor.h"
+#include <math.h>
+#include <string.h>
+#include <time.h>
+#include <esp_log.h>
+
+static const char *TAG = "ET_PREDICTOR";
+
+#define SECONDS_PER_DAY             86400
+#define SOLAR_CONSTANT              0.0820f     // MJ m-2 min-1
+#define MJ_TO_MM                    0.408f      // Evaporation equivalent of 1 MJ m-2
+#define HARGREAVES_KRS              0.16f       // Interior location radiation coefficient
+#define DEFAULT_TEMP_RANGE          10.0f       // Used until a full day has been observed
+#define MIN_DAY_COVERAGE_SECONDS    (12 * 3600)
+#define LEARN_MIN_ETC_MM            2.0f        // ETc needed before a drydown update
+#define LEARN_ALPHA                 0.2f        // EWMA weight of a new rate estimate
+#define SETTLE_SECONDS              900         // Infiltration time before measuring a dose
+#define CLEAR_SKY_DECAY             0.98f       // Daily decay of the clear-sky light reference
+
+typedef struct {
+    int64_t day;                // Solar day index
+    float t_min;
+    float t_max;
+    float t_sum;
+    int t_count;
+    float light_sum;            // Daytime light samples only
+    int light_count;
+    int64_t first_time;
+    int64_t last_time;
+} et_day_stats_t;
+
+typedef struct {
+    et_zone_params_t params;
+    bool have_sample;
+    float last_moisture;
+    int64_t last_time;
+    float anchor_moisture;      // Start of the current drydown observation
+    int64_t anchor_time;
+    bool awaiting_response;     // A dose was applied and not yet measured
+    float pre_irrigation_moisture;
+    int64_t irrigation_start;
+    int irrigation_duration;
+} et_zone_t;
+
+static float s_latitude_rad = 0.0f;
+static float s_longitude_deg = 0.0f;
+static et_day_stats_t s_today;
+static et_day_stats_t s_yesterday;
+static bool s_have_today = false;
+static bool s_have_yesterday = false;
+static float s_clear_sky_light = 0.0f;
+static et_zone_t s_zones[ET_PREDICTOR_MAX_ZONES];
+
+static const et_zone_params_t s_default_zone_params = {
+    .crop_coefficient = 1.0f,
+    .moisture_per_mm = 0.33f,       // 300 mm effective root zone
+    .moisture_per_second = 0.05f,   // 3% per minute of watering
+    .target_moisture = 0.0f         // 0 selects threshold + 5%
+};
+
+static inline bool zone_valid(int zone)
+{
+    return zone >= 0 && zone < ET_PREDICTOR_MAX_ZONES;
+}
+
+static int64_t solar_day(int64_t timestamp)
+{
+    // Shift to local solar time so days roll over near local midnight
+    int64_t local = timestamp + (int64_t)(s_longitude_deg * 240.0f);
+    int64_t day = local / SECONDS_PER_DAY;
+    if (local < 0 && local % SECONDS_PER_DAY) {
+        day--;
+    }
+    return day;
+}
+
+static int64_t solar_noon(int64_t day)
+{
+    return day * SECONDS_PER_DAY + SECONDS_PER_DAY / 2 - (int64_t)(s_longitude_deg * 240.0f);
+}
+
+static int day_of_year(int64_t timestamp)
+{
+    time_t t = (time_t)timestamp;
+    struct tm tm_utc;
+    gmtime_r(&t, &tm_utc);
+    return tm_utc.tm_yday + 1;
+}
+
+/* Sunset hour angle and extraterrestrial radiation (MJ m-2 day-1) for a day */
+static void solar_geometry(int64_t day, float *sunset_angle, float *ra)
+{
+    int j = day_of_year(solar_noon(day));
+    float dr = 1.0f + 0.033f * cosf(2.0f * (float)M_PI * j / 365.0f);
+    float decl = 0.409f * sinf(2.0f * (float)M_PI * j / 365.0f - 1.39f);
+    float x = -tanf(s_latitude_rad) * tanf(decl);
+
+    if (x > 1.0f) x = 1.0f;     // Polar night
+    if (x < -1.0f) x = -1.0f;   // Midnight sun
+    float ws = acosf(x);
+
+    if (sunset_angle) {
+        *sunset_angle = ws;
+    }
+    if (ra) {
+        *ra = 24.0f * 60.0f / (float)M_PI * SOLAR_CONSTANT * dr *
+              (ws * sinf(s_latitude_rad) * sinf(decl) +
+               cosf(s_latitude_rad) * cosf(decl) * sinf(ws));
+    }
+}
+
+static void sun_times_for_day(int64_t day, int64_t *sunrise, int64_t *sunset)
+{
+    float ws;
+    solar_geometry(day, &ws, NULL);
+
+    int64_t half_day = (int64_t)(ws / (float)M_PI * SECONDS_PER_DAY / 2.0f);
+    int64_t noon = solar_noon(day);
+    *sunrise = noon - half_day;
+    *sunset = noon + half_day;
+}
+
+void et_predictor_get_sun_times(int64_t timestamp, int64_t *sunrise, int64_t *sunset)
+{
+    int64_t sr, ss;
+    sun_times_for_day(solar_day(timestamp), &sr, &ss);
+    if (sunrise) *sunrise = sr;
+    if (sunset) *sunset = ss;
+}
+
+static float reference_et_for_day(int64_t day)
+{
+    float ra;
+    solar_geometry(day, NULL, &ra);
+
+    // Weather from the last complete day, falling back to today so far
+    const et_day_stats_t *stats = NULL;
+    if (s_have_yesterday) {
+        stats = &s_yesterday;
+    } else if (s_have_today) {
+        stats = &s_today;
+    }
+
+    float t_mean = 20.0f;
+    float t_range = DEFAULT_TEMP_RANGE;
+    if (stats && stats->t_count > 0) {
+        t_mean = stats->t_sum / stats->t_count;
+        if (stats->last_time - stats->first_time >= MIN_DAY_COVERAGE_SECONDS) {
+            t_range = stats->t_max - stats->t_min;
+        }
+    }
+    if (t_range < 0.0f) t_range = 0.0f;
+
+    float rso = 0.75f * ra;
+    float rs;
+    if (s_have_yesterday && s_yesterday.light_count > 0 && s_clear_sky_light > 0.0f) {
+        float ratio = (s_yesterday.light_sum / s_yesterday.light_count) / s_clear_sky_light;
+        if (ratio < 0.25f) ratio = 0.25f;
+        if (ratio > 1.0f) ratio = 1.0f;
+        rs = rso * ratio;
+    } else {
+        rs = HARGREAVES_KRS * sqrtf(t_range) * ra;
+        if (rs > rso) rs = rso;
+    }
+
+    float et0 = 0.0135f * (t_mean + 17.8f) * rs * MJ_TO_MM;
+    return et0 > 0.0f ? et0 : 0.0f;
+}
+
+float et_predictor_get_reference_et(int64_t timestamp)
+{
+    return reference_et_for_day(solar_day(timestamp));
+}
+
+/* Crop ET in mm between two times, distributed as a half-sine over daylight */
+static float crop_et_between(const et_zone_t *z, int64_t from, int64_t to)
+{
+    if (to <= from) {
+        return 0.0f;
+    }
+
+    float total = 0.0f;
+    for (int64_t day = solar_day(from); day <= solar_day(to); day++) {
+        int64_t sunrise, sunset;
+        sun_times_for_day(day, &sunrise, &sunset);
+        if (sunset <= sunrise) {
+            continue;
+        }
+
+        int64_t a = from > sunrise ? from : sunrise;
+        int64_t b = to < sunset ? to : sunset;
+        if (b <= a) {
+            continue;
+        }
+
+        float span = (float)(sunset - sunrise);
+        float u0 = (float)(a - sunrise) / span;
+        float u1 = (float)(b - sunrise) / span;
+        float fraction = (cosf((float)M_PI * u0) - cosf((float)M_PI * u1)) / 2.0f;
+        total += reference_et_for_day(day) * fraction;
+    }
+
+    return total * z->params.crop_coefficient;
+}
+
+static void roll_day(int64_t day)
+{
+    if (s_have_today) {
+        if (s_today.light_count > 0) {
+            float mean = s_today.light_sum / s_today.light_count;
+            s_clear_sky_light *= CLEAR_SKY_DECAY;
+            if (mean > s_clear_sky_light) {
+                s_clear_sky_light = mean;
+            }
+        }
+        if (s_today.last_time - s_today.first_time >= MIN_DAY_COVERAGE_SECONDS) {
+            s_yesterday = s_today;
+            s_have_yesterday = true;
+        }
+    }
+
+    memset(&s_today, 0, sizeof(s_today));
+    s_today.day = day;
+    s_today.t_min = INFINITY;
+    s_today.t_max = -INFINITY;
+    s_have_today = true;
+}
+
+static void update_weather(const sensor_data_t *data)
+{
+    int64_t day = solar_day(data->timestamp);
+    if (!s_have_today || day > s_today.day) {
+        roll_day(day);
+    } else if (day < s_today.day) {
+        return;     // Out-of-order sample from a finished day
+    }
+
+    if (s_today.t_count == 0) {
+        s_today.first_time = data->timestamp;
+    }
+    s_today.last_time = data->timestamp;
+
+    if (data->temperature < s_today.t_min) s_today.t_min = data->temperature;
+    if (data->temperature > s_today.t_max) s_today.t_max = data->temperature;
+    s_today.t_sum += data->temperature;
+    s_today.t_count++;
+
+    int64_t sunrise, sunset;
+    sun_times_for_day(day, &sunrise, &sunset);
+    if (data->timestamp > sunrise && data->timestamp < sunset) {
+        s_today.light_sum += data->light_level;
+        s_today.light_count++;
+    }
+}
+
+static void update_zone(et_zone_t *z, const sensor_data_t *data)
+{
+    float moisture = data->soil_moisture;
+    int64_t now = data->timestamp;
+
+    if (z->awaiting_response) {
+        int64_t settled = z->irrigation_start + z->irrigation_duration + SETTLE_SECONDS;
+        if (now < settled) {
+            z->last_moisture = moisture;
+            z->last_time = now;
+            return;
+        }
+
+        // Gain net of the ET that happened while the dose soaked in
+        float lost = crop_et_between(z, z->irrigation_start, now) * z->params.moisture_per_mm;
+        float gain = (moisture - z->pre_irrigation_moisture + lost) / z->irrigation_duration;
+        if (gain > 0.0f) {
+            z->params.moisture_per_second += LEARN_ALPHA * (gain - z->params.moisture_per_second);
+        }
+        z->awaiting_response = false;
+        z->anchor_moisture = moisture;
+        z->anchor_time = now;
+    } else if (!z->have_sample) {
+        z->anchor_moisture = moisture;
+        z->anchor_time = now;
+    } else {
+        float etc = crop_et_between(z, z->anchor_time, now);
+        if (etc >= LEARN_MIN_ETC_MM) {
+            float drop = z->anchor_moisture - moisture;
+            float rate = drop > 0.0f ? drop / etc : 0.0f;
+            z->params.moisture_per_mm += LEARN_ALPHA * (rate - z->params.moisture_per_mm);
+            if (z->params.moisture_per_mm < 0.01f) {
+                z->params.moisture_per_mm = 0.01f;
+            }
+            z->anchor_moisture = moisture;
+            z->anchor_time = now;
+        } else if (moisture > z->anchor_moisture + 2.0f) {
+            // Rain or an unrecorded watering: restart the observation
+            z->anchor_moisture = moisture;
+            z->anchor_time = now;
+        }
+    }
+
+    z->have_sample = true;
+    z->last_moisture = moisture;
+    z->last_time = now;
+}
+
+esp_err_t et_predictor_init(float latitude_deg, float longitude_deg)
+{
+    if (latitude_deg < -90.0f || latitude_deg > 90.0f ||
+        longitude_deg < -180.0f || longitude_deg > 180.0f) {
+        ESP_LOGE(TAG, "Invalid site coordinates: %.2f, %.2f", latitude_deg, longitude_deg);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    s_latitude_rad = latitude_deg * (float)M_PI / 180.0f;
+    s_longitude_deg = longitude_deg;
+    s_have_today = false;
+    s_have_yesterday = false;
+    s_clear_sky_light = 0.0f;
+
+    memset(s_zones, 0, sizeof(s_zones));
+    for (int i = 0; i < ET_PREDICTOR_MAX_ZONES; i++) {
+        s_zones[i].params = s_default_zone_params;
+    }
+
+    ESP_LOGI(TAG, "ET predictor initialized for site %.2f, %.2f", latitude_deg, longitude_deg);
+    return ESP_OK;
+}
+
+esp_err_t et_predictor_set_zone_params(int zone, const et_zone_params_t *params)
+{
+    if (!zone_valid(zone) || params == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (params->crop_coefficient <= 0.0f || params->moisture_per_mm <= 0.0f ||
+        params->moisture_per_second <= 0.0f) {
+        ESP_LOGE(TAG, "Zone %d parameters must be positive", zone);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    s_zones[zone].params = *params;
+    return ESP_OK;
+}
+
+esp_err_t et_predictor_get_zone_params(int zone, et_zone_params_t *params)
+{
+    if (!zone_valid(zone) || params == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    *params = s_zones[zone].params;
+    return ESP_OK;
+}
+
+esp_err_t et_predictor_add_sample(int zone, const sensor_data_t *data)
+{
+    if (!zone_valid(zone) || data == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    update_weather(data);
+    update_zone(&s_zones[zone], data);
+    return ESP_OK;
+}
+
+esp_err_t et_predictor_note_irrigation(int zone, int64_t start_time, int duration)
+{
+    if (!zone_valid(zone) || duration <= 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    et_zone_t *z = &s_zones[zone];
+    if (z->awaiting_response && z->irrigation_start == start_time) {
+        // Same run stopped early: keep the pre-watering reading
+        z->irrigation_duration = duration;
+        return ESP_OK;
+    }
+
+    z->pre_irrigation_moisture = z->have_sample ? z->last_moisture : 0.0f;
+    z->irrigation_start = start_time;
+    z->irrigation_duration = duration;
+    z->awaiting_response = z->have_sample;
+    return ESP_OK;
+}
+
+float et_predictor_forecast_moisture(int zone, int64_t at_time)
+{
+    if (!zone_valid(zone) || !s_zones[zone].have_sample) {
+        return NAN;
+    }
+
+    const et_zone_t *z = &s_zones[zone];
+    float base = z->last_moisture;
+    int64_t base_time = z->last_time;
+
+    if (z->awaiting_response) {
+        // Sensor has not caught up with the dose yet, assume the learned gain
+        base = z->pre_irrigation_moisture + z->params.moisture_per_second * z->irrigation_duration;
+        base_time = z->irrigation_start;
+    }
+
+    if (at_time <= base_time) {
+        return base;
+    }
+    return base - crop_et_between(z, base_time, at_time) * z->params.moisture_per_mm;
+}
+
+esp_err_t et_predictor_plan_dose(int zone, int64_t now, float threshold,
+                                 int max_duration, et_dose_plan_t *plan)
+{
+    if (!zone_valid(zone) || plan == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(plan, 0, sizeof(*plan));
+    const et_zone_t *z = &s_zones[zone];
+    if (!z->have_sample) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Next pre-dawn window, or the current one if we are inside it
+    int64_t sunrise;
+    et_predictor_get_sun_times(now, &sunrise, NULL);
+    if (now >= sunrise) {
+        et_predictor_get_sun_times(now + SECONDS_PER_DAY, &sunrise, NULL);
+    }
+    plan->end_time = sunrise;
+    plan->start_time = sunrise - ET_PREDICTOR_WINDOW_SECONDS;
+    if (plan->start_time < now) {
+        plan->start_time = now;
+    }
+
+    // One dose per window
+    if (z->irrigation_duration > 0 &&
+        z->irrigation_start >= sunrise - ET_PREDICTOR_WINDOW_SECONDS) {
+        plan->forecast_moisture = et_predictor_forecast_moisture(zone, sunrise + SECONDS_PER_DAY);
+        return ESP_OK;
+    }
+
+    float target = z->params.target_moisture > 0.0f ? z->params.target_moisture : threshold + 5.0f;
+    plan->forecast_moisture = et_predictor_forecast_moisture(zone,
+                                  plan->end_time - ET_PREDICTOR_WINDOW_SECONDS + SECONDS_PER_DAY);
+
+    float deficit = target - plan->forecast_moisture;
+    if (deficit <= 0.0f) {
+        return ESP_OK;
+    }
+
+    int duration = (int)ceilf(deficit / z->params.moisture_per_second);
+    if (duration > max_duration) {
+        duration = max_duration;
+    }
+    if (duration >= ET_PREDICTOR_MIN_DOSE_SECONDS) {
+        plan->duration = duration;
+    }
+
+    ESP_LOGD(TAG, "Zone %d forecast %.1f%% at next window, dose %d s", zone,
+             plan->forecast_moisture, plan->duration);
+    return ESP_OK;
+}
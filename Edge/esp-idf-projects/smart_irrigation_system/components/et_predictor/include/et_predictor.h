@@ -0,0 +1,132 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "sensor_manager.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ET_PREDICTOR_MAX_ZONES          4
+#define ET_PREDICTOR_WINDOW_SECONDS     (2 * 3600)  // Off-peak window length before sunrise
+#define ET_PREDICTOR_MIN_DOSE_SECONDS   10          // Doses shorter than this are skipped
+
+/**
+ * @brief Per-zone soil and crop parameters
+ */
+typedef struct {
+    float crop_coefficient;     // Kc applied to reference ET (ETc = Kc * ET0)
+    float moisture_per_mm;      // Soil moisture % lost per mm of ETc (learned online)
+    float moisture_per_second;  // Soil moisture % gained per second of watering (learned online)
+    float target_moisture;      // Moisture the next window should still see after a dose
+} et_zone_params_t;
+
+/**
+ * @brief Pre-emptive dose planned for an off-peak window
+ */
+typedef struct {
+    int64_t start_time;         // Window start, seconds since epoch
+    int64_t end_time;           // Window end (sunrise), seconds since epoch
+    int duration;               // Dose length in seconds, 0 if no dose is needed
+    float forecast_moisture;    // Forecast moisture at the following window without a dose
+} et_dose_plan_t;
+
+/**
+ * @brief Initialize the ET predictor for a site
+ *
+ * @param latitude_deg Site latitude in degrees (north positive)
+ * @param longitude_deg Site longitude in degrees (east positive)
+ * @return ESP_OK on success
+ */
+esp_err_t et_predictor_init(float latitude_deg, float longitude_deg);
+
+/**
+ * @brief Set soil and crop parameters of a zone
+ *
+ * @param zone Zone index
+ * @param params Parameters to set
+ * @return ESP_OK on success
+ */
+esp_err_t et_predictor_set_zone_params(int zone, const et_zone_params_t *params);
+
+/**
+ * @brief Get soil and crop parameters of a zone, including learned rates
+ *
+ * @param zone Zone index
+ * @param params Pointer to parameter structure
+ * @return ESP_OK on success
+ */
+esp_err_t et_predictor_get_zone_params(int zone, et_zone_params_t *params);
+
+/**
+ * @brief Feed a sensor sample for a zone
+ *
+ * Weather fields update the daily temperature range and light statistics,
+ * soil moisture refines the zone's drydown and watering rates.
+ *
+ * @param zone Zone index
+ * @param data Sensor sample with a valid timestamp
+ * @return ESP_OK on success
+ */
+esp_err_t et_predictor_add_sample(int zone, const sensor_data_t *data);
+
+/**
+ * @brief Record that a zone was watered
+ *
+ * Calling again with the same start time updates the length of a run that
+ * was stopped early.
+ *
+ * @param zone Zone index
+ * @param start_time Watering start, seconds since epoch
+ * @param duration Watering length in seconds
+ * @return ESP_OK on success
+ */
+esp_err_t et_predictor_note_irrigation(int zone, int64_t start_time, int duration);
+
+/**
+ * @brief Get current reference evapotranspiration estimate
+ *
+ * @param timestamp Day to evaluate, seconds since epoch
+ * @return ET0 in mm/day
+ */
+float et_predictor_get_reference_et(int64_t timestamp);
+
+/**
+ * @brief Forecast soil moisture of a zone assuming no watering
+ *
+ * @param zone Zone index
+ * @param at_time Forecast time, seconds since epoch
+ * @return Forecast soil moisture in percentage
+ */
+float et_predictor_forecast_moisture(int zone, int64_t at_time);
+
+/**
+ * @brief Plan the next pre-emptive dose for a zone
+ *
+ * Doses are placed in the off-peak window that ends at sunrise and sized so
+ * that the forecast at the following window stays at the zone's target.
+ *
+ * @param zone Zone index
+ * @param now Current time, seconds since epoch
+ * @param threshold Soil moisture threshold that must not be crossed
+ * @param max_duration Upper bound for the dose in seconds
+ * @param plan Pointer to plan structure
+ * @return ESP_OK on success
+ */
+esp_err_t et_predictor_plan_dose(int zone, int64_t now, float threshold,
+                                 int max_duration, et_dose_plan_t *plan);
+
+/**
+ * @brief Compute sunrise and sunset for a day
+ *
+ * @param timestamp Any time within the day, seconds since epoch
+ * @param sunrise Pointer to sunrise time, seconds since epoch
+ * @param sunset Pointer to sunset time, seconds since epoch
+ */
+void et_predictor_get_sun_times(int64_t timestamp, int64_t *sunrise, int64_t *sunset);
+
+#ifdef __cplusplus
+}
+#endif
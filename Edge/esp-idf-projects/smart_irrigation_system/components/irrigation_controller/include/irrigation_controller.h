@@ -2,6 +2,7 @@
 
 #include "esp_err.h"
 #include "sensor_manager.h"
+#include "moisture_pid.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -25,6 +26,9 @@ typedef struct {
     int irrigation_duration;        // Duration in seconds
     int min_interval;              // Minimum interval between irrigations (seconds)
     bool auto_mode;                // Auto mode enabled
+    bool predictive_mode;          // Pre-emptive doses from the ET forecast
+    bool closed_loop;              // PID modulates flow instead of a fixed duration
+    float moisture_setpoint;       // Closed-loop target moisture
 } irrigation_config_t;
 
 /**
@@ -35,46 +39,60 @@ typedef struct {
 esp_err_t irrigation_controller_init(void);
 
 /**
- * @brief Update irrigation controller (call regularly)
+ * @brief Run the controller event loop (never returns)
  * 
- * @return ESP_OK on success
+ * Sensor samples, commands, timer expiries and faults are queued to this
+ * loop, which blocks until the next one arrives. Call from a dedicated task.
  */
-esp_err_t irrigation_controller_update(void);
+void irrigation_controller_run(void);
 
 /**
  * @brief Check irrigation conditions based on sensor data
  * 
+ * The sample is copied and evaluated by the controller task.
+ * 
  * @param sensor_data Sensor data to check
- * @return ESP_OK on success
+ * @return ESP_OK if queued
  */
 esp_err_t irrigation_controller_check_conditions(const sensor_data_t *sensor_data);
 
+/**
+ * @brief Report a fault that makes watering unsafe
+ * 
+ * Flow stops and the controller enters IRRIGATION_STATE_ERROR until the
+ * next valid sensor sample or an explicit stop.
+ * 
+ * @param reason Error that caused the fault
+ * @return ESP_OK if queued
+ */
+esp_err_t irrigation_controller_report_fault(esp_err_t reason);
+
 /**
  * @brief Start irrigation manually
  * 
  * @param duration Duration in seconds (0 for default)
- * @return ESP_OK on success
+ * @return ESP_OK if queued
  */
 esp_err_t irrigation_controller_start_manual(int duration);
 
 /**
  * @brief Stop irrigation
  * 
- * @return ESP_OK on success
+ * @return ESP_OK if queued
  */
 esp_err_t irrigation_controller_stop(void);
 
 /**
  * @brief Pause irrigation
  * 
- * @return ESP_OK on success
+ * @return ESP_OK if queued
  */
 esp_err_t irrigation_controller_pause(void);
 
 /**
  * @brief Resume irrigation
  * 
- * @return ESP_OK on success
+ * @return ESP_OK if queued
  */
 esp_err_t irrigation_controller_resume(void);
 
@@ -88,8 +106,11 @@ irrigation_state_t irrigation_controller_get_state(void);
 /**
  * @brief Set irrigation configuration
  * 
+ * Written through to system_config, which persists it and notifies the
+ * controller. Threshold and setpoint are stored in whole percent.
+ * 
  * @param config Configuration to set
- * @return ESP_OK on success
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if a value is out of range
  */
 esp_err_t irrigation_controller_set_config(const irrigation_config_t *config);
 
@@ -104,10 +125,39 @@ esp_err_t irrigation_controller_get_config(irrigation_config_t *config);
 /**
  * @brief Get remaining irrigation time
  * 
+ * In closed-loop mode this is the remaining flow allowance of the session.
+ * 
  * @return Remaining time in seconds
  */
 int irrigation_controller_get_remaining_time(void);
 
+/**
+ * @brief Tune the closed-loop gains from a step response
+ * 
+ * Applies one full-flow pulse and records the moisture response until it
+ * settles. Automatic watering is suspended while tuning.
+ * 
+ * @param pulse_seconds Pulse length in seconds (0 for default)
+ * @return ESP_OK if queued
+ */
+esp_err_t irrigation_controller_autotune(int pulse_seconds);
+
+/**
+ * @brief Set closed-loop PID gains
+ * 
+ * @param gains Gains to set
+ * @return ESP_OK on success
+ */
+esp_err_t irrigation_controller_set_pid_gains(const moisture_pid_gains_t *gains);
+
+/**
+ * @brief Get closed-loop PID gains
+ * 
+ * @param gains Pointer to gains structure
+ * @return ESP_OK on success
+ */
+esp_err_t irrigation_controller_get_pid_gains(moisture_pid_gains_t *gains);
+
 #ifdef __cplusplus
 }
 #endif
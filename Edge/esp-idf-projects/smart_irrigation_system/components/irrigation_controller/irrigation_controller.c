@@ -1,11 +1,19 @@
 #include "irrigation_controller.h"
 #include <stdio.h>
 #include <string.h>
+#include <sys/time.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
 #include "driver/gpio.h"
 #include "esp_log.h"
 #include "esp_timer.h"
+#include "et_predictor.h"
+#include "moisture_pid.h"
+#include "system_config.h"
+#ifdef CONFIG_IRRIGATION_PWM_PUMP
+#include "driver/ledc.h"
+#endif
 
 static const char *TAG = "IRRIGATION_CONTROLLER";
 
@@ -14,26 +22,101 @@ static const char *TAG = "IRRIGATION_CONTROLLER";
 #define VALVE_RELAY_PIN     GPIO_NUM_15
 #define STATUS_LED_PIN      GPIO_NUM_13
 
-// Controller state
-static irrigation_state_t s_current_state = IRRIGATION_STATE_IDLE;
-static irrigation_config_t s_config = {
-    .soil_moisture_threshold = CONFIG_SOIL_MOISTURE_THRESHOLD,
-    .irrigation_duration = CONFIG_IRRIGATION_DURATION,
-    .min_interval = 3600,  // 1 hour minimum interval
-    .auto_mode = true
-};
+// Hardware drives a single zone
+#define IRRIGATION_ZONE     0
+
+#ifdef CONFIG_IRRIGATION_PWM_PUMP
+#define PUMP_PWM_PIN        CONFIG_IRRIGATION_PWM_PUMP_PIN
+#define PUMP_PWM_MODE       LEDC_LOW_SPEED_MODE
+#define PUMP_PWM_TIMER      LEDC_TIMER_0
+#define PUMP_PWM_CHANNEL    LEDC_CHANNEL_0
+#define PUMP_PWM_FREQ_HZ    1000
+#define PUMP_PWM_MAX_DUTY   1023    // 10-bit resolution
+#endif
+
+// Closed-loop control
+#define CONTROL_MIN_PULSE_SECONDS       1   // Shorter valve pulses are skipped
+#define CONTROL_SETTLE_SAMPLES          3   // Samples at setpoint that end a session
+#define AUTOTUNE_DEFAULT_PULSE_SECONDS  60
+
+#define IRRIGATION_QUEUE_LENGTH         16
+
+typedef enum {
+    IRRIGATION_MSG_SENSOR_SAMPLE,
+    IRRIGATION_MSG_COMMAND,
+    IRRIGATION_MSG_TIMER_EXPIRY,
+    IRRIGATION_MSG_FAULT
+} irrigation_msg_type_t;
+
+typedef enum {
+    IRRIGATION_CMD_START,
+    IRRIGATION_CMD_STOP,
+    IRRIGATION_CMD_PAUSE,
+    IRRIGATION_CMD_RESUME,
+    IRRIGATION_CMD_AUTOTUNE
+} irrigation_cmd_t;
+
+typedef struct {
+    irrigation_msg_type_t type;
+    union {
+        sensor_data_t sample;
+        struct {
+            irrigation_cmd_t cmd;
+            int seconds;
+        } command;
+        uint32_t timer_generation;  // Stale expiries of a re-armed timer are dropped
+        esp_err_t fault;
+    };
+} irrigation_msg_t;
+
+// Controller state, written only by the controller task. Fields read by
+// other tasks are updated under s_lock.
+static QueueHandle_t s_queue = NULL;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static volatile irrigation_state_t s_current_state = IRRIGATION_STATE_IDLE;
+static irrigation_config_t s_config;        // Mirror of system_config, updated on change
+static float s_sample_period = CONFIG_SENSOR_READ_INTERVAL;
+
+// Closed-loop state, gains until the first auto-tune assume a loam with
+// ~0.04%/s watering gain, 2 minutes infiltration delay and 5 minutes lag
+static moisture_pid_gains_t s_pid_gains = { .kc = 0.046f, .ti = 0.0f, .td = 300.0f };
+static moisture_pid_t s_pid;
+static moisture_pid_autotune_t s_autotune;
+static bool s_autotuning = false;
+static bool s_closed_loop_session = false;
+static float s_session_on_time = 0.0f;      // Full-flow seconds delivered this session
+static int64_t s_last_control_time = 0;
+static int s_settle_count = 0;
+static float s_last_moisture = 0.0f;
+static bool s_have_moisture = false;
 
 // Timers
 static esp_timer_handle_t s_irrigation_timer;
+static volatile uint32_t s_timer_generation = 0;
 static int64_t s_irrigation_start_time = 0;
 static int64_t s_last_irrigation_time = 0;
-static int s_remaining_time = 0;
+static int64_t s_irrigation_start_epoch = 0;
+static int64_t s_run_deadline = 0;         // esp_timer time the open-loop run ends
+static int s_paused_remaining = 0;         // Seconds left when the run was paused
 
 // Function prototypes
 static void irrigation_timer_callback(void *arg);
+static void config_listener(const system_config_t *config, void *arg);
+static esp_err_t post_message(const irrigation_msg_t *msg);
+static esp_err_t post_command(irrigation_cmd_t cmd, int seconds);
+static void handle_sample(const sensor_data_t *sensor_data);
+static void handle_command(irrigation_cmd_t cmd, int seconds);
+static void set_state(irrigation_state_t state);
+static void arm_timer(uint64_t timeout_us);
+static void disarm_timer(void);
 static esp_err_t start_irrigation(int duration);
+static void end_run(void);
 static esp_err_t stop_irrigation(void);
+static esp_err_t start_closed_loop(const sensor_data_t *sensor_data);
+static esp_err_t closed_loop_step(const sensor_data_t *sensor_data);
+static void set_flow(float fraction);
 static esp_err_t update_status_led(void);
+static int64_t epoch_seconds(void);
 
 esp_err_t irrigation_controller_init(void)
 {
@@ -54,6 +137,28 @@ esp_err_t irrigation_controller_init(void)
     gpio_set_level(VALVE_RELAY_PIN, 0);
     gpio_set_level(STATUS_LED_PIN, 0);
     
+#ifdef CONFIG_IRRIGATION_PWM_PUMP
+    // Pump speed follows the controller output
+    ledc_timer_config_t pwm_timer = {
+        .speed_mode = PUMP_PWM_MODE,
+        .duty_resolution = LEDC_TIMER_10_BIT,
+        .timer_num = PUMP_PWM_TIMER,
+        .freq_hz = PUMP_PWM_FREQ_HZ,
+        .clk_cfg = LEDC_AUTO_CLK
+    };
+    ESP_ERROR_CHECK(ledc_timer_config(&pwm_timer));
+    
+    ledc_channel_config_t pwm_channel = {
+        .gpio_num = PUMP_PWM_PIN,
+        .speed_mode = PUMP_PWM_MODE,
+        .channel = PUMP_PWM_CHANNEL,
+        .timer_sel = PUMP_PWM_TIMER,
+        .duty = 0,
+        .hpoint = 0
+    };
+    ESP_ERROR_CHECK(ledc_channel_config(&pwm_channel));
+#endif
+    
     // Create irrigation timer
     const esp_timer_create_args_t irrigation_timer_args = {
         .callback = &irrigation_timer_callback,
@@ -67,16 +172,165 @@ esp_err_t irrigation_controller_init(void)
         return ret;
     }
     
+    ret = et_predictor_init(CONFIG_SITE_LATITUDE / 100.0f, CONFIG_SITE_LONGITUDE / 100.0f);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize ET predictor: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    
+    ret = system_config_subscribe(config_listener, NULL);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to subscribe to configuration: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    
+    moisture_pid_init(&s_pid, &s_pid_gains);
+    
+    s_queue = xQueueCreate(IRRIGATION_QUEUE_LENGTH, sizeof(irrigation_msg_t));
+    if (s_queue == NULL) {
+        ESP_LOGE(TAG, "Failed to create irrigation queue");
+        return ESP_ERR_NO_MEM;
+    }
+    
     s_current_state = IRRIGATION_STATE_IDLE;
     
     ESP_LOGI(TAG, "Irrigation controller initialized successfully");
     return ESP_OK;
 }
 
+static int64_t epoch_seconds(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec;
+}
+
+static void set_flow(float fraction)
+{
+    uint32_t on = fraction > 0.0f ? 1 : 0;
+    
+#ifdef CONFIG_IRRIGATION_PWM_PUMP
+    ledc_set_duty(PUMP_PWM_MODE, PUMP_PWM_CHANNEL, (uint32_t)(fraction * PUMP_PWM_MAX_DUTY));
+    ledc_update_duty(PUMP_PWM_MODE, PUMP_PWM_CHANNEL);
+#endif
+    
+    gpio_set_level(PUMP_RELAY_PIN, on);
+    gpio_set_level(VALVE_RELAY_PIN, on);
+}
+
 static void irrigation_timer_callback(void *arg)
 {
-    ESP_LOGI(TAG, "Irrigation timer expired, stopping irrigation");
-    stop_irrigation();
+    irrigation_msg_t msg = {
+        .type = IRRIGATION_MSG_TIMER_EXPIRY,
+        .timer_generation = s_timer_generation
+    };
+    post_message(&msg);
+}
+
+static void config_listener(const system_config_t *config, void *arg)
+{
+    irrigation_config_t mirror = {
+        .soil_moisture_threshold = config->soil_moisture_threshold,
+        .irrigation_duration = config->irrigation_duration_seconds,
+        .min_interval = config->min_irrigation_interval_seconds,
+        .auto_mode = config->auto_mode_enabled,
+        .predictive_mode = config->predictive_mode_enabled,
+        .closed_loop = config->closed_loop_enabled,
+        .moisture_setpoint = config->moisture_setpoint
+    };
+    
+    // Every event handler takes a fresh snapshot, so the change applies from the next event
+    portENTER_CRITICAL(&s_lock);
+    s_config = mirror;
+    s_sample_period = config->sensor_read_interval_seconds;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+static esp_err_t post_message(const irrigation_msg_t *msg)
+{
+    if (s_queue == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    if (xQueueSend(s_queue, msg, 0) != pdTRUE) {
+        ESP_LOGW(TAG, "Irrigation queue full, dropping message %d", msg->type);
+        return ESP_ERR_TIMEOUT;
+    }
+    
+    return ESP_OK;
+}
+
+static esp_err_t post_command(irrigation_cmd_t cmd, int seconds)
+{
+    irrigation_msg_t msg = {
+        .type = IRRIGATION_MSG_COMMAND,
+        .command = { .cmd = cmd, .seconds = seconds }
+    };
+    return post_message(&msg);
+}
+
+static void set_state(irrigation_state_t state)
+{
+    s_current_state = state;
+    update_status_led();
+}
+
+static void arm_timer(uint64_t timeout_us)
+{
+    esp_timer_stop(s_irrigation_timer);
+    s_timer_generation++;
+    esp_timer_start_once(s_irrigation_timer, timeout_us);
+}
+
+static void disarm_timer(void)
+{
+    esp_timer_stop(s_irrigation_timer);
+    s_timer_generation++;
+}
+
+void irrigation_controller_run(void)
+{
+    irrigation_msg_t msg;
+    
+    while (1) {
+        // Nothing to do between events, so block without a timeout
+        if (xQueueReceive(s_queue, &msg, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        
+        switch (msg.type) {
+            case IRRIGATION_MSG_SENSOR_SAMPLE:
+                handle_sample(&msg.sample);
+                break;
+            case IRRIGATION_MSG_COMMAND:
+                handle_command(msg.command.cmd, msg.command.seconds);
+                break;
+            case IRRIGATION_MSG_TIMER_EXPIRY:
+                if (msg.timer_generation != s_timer_generation) {
+                    break;
+                }
+                if (s_closed_loop_session) {
+                    // End of a time-proportioned pulse, the session continues
+                    set_flow(0.0f);
+                    break;
+                }
+                ESP_LOGI(TAG, "Irrigation timer expired, stopping irrigation");
+                stop_irrigation();
+                break;
+            case IRRIGATION_MSG_FAULT:
+                ESP_LOGE(TAG, "Fault reported: %s", esp_err_to_name(msg.fault));
+                // An idle fault must not count as a run, or min_interval
+                // would hold off auto watering after a transient sensor error
+                if (s_current_state == IRRIGATION_STATE_WATERING ||
+                    s_current_state == IRRIGATION_STATE_PAUSED) {
+                    ESP_LOGW(TAG, "Stopping irrigation");
+                    end_run();
+                }
+                s_autotuning = false;
+                set_state(IRRIGATION_STATE_ERROR);
+                break;
+        }
+    }
 }
 
 static esp_err_t start_irrigation(int duration)
@@ -89,37 +343,143 @@ static esp_err_t start_irrigation(int duration)
     ESP_LOGI(TAG, "Starting irrigation for %d seconds", duration);
     
     // Turn on pump and valve
-    gpio_set_level(PUMP_RELAY_PIN, 1);
-    gpio_set_level(VALVE_RELAY_PIN, 1);
+    set_flow(1.0f);
     
     // Start timer
-    esp_timer_start_once(s_irrigation_timer, duration * 1000000ULL); // Convert to microseconds
+    arm_timer(duration * 1000000ULL); // Convert to microseconds
     
     s_irrigation_start_time = esp_timer_get_time();
-    s_remaining_time = duration;
-    s_current_state = IRRIGATION_STATE_WATERING;
-    
-    update_status_led();
+    s_irrigation_start_epoch = epoch_seconds();
+    portENTER_CRITICAL(&s_lock);
+    s_run_deadline = s_irrigation_start_time + duration * 1000000LL;
+    portEXIT_CRITICAL(&s_lock);
+    et_predictor_note_irrigation(IRRIGATION_ZONE, s_irrigation_start_epoch, duration);
+    set_state(IRRIGATION_STATE_WATERING);
     
     return ESP_OK;
 }
 
-static esp_err_t stop_irrigation(void)
+/*
+ * Turn the flow off and close the books on the current run without
+ * starting the min_interval hold-off. Leaves the state to the caller.
+ */
+static void end_run(void)
 {
-    ESP_LOGI(TAG, "Stopping irrigation");
-    
     // Turn off pump and valve
-    gpio_set_level(PUMP_RELAY_PIN, 0);
-    gpio_set_level(VALVE_RELAY_PIN, 0);
+    set_flow(0.0f);
     
     // Stop timer
-    esp_timer_stop(s_irrigation_timer);
+    disarm_timer();
+    
+    if (s_current_state == IRRIGATION_STATE_WATERING || s_current_state == IRRIGATION_STATE_PAUSED) {
+        int elapsed = s_closed_loop_session ? (int)s_session_on_time :
+                      (int)((esp_timer_get_time() - s_irrigation_start_time) / 1000000);
+        if (elapsed > 0) {
+            et_predictor_note_irrigation(IRRIGATION_ZONE, s_irrigation_start_epoch, elapsed);
+        }
+    }
+    
+    portENTER_CRITICAL(&s_lock);
+    s_closed_loop_session = false;
+    s_run_deadline = 0;
+    s_paused_remaining = 0;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+static esp_err_t stop_irrigation(void)
+{
+    ESP_LOGI(TAG, "Stopping irrigation");
     
+    end_run();
     s_last_irrigation_time = esp_timer_get_time();
-    s_remaining_time = 0;
-    s_current_state = IRRIGATION_STATE_IDLE;
+    set_state(IRRIGATION_STATE_IDLE);
     
-    update_status_led();
+    return ESP_OK;
+}
+
+static esp_err_t start_closed_loop(const sensor_data_t *sensor_data)
+{
+    irrigation_config_t config;
+    irrigation_controller_get_config(&config);
+    
+    ESP_LOGI(TAG, "Starting closed-loop irrigation to %.2f%% (limit %d seconds)",
+             config.moisture_setpoint, config.irrigation_duration);
+    
+    moisture_pid_reset(&s_pid);
+    portENTER_CRITICAL(&s_lock);
+    s_closed_loop_session = true;
+    s_session_on_time = 0.0f;
+    portEXIT_CRITICAL(&s_lock);
+    s_settle_count = 0;
+    s_last_control_time = 0;
+    
+    s_irrigation_start_time = esp_timer_get_time();
+    s_irrigation_start_epoch = sensor_data->timestamp;
+    et_predictor_note_irrigation(IRRIGATION_ZONE, s_irrigation_start_epoch, config.irrigation_duration);
+    set_state(IRRIGATION_STATE_WATERING);
+    
+    return closed_loop_step(sensor_data);
+}
+
+static esp_err_t closed_loop_step(const sensor_data_t *sensor_data)
+{
+    irrigation_config_t config;
+    irrigation_controller_get_config(&config);
+    
+    // Output applies until the next sample
+    const float period = s_sample_period;
+    float dt = s_last_control_time > 0 ? (float)(sensor_data->timestamp - s_last_control_time) : 0.0f;
+    s_last_control_time = sensor_data->timestamp;
+    
+    portENTER_CRITICAL(&s_lock);
+    s_pid.gains = s_pid_gains;
+    portEXIT_CRITICAL(&s_lock);
+    float output = moisture_pid_update(&s_pid, config.moisture_setpoint,
+                                       sensor_data->soil_moisture, dt);
+    
+    if (sensor_data->soil_moisture >= config.moisture_setpoint) {
+        if (++s_settle_count >= CONTROL_SETTLE_SAMPLES) {
+            ESP_LOGI(TAG, "Setpoint reached after %.0f seconds of flow", s_session_on_time);
+            return stop_irrigation();
+        }
+    } else {
+        s_settle_count = 0;
+    }
+    
+    float budget = config.irrigation_duration - s_session_on_time;
+    if (budget <= 0.0f) {
+        ESP_LOGW(TAG, "Closed-loop flow limit reached at %.2f%% moisture", sensor_data->soil_moisture);
+        return stop_irrigation();
+    }
+    
+#ifdef CONFIG_IRRIGATION_PWM_PUMP
+    // Continuous flow at the controller output
+    if (output * period > budget) {
+        output = budget / period;
+    }
+    set_flow(output);
+    portENTER_CRITICAL(&s_lock);
+    s_session_on_time += output * period;
+    portEXIT_CRITICAL(&s_lock);
+#else
+    // Time-proportioning: full flow for a fraction of the sample period
+    float pulse = output * period;
+    if (pulse > budget) {
+        pulse = budget;
+    }
+    if (pulse >= CONTROL_MIN_PULSE_SECONDS) {
+        set_flow(1.0f);
+        arm_timer((uint64_t)(pulse * 1000000.0f));
+        portENTER_CRITICAL(&s_lock);
+        s_session_on_time += pulse;
+        portEXIT_CRITICAL(&s_lock);
+    } else {
+        disarm_timer();
+        set_flow(0.0f);
+    }
+#endif
+    
+    ESP_LOGD(TAG, "Closed loop: moisture %.2f%%, output %.2f", sensor_data->soil_moisture, output);
     
     return ESP_OK;
 }
@@ -146,109 +506,238 @@ static esp_err_t update_status_led(void)
     return ESP_OK;
 }
 
-esp_err_t irrigation_controller_update(void)
+esp_err_t irrigation_controller_check_conditions(const sensor_data_t *sensor_data)
 {
-    // Update remaining time
-    if (s_current_state == IRRIGATION_STATE_WATERING && s_irrigation_start_time > 0) {
-        int64_t elapsed = (esp_timer_get_time() - s_irrigation_start_time) / 1000000;
-        s_remaining_time = s_config.irrigation_duration - elapsed;
-        if (s_remaining_time < 0) {
-            s_remaining_time = 0;
-        }
+    if (sensor_data == NULL) {
+        return ESP_ERR_INVALID_ARG;
     }
     
-    return ESP_OK;
+    irrigation_msg_t msg = {
+        .type = IRRIGATION_MSG_SENSOR_SAMPLE,
+        .sample = *sensor_data
+    };
+    return post_message(&msg);
 }
 
-esp_err_t irrigation_controller_check_conditions(const sensor_data_t *sensor_data)
+esp_err_t irrigation_controller_report_fault(esp_err_t reason)
 {
-    if (!s_config.auto_mode) {
-        return ESP_OK;
+    irrigation_msg_t msg = {
+        .type = IRRIGATION_MSG_FAULT,
+        .fault = reason
+    };
+    return post_message(&msg);
+}
+
+static void handle_sample(const sensor_data_t *sensor_data)
+{
+    if (s_current_state == IRRIGATION_STATE_ERROR) {
+        ESP_LOGI(TAG, "Valid sensor sample received, clearing fault");
+        set_state(IRRIGATION_STATE_IDLE);
+    }
+    
+    // Keep the forecast current even while watering or in manual mode
+    et_predictor_add_sample(IRRIGATION_ZONE, sensor_data);
+    s_last_moisture = sensor_data->soil_moisture;
+    s_have_moisture = true;
+    
+    irrigation_config_t config;
+    irrigation_controller_get_config(&config);
+    
+    if (s_autotuning) {
+        // No automatic watering while the step response is recorded
+        moisture_pid_gains_t gains;
+        esp_err_t ret = moisture_pid_autotune_sample(&s_autotune, sensor_data->timestamp,
+                                                     sensor_data->soil_moisture, &gains);
+        if (ret == ESP_ERR_NOT_FINISHED) {
+            return;
+        }
+        
+        s_autotuning = false;
+        if (ret == ESP_OK) {
+            irrigation_controller_set_pid_gains(&gains);
+        } else {
+            ESP_LOGW(TAG, "Auto-tune failed, keeping previous gains");
+        }
+        return;
+    }
+    
+    if (s_closed_loop_session) {
+        if (s_current_state == IRRIGATION_STATE_WATERING) {
+            closed_loop_step(sensor_data);
+        }
+        return;
+    }
+    
+    if (!config.auto_mode) {
+        return;
     }
     
     if (s_current_state != IRRIGATION_STATE_IDLE) {
-        return ESP_OK;
+        return;
     }
     
     // Check if enough time has passed since last irrigation
     int64_t current_time = esp_timer_get_time();
     int64_t time_since_last = (current_time - s_last_irrigation_time) / 1000000;
     
-    if (time_since_last < s_config.min_interval) {
+    if (time_since_last < config.min_interval) {
         ESP_LOGD(TAG, "Not enough time since last irrigation: %lld seconds", time_since_last);
-        return ESP_OK;
+        return;
     }
     
     // Check soil moisture
-    if (sensor_data->soil_moisture < s_config.soil_moisture_threshold) {
+    if (sensor_data->soil_moisture < config.soil_moisture_threshold) {
         ESP_LOGI(TAG, "Soil moisture (%.2f%%) below threshold (%.2f%%), starting irrigation",
-                 sensor_data->soil_moisture, s_config.soil_moisture_threshold);
+                 sensor_data->soil_moisture, config.soil_moisture_threshold);
         
-        return start_irrigation(s_config.irrigation_duration);
+        if (config.closed_loop) {
+            start_closed_loop(sensor_data);
+        } else {
+            start_irrigation(config.irrigation_duration);
+        }
+        return;
     }
     
-    return ESP_OK;
+    if (config.predictive_mode) {
+        et_dose_plan_t plan;
+        esp_err_t ret = et_predictor_plan_dose(IRRIGATION_ZONE, sensor_data->timestamp,
+                                               config.soil_moisture_threshold,
+                                               config.irrigation_duration, &plan);
+        if (ret == ESP_OK && plan.duration > 0 && sensor_data->timestamp >= plan.start_time) {
+            ESP_LOGI(TAG, "Forecast moisture %.2f%% at next window, pre-emptive dose of %d seconds",
+                     plan.forecast_moisture, plan.duration);
+            start_irrigation(plan.duration);
+        }
+    }
 }
 
-esp_err_t irrigation_controller_start_manual(int duration)
+static void handle_command(irrigation_cmd_t cmd, int seconds)
 {
-    if (duration <= 0) {
-        duration = s_config.irrigation_duration;
+    switch (cmd) {
+        case IRRIGATION_CMD_START:
+            if (s_current_state == IRRIGATION_STATE_ERROR) {
+                ESP_LOGW(TAG, "Cannot start: controller in fault state");
+                break;
+            }
+            if (seconds <= 0) {
+                irrigation_config_t config;
+                irrigation_controller_get_config(&config);
+                seconds = config.irrigation_duration;
+            }
+            if (s_current_state == IRRIGATION_STATE_PAUSED ||
+                (s_current_state == IRRIGATION_STATE_WATERING && s_closed_loop_session)) {
+                // The manual run replaces the paused or closed-loop one, or the
+                // timer would only end a pulse and the session would go on
+                ESP_LOGI(TAG, "Ending the current run for manual irrigation");
+                end_run();
+                set_state(IRRIGATION_STATE_IDLE);
+            }
+            ESP_LOGI(TAG, "Starting manual irrigation for %d seconds", seconds);
+            start_irrigation(seconds);
+            break;
+            
+        case IRRIGATION_CMD_STOP:
+            s_autotuning = false;
+            stop_irrigation();
+            break;
+            
+        case IRRIGATION_CMD_PAUSE: {
+            if (s_current_state != IRRIGATION_STATE_WATERING) {
+                ESP_LOGW(TAG, "Cannot pause: irrigation not running");
+                break;
+            }
+            
+            ESP_LOGI(TAG, "Pausing irrigation");
+            
+            // Turn off pump and valve
+            set_flow(0.0f);
+            
+            // Stop timer
+            disarm_timer();
+            
+            int64_t left = s_run_deadline - esp_timer_get_time();
+            portENTER_CRITICAL(&s_lock);
+            s_paused_remaining = left > 0 ? (int)((left + 999999) / 1000000) : 0;
+            s_run_deadline = 0;
+            portEXIT_CRITICAL(&s_lock);
+            
+            set_state(IRRIGATION_STATE_PAUSED);
+            break;
+        }
+            
+        case IRRIGATION_CMD_RESUME:
+            if (s_current_state != IRRIGATION_STATE_PAUSED) {
+                ESP_LOGW(TAG, "Cannot resume: irrigation not paused");
+                break;
+            }
+            
+            ESP_LOGI(TAG, "Resuming irrigation");
+            
+            if (s_closed_loop_session) {
+                // Flow resumes with the next sensor sample
+                s_last_control_time = 0;
+                set_state(IRRIGATION_STATE_WATERING);
+                break;
+            }
+            
+            if (s_paused_remaining <= 0) {
+                stop_irrigation();
+                break;
+            }
+            
+            // Turn on pump and valve
+            set_flow(1.0f);
+            
+            // Restart timer with remaining time
+            arm_timer(s_paused_remaining * 1000000ULL);
+            portENTER_CRITICAL(&s_lock);
+            s_run_deadline = esp_timer_get_time() + s_paused_remaining * 1000000LL;
+            s_paused_remaining = 0;
+            portEXIT_CRITICAL(&s_lock);
+            
+            set_state(IRRIGATION_STATE_WATERING);
+            break;
+            
+        case IRRIGATION_CMD_AUTOTUNE:
+            if (s_current_state != IRRIGATION_STATE_IDLE || s_autotuning) {
+                ESP_LOGW(TAG, "Cannot auto-tune: controller busy");
+                break;
+            }
+            if (!s_have_moisture) {
+                ESP_LOGW(TAG, "Cannot auto-tune: no soil moisture reading yet");
+                break;
+            }
+            
+            if (seconds <= 0) {
+                seconds = AUTOTUNE_DEFAULT_PULSE_SECONDS;
+            }
+            
+            ESP_LOGI(TAG, "Starting auto-tune with a %d second pulse from %.2f%%", seconds, s_last_moisture);
+            moisture_pid_autotune_start(&s_autotune, epoch_seconds(), s_last_moisture, seconds);
+            s_autotuning = true;
+            start_irrigation(seconds);
+            break;
     }
-    
-    ESP_LOGI(TAG, "Starting manual irrigation for %d seconds", duration);
-    return start_irrigation(duration);
+}
+
+esp_err_t irrigation_controller_start_manual(int duration)
+{
+    return post_command(IRRIGATION_CMD_START, duration);
 }
 
 esp_err_t irrigation_controller_stop(void)
 {
-    return stop_irrigation();
+    return post_command(IRRIGATION_CMD_STOP, 0);
 }
 
 esp_err_t irrigation_controller_pause(void)
 {
-    if (s_current_state != IRRIGATION_STATE_WATERING) {
-        ESP_LOGW(TAG, "Cannot pause: irrigation not running");
-        return ESP_FAIL;
-    }
-    
-    ESP_LOGI(TAG, "Pausing irrigation");
-    
-    // Turn off pump and valve
-    gpio_set_level(PUMP_RELAY_PIN, 0);
-    gpio_set_level(VALVE_RELAY_PIN, 0);
-    
-    // Stop timer
-    esp_timer_stop(s_irrigation_timer);
-    
-    s_current_state = IRRIGATION_STATE_PAUSED;
-    update_status_led();
-    
-    return ESP_OK;
+    return post_command(IRRIGATION_CMD_PAUSE, 0);
 }
 
 esp_err_t irrigation_controller_resume(void)
 {
-    if (s_current_state != IRRIGATION_STATE_PAUSED) {
-        ESP_LOGW(TAG, "Cannot resume: irrigation not paused");
-        return ESP_FAIL;
-    }
-    
-    ESP_LOGI(TAG, "Resuming irrigation");
-    
-    // Turn on pump and valve
-    gpio_set_level(PUMP_RELAY_PIN, 1);
-    gpio_set_level(VALVE_RELAY_PIN, 1);
-    
-    // Restart timer with remaining time
-    if (s_remaining_time > 0) {
-        esp_timer_start_once(s_irrigation_timer, s_remaining_time * 1000000ULL);
-    }
-    
-    s_current_state = IRRIGATION_STATE_WATERING;
-    update_status_led();
-    
-    return ESP_OK;
+    return post_command(IRRIGATION_CMD_RESUME, 0);
 }
 
 irrigation_state_t irrigation_controller_get_state(void)
@@ -262,11 +751,28 @@ esp_err_t irrigation_controller_set_config(const irrigation_config_t *config)
         return ESP_ERR_INVALID_ARG;
     }
     
-    memcpy(&s_config, config, sizeof(irrigation_config_t));
+    // Stored by system_config, which notifies config_listener
+    system_config_t stored;
+    system_config_load(&stored);
+    stored.soil_moisture_threshold = (uint32_t)(config->soil_moisture_threshold + 0.5f);
+    stored.irrigation_duration_seconds = config->irrigation_duration;
+    stored.min_irrigation_interval_seconds = config->min_interval;
+    stored.auto_mode_enabled = config->auto_mode;
+    stored.predictive_mode_enabled = config->predictive_mode;
+    stored.closed_loop_enabled = config->closed_loop;
+    stored.moisture_setpoint = (uint32_t)(config->moisture_setpoint + 0.5f);
+    
+    esp_err_t ret = system_config_save(&stored);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to store configuration: %s", esp_err_to_name(ret));
+        return ret;
+    }
     
-    ESP_LOGI(TAG, "Configuration updated - Threshold: %.2f%%, Duration: %d seconds, Auto: %s",
-             s_config.soil_moisture_threshold, s_config.irrigation_duration,
-             s_config.auto_mode ? "enabled" : "disabled");
+    ESP_LOGI(TAG, "Configuration updated - Threshold: %.2f%%, Duration: %d seconds, Auto: %s, Predictive: %s, Closed loop: %s (%.2f%%)",
+             config->soil_moisture_threshold, config->irrigation_duration,
+             config->auto_mode ? "enabled" : "disabled",
+             config->predictive_mode ? "enabled" : "disabled",
+             config->closed_loop ? "enabled" : "disabled", config->moisture_setpoint);
     
     return ESP_OK;
 }
@@ -277,11 +783,56 @@ esp_err_t irrigation_controller_get_config(irrigation_config_t *config)
         return ESP_ERR_INVALID_ARG;
     }
     
+    portENTER_CRITICAL(&s_lock);
     memcpy(config, &s_config, sizeof(irrigation_config_t));
+    portEXIT_CRITICAL(&s_lock);
     return ESP_OK;
 }
 
 int irrigation_controller_get_remaining_time(void)
 {
-    return s_remaining_time;
+    // Derived on demand from the run deadline instead of a periodic tick
+    int remaining = 0;
+    
+    portENTER_CRITICAL(&s_lock);
+    if (s_closed_loop_session) {
+        remaining = s_config.irrigation_duration - (int)s_session_on_time;
+    } else if (s_run_deadline > 0) {
+        int64_t left = s_run_deadline - esp_timer_get_time();
+        remaining = left > 0 ? (int)((left + 999999) / 1000000) : 0;
+    } else {
+        remaining = s_paused_remaining;
+    }
+    portEXIT_CRITICAL(&s_lock);
+    
+    return remaining > 0 ? remaining : 0;
+}
+
+esp_err_t irrigation_controller_autotune(int pulse_seconds)
+{
+    return post_command(IRRIGATION_CMD_AUTOTUNE, pulse_seconds);
+}
+
+esp_err_t irrigation_controller_set_pid_gains(const moisture_pid_gains_t *gains)
+{
+    if (gains == NULL || gains->kc <= 0.0f || gains->ti < 0.0f || gains->td < 0.0f) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    portENTER_CRITICAL(&s_lock);
+    s_pid_gains = *gains;
+    portEXIT_CRITICAL(&s_lock);
+    return ESP_OK;
+}
+
+esp_err_t irrigation_controller_get_pid_gains(moisture_pid_gains_t *gains)
+{
+    if (gains == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    portENTER_CRITICAL(&s_lock);
+    *gains = s_pid_gains;
+    portEXIT_CRITICAL(&s_lock);
+    return ESP_OK;
 }
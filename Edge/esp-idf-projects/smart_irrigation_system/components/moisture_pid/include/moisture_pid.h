@@ -0,0 +1,112 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MOISTURE_PID_AUTOTUNE_SAMPLES   256
+
+/**
+ * @brief PID gains in standard form: u = Kc * (e + 1/Ti * int(e) + Td * de/dt)
+ */
+typedef struct {
+    float kc;                   // Proportional gain (output fraction per % moisture)
+    float ti;                   // Integral time in seconds (0 disables integral action)
+    float td;                   // Derivative time in seconds
+} moisture_pid_gains_t;
+
+/**
+ * @brief PID controller state for one zone
+ *
+ * Output is the fraction of full flow (0..1) applied until the next update.
+ */
+typedef struct {
+    moisture_pid_gains_t gains;
+    float output_min;
+    float output_max;
+    float integral;             // Integral term, already scaled to output units
+    float derivative;           // Filtered derivative term
+    float prev_measurement;
+    float output;               // Last saturated output
+    bool initialized;
+} moisture_pid_t;
+
+/**
+ * @brief Step-response auto-tuner state
+ *
+ * A single full-flow pulse is applied from steady state and the moisture
+ * response is fitted to an integrating process with dead time and lag.
+ */
+typedef struct {
+    int64_t pulse_start;        // Seconds
+    int pulse_seconds;
+    float baseline;
+    float peak;
+    int64_t last_rise;          // Last time the response set a new peak
+    int count;
+    int32_t offsets[MOISTURE_PID_AUTOTUNE_SAMPLES];    // Seconds after pulse start
+    float samples[MOISTURE_PID_AUTOTUNE_SAMPLES];
+    bool active;
+} moisture_pid_autotune_t;
+
+/**
+ * @brief Initialize a PID controller
+ *
+ * @param pid Controller state
+ * @param gains Initial gains
+ */
+void moisture_pid_init(moisture_pid_t *pid, const moisture_pid_gains_t *gains);
+
+/**
+ * @brief Clear integral and derivative history, keeping gains
+ *
+ * @param pid Controller state
+ */
+void moisture_pid_reset(moisture_pid_t *pid);
+
+/**
+ * @brief Run one control step
+ *
+ * Uses derivative on measurement and back-calculation anti-windup.
+ *
+ * @param pid Controller state
+ * @param setpoint Target soil moisture in percentage
+ * @param measurement Measured soil moisture in percentage
+ * @param dt Seconds since the previous update
+ * @return Output fraction between output_min and output_max
+ */
+float moisture_pid_update(moisture_pid_t *pid, float setpoint, float measurement, float dt);
+
+/**
+ * @brief Start a step-response auto-tune
+ *
+ * The caller applies full flow for pulse_seconds starting at now.
+ *
+ * @param tune Auto-tuner state
+ * @param now Current time in seconds
+ * @param baseline Moisture before the pulse
+ * @param pulse_seconds Pulse length in seconds
+ */
+void moisture_pid_autotune_start(moisture_pid_autotune_t *tune, int64_t now,
+                                 float baseline, int pulse_seconds);
+
+/**
+ * @brief Feed a moisture sample to the auto-tuner
+ *
+ * @param tune Auto-tuner state
+ * @param now Sample time in seconds
+ * @param measurement Measured soil moisture in percentage
+ * @param gains Receives tuned gains once the response has settled
+ * @return ESP_OK when tuning finished, ESP_ERR_NOT_FINISHED while sampling,
+ *         ESP_ERR_INVALID_RESPONSE if the pulse produced no usable rise
+ */
+esp_err_t moisture_pid_autotune_sample(moisture_pid_autotune_t *tune, int64_t now,
+                                       float measurement, moisture_pid_gains_t *gains);
+
+#ifdef __cplusplus
+}
+#endif
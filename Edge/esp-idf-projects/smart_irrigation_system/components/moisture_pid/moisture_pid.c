@@ -0,0 +1,173 @@
+/*
+ * Moisture PID Component Implementation
+ *
+ * Soil behaves as an integrating process: water added stays in the root zone
+ * and reaches the probe after an infiltration delay and lag. Tuning follows the
+ * SIMC rules for an integrating process with dead time and one lag
+ * (Skogestad 2003). Watering cannot be undone, so the tuner leaves integral
+ * action off: an integrating plant tracks the setpoint without it and the
+ * integral only adds overshoot. Manual gains may still enable it.
+ */
+
+#include "moisture_pid.h"
+#include <math.h>
+#include <string.h>
+#include <esp_log.h>
+
+static const char *TAG = "MOISTURE_PID";
+
+#define DERIVATIVE_FILTER_N         8.0f    // Derivative filter time = Td / N
+#define AUTOTUNE_SETTLE_SECONDS     900     // No new peak for this long ends the test
+#define AUTOTUNE_TIMEOUT_SECONDS    (3 * 3600)
+#define AUTOTUNE_MIN_RISE           1.0f    // Smaller rises are within sensor noise
+#define AUTOTUNE_NOISE              0.3f    // Rise needed to count as a new peak
+
+void moisture_pid_init(moisture_pid_t *pid, const moisture_pid_gains_t *gains)
+{
+    memset(pid, 0, sizeof(*pid));
+    pid->gains = *gains;
+    pid->output_min = 0.0f;
+    pid->output_max = 1.0f;
+}
+
+void moisture_pid_reset(moisture_pid_t *pid)
+{
+    pid->integral = 0.0f;
+    pid->derivative = 0.0f;
+    pid->output = 0.0f;
+    pid->initialized = false;
+}
+
+float moisture_pid_update(moisture_pid_t *pid, float setpoint, float measurement, float dt)
+{
+    const moisture_pid_gains_t *g = &pid->gains;
+    float error = setpoint - measurement;
+
+    if (!pid->initialized || dt <= 0.0f) {
+        pid->prev_measurement = measurement;
+        pid->derivative = 0.0f;
+        pid->initialized = true;
+        dt = 0.0f;
+    }
+
+    // Derivative on measurement avoids a kick when the setpoint changes
+    if (g->td > 0.0f && dt > 0.0f) {
+        float tf = g->td / DERIVATIVE_FILTER_N;
+        float raw = -g->kc * g->td * (measurement - pid->prev_measurement) / dt;
+        pid->derivative += dt / (tf + dt) * (raw - pid->derivative);
+    }
+    pid->prev_measurement = measurement;
+
+    float proportional = g->kc * error;
+    float unsaturated = proportional + pid->integral + pid->derivative;
+    float output = unsaturated;
+    if (output > pid->output_max) output = pid->output_max;
+    if (output < pid->output_min) output = pid->output_min;
+
+    // Back-calculation: bleed the integral while the output is saturated
+    if (g->ti > 0.0f && dt > 0.0f) {
+        float tracking = g->td > 0.0f ? sqrtf(g->ti * g->td) : g->ti;
+        pid->integral += dt * (g->kc * error / g->ti + (output - unsaturated) / tracking);
+    }
+
+    pid->output = output;
+    return output;
+}
+
+void moisture_pid_autotune_start(moisture_pid_autotune_t *tune, int64_t now,
+                                 float baseline, int pulse_seconds)
+{
+    memset(tune, 0, sizeof(*tune));
+    tune->pulse_start = now;
+    tune->pulse_seconds = pulse_seconds;
+    tune->baseline = baseline;
+    tune->peak = baseline;
+    tune->last_rise = now;
+    tune->active = true;
+}
+
+/* Three-point median keeps single noisy readings from setting the peak */
+static float filtered_sample(const moisture_pid_autotune_t *tune, int i)
+{
+    if (i < 2) {
+        return tune->samples[i];
+    }
+
+    float a = tune->samples[i - 2];
+    float b = tune->samples[i - 1];
+    float c = tune->samples[i];
+    return fmaxf(fminf(a, b), fminf(fmaxf(a, b), c));
+}
+
+/* First time the response reaches a level, interpolated between samples */
+static float crossing_time(const moisture_pid_autotune_t *tune, float level)
+{
+    for (int i = 1; i < tune->count; i++) {
+        float y0 = filtered_sample(tune, i - 1);
+        float y1 = filtered_sample(tune, i);
+        if (y1 >= level && y0 < level) {
+            float f = (level - y0) / (y1 - y0);
+            return tune->offsets[i - 1] + f * (tune->offsets[i] - tune->offsets[i - 1]);
+        }
+    }
+    return -1.0f;
+}
+
+esp_err_t moisture_pid_autotune_sample(moisture_pid_autotune_t *tune, int64_t now,
+                                       float measurement, moisture_pid_gains_t *gains)
+{
+    if (!tune->active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    int64_t offset = now - tune->pulse_start;
+    if (tune->count < MOISTURE_PID_AUTOTUNE_SAMPLES) {
+        tune->offsets[tune->count] = (int32_t)offset;
+        tune->samples[tune->count] = measurement;
+        tune->count++;
+    }
+    measurement = filtered_sample(tune, tune->count - 1);
+
+    if (measurement > tune->peak + AUTOTUNE_NOISE) {
+        tune->peak = measurement;
+        tune->last_rise = now;
+    } else if (measurement > tune->peak) {
+        tune->peak = measurement;
+    }
+
+    bool settled = offset > tune->pulse_seconds &&
+                   now - tune->last_rise >= AUTOTUNE_SETTLE_SECONDS;
+    bool full = tune->count >= MOISTURE_PID_AUTOTUNE_SAMPLES;
+    if (!settled && !full && offset < AUTOTUNE_TIMEOUT_SECONDS) {
+        return ESP_ERR_NOT_FINISHED;
+    }
+    tune->active = false;
+
+    float rise = tune->peak - tune->baseline;
+    if (rise < AUTOTUNE_MIN_RISE) {
+        ESP_LOGW(TAG, "Pulse of %d s raised moisture by only %.2f%%", tune->pulse_seconds, rise);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    // Treat the pulse as an impulse at its midpoint: y = k P (1 - exp(-(t - theta) / tau))
+    float t10 = crossing_time(tune, tune->baseline + 0.10f * rise);
+    float t63 = crossing_time(tune, tune->baseline + 0.63f * rise);
+    if (t10 < 0.0f || t63 <= t10) {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    float k = rise / tune->pulse_seconds;           // % per second at full flow
+    float tau = (t63 - t10) / 0.895f;
+    float theta = t63 - tune->pulse_seconds / 2.0f - tau;
+    if (theta < 0.0f) theta = 0.0f;
+
+    // SIMC PD: derivative cancels the lag, a slow closed loop absorbs the delay
+    float tau_c = theta + tau;
+    gains->kc = 1.0f / (k * (tau_c + theta));
+    gains->ti = 0.0f;
+    gains->td = tau;
+
+    ESP_LOGI(TAG, "Step response: gain %.4f %%/s, dead time %.0f s, lag %.0f s -> Kc %.3f, Ti %.0f s, Td %.0f s",
+             k, theta, tau, gains->kc, gains->ti, gains->td);
+    return ESP_OK;
+}
@@ -1,6 +1,13 @@
 /*
  * MQTT Client Manager Component
  * Handles MQTT client connections and messaging
+ *
+ * Remote configuration: JSON merge patches sent to irrigation/<id>/config/set
+ * are applied atomically, the outcome goes to irrigation/<id>/config/result
+ * and the full configuration with its etag is retained on irrigation/<id>/config.
+ *
+ * Sensor data and alarms go through the outbox (mqtt_outbox.h), alarms on
+ * irrigation/<id>/alarm are sent ahead of queued readings.
  */
 
 #ifndef MQTT_CLIENT_MANAGER_H
@@ -40,11 +47,23 @@ esp_err_t mqtt_client_handle_events(void);
 
 /**
  * @brief Publish sensor data to MQTT broker
+ *
+ * The reading is queued in the outbox and sent with QoS1 once connected,
+ * it survives link drops and reboots until the broker acknowledges it.
+ *
  * @param data Sensor data to publish
- * @return ESP_OK on success
+ * @return ESP_OK once queued
  */
 esp_err_t mqtt_client_publish_sensor_data(const sensor_data_t *data);
 
+/**
+ * @brief Publish an alarm, ahead of any queued sensor data
+ * @param type Alarm type, e.g. "sensor_fault"
+ * @param detail Human readable detail
+ * @return ESP_OK once queued
+ */
+esp_err_t mqtt_client_publish_alarm(const char *type, const char *detail);
+
 /**
  * @brief Subscribe to MQTT topic
  * @param topic Topic to subscribe to
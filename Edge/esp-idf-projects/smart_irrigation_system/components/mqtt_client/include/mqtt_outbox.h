@@ -0,0 +1,157 @@
+/*
+ * MQTT Outbox
+ * QoS1 publishing with a bounded in-flight window
+ *
+ * Messages are kept until the broker acknowledges them: in RAM, and in NVS
+ * when persistence is on and they wait for longer than
+ * MQTT_OUTBOX_PERSIST_DELAY_MS, so they survive a reboot. Each message carries a
+ * sequence number that is stable across retransmits and reboots. A message
+ * may reach the broker twice, e.g. when the link drops before its PUBACK
+ * arrives, and consumers drop repeats by sequence number. Higher priority
+ * messages are sent first, so an alarm overtakes queued telemetry.
+ */
+
+#ifndef MQTT_OUTBOX_H
+#define MQTT_OUTBOX_H
+
+#include <esp_err.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MQTT_OUTBOX_MAX_MESSAGES    64
+#define MQTT_OUTBOX_MAX_BYTES       (16 * 1024)     // Topics and payloads held at once
+#define MQTT_OUTBOX_MAX_WINDOW      16
+#define MQTT_OUTBOX_MAX_RULES       8               // Topic priority rules
+
+// Unacknowledged for this long, a message is written to NVS
+#ifndef MQTT_OUTBOX_PERSIST_DELAY_MS
+#define MQTT_OUTBOX_PERSIST_DELAY_MS    1000
+#endif
+
+/**
+ * @brief Message priority, higher is sent first
+ */
+typedef enum {
+    MQTT_PRIORITY_LOW,
+    MQTT_PRIORITY_NORMAL,
+    MQTT_PRIORITY_HIGH
+} mqtt_priority_t;
+
+/**
+ * @brief Hands one message to the MQTT client
+ *
+ * Called without the outbox lock held.
+ *
+ * @return Message ID of the QoS1 PUBLISH, or -1 if the client did not take it
+ */
+typedef int (*mqtt_outbox_publish_t)(const char *topic, const char *data, int len, bool retain, void *arg);
+
+/**
+ * @brief Outbox configuration
+ */
+typedef struct {
+    uint8_t window;                 // Messages awaiting PUBACK at once
+    bool persist;                   // Keep unacknowledged messages in NVS
+    mqtt_outbox_publish_t publish;
+    void *arg;
+} mqtt_outbox_config_t;
+
+/**
+ * @brief Outbox statistics
+ */
+typedef struct {
+    uint32_t queued;                // Messages held now
+    uint32_t in_flight;             // Of those, sent and awaiting PUBACK
+    uint32_t bytes;                 // Bytes held now
+    uint32_t enqueued;
+    uint32_t restored;              // Loaded from NVS at start-up
+    uint32_t stored;                // Written to NVS
+    uint32_t sent;                  // PUBLISH packets, retransmits included
+    uint32_t retransmits;           // Sent again after a reconnect
+    uint32_t acked;
+    uint32_t rejected;              // Turned away with the outbox full
+} mqtt_outbox_stats_t;
+
+/**
+ * @brief Initialize the outbox
+ *
+ * Loads messages left in NVS by the last run when persistence is on. NVS
+ * must be initialized first.
+ *
+ * @param config Outbox configuration
+ * @return ESP_OK on success
+ */
+esp_err_t mqtt_outbox_init(const mqtt_outbox_config_t *config);
+
+/**
+ * @brief Set the priority of topics starting with a prefix
+ *
+ * The longest matching prefix wins, other topics are MQTT_PRIORITY_NORMAL.
+ *
+ * @param topic_prefix Topic prefix
+ * @param priority Priority of matching topics
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if the rule table is full
+ */
+esp_err_t mqtt_outbox_set_topic_priority(const char *topic_prefix, mqtt_priority_t priority);
+
+/**
+ * @brief Reserve a sequence number to embed in a payload before queueing it
+ * @return Sequence number, never 0
+ */
+uint32_t mqtt_outbox_reserve_seq(void);
+
+/**
+ * @brief Queue a message
+ *
+ * Returns once the message is queued, it is sent when the window allows.
+ * Without a session it is written to NVS first.
+ *
+ * @param topic Topic
+ * @param data Payload
+ * @param len Payload length
+ * @param retain Retain flag
+ * @param seq Sequence number from mqtt_outbox_reserve_seq(), or 0 to assign one
+ * @return ESP_OK once stored, ESP_ERR_NO_MEM if the outbox is full
+ */
+esp_err_t mqtt_outbox_enqueue(const char *topic, const char *data, size_t len, bool retain, uint32_t seq);
+
+/**
+ * @brief Session started, messages awaiting PUBACK are sent again
+ */
+void mqtt_outbox_connected(void);
+
+/**
+ * @brief Session lost, sending stops until mqtt_outbox_connected()
+ *
+ * Messages not yet in NVS are written there.
+ */
+void mqtt_outbox_disconnected(void);
+
+/**
+ * @brief PUBACK received
+ * @param msg_id Message ID of the acknowledged PUBLISH
+ */
+void mqtt_outbox_acked(int msg_id);
+
+/**
+ * @brief Send queued messages while the window has room
+ */
+void mqtt_outbox_pump(void);
+
+/**
+ * @brief Get outbox statistics
+ * @param stats Pointer to statistics structure
+ * @return ESP_OK on success
+ */
+esp_err_t mqtt_outbox_get_stats(mqtt_outbox_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MQTT_OUTBOX_H
@@ -3,15 +3,79 @@
  */
 
 #include "mqtt_client_manager.h"
+#include "mqtt_outbox.h"
 #include <string.h>
 #include <esp_log.h>
 #include <cJSON.h>
 #include <sys/time.h>
+#include "system_config.h"
 
 static const char *TAG = "MQTT_CLIENT_MANAGER";
 
+#define CONFIG_ERROR_LEN    64
+#define OUTBOX_WINDOW       4       // QoS1 publishes awaiting PUBACK at once
+
 static esp_mqtt_client_handle_t s_mqtt_client = NULL;
 static bool s_mqtt_connected = false;
+static char s_config_topic[64];
+static char s_config_set_topic[64];
+static char s_config_result_topic[64];
+static char s_sensor_topic[64];
+static char s_alarm_topic[64];
+
+/* Retained state lets a dashboard read the config and its etag at any time */
+static void publish_config_state(void)
+{
+    char *json_string = system_config_to_json();
+    if (json_string == NULL) {
+        ESP_LOGE(TAG, "Failed to serialize configuration");
+        return;
+    }
+
+    esp_mqtt_client_publish(s_mqtt_client, s_config_topic, json_string, 0, 1, 1);
+    free(json_string);
+}
+
+static void config_listener(const system_config_t *config, void *arg)
+{
+    if (s_mqtt_client != NULL && s_mqtt_connected) {
+        publish_config_state();
+    }
+}
+
+static void handle_config_patch(const char *data, int len)
+{
+    char error[CONFIG_ERROR_LEN] = "";
+    uint32_t etag = 0;
+    esp_err_t err = system_config_apply_patch(data, len, &etag, error, sizeof(error));
+
+    cJSON *json = cJSON_CreateObject();
+    if (json == NULL) {
+        return;
+    }
+
+    char etag_string[9];
+    if (err != ESP_OK) {
+        system_config_t config;
+        system_config_load(&config);
+        etag = system_config_etag(&config);
+    }
+    snprintf(etag_string, sizeof(etag_string), "%08lx", (unsigned long)etag);
+
+    cJSON_AddStringToObject(json, "status", err == ESP_OK ? "applied" :
+                            err == ESP_ERR_INVALID_STATE ? "conflict" : "rejected");
+    cJSON_AddStringToObject(json, "etag", etag_string);
+    if (err != ESP_OK) {
+        cJSON_AddStringToObject(json, "error", error);
+    }
+
+    char *json_string = cJSON_PrintUnformatted(json);
+    if (json_string != NULL) {
+        esp_mqtt_client_publish(s_mqtt_client, s_config_result_topic, json_string, 0, 1, 0);
+        free(json_string);
+    }
+    cJSON_Delete(json);
+}
 
 static esp_err_t mqtt_event_handler_cb(esp_mqtt_event_handle_t event)
 {
@@ -19,10 +83,14 @@ static esp_err_t mqtt_event_handler_cb(esp_mqtt_event_handle_t event)
         case MQTT_EVENT_CONNECTED:
             ESP_LOGI(TAG, "MQTT_EVENT_CONNECTED");
             s_mqtt_connected = true;
+            esp_mqtt_client_subscribe(s_mqtt_client, s_config_set_topic, 1);
+            publish_config_state();
+            mqtt_outbox_connected();
             break;
         case MQTT_EVENT_DISCONNECTED:
             ESP_LOGI(TAG, "MQTT_EVENT_DISCONNECTED");
             s_mqtt_connected = false;
+            mqtt_outbox_disconnected();
             break;
         case MQTT_EVENT_SUBSCRIBED:
             ESP_LOGI(TAG, "MQTT_EVENT_SUBSCRIBED, msg_id=%d", event->msg_id);
@@ -32,9 +100,16 @@ static esp_err_t mqtt_event_handler_cb(esp_mqtt_event_handle_t event)
             break;
         case MQTT_EVENT_PUBLISHED:
             ESP_LOGI(TAG, "MQTT_EVENT_PUBLISHED, msg_id=%d", event->msg_id);
+            mqtt_outbox_acked(event->msg_id);
             break;
         case MQTT_EVENT_DATA:
             ESP_LOGI(TAG, "MQTT_EVENT_DATA");
+            // Patches fit in one event, larger payloads arrive fragmented and are ignored
+            if (event->topic_len == (int)strlen(s_config_set_topic) &&
+                strncmp(event->topic, s_config_set_topic, event->topic_len) == 0 &&
+                event->current_data_offset == 0 && event->data_len == event->total_data_len) {
+                handle_config_patch(event->data, event->data_len);
+            }
             break;
         case MQTT_EVENT_ERROR:
             ESP_LOGI(TAG, "MQTT_EVENT_ERROR");
@@ -46,6 +121,11 @@ static esp_err_t mqtt_event_handler_cb(esp_mqtt_event_handle_t event)
     return ESP_OK;
 }
 
+static int outbox_publish(const char *topic, const char *data, int len, bool retain, void *arg)
+{
+    return esp_mqtt_client_publish(s_mqtt_client, topic, data, len, 1, retain);
+}
+
 static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data)
 {
     mqtt_event_handler_cb(event_data);
@@ -55,6 +135,12 @@ esp_err_t mqtt_client_init(void)
 {
     ESP_LOGI(TAG, "Initializing MQTT Client");
     
+    snprintf(s_config_topic, sizeof(s_config_topic), "irrigation/%s/config", CONFIG_DEVICE_ID);
+    snprintf(s_config_set_topic, sizeof(s_config_set_topic), "irrigation/%s/config/set", CONFIG_DEVICE_ID);
+    snprintf(s_config_result_topic, sizeof(s_config_result_topic), "irrigation/%s/config/result", CONFIG_DEVICE_ID);
+    snprintf(s_sensor_topic, sizeof(s_sensor_topic), "irrigation/%s/sensors", CONFIG_DEVICE_ID);
+    snprintf(s_alarm_topic, sizeof(s_alarm_topic), "irrigation/%s/alarm", CONFIG_DEVICE_ID);
+    
     esp_mqtt_client_config_t mqtt_cfg = {
         .broker.address.uri = CONFIG_MQTT_BROKER_URL,
         .credentials.username = CONFIG_MQTT_USERNAME,
@@ -73,6 +159,22 @@ esp_err_t mqtt_client_init(void)
         return ret;
     }
     
+    // Any configuration change, remote or local, refreshes the retained state
+    system_config_subscribe(config_listener, NULL);
+    
+    // Readings and alarms go through the outbox and survive link drops and reboots
+    mqtt_outbox_config_t outbox_cfg = {
+        .window = OUTBOX_WINDOW,
+        .persist = true,
+        .publish = outbox_publish,
+    };
+    ret = mqtt_outbox_init(&outbox_cfg);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize MQTT outbox: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    mqtt_outbox_set_topic_priority(s_alarm_topic, MQTT_PRIORITY_HIGH);
+    
     ESP_LOGI(TAG, "MQTT Client initialized successfully");
     return ESP_OK;
 }
@@ -123,12 +225,12 @@ esp_err_t mqtt_client_handle_events(void)
 
 esp_err_t mqtt_client_publish_sensor_data(const sensor_data_t *data)
 {
-    if (s_mqtt_client == NULL || !s_mqtt_connected) {
-        ESP_LOGW(TAG, "MQTT client not connected");
+    if (s_mqtt_client == NULL) {
+        ESP_LOGE(TAG, "MQTT client not initialized");
         return ESP_FAIL;
     }
     
-    // Create JSON payload
+    // Create JSON payload, seq lets the consumer drop repeats after a reconnect
     cJSON *json = cJSON_CreateObject();
     if (json == NULL) {
         ESP_LOGE(TAG, "Failed to create JSON object");
@@ -141,31 +243,57 @@ esp_err_t mqtt_client_publish_sensor_data(const sensor_data_t *data)
     cJSON_AddNumberToObject(json, "water_level", data->water_level);
     cJSON_AddNumberToObject(json, "light_level", data->light_level);
     cJSON_AddNumberToObject(json, "timestamp", (double)data->timestamp);
+    uint32_t seq = mqtt_outbox_reserve_seq();
+    cJSON_AddNumberToObject(json, "seq", seq);
     
-    char *json_string = cJSON_Print(json);
+    char *json_string = cJSON_PrintUnformatted(json);
+    cJSON_Delete(json);
     if (json_string == NULL) {
         ESP_LOGE(TAG, "Failed to print JSON");
-        cJSON_Delete(json);
         return ESP_FAIL;
     }
     
-    // Publish to topic
-    char topic[64];
-    snprintf(topic, sizeof(topic), "irrigation/%s/sensors", CONFIG_DEVICE_ID);
+    esp_err_t ret = mqtt_outbox_enqueue(s_sensor_topic, json_string, strlen(json_string), false, seq);
+    free(json_string);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to queue sensor data: %s", esp_err_to_name(ret));
+        return ret;
+    }
     
-    int msg_id = esp_mqtt_client_publish(s_mqtt_client, topic, json_string, 0, 1, 0);
-    if (msg_id == -1) {
-        ESP_LOGE(TAG, "Failed to publish sensor data");
-        free(json_string);
-        cJSON_Delete(json);
+    ESP_LOGI(TAG, "Queued sensor data, seq=%lu", (unsigned long)seq);
+    return ESP_OK;
+}
+
+esp_err_t mqtt_client_publish_alarm(const char *type, const char *detail)
+{
+    if (s_mqtt_client == NULL) {
+        ESP_LOGE(TAG, "MQTT client not initialized");
+        return ESP_FAIL;
+    }
+    
+    cJSON *json = cJSON_CreateObject();
+    if (json == NULL) {
         return ESP_FAIL;
     }
     
-    ESP_LOGI(TAG, "Published sensor data, msg_id=%d", msg_id);
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    uint32_t seq = mqtt_outbox_reserve_seq();
+    cJSON_AddStringToObject(json, "type", type);
+    cJSON_AddStringToObject(json, "detail", detail);
+    cJSON_AddNumberToObject(json, "timestamp", (double)tv.tv_sec);
+    cJSON_AddNumberToObject(json, "seq", seq);
     
-    free(json_string);
+    char *json_string = cJSON_PrintUnformatted(json);
     cJSON_Delete(json);
-    return ESP_OK;
+    if (json_string == NULL) {
+        return ESP_FAIL;
+    }
+    
+    // The alarm topic is high priority, so this overtakes queued readings
+    esp_err_t ret = mqtt_outbox_enqueue(s_alarm_topic, json_string, strlen(json_string), false, seq);
+    free(json_string);
+    return ret;
 }
 
 esp_err_t mqtt_client_subscribe(const char *topic)
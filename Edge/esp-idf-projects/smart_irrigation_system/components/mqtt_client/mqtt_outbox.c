@@ -0,0 +1,587 @@
+/*
+ * MQTT Outbox Implementation
+ *
+ * Messages sit in a fixed slot table, the next one to send is the unsent
+ * message with the highest priority and then the lowest sequence number.
+ * The MQTT client is called without the outbox lock held: its event task
+ * holds the client lock while delivering PUBACKs to mqtt_outbox_acked(),
+ * so holding ours across a publish could deadlock. A PUBACK can therefore
+ * arrive before the publishing task has recorded the message ID, such
+ * acknowledgements are parked until it has.
+ *
+ * Most messages are acknowledged within a round trip, so a message is only
+ * written to NVS once it has waited MQTT_OUTBOX_PERSIST_DELAY_MS, when it is
+ * queued or left unacknowledged without a session, or on esp_restart(). A
+ * power cut loses at most the messages younger than the delay.
+ */
+
+#include "mqtt_outbox.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "nvs_flash.h"
+#include "nvs.h"
+
+static const char *TAG = "MQTT_OUTBOX";
+
+#define NVS_NAMESPACE   "mqtt_outbox"
+#define NVS_SEQ_KEY     "seq"
+#define SEQ_BLOCK       256     // Sequence numbers reserved per NVS write
+#define EARLY_ACKS      8
+
+typedef struct {
+    char *topic;                // NULL for a free slot
+    char *data;
+    size_t len;
+    uint32_t seq;
+    uint8_t priority;
+    bool retain;
+    bool sending;               // Handed to the client, message ID not recorded yet
+    bool sent_before;
+    bool stored;                // Written to NVS
+    int msg_id;                 // -1 until sent in this session
+    int64_t queued_at;          // esp_timer time, us
+} outbox_entry_t;
+
+// Stored before the topic and payload in each NVS blob
+typedef struct {
+    uint32_t seq;
+    uint8_t priority;
+    uint8_t retain;
+    uint16_t topic_len;
+    uint32_t len;
+} outbox_record_t;
+
+typedef struct {
+    char prefix[64];
+    size_t prefix_len;
+    mqtt_priority_t priority;
+} priority_rule_t;
+
+static SemaphoreHandle_t s_lock = NULL;
+static mqtt_outbox_config_t s_config;
+static outbox_entry_t s_entries[MQTT_OUTBOX_MAX_MESSAGES];
+static uint32_t s_count = 0;
+static uint32_t s_bytes = 0;
+static uint32_t s_in_flight = 0;
+static bool s_connected = false;
+static uint32_t s_session = 0;
+static int s_early_acks[EARLY_ACKS];
+static uint8_t s_early_count = 0;
+static uint32_t s_next_seq = 1;
+static uint32_t s_seq_limit = 1;    // Persisted block ends here
+static priority_rule_t s_rules[MQTT_OUTBOX_MAX_RULES];
+static uint8_t s_rule_count = 0;
+static mqtt_outbox_stats_t s_stats;
+
+static void record_key(uint32_t seq, char *key)
+{
+    snprintf(key, 16, "m%08lx", (unsigned long)seq);
+}
+
+static esp_err_t store_entry(const outbox_entry_t *e)
+{
+    size_t topic_len = strlen(e->topic);
+    size_t size = sizeof(outbox_record_t) + topic_len + e->len;
+    uint8_t *blob = malloc(size);
+    if (blob == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    outbox_record_t record = {
+        .seq = e->seq,
+        .priority = e->priority,
+        .retain = e->retain,
+        .topic_len = topic_len,
+        .len = e->len
+    };
+    memcpy(blob, &record, sizeof(record));
+    memcpy(blob + sizeof(record), e->topic, topic_len);
+    memcpy(blob + sizeof(record) + topic_len, e->data, e->len);
+
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err == ESP_OK) {
+        char key[16];
+        record_key(e->seq, key);
+        err = nvs_set_blob(nvs_handle, key, blob, size);
+        if (err == ESP_OK) {
+            err = nvs_commit(nvs_handle);
+        }
+        nvs_close(nvs_handle);
+    }
+    free(blob);
+    return err;
+}
+
+// Writes the messages due for NVS, all of them when forced. Called with the
+// lock held; one that fails is tried again on the next call.
+static void store_due(bool force)
+{
+    int64_t now = esp_timer_get_time();
+    for (int i = 0; i < MQTT_OUTBOX_MAX_MESSAGES; i++) {
+        outbox_entry_t *e = &s_entries[i];
+        if (e->topic == NULL || e->stored ||
+            (!force && now - e->queued_at < MQTT_OUTBOX_PERSIST_DELAY_MS * 1000LL)) {
+            continue;
+        }
+        esp_err_t err = store_entry(e);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to store message: %s", esp_err_to_name(err));
+            return;
+        }
+        e->stored = true;
+        s_stats.stored++;
+    }
+}
+
+// esp_restart() runs this before the reset
+static void store_on_restart(void)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    store_due(true);
+    xSemaphoreGive(s_lock);
+}
+
+static void erase_entry(uint32_t seq)
+{
+    nvs_handle_t nvs_handle;
+    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle) != ESP_OK) {
+        return;
+    }
+    char key[16];
+    record_key(seq, key);
+    if (nvs_erase_key(nvs_handle, key) == ESP_OK) {
+        nvs_commit(nvs_handle);
+    }
+    nvs_close(nvs_handle);
+}
+
+// Sequence numbers never repeat across reboots: a block is reserved in NVS
+// before any of it is handed out
+static uint32_t next_seq(void)
+{
+    if (s_config.persist && s_next_seq >= s_seq_limit) {
+        nvs_handle_t nvs_handle;
+        if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle) == ESP_OK) {
+            s_seq_limit = s_next_seq + SEQ_BLOCK;
+            nvs_set_u32(nvs_handle, NVS_SEQ_KEY, s_seq_limit);
+            nvs_commit(nvs_handle);
+            nvs_close(nvs_handle);
+        }
+    }
+
+    uint32_t seq = s_next_seq++;
+    if (s_next_seq == 0) {
+        s_next_seq = 1;
+    }
+    return seq;
+}
+
+static outbox_entry_t *free_slot(void)
+{
+    for (int i = 0; i < MQTT_OUTBOX_MAX_MESSAGES; i++) {
+        if (s_entries[i].topic == NULL) {
+            return &s_entries[i];
+        }
+    }
+    return NULL;
+}
+
+static void release(outbox_entry_t *e)
+{
+    s_bytes -= strlen(e->topic) + e->len;
+    s_count--;
+    free(e->topic);
+    free(e->data);
+    memset(e, 0, sizeof(*e));
+}
+
+static void restore(void)
+{
+    nvs_handle_t nvs_handle;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs_handle) != ESP_OK) {
+        return;     // Nothing stored yet
+    }
+
+    uint32_t limit = 1;
+    if (nvs_get_u32(nvs_handle, NVS_SEQ_KEY, &limit) == ESP_OK) {
+        s_next_seq = s_seq_limit = limit;
+    }
+
+    nvs_iterator_t it = NULL;
+    esp_err_t res = nvs_entry_find(NVS_DEFAULT_PART_NAME, NVS_NAMESPACE, NVS_TYPE_BLOB, &it);
+    while (res == ESP_OK) {
+        nvs_entry_info_t info;
+        nvs_entry_info(it, &info);
+        res = nvs_entry_next(&it);
+
+        size_t size = 0;
+        if (nvs_get_blob(nvs_handle, info.key, NULL, &size) != ESP_OK || size < sizeof(outbox_record_t)) {
+            continue;
+        }
+        uint8_t *blob = malloc(size);
+        outbox_entry_t *e = free_slot();
+        if (blob == NULL || e == NULL || nvs_get_blob(nvs_handle, info.key, blob, &size) != ESP_OK) {
+            free(blob);
+            ESP_LOGE(TAG, "Could not restore %s", info.key);
+            continue;
+        }
+
+        outbox_record_t record;
+        memcpy(&record, blob, sizeof(record));
+        if (sizeof(record) + record.topic_len + record.len != size) {
+            free(blob);
+            ESP_LOGE(TAG, "Corrupt record %s", info.key);
+            continue;
+        }
+
+        e->topic = malloc(record.topic_len + 1);
+        e->data = malloc(record.len ? record.len : 1);
+        if (e->topic == NULL || e->data == NULL) {
+            free(e->topic);
+            free(e->data);
+            e->topic = NULL;
+            free(blob);
+            continue;
+        }
+        memcpy(e->topic, blob + sizeof(record), record.topic_len);
+        e->topic[record.topic_len] = '\0';
+        memcpy(e->data, blob + sizeof(record) + record.topic_len, record.len);
+        e->len = record.len;
+        e->seq = record.seq;
+        e->priority = record.priority;
+        e->retain = record.retain;
+        e->sent_before = true;  // May have reached the broker before the reboot
+        e->stored = true;
+        e->msg_id = -1;
+        free(blob);
+
+        s_count++;
+        s_bytes += record.topic_len + record.len;
+        s_stats.restored++;
+        if (record.seq >= s_next_seq) {
+            s_next_seq = record.seq + 1;
+        }
+    }
+    nvs_release_iterator(it);
+    nvs_close(nvs_handle);
+
+    if (s_stats.restored) {
+        ESP_LOGI(TAG, "Restored %lu unacknowledged messages", (unsigned long)s_stats.restored);
+    }
+}
+
+esp_err_t mqtt_outbox_init(const mqtt_outbox_config_t *config)
+{
+    if (config == NULL || config->publish == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (s_lock == NULL) {
+        s_lock = xSemaphoreCreateMutex();
+        if (s_lock == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    s_config = *config;
+    if (s_config.window == 0) {
+        s_config.window = 1;
+    } else if (s_config.window > MQTT_OUTBOX_MAX_WINDOW) {
+        s_config.window = MQTT_OUTBOX_MAX_WINDOW;
+    }
+
+    if (s_config.persist) {
+        restore();
+        esp_register_shutdown_handler(store_on_restart);
+    }
+
+    ESP_LOGI(TAG, "Outbox ready, window %u, %lu messages pending",
+             s_config.window, (unsigned long)s_count);
+    return ESP_OK;
+}
+
+esp_err_t mqtt_outbox_set_topic_priority(const char *topic_prefix, mqtt_priority_t priority)
+{
+    if (topic_prefix == NULL || strlen(topic_prefix) >= sizeof(s_rules[0].prefix)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_rule_count >= MQTT_OUTBOX_MAX_RULES) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    priority_rule_t *rule = &s_rules[s_rule_count++];
+    strcpy(rule->prefix, topic_prefix);
+    rule->prefix_len = strlen(topic_prefix);
+    rule->priority = priority;
+    return ESP_OK;
+}
+
+static mqtt_priority_t topic_priority(const char *topic)
+{
+    mqtt_priority_t priority = MQTT_PRIORITY_NORMAL;
+    size_t best = 0;
+    for (int i = 0; i < s_rule_count; i++) {
+        if (s_rules[i].prefix_len > best && strncmp(topic, s_rules[i].prefix, s_rules[i].prefix_len) == 0) {
+            best = s_rules[i].prefix_len;
+            priority = s_rules[i].priority;
+        }
+    }
+    return priority;
+}
+
+uint32_t mqtt_outbox_reserve_seq(void)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    uint32_t seq = next_seq();
+    xSemaphoreGive(s_lock);
+    return seq;
+}
+
+esp_err_t mqtt_outbox_enqueue(const char *topic, const char *data, size_t len, bool retain, uint32_t seq)
+{
+    if (topic == NULL || (data == NULL && len > 0)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_lock == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    size_t size = strlen(topic) + len;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    outbox_entry_t *e = free_slot();
+    if (e == NULL || s_bytes + size > MQTT_OUTBOX_MAX_BYTES) {
+        s_stats.rejected++;
+        xSemaphoreGive(s_lock);
+        ESP_LOGW(TAG, "Outbox full, message to %s rejected", topic);
+        return ESP_ERR_NO_MEM;
+    }
+
+    e->topic = strdup(topic);
+    e->data = malloc(len ? len : 1);
+    if (e->topic == NULL || e->data == NULL) {
+        free(e->topic);
+        free(e->data);
+        e->topic = NULL;
+        xSemaphoreGive(s_lock);
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(e->data, data, len);
+    e->len = len;
+    e->seq = seq ? seq : next_seq();
+    e->priority = topic_priority(topic);
+    e->retain = retain;
+    e->sending = false;
+    e->sent_before = false;
+    e->stored = false;
+    e->msg_id = -1;
+    e->queued_at = esp_timer_get_time();
+
+    // Without a session it may wait long, accepted only once it would survive a reboot
+    if (s_config.persist && !s_connected) {
+        esp_err_t err = store_entry(e);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to store message: %s", esp_err_to_name(err));
+            free(e->topic);
+            free(e->data);
+            memset(e, 0, sizeof(*e));
+            xSemaphoreGive(s_lock);
+            return err;
+        }
+        e->stored = true;
+        s_stats.stored++;
+    }
+
+    s_count++;
+    s_bytes += size;
+    s_stats.enqueued++;
+    xSemaphoreGive(s_lock);
+
+    mqtt_outbox_pump();
+    return ESP_OK;
+}
+
+static outbox_entry_t *next_to_send(void)
+{
+    outbox_entry_t *best = NULL;
+    for (int i = 0; i < MQTT_OUTBOX_MAX_MESSAGES; i++) {
+        outbox_entry_t *e = &s_entries[i];
+        if (e->topic == NULL || e->sending || e->msg_id >= 0) {
+            continue;
+        }
+        if (best == NULL || e->priority > best->priority ||
+            (e->priority == best->priority && (int32_t)(e->seq - best->seq) < 0)) {
+            best = e;
+        }
+    }
+    return best;
+}
+
+static void complete(outbox_entry_t *e)
+{
+    s_in_flight--;
+    s_stats.acked++;
+    if (e->stored) {
+        erase_entry(e->seq);
+    }
+    release(e);
+}
+
+static bool take_early_ack(int msg_id)
+{
+    for (int i = 0; i < s_early_count; i++) {
+        if (s_early_acks[i] == msg_id) {
+            s_early_acks[i] = s_early_acks[--s_early_count];
+            return true;
+        }
+    }
+    return false;
+}
+
+void mqtt_outbox_pump(void)
+{
+    if (s_lock == NULL) {
+        return;
+    }
+
+    while (true) {
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        if (s_config.persist) {
+            store_due(false);
+        }
+        outbox_entry_t *e = NULL;
+        if (s_connected && s_in_flight < s_config.window) {
+            e = next_to_send();
+        }
+        if (e == NULL) {
+            xSemaphoreGive(s_lock);
+            return;
+        }
+        e->sending = true;
+        s_in_flight++;
+        uint32_t session = s_session;
+        const char *topic = e->topic;
+        const char *data = e->data;
+        int len = e->len;
+        bool retain = e->retain;
+        xSemaphoreGive(s_lock);
+
+        int msg_id = s_config.publish(topic, data, len, retain, s_config.arg);
+
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        e->sending = false;
+        if (msg_id < 0 || session != s_session) {
+            // Not taken, or the session it went out on is gone: send again later
+            s_in_flight--;
+            xSemaphoreGive(s_lock);
+            if (msg_id < 0) {
+                return;
+            }
+            continue;
+        }
+
+        s_stats.sent++;
+        if (e->sent_before) {
+            s_stats.retransmits++;
+        }
+        e->sent_before = true;
+        if (take_early_ack(msg_id)) {
+            complete(e);
+        } else {
+            e->msg_id = msg_id;
+        }
+        xSemaphoreGive(s_lock);
+    }
+}
+
+void mqtt_outbox_connected(void)
+{
+    if (s_lock == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_connected = true;
+    xSemaphoreGive(s_lock);
+
+    mqtt_outbox_pump();
+}
+
+void mqtt_outbox_disconnected(void)
+{
+    if (s_lock == NULL) {
+        return;
+    }
+
+    // Unacknowledged messages go again in the next session
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_connected = false;
+    s_session++;
+    s_early_count = 0;
+    for (int i = 0; i < MQTT_OUTBOX_MAX_MESSAGES; i++) {
+        if (s_entries[i].topic != NULL && s_entries[i].msg_id >= 0) {
+            s_entries[i].msg_id = -1;
+            s_in_flight--;
+        }
+    }
+    if (s_config.persist) {
+        store_due(true);
+    }
+    xSemaphoreGive(s_lock);
+}
+
+void mqtt_outbox_acked(int msg_id)
+{
+    if (s_lock == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    bool found = false;
+    bool sending = false;
+    for (int i = 0; i < MQTT_OUTBOX_MAX_MESSAGES; i++) {
+        outbox_entry_t *e = &s_entries[i];
+        if (e->topic == NULL) {
+            continue;
+        }
+        if (e->msg_id == msg_id) {
+            complete(e);
+            found = true;
+            break;
+        }
+        sending |= e->sending;
+    }
+
+    // Raced ahead of the publishing task, which takes it from here
+    if (!found && sending && s_early_count < EARLY_ACKS) {
+        s_early_acks[s_early_count++] = msg_id;
+    }
+    xSemaphoreGive(s_lock);
+
+    mqtt_outbox_pump();
+}
+
+esp_err_t mqtt_outbox_get_stats(mqtt_outbox_stats_t *stats)
+{
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_lock == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    *stats = s_stats;
+    stats->queued = s_count;
+    stats->in_flight = s_in_flight;
+    stats->bytes = s_bytes;
+    xSemaphoreGive(s_lock);
+    return ESP_OK;
+}
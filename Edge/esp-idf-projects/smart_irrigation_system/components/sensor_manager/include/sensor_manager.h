@@ -26,6 +26,15 @@ typedef struct {
  */
 esp_err_t sensor_manager_init(void);
 
+/**
+ * @brief Set soil moisture probe calibration
+ * 
+ * @param dry ADC reading in dry soil
+ * @param wet ADC reading in saturated soil
+ * @return ESP_OK on success
+ */
+esp_err_t sensor_manager_set_calibration(uint16_t dry, uint16_t wet);
+
 /**
  * @brief Read all sensor data
  * 
@@ -21,8 +21,8 @@ static adc_oneshot_unit_handle_t s_adc2_handle;
 #define ADC_WATER_LEVEL_CHANNEL     ADC_CHANNEL_0  // GPIO36
 
 // Sensor calibration values
-static const int SOIL_MOISTURE_DRY = 4095;    // ADC value when dry
-static const int SOIL_MOISTURE_WET = 1500;    // ADC value when wet
+static volatile int s_soil_moisture_dry = 4095;    // ADC value when dry
+static volatile int s_soil_moisture_wet = 1500;    // ADC value when wet
 
 esp_err_t sensor_manager_init(void)
 {
@@ -76,6 +76,19 @@ esp_err_t sensor_manager_init(void)
     return ESP_OK;
 }
 
+esp_err_t sensor_manager_set_calibration(uint16_t dry, uint16_t wet)
+{
+    if (dry <= wet) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    s_soil_moisture_dry = dry;
+    s_soil_moisture_wet = wet;
+    
+    ESP_LOGI(TAG, "Soil moisture calibration set - Dry: %u, Wet: %u", dry, wet);
+    return ESP_OK;
+}
+
 esp_err_t sensor_manager_read_all(sensor_data_t *sensor_data)
 {
     if (sensor_data == NULL) {
@@ -179,7 +192,9 @@ esp_err_t sensor_manager_read_soil_moisture(float *soil_moisture)
     
     // Convert ADC reading to percentage (0-100%)
     // Higher ADC value means drier soil, so we invert the calculation
-    *soil_moisture = 100.0f - ((float)(adc_raw - SOIL_MOISTURE_WET) / (SOIL_MOISTURE_DRY - SOIL_MOISTURE_WET) * 100.0f);
+    int dry = s_soil_moisture_dry;
+    int wet = s_soil_moisture_wet;
+    *soil_moisture = 100.0f - ((float)(adc_raw - wet) / (dry - wet) * 100.0f);
     
     // Clamp to valid range
     if (*soil_moisture < 0.0f) *soil_moisture = 0.0f;
@@ -1,6 +1,10 @@
 /*
  * System Configuration Component
  * Handles system configuration and NVS storage
+ *
+ * The configuration is loaded from NVS once into a RAM cache. Reads return a
+ * consistent snapshot of the cache, saves update it immediately and reach
+ * flash after a short debounce so bursts of changes cost one write.
  */
 
 #ifndef SYSTEM_CONFIG_H
@@ -9,46 +13,142 @@
 #include <esp_err.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+#define SYSTEM_CONFIG_VERSION           2       // Stored schema version, bump on layout changes
+#define SYSTEM_CONFIG_MAX_SUBSCRIBERS   8
+#define SYSTEM_CONFIG_SAVE_DELAY_MS     2000    // Quiet time before a change is written
+#define SYSTEM_CONFIG_MAX_DEFER_MS      30000   // Upper bound on how long a change stays unsaved
+
 /**
  * @brief System configuration structure
  */
 typedef struct {
     uint32_t soil_moisture_threshold;
-    uint32_t max_irrigation_time_minutes;
+    uint32_t irrigation_duration_seconds;
     uint32_t sensor_read_interval_seconds;
     uint32_t mqtt_publish_interval_seconds;
-    uint32_t min_irrigation_interval_minutes;
+    uint32_t min_irrigation_interval_seconds;
     bool safety_timeout_enabled;
     bool auto_mode_enabled;
+    bool predictive_mode_enabled;
+    bool closed_loop_enabled;
+    uint32_t moisture_setpoint;
     uint16_t soil_moisture_calibration_dry;
     uint16_t soil_moisture_calibration_wet;
 } system_config_t;
 
+/**
+ * @brief Change notification callback
+ *
+ * Called from the task that saved the change, after the cache is updated.
+ *
+ * @param config Snapshot of the new configuration
+ * @param arg User argument given at subscription
+ */
+typedef void (*system_config_listener_t)(const system_config_t *config, void *arg);
+
 /**
  * @brief Initialize system configuration
+ *
+ * Loads the stored configuration into the cache, migrating older schema
+ * versions. NVS must be initialized first.
+ *
  * @return ESP_OK on success
  */
 esp_err_t system_config_init(void);
 
 /**
- * @brief Load configuration from NVS
+ * @brief Get a snapshot of the cached configuration
  * @param config Pointer to configuration structure
  * @return ESP_OK on success
  */
 esp_err_t system_config_load(system_config_t *config);
 
 /**
- * @brief Save configuration to NVS
+ * @brief Update the configuration
+ *
+ * The cache and subscribers are updated immediately, the NVS write is
+ * deferred by SYSTEM_CONFIG_SAVE_DELAY_MS.
+ *
  * @param config Pointer to configuration structure
- * @return ESP_OK on success
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if validation fails
  */
 esp_err_t system_config_save(const system_config_t *config);
 
+/**
+ * @brief Update the configuration if nobody changed it in between
+ *
+ * Used for read-modify-write: take a snapshot, note its etag, modify the
+ * copy and save it conditionally.
+ *
+ * @param config Pointer to configuration structure
+ * @param etag Etag of the snapshot the change was based on
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if the configuration
+ *         changed since, ESP_ERR_INVALID_ARG if validation fails
+ */
+esp_err_t system_config_save_if_match(const system_config_t *config, uint32_t etag);
+
+/**
+ * @brief Compute the etag of a configuration
+ * @param config Pointer to configuration structure
+ * @return CRC32 of the configuration content
+ */
+uint32_t system_config_etag(const system_config_t *config);
+
+/**
+ * @brief Apply a JSON merge patch (RFC 7396) atomically
+ *
+ * Members name system_config_t fields, null restores a field's default.
+ * An optional "etag" member must match the current etag. Unknown fields,
+ * wrong types or out-of-range values reject the whole patch.
+ *
+ * @param json Patch document, need not be NUL terminated
+ * @param len Length of the document
+ * @param etag Receives the etag after the patch, may be NULL
+ * @param error Receives a short reason on failure, may be NULL
+ * @param error_len Size of the error buffer
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE on etag mismatch,
+ *         ESP_ERR_INVALID_ARG for a malformed or invalid patch
+ */
+esp_err_t system_config_apply_patch(const char *json, size_t len, uint32_t *etag,
+                                    char *error, size_t error_len);
+
+/**
+ * @brief Serialize the current configuration with its etag
+ * @return Newly allocated JSON string to be freed by the caller, NULL on error
+ */
+char *system_config_to_json(void);
+
+/**
+ * @brief Write a pending change to NVS now
+ * @return ESP_OK on success
+ */
+esp_err_t system_config_flush(void);
+
+/**
+ * @brief Check configuration values against their allowed ranges
+ * @param config Pointer to configuration structure
+ * @return ESP_OK if valid, ESP_ERR_INVALID_ARG otherwise
+ */
+esp_err_t system_config_validate(const system_config_t *config);
+
+/**
+ * @brief Subscribe to configuration changes
+ *
+ * The listener is called once with the current configuration before this
+ * function returns.
+ *
+ * @param listener Callback to register
+ * @param arg User argument passed to the callback
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if all slots are used
+ */
+esp_err_t system_config_subscribe(system_config_listener_t listener, void *arg);
+
 /**
  * @brief Reset configuration to defaults
  * @return ESP_OK on success
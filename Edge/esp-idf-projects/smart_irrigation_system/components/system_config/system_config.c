@@ -1,72 +1,159 @@
 #include <stdio.h>
 #include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_rom_crc.h"
 #include "nvs_flash.h"
 #include "nvs.h"
 #include "system_config.h"
 
 static const char *TAG = "SYSTEM_CONFIG";
 
+#define NVS_NAMESPACE   "system_config"
+#define NVS_KEY         "config"
+
 // Default configuration values
 static const system_config_t default_config = {
-    .soil_moisture_threshold = 30,
-    .max_irrigation_time_minutes = 10,
-    .sensor_read_interval_seconds = 30,
+    .soil_moisture_threshold = CONFIG_SOIL_MOISTURE_THRESHOLD,
+    .irrigation_duration_seconds = CONFIG_IRRIGATION_DURATION,
+    .sensor_read_interval_seconds = CONFIG_SENSOR_READ_INTERVAL,
     .mqtt_publish_interval_seconds = 60,
-    .min_irrigation_interval_minutes = 60,
+    .min_irrigation_interval_seconds = 3600,
     .safety_timeout_enabled = true,
     .auto_mode_enabled = true,
+#ifdef CONFIG_IRRIGATION_PREDICTIVE_MODE
+    .predictive_mode_enabled = true,
+#else
+    .predictive_mode_enabled = false,
+#endif
+#ifdef CONFIG_IRRIGATION_CLOSED_LOOP
+    .closed_loop_enabled = true,
+#else
+    .closed_loop_enabled = false,
+#endif
+    .moisture_setpoint = CONFIG_IRRIGATION_MOISTURE_SETPOINT,
     .soil_moisture_calibration_dry = 4095,
     .soil_moisture_calibration_wet = 1500
 };
 
-esp_err_t system_config_init(void)
+// Version 1 was stored as a bare struct without a version field
+typedef struct {
+    uint32_t soil_moisture_threshold;
+    uint32_t max_irrigation_time_minutes;
+    uint32_t sensor_read_interval_seconds;
+    uint32_t mqtt_publish_interval_seconds;
+    uint32_t min_irrigation_interval_minutes;
+    bool safety_timeout_enabled;
+    bool auto_mode_enabled;
+    uint16_t soil_moisture_calibration_dry;
+    uint16_t soil_moisture_calibration_wet;
+} system_config_v1_t;
+
+// Stored layout from version 2 on
+typedef struct {
+    uint32_t version;
+    system_config_t config;
+} system_config_record_t;
+
+typedef struct {
+    system_config_listener_t listener;
+    void *arg;
+} subscriber_t;
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static system_config_t s_config;            // Cache, guarded by s_lock
+static SemaphoreHandle_t s_flush_lock;      // Serializes NVS writes, held across flash I/O
+static system_config_t s_persisted;         // Last content known to be in NVS, guarded by s_flush_lock
+static subscriber_t s_subscribers[SYSTEM_CONFIG_MAX_SUBSCRIBERS];
+static int s_subscriber_count = 0;
+static bool s_initialized = false;
+
+// Deferred save
+static esp_timer_handle_t s_save_timer;
+static QueueHandle_t s_save_queue;          // Flush requests from the save timer
+static bool s_dirty = false;
+static int64_t s_dirty_since = 0;
+
+static void migrate_v1(const system_config_v1_t *old, system_config_t *config)
 {
-    ESP_LOGI(TAG, "System configuration initialized");
-    return ESP_OK;
+    *config = default_config;
+    config->soil_moisture_threshold = old->soil_moisture_threshold;
+    config->irrigation_duration_seconds = old->max_irrigation_time_minutes * 60;
+    config->sensor_read_interval_seconds = old->sensor_read_interval_seconds;
+    config->mqtt_publish_interval_seconds = old->mqtt_publish_interval_seconds;
+    config->min_irrigation_interval_seconds = old->min_irrigation_interval_minutes * 60;
+    config->safety_timeout_enabled = old->safety_timeout_enabled;
+    config->auto_mode_enabled = old->auto_mode_enabled;
+    config->soil_moisture_calibration_dry = old->soil_moisture_calibration_dry;
+    config->soil_moisture_calibration_wet = old->soil_moisture_calibration_wet;
 }
 
-esp_err_t system_config_load(system_config_t *config)
+/*
+ * Read the stored configuration. Returns ESP_OK with *migrated set when an
+ * older schema was converted and should be written back.
+ */
+static esp_err_t read_from_nvs(system_config_t *config, bool *migrated)
 {
-    if (config == NULL) {
-        ESP_LOGE(TAG, "Config pointer is NULL");
-        return ESP_ERR_INVALID_ARG;
-    }
+    *migrated = false;
     
     nvs_handle_t nvs_handle;
-    esp_err_t err = nvs_open("system_config", NVS_READONLY, &nvs_handle);
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs_handle);
     if (err != ESP_OK) {
-        ESP_LOGW(TAG, "Error opening NVS handle: %s, using defaults", esp_err_to_name(err));
-        *config = default_config;
-        return ESP_OK;
+        return err;
     }
     
-    size_t required_size = sizeof(system_config_t);
-    err = nvs_get_blob(nvs_handle, "config", config, &required_size);
+    size_t size = 0;
+    err = nvs_get_blob(nvs_handle, NVS_KEY, NULL, &size);
     if (err != ESP_OK) {
-        ESP_LOGW(TAG, "Error getting config: %s, using defaults", esp_err_to_name(err));
-        *config = default_config;
+        nvs_close(nvs_handle);
+        return err;
+    }
+    
+    if (size == sizeof(system_config_v1_t)) {
+        system_config_v1_t old;
+        err = nvs_get_blob(nvs_handle, NVS_KEY, &old, &size);
+        if (err == ESP_OK) {
+            ESP_LOGI(TAG, "Migrating configuration from version 1 to %d", SYSTEM_CONFIG_VERSION);
+            migrate_v1(&old, config);
+            *migrated = true;
+        }
+    } else if (size == sizeof(system_config_record_t)) {
+        system_config_record_t record;
+        err = nvs_get_blob(nvs_handle, NVS_KEY, &record, &size);
+        if (err == ESP_OK && record.version != SYSTEM_CONFIG_VERSION) {
+            ESP_LOGW(TAG, "Stored configuration version %u not supported", (unsigned)record.version);
+            err = ESP_ERR_INVALID_VERSION;
+        } else if (err == ESP_OK) {
+            *config = record.config;
+        }
+    } else {
+        ESP_LOGW(TAG, "Stored configuration has unexpected size %u", (unsigned)size);
+        err = ESP_ERR_INVALID_SIZE;
     }
     
     nvs_close(nvs_handle);
-    return ESP_OK;
+    return err;
 }
 
-esp_err_t system_config_save(const system_config_t *config)
+static esp_err_t write_to_nvs(const system_config_t *config)
 {
-    if (config == NULL) {
-        ESP_LOGE(TAG, "Config pointer is NULL");
-        return ESP_ERR_INVALID_ARG;
-    }
+    system_config_record_t record = {
+        .version = SYSTEM_CONFIG_VERSION,
+        .config = *config
+    };
     
     nvs_handle_t nvs_handle;
-    esp_err_t err = nvs_open("system_config", NVS_READWRITE, &nvs_handle);
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Error opening NVS handle: %s", esp_err_to_name(err));
         return err;
     }
     
-    err = nvs_set_blob(nvs_handle, "config", config, sizeof(system_config_t));
+    err = nvs_set_blob(nvs_handle, NVS_KEY, &record, sizeof(record));
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Error setting config: %s", esp_err_to_name(err));
         nvs_close(nvs_handle);
@@ -82,6 +169,271 @@ esp_err_t system_config_save(const system_config_t *config)
     return err;
 }
 
+static void save_timer_callback(void *arg)
+{
+    // The esp_timer task also fires the irrigation stop timer, so the flash
+    // write is left to the save task. A full queue means one is pending.
+    uint8_t request = 0;
+    xQueueSend(s_save_queue, &request, 0);
+}
+
+static void save_task(void *arg)
+{
+    uint8_t request;
+    while (1) {
+        if (xQueueReceive(s_save_queue, &request, portMAX_DELAY) == pdTRUE) {
+            system_config_flush();
+        }
+    }
+}
+
+static void notify_subscribers(void)
+{
+    subscriber_t subscribers[SYSTEM_CONFIG_MAX_SUBSCRIBERS];
+    system_config_t config;
+    int count;
+    
+    // Concurrent saves may notify in any order, so always send the latest
+    portENTER_CRITICAL(&s_lock);
+    config = s_config;
+    count = s_subscriber_count;
+    memcpy(subscribers, s_subscribers, count * sizeof(subscriber_t));
+    portEXIT_CRITICAL(&s_lock);
+    
+    for (int i = 0; i < count; i++) {
+        subscribers[i].listener(&config, subscribers[i].arg);
+    }
+}
+
+esp_err_t system_config_init(void)
+{
+    if (s_initialized) {
+        return ESP_OK;
+    }
+    
+    s_flush_lock = xSemaphoreCreateMutex();
+    if (s_flush_lock == NULL) {
+        ESP_LOGE(TAG, "Failed to create flush lock");
+        return ESP_ERR_NO_MEM;
+    }
+    
+    s_save_queue = xQueueCreate(1, sizeof(uint8_t));
+    if (s_save_queue == NULL ||
+        xTaskCreate(save_task, "config_save", 3072, NULL, 3, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create save task");
+        return ESP_ERR_NO_MEM;
+    }
+    
+    const esp_timer_create_args_t save_timer_args = {
+        .callback = &save_timer_callback,
+        .arg = NULL,
+        .name = "config_save"
+    };
+    esp_err_t err = esp_timer_create(&save_timer_args, &s_save_timer);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create save timer: %s", esp_err_to_name(err));
+        return err;
+    }
+    
+    system_config_t config;
+    bool migrated = false;
+    err = read_from_nvs(&config, &migrated);
+    if (err == ESP_OK && system_config_validate(&config) != ESP_OK) {
+        ESP_LOGW(TAG, "Stored configuration out of range");
+        err = ESP_ERR_INVALID_STATE;
+    }
+    
+    xSemaphoreTake(s_flush_lock, portMAX_DELAY);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Error loading config: %s, using defaults", esp_err_to_name(err));
+        config = default_config;
+        memset(&s_persisted, 0, sizeof(s_persisted));
+    } else {
+        s_persisted = config;
+    }
+    
+    if (migrated && err == ESP_OK) {
+        // Keep the old blob's content but store it in the current layout
+        memset(&s_persisted, 0, sizeof(s_persisted));
+        if (write_to_nvs(&config) == ESP_OK) {
+            s_persisted = config;
+        }
+    }
+    xSemaphoreGive(s_flush_lock);
+    
+    s_config = config;
+    s_initialized = true;
+    
+    ESP_LOGI(TAG, "System configuration initialized (version %d)", SYSTEM_CONFIG_VERSION);
+    return ESP_OK;
+}
+
+esp_err_t system_config_load(system_config_t *config)
+{
+    if (config == NULL) {
+        ESP_LOGE(TAG, "Config pointer is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    if (!s_initialized) {
+        *config = default_config;
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    portENTER_CRITICAL(&s_lock);
+    *config = s_config;
+    portEXIT_CRITICAL(&s_lock);
+    return ESP_OK;
+}
+
+/*
+ * Validate and publish a new configuration. With if_match set the swap only
+ * happens while the cache still has that etag.
+ */
+static esp_err_t commit(const system_config_t *config, const uint32_t *if_match)
+{
+    if (config == NULL) {
+        ESP_LOGE(TAG, "Config pointer is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    if (!s_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    esp_err_t err = system_config_validate(config);
+    if (err != ESP_OK) {
+        return err;
+    }
+    
+    portENTER_CRITICAL(&s_lock);
+    if (if_match != NULL && system_config_etag(&s_config) != *if_match) {
+        portEXIT_CRITICAL(&s_lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    bool changed = memcmp(&s_config, config, sizeof(system_config_t)) != 0;
+    s_config = *config;
+    portEXIT_CRITICAL(&s_lock);
+    
+    if (!changed) {
+        return ESP_OK;
+    }
+    
+    // Restart the quiet period, but never defer a change past the limit
+    int64_t now = esp_timer_get_time();
+    int64_t delay = SYSTEM_CONFIG_SAVE_DELAY_MS * 1000LL;
+    portENTER_CRITICAL(&s_lock);
+    if (!s_dirty) {
+        s_dirty = true;
+        s_dirty_since = now;
+    }
+    int64_t deadline = s_dirty_since + SYSTEM_CONFIG_MAX_DEFER_MS * 1000LL;
+    portEXIT_CRITICAL(&s_lock);
+    
+    if (now + delay > deadline) {
+        delay = deadline > now ? deadline - now : 0;
+    }
+    esp_timer_stop(s_save_timer);
+    esp_timer_start_once(s_save_timer, delay);
+    
+    notify_subscribers();
+    return ESP_OK;
+}
+
+esp_err_t system_config_save(const system_config_t *config)
+{
+    return commit(config, NULL);
+}
+
+esp_err_t system_config_save_if_match(const system_config_t *config, uint32_t etag)
+{
+    return commit(config, &etag);
+}
+
+uint32_t system_config_etag(const system_config_t *config)
+{
+    // Content hash: equal configurations share an etag across reboots
+    return esp_rom_crc32_le(0, (const uint8_t *)config, sizeof(system_config_t));
+}
+
+esp_err_t system_config_flush(void)
+{
+    if (!s_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    esp_timer_stop(s_save_timer);
+    
+    // The timer task and explicit callers may flush at the same time. The
+    // snapshot is taken under the lock too, so an older snapshot can never
+    // be written after a newer one.
+    xSemaphoreTake(s_flush_lock, portMAX_DELAY);
+    
+    system_config_t config;
+    portENTER_CRITICAL(&s_lock);
+    config = s_config;
+    s_dirty = false;
+    portEXIT_CRITICAL(&s_lock);
+    
+    // Changes that were reverted before the timer fired cost nothing
+    esp_err_t err = ESP_OK;
+    if (memcmp(&config, &s_persisted, sizeof(config)) != 0) {
+        err = write_to_nvs(&config);
+        if (err == ESP_OK) {
+            s_persisted = config;
+            ESP_LOGI(TAG, "Configuration saved");
+        }
+    }
+    
+    xSemaphoreGive(s_flush_lock);
+    return err;
+}
+
+esp_err_t system_config_validate(const system_config_t *config)
+{
+    if (config == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    if (config->soil_moisture_threshold > 100 ||
+        config->moisture_setpoint > 100 ||
+        config->irrigation_duration_seconds < 1 || config->irrigation_duration_seconds > 3600 ||
+        config->sensor_read_interval_seconds < 1 || config->sensor_read_interval_seconds > 3600 ||
+        config->mqtt_publish_interval_seconds < 1 || config->mqtt_publish_interval_seconds > 86400 ||
+        config->min_irrigation_interval_seconds > 7 * 86400 ||
+        config->soil_moisture_calibration_dry > 4095 ||
+        config->soil_moisture_calibration_dry <= config->soil_moisture_calibration_wet) {
+        ESP_LOGW(TAG, "Configuration value out of range");
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    return ESP_OK;
+}
+
+esp_err_t system_config_subscribe(system_config_listener_t listener, void *arg)
+{
+    if (listener == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    system_config_t config;
+    
+    portENTER_CRITICAL(&s_lock);
+    if (s_subscriber_count >= SYSTEM_CONFIG_MAX_SUBSCRIBERS) {
+        portEXIT_CRITICAL(&s_lock);
+        ESP_LOGE(TAG, "No free subscriber slot");
+        return ESP_ERR_NO_MEM;
+    }
+    s_subscribers[s_subscriber_count].listener = listener;
+    s_subscribers[s_subscriber_count].arg = arg;
+    s_subscriber_count++;
+    config = s_initialized ? s_config : default_config;
+    portEXIT_CRITICAL(&s_lock);
+    
+    listener(&config, arg);
+    return ESP_OK;
+}
+
 esp_err_t system_config_reset_to_defaults(void)
 {
     ESP_LOGI(TAG, "Resetting configuration to defaults");
@@ -0,0 +1,245 @@
+/*
+ * System Configuration JSON Representation
+ * Field table shared by remote patches and state reports
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <math.h>
+#include "esp_log.h"
+#include "cJSON.h"
+#include "system_config.h"
+
+static const char *TAG = "SYSTEM_CONFIG_JSON";
+
+#define ETAG_MEMBER         "etag"
+#define PATCH_MAX_RETRIES   3       // Patches without an etag retry on a concurrent change
+
+typedef enum {
+    FIELD_U32,
+    FIELD_U16,
+    FIELD_BOOL
+} field_type_t;
+
+typedef struct {
+    const char *name;
+    field_type_t type;
+    size_t offset;
+} field_t;
+
+#define FIELD(member, type) { #member, type, offsetof(system_config_t, member) }
+
+static const field_t s_fields[] = {
+    FIELD(soil_moisture_threshold, FIELD_U32),
+    FIELD(irrigation_duration_seconds, FIELD_U32),
+    FIELD(sensor_read_interval_seconds, FIELD_U32),
+    FIELD(mqtt_publish_interval_seconds, FIELD_U32),
+    FIELD(min_irrigation_interval_seconds, FIELD_U32),
+    FIELD(safety_timeout_enabled, FIELD_BOOL),
+    FIELD(auto_mode_enabled, FIELD_BOOL),
+    FIELD(predictive_mode_enabled, FIELD_BOOL),
+    FIELD(closed_loop_enabled, FIELD_BOOL),
+    FIELD(moisture_setpoint, FIELD_U32),
+    FIELD(soil_moisture_calibration_dry, FIELD_U16),
+    FIELD(soil_moisture_calibration_wet, FIELD_U16),
+};
+
+#define FIELD_COUNT (sizeof(s_fields) / sizeof(s_fields[0]))
+
+static void set_error(char *error, size_t error_len, const char *fmt, ...)
+{
+    if (error == NULL || error_len == 0) {
+        return;
+    }
+
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(error, error_len, fmt, args);
+    va_end(args);
+}
+
+static const field_t *find_field(const char *name)
+{
+    for (size_t i = 0; i < FIELD_COUNT; i++) {
+        if (strcmp(s_fields[i].name, name) == 0) {
+            return &s_fields[i];
+        }
+    }
+    return NULL;
+}
+
+static void copy_field(const field_t *field, system_config_t *dst, const system_config_t *src)
+{
+    size_t size = field->type == FIELD_U32 ? sizeof(uint32_t) :
+                  field->type == FIELD_U16 ? sizeof(uint16_t) : sizeof(bool);
+    memcpy((uint8_t *)dst + field->offset, (const uint8_t *)src + field->offset, size);
+}
+
+static bool set_field(const field_t *field, system_config_t *config, const cJSON *value)
+{
+    uint8_t *ptr = (uint8_t *)config + field->offset;
+
+    if (field->type == FIELD_BOOL) {
+        if (!cJSON_IsBool(value)) {
+            return false;
+        }
+        *(bool *)ptr = cJSON_IsTrue(value);
+        return true;
+    }
+
+    if (!cJSON_IsNumber(value)) {
+        return false;
+    }
+    double number = value->valuedouble;
+    double max = field->type == FIELD_U32 ? (double)UINT32_MAX : (double)UINT16_MAX;
+    if (number < 0 || number > max || floor(number) != number) {
+        return false;
+    }
+
+    if (field->type == FIELD_U32) {
+        *(uint32_t *)ptr = (uint32_t)number;
+    } else {
+        *(uint16_t *)ptr = (uint16_t)number;
+    }
+    return true;
+}
+
+/* Merge the patch members into config, leaving it untouched on error */
+static esp_err_t merge_patch(const cJSON *root, system_config_t *config, char *error, size_t error_len)
+{
+    system_config_t defaults;
+    system_config_t merged = *config;
+    system_config_get_defaults(&defaults);
+
+    const cJSON *item;
+    cJSON_ArrayForEach(item, root) {
+        if (strcmp(item->string, ETAG_MEMBER) == 0) {
+            continue;
+        }
+
+        const field_t *field = find_field(item->string);
+        if (field == NULL) {
+            set_error(error, error_len, "unknown field %s", item->string);
+            return ESP_ERR_INVALID_ARG;
+        }
+
+        if (cJSON_IsNull(item)) {
+            copy_field(field, &merged, &defaults);
+        } else if (!set_field(field, &merged, item)) {
+            set_error(error, error_len, "bad value for %s", item->string);
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    if (system_config_validate(&merged) != ESP_OK) {
+        set_error(error, error_len, "value out of range");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    *config = merged;
+    return ESP_OK;
+}
+
+esp_err_t system_config_apply_patch(const char *json, size_t len, uint32_t *etag,
+                                    char *error, size_t error_len)
+{
+    if (json == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    cJSON *root = cJSON_ParseWithLength(json, len);
+    if (root == NULL || !cJSON_IsObject(root)) {
+        set_error(error, error_len, "patch is not a JSON object");
+        cJSON_Delete(root);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    bool has_etag = false;
+    uint32_t if_match = 0;
+    const cJSON *etag_item = cJSON_GetObjectItemCaseSensitive(root, ETAG_MEMBER);
+    if (etag_item != NULL) {
+        char *end = NULL;
+        if (!cJSON_IsString(etag_item) ||
+            (if_match = strtoul(etag_item->valuestring, &end, 16), end == etag_item->valuestring || *end != '\0')) {
+            set_error(error, error_len, "bad etag");
+            cJSON_Delete(root);
+            return ESP_ERR_INVALID_ARG;
+        }
+        has_etag = true;
+    }
+
+    esp_err_t err = ESP_ERR_INVALID_STATE;
+    system_config_t config;
+    uint32_t base = 0;
+
+    for (int attempt = 0; attempt < PATCH_MAX_RETRIES && err == ESP_ERR_INVALID_STATE; attempt++) {
+        system_config_load(&config);
+        base = system_config_etag(&config);
+        if (has_etag && base != if_match) {
+            set_error(error, error_len, "stale etag, current is %08lx", (unsigned long)base);
+            break;
+        }
+
+        err = merge_patch(root, &config, error, error_len);
+        if (err != ESP_OK) {
+            break;
+        }
+
+        // A change that raced in makes an etag-guarded patch stale, others retry on the new base
+        err = system_config_save_if_match(&config, base);
+        if (err == ESP_ERR_INVALID_STATE && has_etag) {
+            set_error(error, error_len, "configuration changed concurrently");
+            break;
+        }
+    }
+
+    cJSON_Delete(root);
+
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Configuration patch rejected: %s", error != NULL ? error : esp_err_to_name(err));
+        return err;
+    }
+
+    if (etag != NULL) {
+        *etag = system_config_etag(&config);
+    }
+    ESP_LOGI(TAG, "Configuration patch applied, etag %08lx", (unsigned long)system_config_etag(&config));
+    return ESP_OK;
+}
+
+char *system_config_to_json(void)
+{
+    system_config_t config;
+    system_config_load(&config);
+
+    cJSON *json = cJSON_CreateObject();
+    if (json == NULL) {
+        return NULL;
+    }
+
+    char etag[9];
+    snprintf(etag, sizeof(etag), "%08lx", (unsigned long)system_config_etag(&config));
+    cJSON_AddStringToObject(json, ETAG_MEMBER, etag);
+
+    for (size_t i = 0; i < FIELD_COUNT; i++) {
+        const field_t *field = &s_fields[i];
+        const uint8_t *ptr = (const uint8_t *)&config + field->offset;
+        switch (field->type) {
+            case FIELD_U32:
+                cJSON_AddNumberToObject(json, field->name, *(const uint32_t *)ptr);
+                break;
+            case FIELD_U16:
+                cJSON_AddNumberToObject(json, field->name, *(const uint16_t *)ptr);
+                break;
+            case FIELD_BOOL:
+                cJSON_AddBoolToObject(json, field->name, *(const bool *)ptr);
+                break;
+        }
+    }
+
+    char *json_string = cJSON_PrintUnformatted(json);
+    cJSON_Delete(json);
+    return json_string;
+}
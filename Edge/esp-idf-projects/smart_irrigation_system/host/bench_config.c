@@ -0,0 +1,219 @@
+/*
+ * Configuration cache cost and consistency
+ *
+ * - Migration of a version 1 blob on first boot
+ * - Cost of a snapshot read, which used to be an NVS read
+ * - NVS writes for bursts of cloud updates, with the debounced save
+ * - Concurrent saves and flushes from several tasks while the save timer
+ *   fires, checking after every round that NVS holds the cached content
+ *
+ *    make bench_config && ./bench_config
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "esp_timer.h"
+#include "nvs_flash.h"
+#include "system_config.h"
+#include "host_port.h"
+
+#define READS               10000000
+#define FLUSH_TASKS         4
+#define FLUSH_ROUNDS        500
+#define FLUSH_SAVES         8           // Saves per task and round
+
+// Layout of the version 1 blob, see system_config.c
+typedef struct {
+    uint32_t soil_moisture_threshold;
+    uint32_t max_irrigation_time_minutes;
+    uint32_t sensor_read_interval_seconds;
+    uint32_t mqtt_publish_interval_seconds;
+    uint32_t min_irrigation_interval_minutes;
+    bool safety_timeout_enabled;
+    bool auto_mode_enabled;
+    uint16_t soil_moisture_calibration_dry;
+    uint16_t soil_moisture_calibration_wet;
+} config_v1_t;
+
+typedef struct {
+    uint32_t version;
+    system_config_t config;
+} config_record_t;
+
+typedef struct {
+    // Migration
+    uint32_t stored_version;
+    uint32_t duration;
+    uint32_t min_interval;
+    bool auto_mode;
+    uint16_t calibration_dry;
+    int64_t migration_writes;
+    // Reads
+    double read_ns;
+    // Bursts
+    int saves;
+    int notifications;
+    int64_t burst_writes;
+    // Concurrent flushes
+    int mismatched_rounds;
+    int64_t flush_writes;
+} result_t;
+
+static _Atomic int s_notifications;
+static _Atomic int s_round;
+static _Atomic int s_tasks_done;
+
+static void listener(const system_config_t *config, void *arg)
+{
+    s_notifications++;
+}
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static bool read_record(config_record_t *record)
+{
+    nvs_handle_t handle;
+    if (nvs_open("system_config", NVS_READONLY, &handle) != ESP_OK) {
+        return false;
+    }
+    size_t size = sizeof(*record);
+    esp_err_t err = nvs_get_blob(handle, "config", record, &size);
+    nvs_close(handle);
+    return err == ESP_OK && size == sizeof(*record);
+}
+
+static void *flush_task(void *arg)
+{
+    int id = (int)(intptr_t)arg;
+    system_config_t config;
+    system_config_load(&config);
+
+    for (int round = 1; round <= FLUSH_ROUNDS; round++) {
+        while (s_round < round) {
+            sched_yield();
+        }
+        for (int i = 0; i < FLUSH_SAVES; i++) {
+            config.soil_moisture_threshold = (uint32_t)((round * 7 + id * 13 + i) % 100);
+            system_config_save(&config);
+            system_config_flush();
+        }
+        s_tasks_done++;
+    }
+    return NULL;
+}
+
+static void run(void *arg, void *out)
+{
+    result_t *r = out;
+
+    // A version 1 blob left by old firmware
+    ESP_ERROR_CHECK(nvs_flash_init());
+    nvs_handle_t handle;
+    ESP_ERROR_CHECK(nvs_open("system_config", NVS_READWRITE, &handle));
+    config_v1_t old = { 35, 10, 30, 60, 90, true, false, 3900, 1400 };
+    ESP_ERROR_CHECK(nvs_set_blob(handle, "config", &old, sizeof(old)));
+    nvs_close(handle);
+
+    int64_t writes = host_nvs_writes();
+    ESP_ERROR_CHECK(system_config_init());
+    r->migration_writes = host_nvs_writes() - writes;
+
+    system_config_t config;
+    system_config_load(&config);
+    config_record_t record;
+    r->stored_version = read_record(&record) ? record.version : 0;
+    r->duration = config.irrigation_duration_seconds;
+    r->min_interval = config.min_irrigation_interval_seconds;
+    r->auto_mode = config.auto_mode_enabled;
+    r->calibration_dry = config.soil_moisture_calibration_dry;
+
+    double start = now_ns();
+    for (int i = 0; i < READS; i++) {
+        system_config_load(&config);
+        __asm__ volatile("" : : "r"(&config) : "memory");
+    }
+    r->read_ns = (now_ns() - start) / READS;
+
+    // 10 bursts of 20 patches 200 ms apart, one burst a minute, then a
+    // 1 Hz stream for two minutes
+    system_config_subscribe(listener, NULL);
+    s_notifications = 0;
+    writes = host_nvs_writes();
+    int64_t t = esp_timer_get_time();
+    for (int burst = 0; burst < 10; burst++) {
+        for (int k = 0; k < 20; k++) {
+            config.soil_moisture_threshold = 20 + k % 10 + burst;
+            system_config_save(&config);
+            r->saves++;
+            t += 200000;
+            host_advance_to(t);
+        }
+        t += 60000000 - 20 * 200000;
+        host_advance_to(t);
+    }
+    for (int k = 0; k < 120; k++) {
+        config.sensor_read_interval_seconds = 30 + k;
+        system_config_save(&config);
+        r->saves++;
+        t += 1000000;
+        host_advance_to(t);
+    }
+    t += 60000000;
+    host_advance_to(t);
+    r->notifications = s_notifications;
+    r->burst_writes = host_nvs_writes() - writes;
+
+    // Tasks saving and flushing while the save timer fires here
+    pthread_t threads[FLUSH_TASKS];
+    for (int i = 0; i < FLUSH_TASKS; i++) {
+        pthread_create(&threads[i], NULL, flush_task, (void *)(intptr_t)i);
+    }
+    writes = host_nvs_writes();
+    for (int round = 1; round <= FLUSH_ROUNDS; round++) {
+        s_round = round;
+        while (s_tasks_done < round * FLUSH_TASKS) {
+            t += 500000;
+            host_advance_to(t);
+            sched_yield();
+        }
+        system_config_flush();
+        system_config_load(&config);
+        if (!read_record(&record) || memcmp(&record.config, &config, sizeof(config)) != 0) {
+            r->mismatched_rounds++;
+        }
+    }
+    for (int i = 0; i < FLUSH_TASKS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    r->flush_writes = host_nvs_writes() - writes;
+}
+
+int main(void)
+{
+    result_t r;
+    if (host_run_isolated(run, NULL, &r, sizeof(r)) != 0) {
+        fprintf(stderr, "run failed\n");
+        return 1;
+    }
+
+    printf("migration: v1 blob -> version %u record, duration %u s, min interval %u s, "
+           "auto %d, dry %u, %lld NVS write(s)\n",
+           (unsigned)r.stored_version, (unsigned)r.duration, (unsigned)r.min_interval,
+           r.auto_mode, (unsigned)r.calibration_dry, (long long)r.migration_writes);
+    printf("snapshot read: %.1f ns\n", r.read_ns);
+    printf("bursts: %d saves, %d notifications, %lld NVS writes\n",
+           r.saves, r.notifications, (long long)r.burst_writes);
+    printf("concurrent flush: %d tasks x %d rounds, %lld NVS writes, %d round(s) with NVS != cache\n",
+           FLUSH_TASKS, FLUSH_ROUNDS, (long long)r.flush_writes, r.mismatched_rounds);
+
+    return r.mismatched_rounds != 0;
+}
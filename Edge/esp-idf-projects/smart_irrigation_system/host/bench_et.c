@@ -0,0 +1,169 @@
+/*
+ * Threshold vs predictive watering
+ *
+ * Replays 30 July days at 35N through the irrigation controller, once with
+ * the threshold trigger and once with CONFIG_IRRIGATION_PREDICTIVE_MODE
+ * behaviour enabled through system_config. The soil is a bucket model: the
+ * sun dries it by a clear-sky ET curve scaled by a daily cloud factor, the
+ * valve wets it, and water applied in sunlight partly evaporates before it
+ * soaks in. Each mode runs in its own process so both start from the same
+ * state.
+ *
+ *    make bench_et && ./bench_et
+ */
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "nvs_flash.h"
+#include "et_predictor.h"
+#include "irrigation_controller.h"
+#include "system_config.h"
+#include "host_port.h"
+
+#define DAYS                30
+#define STEP_SECONDS        30          // Sensor read interval
+#define PUMP_GPIO           2
+
+#define FIELD_CAPACITY      42.0        // %, wetter soil drains
+#define THRESHOLD           30.0        // %, CONFIG_SOIL_MOISTURE_THRESHOLD
+#define MOISTURE_PER_MM     0.40        // % lost per mm of ET
+#define MOISTURE_PER_SECOND 0.04        // % gained per second of watering
+#define PEAK_ET_MM          6.5         // Clear-sky July ET per day
+#define SUNRISE_HOUR        5.0
+#define SUNSET_HOUR         19.0
+#define EVAPORATION_SHARE   0.25        // Part of the water lost at full sun
+
+typedef struct {
+    double water_seconds;
+    int events;
+    double peak_seconds;                // Watering between 09:00 and 18:00
+    double evaporated;                  // % moisture lost before soaking in
+    double applied;
+    double below_seconds;
+    et_zone_params_t learned;
+} result_t;
+
+static double uniform(void)
+{
+    return rand() / (double)RAND_MAX;
+}
+
+static void *controller_task(void *arg)
+{
+    irrigation_controller_run();
+    return NULL;
+}
+
+static void run(void *arg, void *out)
+{
+    bool predictive = *(const bool *)arg;
+    result_t *result = out;
+
+    ESP_ERROR_CHECK(nvs_flash_init());
+    ESP_ERROR_CHECK(system_config_init());
+    ESP_ERROR_CHECK(irrigation_controller_init());
+
+    system_config_t config;
+    system_config_load(&config);
+    config.predictive_mode_enabled = predictive;
+    ESP_ERROR_CHECK(system_config_save(&config));
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, controller_task, NULL);
+    QueueHandle_t queue = host_last_queue();
+    host_queue_wait_idle(queue);
+
+    srand(42);
+    double moisture = 38.0;
+    double cloud = 1.0;
+    bool was_on = false;
+
+    for (int64_t t = 0; t < DAYS * 86400LL; t += STEP_SECONDS) {
+        double hour = fmod((double)t, 86400.0) / 3600.0;
+        if (t % 86400 == 0) {
+            cloud = 0.55 + 0.45 * uniform();
+        }
+        double sun = hour > SUNRISE_HOUR && hour < SUNSET_HOUR ?
+                     sin((hour - SUNRISE_HOUR) / (SUNSET_HOUR - SUNRISE_HOUR) * M_PI) : 0.0;
+        double et_per_second = PEAK_ET_MM * cloud * sun * M_PI / (2.0 * (SUNSET_HOUR - SUNRISE_HOUR) * 3600.0);
+
+        moisture -= et_per_second * STEP_SECONDS * MOISTURE_PER_MM;
+
+        bool on = host_gpio_level(PUMP_GPIO) != 0;
+        if (on) {
+            double added = MOISTURE_PER_SECOND * STEP_SECONDS;
+            double lost = added * EVAPORATION_SHARE * sun;
+            moisture += added - lost;
+            result->applied += added;
+            result->evaporated += lost;
+            result->water_seconds += STEP_SECONDS;
+            if (hour >= 9.0 && hour < 18.0) {
+                result->peak_seconds += STEP_SECONDS;
+            }
+            if (!was_on) {
+                result->events++;
+            }
+        }
+        was_on = on;
+
+        if (moisture > FIELD_CAPACITY) {
+            moisture = FIELD_CAPACITY;
+        }
+        if (moisture < THRESHOLD) {
+            result->below_seconds += STEP_SECONDS;
+        }
+
+        host_advance_to(t * 1000000LL);
+        host_queue_wait_idle(queue);
+
+        sensor_data_t sample = {
+            .temperature = 24.0f + 8.0f * (float)sin((hour - 9.0) / 24.0 * 2.0 * M_PI),
+            .humidity = 60.0f,
+            .soil_moisture = (float)(moisture + uniform() - 0.5),
+            .water_level = 80.0f,
+            .light_level = (float)(100.0 * sun * cloud),
+            .timestamp = HOST_EPOCH_BASE + t
+        };
+        irrigation_controller_check_conditions(&sample);
+        host_queue_wait_idle(queue);
+    }
+
+    et_predictor_get_zone_params(0, &result->learned);
+}
+
+static void print_result(const char *mode, const result_t *r)
+{
+    printf("%-10s  %9.0f  %6d  %8.0f  %8.1f  %9.2f  %7.3f  %7.4f\n",
+           mode, r->water_seconds, r->events, r->peak_seconds,
+           r->applied > 0 ? 100.0 * r->evaporated / r->applied : 0.0,
+           r->below_seconds / 3600.0, r->learned.moisture_per_mm, r->learned.moisture_per_second);
+}
+
+int main(void)
+{
+    static const struct {
+        const char *name;
+        bool predictive;
+    } modes[] = {
+        { "threshold", false },
+        { "predictive", true }
+    };
+
+    printf("%d days at 35N, truth: %.2f %%/mm drydown, %.3f %%/s watering\n\n",
+           DAYS, MOISTURE_PER_MM, MOISTURE_PER_SECOND);
+    printf("mode        water [s]  events  peak [s]  evap [%%]  below [h]  %%/mm     %%/s\n");
+
+    for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+        bool predictive = modes[i].predictive;
+        result_t result;
+        if (host_run_isolated(run, &predictive, &result, sizeof(result)) != 0) {
+            fprintf(stderr, "%s run failed\n", modes[i].name);
+            return 1;
+        }
+        print_result(modes[i].name, &result);
+    }
+
+    return 0;
+}
@@ -0,0 +1,179 @@
+/*
+ * Irrigation controller task cost and response
+ *
+ * Counts controller wakeups over a simulated day of 30 second samples with
+ * one 300 second manual run per hour, checks the remaining time it reports
+ * during those runs, and times manual commands from the call to the relay
+ * on the wall clock. A last scenario reports a sensor fault while idle and
+ * checks that auto watering starts with the next dry sample.
+ *
+ *    make bench_events && ./bench_events
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "nvs_flash.h"
+#include "irrigation_controller.h"
+#include "system_config.h"
+#include "host_port.h"
+
+#define PUMP_GPIO           2
+#define SAMPLE_SECONDS      30
+#define HOURS               24
+#define RUN_OFFSET          600         // Manual run starts 10 minutes into each hour
+#define RUN_SECONDS         300
+#define LATENCY_SAMPLES     20000
+
+typedef struct {
+    double wakeups_per_hour;
+    int remaining_error_max;
+    double p50_us;
+    double p99_us;
+    double max_us;
+    int fault_resume_seconds;           // -1 if auto watering never resumed
+} result_t;
+
+static QueueHandle_t s_queue;
+
+static void *controller_task(void *arg)
+{
+    irrigation_controller_run();
+    return NULL;
+}
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void start_controller(void)
+{
+    ESP_ERROR_CHECK(nvs_flash_init());
+    ESP_ERROR_CHECK(system_config_init());
+    ESP_ERROR_CHECK(irrigation_controller_init());
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, controller_task, NULL);
+    s_queue = host_last_queue();
+    host_queue_wait_idle(s_queue);
+}
+
+static void post_sample(int64_t t, float moisture)
+{
+    sensor_data_t sample = {
+        .temperature = 20.0f,
+        .humidity = 60.0f,
+        .soil_moisture = moisture,
+        .water_level = 80.0f,
+        .timestamp = HOST_EPOCH_BASE + t
+    };
+    irrigation_controller_check_conditions(&sample);
+    host_queue_wait_idle(s_queue);
+}
+
+static void run_day(void *arg, void *out)
+{
+    result_t *result = out;
+    start_controller();
+
+    // Samples above the threshold, so only the manual runs water
+    int64_t wakeups = host_queue_wakeups();
+    for (int64_t t = 1; t <= HOURS * 3600; t++) {
+        host_advance_to(t * 1000000LL);
+        host_queue_wait_idle(s_queue);
+
+        if (t % SAMPLE_SECONDS == 0) {
+            post_sample(t, 55.0f);
+        }
+        if (t % 3600 == RUN_OFFSET) {
+            irrigation_controller_start_manual(RUN_SECONDS);
+            host_queue_wait_idle(s_queue);
+        }
+        if (t % 3600 > RUN_OFFSET && t % 3600 < RUN_OFFSET + RUN_SECONDS) {
+            int expected = RUN_OFFSET + RUN_SECONDS - (int)(t % 3600);
+            int error = abs(irrigation_controller_get_remaining_time() - expected);
+            if (error > result->remaining_error_max) {
+                result->remaining_error_max = error;
+            }
+        }
+    }
+    result->wakeups_per_hour = (host_queue_wakeups() - wakeups) / (double)HOURS;
+
+    static double latency[LATENCY_SAMPLES];
+    for (int i = 0; i < LATENCY_SAMPLES; i++) {
+        double start = now_us();
+        irrigation_controller_start_manual(60);
+        while (host_gpio_level(PUMP_GPIO) == 0) {
+        }
+        latency[i] = now_us() - start;
+        irrigation_controller_stop();
+        host_queue_wait_idle(s_queue);
+    }
+    qsort(latency, LATENCY_SAMPLES, sizeof(latency[0]), compare_double);
+    result->p50_us = latency[LATENCY_SAMPLES / 2];
+    result->p99_us = latency[LATENCY_SAMPLES * 99 / 100];
+    result->max_us = latency[LATENCY_SAMPLES - 1];
+}
+
+static void run_fault(void *arg, void *out)
+{
+    result_t *result = out;
+    start_controller();
+
+    // Idle and wet for an hour and a half, then a transient fault, then dry
+    int64_t t = 0;
+    for (; t < 5400; t += SAMPLE_SECONDS) {
+        host_advance_to(t * 1000000LL);
+        post_sample(t, 45.0f);
+    }
+    irrigation_controller_report_fault(ESP_ERR_TIMEOUT);
+    host_queue_wait_idle(s_queue);
+
+    int64_t fault_time = t;
+    result->fault_resume_seconds = -1;
+    for (; t < fault_time + 7200; t += SAMPLE_SECONDS) {
+        host_advance_to(t * 1000000LL);
+        post_sample(t, 25.0f);
+        if (host_gpio_level(PUMP_GPIO) != 0) {
+            result->fault_resume_seconds = (int)(t - fault_time);
+            break;
+        }
+    }
+}
+
+int main(void)
+{
+    result_t day;
+    result_t fault;
+    if (host_run_isolated(run_day, NULL, &day, sizeof(day)) != 0 ||
+        host_run_isolated(run_fault, NULL, &fault, sizeof(fault)) != 0) {
+        fprintf(stderr, "scenario failed\n");
+        return 1;
+    }
+
+    printf("%d h, a sample every %d s and a %d s manual run per hour\n",
+           HOURS, SAMPLE_SECONDS, RUN_SECONDS);
+    printf("  controller wakeups/hour   %.1f (%d samples, 1 command, 1 timer expiry)\n",
+           day.wakeups_per_hour, 3600 / SAMPLE_SECONDS);
+    printf("  remaining time max error  %d s\n", day.remaining_error_max);
+    printf("command to relay, %d runs\n", LATENCY_SAMPLES);
+    printf("  p50 %.1f us  p99 %.1f us  max %.1f us\n", day.p50_us, day.p99_us, day.max_us);
+    if (fault.fault_resume_seconds < 0) {
+        printf("idle fault: auto watering did not resume within 2 h\n");
+    } else {
+        printf("idle fault: auto watering resumed %d s after the fault\n", fault.fault_resume_seconds);
+    }
+
+    return fault.fault_resume_seconds < 0;
+}
@@ -0,0 +1,281 @@
+/*
+ * Fixed-duration vs closed-loop watering
+ *
+ * A dry zone (28%) is brought back above the 30% threshold on two soils,
+ * once with the fixed 300 second run and once with the PID after a
+ * step-response auto-tune, aiming for 40%. Water reaches the probe after a
+ * dead time and then through a first-order lag, which is what makes a fixed
+ * run overshoot on sand and fall short on clay. A last check pauses a PID
+ * session and starts a manual run over it, which must water for its own
+ * duration and then stop.
+ *
+ *    make bench_pid && ./bench_pid
+ */
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "nvs_flash.h"
+#include "irrigation_controller.h"
+#include "system_config.h"
+#include "host_port.h"
+
+#define PUMP_GPIO           2
+#define SETPOINT            40.0
+#define START_MOISTURE      28.0
+#define TUNE_MOISTURE       32.0        // Above the threshold, so auto mode stays quiet
+#define BAND                1.0         // Settled within +-1% of the setpoint
+#define SAMPLE_SECONDS      30
+#define RUN_SECONDS         (6 * 3600)
+#define TUNE_LIMIT_SECONDS  (6 * 3600)
+#define MAX_DEAD_SECONDS    600
+#define MANUAL_SECONDS      120
+
+typedef struct {
+    const char *name;
+    double gain;                        // % per second of full flow, after the lag
+    int dead_seconds;                   // Infiltration delay to the probe depth
+    double lag_seconds;                 // Spread of the response
+    double field_capacity;              // Above this, soil drains slowly
+    int tune_pulse_seconds;
+} soil_t;
+
+typedef struct {
+    const soil_t *soil;
+    bool closed_loop;
+} scenario_t;
+
+typedef struct {
+    bool tuned;
+    moisture_pid_gains_t gains;
+    double water_seconds;
+    double peak;
+    double final;
+    int settling_seconds;               // -1 if never settled
+} result_t;
+
+static const soil_t s_soils[] = {
+    { "sandy", 0.080, 30, 90.0, 45.0, 60 },
+    { "clay", 0.025, 240, 900.0, 50.0, 180 },
+};
+
+// Soil state, advanced one second at a time
+static double s_moisture;
+static double s_store;                  // Water on its way through the lag
+static bool s_history[MAX_DEAD_SECONDS];
+static int64_t s_now;
+
+static double uniform(void)
+{
+    return rand() / (double)RAND_MAX;
+}
+
+static void *controller_task(void *arg)
+{
+    irrigation_controller_run();
+    return NULL;
+}
+
+static void reset_soil(double moisture)
+{
+    s_moisture = moisture;
+    s_store = 0.0;
+    memset(s_history, 0, sizeof(s_history));
+}
+
+static bool step(const soil_t *soil, QueueHandle_t queue)
+{
+    bool on = host_gpio_level(PUMP_GPIO) != 0;
+    s_history[s_now % MAX_DEAD_SECONDS] = on;
+    int64_t arrived = s_now - soil->dead_seconds;
+    if (arrived >= 0 && s_history[arrived % MAX_DEAD_SECONDS]) {
+        s_store += soil->gain;
+    }
+    double inflow = s_store / soil->lag_seconds;
+    s_store -= inflow;
+    s_moisture += inflow;
+    if (s_moisture > soil->field_capacity) {
+        s_moisture -= (s_moisture - soil->field_capacity) * 0.01;
+    }
+
+    s_now++;
+    host_advance_to(s_now * 1000000LL);
+    host_queue_wait_idle(queue);
+
+    if (s_now % SAMPLE_SECONDS == 0) {
+        sensor_data_t sample = {
+            .temperature = 20.0f,
+            .humidity = 60.0f,
+            .soil_moisture = (float)(s_moisture + (uniform() - 0.5) * 0.6),
+            .water_level = 80.0f,
+            .timestamp = HOST_EPOCH_BASE + s_now
+        };
+        irrigation_controller_check_conditions(&sample);
+        host_queue_wait_idle(queue);
+    }
+    return on;
+}
+
+static void run(void *arg, void *out)
+{
+    const scenario_t *scenario = arg;
+    const soil_t *soil = scenario->soil;
+    result_t *result = out;
+
+    ESP_ERROR_CHECK(nvs_flash_init());
+    ESP_ERROR_CHECK(system_config_init());
+    ESP_ERROR_CHECK(irrigation_controller_init());
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, controller_task, NULL);
+    QueueHandle_t queue = host_last_queue();
+    host_queue_wait_idle(queue);
+
+    irrigation_config_t config;
+    irrigation_controller_get_config(&config);
+    config.closed_loop = scenario->closed_loop;
+    config.moisture_setpoint = SETPOINT;
+    config.irrigation_duration = scenario->closed_loop ? 1200 : 300;
+    ESP_ERROR_CHECK(irrigation_controller_set_config(&config));
+
+    srand(1);
+
+    if (scenario->closed_loop) {
+        reset_soil(TUNE_MOISTURE);
+        moisture_pid_gains_t initial;
+        irrigation_controller_get_pid_gains(&initial);
+
+        // The auto-tune needs a reading to start from
+        while (s_now < SAMPLE_SECONDS) {
+            step(soil, queue);
+        }
+        irrigation_controller_autotune(soil->tune_pulse_seconds);
+        host_queue_wait_idle(queue);
+
+        while (s_now < TUNE_LIMIT_SECONDS && !result->tuned) {
+            step(soil, queue);
+            irrigation_controller_get_pid_gains(&result->gains);
+            result->tuned = memcmp(&result->gains, &initial, sizeof(initial)) != 0;
+        }
+        if (!result->tuned) {
+            return;
+        }
+    }
+
+    reset_soil(START_MOISTURE);
+    int64_t start = s_now;
+    int64_t last_outside = s_now;
+    result->peak = s_moisture;
+
+    while (s_now - start < RUN_SECONDS) {
+        if (step(soil, queue)) {
+            result->water_seconds++;
+        }
+        if (s_moisture > result->peak) {
+            result->peak = s_moisture;
+        }
+        if (fabs(s_moisture - SETPOINT) > BAND) {
+            last_outside = s_now;
+        }
+    }
+
+    result->final = s_moisture;
+    result->settling_seconds = s_now - last_outside < RUN_SECONDS / 2 ? -1 : (int)(last_outside - start);
+}
+
+typedef struct {
+    bool paused;                        // The session was running and paused
+    int on_seconds;                     // Pump time after the manual start
+    irrigation_state_t state;           // A minute after the manual run ended
+} manual_result_t;
+
+static void run_manual_over_paused(void *arg, void *out)
+{
+    const soil_t *soil = &s_soils[0];
+    manual_result_t *result = out;
+
+    ESP_ERROR_CHECK(nvs_flash_init());
+    ESP_ERROR_CHECK(system_config_init());
+    ESP_ERROR_CHECK(irrigation_controller_init());
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, controller_task, NULL);
+    QueueHandle_t queue = host_last_queue();
+    host_queue_wait_idle(queue);
+
+    irrigation_config_t config;
+    irrigation_controller_get_config(&config);
+    config.closed_loop = true;
+    config.moisture_setpoint = SETPOINT;
+    config.irrigation_duration = 1200;
+    ESP_ERROR_CHECK(irrigation_controller_set_config(&config));
+
+    srand(1);
+    reset_soil(START_MOISTURE);
+    while (s_now < RUN_SECONDS && irrigation_controller_get_state() != IRRIGATION_STATE_WATERING) {
+        step(soil, queue);
+    }
+    for (int i = 0; i < 2 * SAMPLE_SECONDS; i++) {
+        step(soil, queue);
+    }
+    irrigation_controller_pause();
+    host_queue_wait_idle(queue);
+    result->paused = irrigation_controller_get_state() == IRRIGATION_STATE_PAUSED;
+
+    irrigation_controller_start_manual(MANUAL_SECONDS);
+    host_queue_wait_idle(queue);
+    for (int i = 0; i < MANUAL_SECONDS + 60; i++) {
+        if (step(soil, queue)) {
+            result->on_seconds++;
+        }
+    }
+    result->state = irrigation_controller_get_state();
+}
+
+int main(void)
+{
+    printf("from %.0f%%, setpoint %.0f%%, settled within +-%.0f%% for the rest of %d h\n\n",
+           START_MOISTURE, SETPOINT, BAND, RUN_SECONDS / 3600);
+    printf("soil   mode   water [s]  peak [%%]  overshoot  final [%%]  settling [s]  tuned gains\n");
+
+    for (size_t i = 0; i < sizeof(s_soils) / sizeof(s_soils[0]); i++) {
+        for (int closed_loop = 0; closed_loop <= 1; closed_loop++) {
+            scenario_t scenario = { &s_soils[i], closed_loop };
+            result_t result;
+            if (host_run_isolated(run, &scenario, &result, sizeof(result)) != 0) {
+                fprintf(stderr, "%s run failed\n", s_soils[i].name);
+                return 1;
+            }
+            if (closed_loop && !result.tuned) {
+                printf("%-6s pid    auto-tune did not finish\n", s_soils[i].name);
+                continue;
+            }
+
+            char settling[16] = "never";
+            if (result.settling_seconds >= 0) {
+                snprintf(settling, sizeof(settling), "%d", result.settling_seconds);
+            }
+            printf("%-6s %-6s %9.0f  %8.2f  %9.2f  %9.2f  %12s",
+                   s_soils[i].name, closed_loop ? "pid" : "fixed", result.water_seconds,
+                   result.peak, result.peak - SETPOINT, result.final, settling);
+            if (closed_loop) {
+                printf("  kc=%.3f ti=%.0f td=%.0f", result.gains.kc, result.gains.ti, result.gains.td);
+            }
+            printf("\n");
+        }
+    }
+
+    manual_result_t manual = { 0 };
+    if (host_run_isolated(run_manual_over_paused, NULL, &manual, sizeof(manual)) != 0) {
+        fprintf(stderr, "manual run failed\n");
+        return 1;
+    }
+    bool ok = manual.paused && manual.on_seconds == MANUAL_SECONDS && manual.state == IRRIGATION_STATE_IDLE;
+    printf("\nmanual %d s run over a paused PID session: pump on %d s, then %s  %s\n", MANUAL_SECONDS,
+           manual.on_seconds, manual.state == IRRIGATION_STATE_IDLE ? "idle" : "still running",
+           ok ? "ok" : "FAILED");
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,288 @@
+/*
+ * The subset of cJSON declared in stubs/cJSON.h, for host builds only.
+ */
+
+#include "cJSON.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    const char *p;
+    const char *end;
+} reader_t;
+
+static cJSON *parse_value(reader_t *r);
+
+static cJSON *new_item(int type)
+{
+    cJSON *item = calloc(1, sizeof(cJSON));
+    if (item != NULL) {
+        item->type = type;
+    }
+    return item;
+}
+
+static void skip_space(reader_t *r)
+{
+    while (r->p < r->end && (*r->p == ' ' || *r->p == '\t' || *r->p == '\r' || *r->p == '\n')) {
+        r->p++;
+    }
+}
+
+// Strings without escapes are all the components exchange
+static char *parse_string(reader_t *r)
+{
+    if (r->p >= r->end || *r->p != '"') {
+        return NULL;
+    }
+    const char *start = ++r->p;
+    while (r->p < r->end && *r->p != '"') {
+        if (*r->p == '\\') {
+            return NULL;
+        }
+        r->p++;
+    }
+    if (r->p >= r->end) {
+        return NULL;
+    }
+    char *s = strndup(start, r->p - start);
+    r->p++;
+    return s;
+}
+
+static cJSON *parse_object(reader_t *r)
+{
+    cJSON *object = new_item(cJSON_Object);
+    cJSON *last = NULL;
+    r->p++;
+    skip_space(r);
+    if (r->p < r->end && *r->p == '}') {
+        r->p++;
+        return object;
+    }
+    
+    while (1) {
+        skip_space(r);
+        char *name = parse_string(r);
+        skip_space(r);
+        if (name == NULL || r->p >= r->end || *r->p != ':') {
+            free(name);
+            break;
+        }
+        r->p++;
+        cJSON *value = parse_value(r);
+        if (value == NULL) {
+            free(name);
+            break;
+        }
+        value->string = name;
+        if (last != NULL) {
+            last->next = value;
+            value->prev = last;
+        } else {
+            object->child = value;
+        }
+        last = value;
+        
+        skip_space(r);
+        if (r->p < r->end && *r->p == ',') {
+            r->p++;
+            continue;
+        }
+        if (r->p < r->end && *r->p == '}') {
+            r->p++;
+            return object;
+        }
+        break;
+    }
+    
+    cJSON_Delete(object);
+    return NULL;
+}
+
+static cJSON *parse_value(reader_t *r)
+{
+    skip_space(r);
+    if (r->p >= r->end) {
+        return NULL;
+    }
+    
+    if (*r->p == '{') {
+        return parse_object(r);
+    }
+    if (*r->p == '"') {
+        char *s = parse_string(r);
+        if (s == NULL) {
+            return NULL;
+        }
+        cJSON *item = new_item(cJSON_String);
+        item->valuestring = s;
+        return item;
+    }
+    
+    static const struct { const char *word; int type; } literals[] = {
+        { "true", cJSON_True }, { "false", cJSON_False }, { "null", cJSON_NULL }
+    };
+    for (size_t i = 0; i < sizeof(literals) / sizeof(literals[0]); i++) {
+        size_t n = strlen(literals[i].word);
+        if ((size_t)(r->end - r->p) >= n && strncmp(r->p, literals[i].word, n) == 0) {
+            r->p += n;
+            return new_item(literals[i].type);
+        }
+    }
+    
+    char number[64];
+    size_t n = 0;
+    while (r->p < r->end && n < sizeof(number) - 1 && strchr("+-0123456789.eE", *r->p) != NULL) {
+        number[n++] = *r->p++;
+    }
+    number[n] = '\0';
+    char *end;
+    double value = strtod(number, &end);
+    if (n == 0 || *end != '\0') {
+        return NULL;
+    }
+    cJSON *item = new_item(cJSON_Number);
+    item->valuedouble = value;
+    item->valueint = (int)value;
+    return item;
+}
+
+cJSON *cJSON_ParseWithLength(const char *value, size_t buffer_length)
+{
+    reader_t r = { value, value + buffer_length };
+    cJSON *item = parse_value(&r);
+    skip_space(&r);
+    if (item != NULL && r.p < r.end && *r.p != '\0') {
+        cJSON_Delete(item);
+        return NULL;
+    }
+    return item;
+}
+
+cJSON *cJSON_Parse(const char *value)
+{
+    return cJSON_ParseWithLength(value, strlen(value));
+}
+
+void cJSON_Delete(cJSON *item)
+{
+    while (item != NULL) {
+        cJSON *next = item->next;
+        cJSON_Delete(item->child);
+        free(item->valuestring);
+        free(item->string);
+        free(item);
+        item = next;
+    }
+}
+
+cJSON *cJSON_GetObjectItemCaseSensitive(const cJSON *object, const char *string)
+{
+    if (object == NULL) {
+        return NULL;
+    }
+    for (cJSON *child = object->child; child != NULL; child = child->next) {
+        if (child->string != NULL && strcmp(child->string, string) == 0) {
+            return child;
+        }
+    }
+    return NULL;
+}
+
+cJSON *cJSON_GetObjectItem(const cJSON *object, const char *string)
+{
+    if (object == NULL) {
+        return NULL;
+    }
+    for (cJSON *child = object->child; child != NULL; child = child->next) {
+        if (child->string != NULL && strcasecmp(child->string, string) == 0) {
+            return child;
+        }
+    }
+    return NULL;
+}
+
+cJSON *cJSON_CreateObject(void)
+{
+    return new_item(cJSON_Object);
+}
+
+static cJSON *add_item(cJSON *object, const char *name, cJSON *item)
+{
+    if (object == NULL || item == NULL) {
+        cJSON_Delete(item);
+        return NULL;
+    }
+    item->string = strdup(name);
+    cJSON **link = &object->child;
+    cJSON *prev = NULL;
+    while (*link != NULL) {
+        prev = *link;
+        link = &(*link)->next;
+    }
+    *link = item;
+    item->prev = prev;
+    return item;
+}
+
+cJSON *cJSON_AddStringToObject(cJSON *object, const char *name, const char *string)
+{
+    cJSON *item = new_item(cJSON_String);
+    item->valuestring = strdup(string);
+    return add_item(object, name, item);
+}
+
+cJSON *cJSON_AddNumberToObject(cJSON *object, const char *name, double number)
+{
+    cJSON *item = new_item(cJSON_Number);
+    item->valuedouble = number;
+    item->valueint = (int)number;
+    return add_item(object, name, item);
+}
+
+cJSON *cJSON_AddBoolToObject(cJSON *object, const char *name, int boolean)
+{
+    return add_item(object, name, new_item(boolean ? cJSON_True : cJSON_False));
+}
+
+static void print_item(const cJSON *item, FILE *out)
+{
+    if (item->type & cJSON_Object) {
+        fputc('{', out);
+        for (const cJSON *child = item->child; child != NULL; child = child->next) {
+            fprintf(out, "%s\"%s\":", child == item->child ? "" : ",", child->string);
+            print_item(child, out);
+        }
+        fputc('}', out);
+    } else if (item->type & cJSON_String) {
+        fprintf(out, "\"%s\"", item->valuestring);
+    } else if (item->type & cJSON_Number) {
+        fprintf(out, "%.17g", item->valuedouble);
+    } else if (item->type & cJSON_True) {
+        fputs("true", out);
+    } else if (item->type & cJSON_False) {
+        fputs("false", out);
+    } else {
+        fputs("null", out);
+    }
+}
+
+char *cJSON_PrintUnformatted(const cJSON *item)
+{
+    char *text = NULL;
+    size_t size = 0;
+    FILE *out = open_memstream(&text, &size);
+    if (out == NULL) {
+        return NULL;
+    }
+    print_item(item, out);
+    fclose(out);
+    return text;
+}
+
+char *cJSON_Print(const cJSON *item)
+{
+    return cJSON_PrintUnformatted(item);
+}
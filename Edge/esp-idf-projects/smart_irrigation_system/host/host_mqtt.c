@@ -0,0 +1,247 @@
+/*
+ * In-process MQTT broker behind the esp-mqtt calls in stubs/mqtt_client.h.
+ * One client, exact topic matches, and a broker that acknowledges QoS1
+ * publishes at once. Events reach the registered handler in order on a
+ * client thread; the benchmark injects messages with host_mqtt_deliver() and
+ * sees the device's publishes through its observer.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "mqtt_client.h"
+#include "host_port.h"
+
+#define HOST_MQTT_TOPICS    16
+#define HOST_MQTT_TOPIC_LEN 128
+
+typedef struct host_mqtt_event {
+    struct host_mqtt_event *next;
+    esp_mqtt_event_id_t id;
+    int msg_id;
+    char *topic;
+    char *data;
+    int len;
+} host_mqtt_event_t;
+
+struct host_mqtt_client {
+    esp_event_handler_t handler;
+    void *handler_arg;
+    pthread_t thread;
+    bool running;
+    bool connected;
+    bool busy;                          // Handler running
+    host_mqtt_event_t *head;
+    host_mqtt_event_t *tail;
+    char topics[HOST_MQTT_TOPICS][HOST_MQTT_TOPIC_LEN];
+    int topic_count;
+    int next_msg_id;
+};
+
+static const char *TAG = "HOST_MQTT";
+
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_cond = PTHREAD_COND_INITIALIZER;
+static struct host_mqtt_client s_client;
+static host_mqtt_observer_t s_observer;
+
+// Called with s_lock held
+static void post_event(esp_mqtt_event_id_t id, int msg_id, const char *topic, const char *data, int len)
+{
+    host_mqtt_event_t *event = calloc(1, sizeof(*event));
+    if (event == NULL) {
+        abort();
+    }
+    event->id = id;
+    event->msg_id = msg_id;
+    if (topic != NULL) {
+        event->topic = strdup(topic);
+        event->data = malloc(len + 1);
+        memcpy(event->data, data, len);
+        event->data[len] = '\0';
+        event->len = len;
+    }
+
+    if (s_client.tail != NULL) {
+        s_client.tail->next = event;
+    } else {
+        s_client.head = event;
+    }
+    s_client.tail = event;
+    pthread_cond_broadcast(&s_cond);
+}
+
+static void *client_task(void *arg)
+{
+    pthread_mutex_lock(&s_lock);
+    for (;;) {
+        while (s_client.head == NULL && s_client.running) {
+            pthread_cond_wait(&s_cond, &s_lock);
+        }
+        host_mqtt_event_t *pending = s_client.head;
+        if (pending == NULL) {
+            break;
+        }
+        s_client.head = pending->next;
+        if (s_client.head == NULL) {
+            s_client.tail = NULL;
+        }
+        s_client.busy = true;
+        pthread_mutex_unlock(&s_lock);
+
+        esp_mqtt_event_t event = {
+            .event_id = pending->id,
+            .client = &s_client,
+            .data = pending->data,
+            .data_len = pending->len,
+            .total_data_len = pending->len,
+            .topic = pending->topic,
+            .topic_len = pending->topic != NULL ? (int)strlen(pending->topic) : 0,
+            .msg_id = pending->msg_id,
+            .qos = 1,
+        };
+        if (s_client.handler != NULL) {
+            s_client.handler(s_client.handler_arg, "MQTT_EVENTS", pending->id, &event);
+        }
+        free(pending->topic);
+        free(pending->data);
+        free(pending);
+
+        pthread_mutex_lock(&s_lock);
+        s_client.busy = false;
+        pthread_cond_broadcast(&s_cond);
+    }
+    pthread_mutex_unlock(&s_lock);
+    return NULL;
+}
+
+esp_mqtt_client_handle_t esp_mqtt_client_init(const esp_mqtt_client_config_t *config)
+{
+    s_client.next_msg_id = 1;
+    return &s_client;
+}
+
+esp_err_t esp_mqtt_client_register_event(esp_mqtt_client_handle_t client, esp_mqtt_event_id_t event,
+                                         esp_event_handler_t event_handler, void *event_handler_arg)
+{
+    client->handler = event_handler;
+    client->handler_arg = event_handler_arg;
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_start(esp_mqtt_client_handle_t client)
+{
+    pthread_mutex_lock(&s_lock);
+    if (client->running) {
+        pthread_mutex_unlock(&s_lock);
+        return ESP_FAIL;
+    }
+    client->running = true;
+    client->connected = true;
+    post_event(MQTT_EVENT_CONNECTED, 0, NULL, NULL, 0);
+    pthread_mutex_unlock(&s_lock);
+
+    pthread_create(&client->thread, NULL, client_task, NULL);
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_stop(esp_mqtt_client_handle_t client)
+{
+    pthread_mutex_lock(&s_lock);
+    if (!client->running) {
+        pthread_mutex_unlock(&s_lock);
+        return ESP_FAIL;
+    }
+    client->connected = false;
+    client->running = false;
+    client->topic_count = 0;
+    post_event(MQTT_EVENT_DISCONNECTED, 0, NULL, NULL, 0);
+    pthread_mutex_unlock(&s_lock);
+
+    pthread_join(client->thread, NULL);
+    return ESP_OK;
+}
+
+int esp_mqtt_client_publish(esp_mqtt_client_handle_t client, const char *topic, const char *data,
+                            int len, int qos, int retain)
+{
+    if (len == 0) {
+        len = (int)strlen(data);
+    }
+
+    pthread_mutex_lock(&s_lock);
+    if (!client->connected) {
+        pthread_mutex_unlock(&s_lock);
+        return -1;
+    }
+    int msg_id = qos > 0 ? client->next_msg_id++ : 0;
+    host_mqtt_observer_t observer = s_observer;
+    pthread_mutex_unlock(&s_lock);
+
+    if (observer != NULL) {
+        observer(topic, data, len, qos, retain);
+    }
+
+    // The stand-in broker acknowledges at once
+    if (qos > 0) {
+        pthread_mutex_lock(&s_lock);
+        post_event(MQTT_EVENT_PUBLISHED, msg_id, NULL, NULL, 0);
+        pthread_mutex_unlock(&s_lock);
+    }
+    return msg_id;
+}
+
+int esp_mqtt_client_subscribe(esp_mqtt_client_handle_t client, const char *topic, int qos)
+{
+    esp_mqtt_topic_t topic_info = { .filter = topic, .qos = qos };
+    return esp_mqtt_client_subscribe_multiple(client, &topic_info, 1);
+}
+
+int esp_mqtt_client_subscribe_multiple(esp_mqtt_client_handle_t client, const esp_mqtt_topic_t *topic_list, int size)
+{
+    pthread_mutex_lock(&s_lock);
+    if (!client->connected || client->topic_count + size > HOST_MQTT_TOPICS) {
+        pthread_mutex_unlock(&s_lock);
+        return -1;
+    }
+    for (int i = 0; i < size; i++) {
+        snprintf(client->topics[client->topic_count++], HOST_MQTT_TOPIC_LEN, "%s", topic_list[i].filter);
+    }
+    int msg_id = client->next_msg_id++;
+    post_event(MQTT_EVENT_SUBSCRIBED, msg_id, NULL, NULL, 0);
+    pthread_mutex_unlock(&s_lock);
+    return msg_id;
+}
+
+void host_mqtt_observe(host_mqtt_observer_t observer)
+{
+    pthread_mutex_lock(&s_lock);
+    s_observer = observer;
+    pthread_mutex_unlock(&s_lock);
+}
+
+int host_mqtt_deliver(const char *topic, const char *data, int len)
+{
+    pthread_mutex_lock(&s_lock);
+    for (int i = 0; i < s_client.topic_count; i++) {
+        if (strcmp(s_client.topics[i], topic) == 0) {
+            post_event(MQTT_EVENT_DATA, 0, topic, data, len);
+            pthread_mutex_unlock(&s_lock);
+            return 0;
+        }
+    }
+    pthread_mutex_unlock(&s_lock);
+    ESP_LOGW(TAG, "No subscriber for %s", topic);
+    return -1;
+}
+
+void host_mqtt_wait_idle(void)
+{
+    pthread_mutex_lock(&s_lock);
+    while (s_client.head != NULL || s_client.busy) {
+        pthread_cond_wait(&s_cond, &s_lock);
+    }
+    pthread_mutex_unlock(&s_lock);
+}
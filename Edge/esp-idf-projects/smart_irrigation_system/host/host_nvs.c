@@ -0,0 +1,330 @@
+/*
+ * NVS on the host filesystem. A namespace is a directory under
+ * host_nvs_dir(), each key a file named after its type and key, replaced
+ * atomically on write. Content survives a restart of the process, which is
+ * what the reboot scenarios of the benchmarks rely on.
+ */
+
+#include <dirent.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "nvs.h"
+#include "nvs_flash.h"
+#include "host_port.h"
+
+#define HOST_NVS_MAX_HANDLES    8
+#define HOST_NVS_MAX_KEYS       512
+#define HOST_NVS_KEY_LEN        16
+
+struct host_nvs_iterator {
+    char namespace_name[HOST_NVS_KEY_LEN];
+    char keys[HOST_NVS_MAX_KEYS][HOST_NVS_KEY_LEN];
+    nvs_type_t types[HOST_NVS_MAX_KEYS];
+    int count;
+    int index;
+};
+
+static pthread_mutex_t s_nvs_lock = PTHREAD_MUTEX_INITIALIZER;
+static char s_root[PATH_MAX];
+static pid_t s_root_owner;          // Process that made s_root, 0 for HOST_NVS_DIR
+static char s_namespaces[HOST_NVS_MAX_HANDLES][HOST_NVS_KEY_LEN];
+static int s_namespace_count;
+static _Atomic int64_t s_writes;
+
+// Remove every namespace and key, leaving the root directory
+static void erase_all(void)
+{
+    DIR *root = opendir(s_root);
+    if (root == NULL) {
+        return;
+    }
+    struct dirent *ns;
+    while ((ns = readdir(root)) != NULL) {
+        if (ns->d_name[0] == '.') {
+            continue;
+        }
+        char dir_path[PATH_MAX];
+        snprintf(dir_path, sizeof(dir_path), "%s/%s", s_root, ns->d_name);
+        DIR *dir = opendir(dir_path);
+        if (dir == NULL) {
+            continue;
+        }
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != NULL) {
+            if (entry->d_name[0] != '.') {
+                char path[PATH_MAX];
+                snprintf(path, sizeof(path), "%s/%s", dir_path, entry->d_name);
+                unlink(path);
+            }
+        }
+        closedir(dir);
+        rmdir(dir_path);
+    }
+    closedir(root);
+}
+
+// A directory made for this run goes with it, forked children keep the parent's
+static void remove_fresh_dir(void)
+{
+    if (s_root_owner != getpid()) {
+        return;
+    }
+    erase_all();
+    rmdir(s_root);
+}
+
+const char *host_nvs_dir(void)
+{
+    pthread_mutex_lock(&s_nvs_lock);
+    if (s_root[0] == '\0') {
+        const char *dir = getenv("HOST_NVS_DIR");
+        if (dir != NULL) {
+            snprintf(s_root, sizeof(s_root), "%s", dir);
+            mkdir(s_root, 0755);
+        } else {
+            snprintf(s_root, sizeof(s_root), "/tmp/host_nvs.XXXXXX");
+            if (mkdtemp(s_root) == NULL) {
+                perror("mkdtemp");
+                abort();
+            }
+            s_root_owner = getpid();
+            atexit(remove_fresh_dir);
+        }
+    }
+    pthread_mutex_unlock(&s_nvs_lock);
+    return s_root;
+}
+
+int64_t host_nvs_writes(void)
+{
+    return s_writes;
+}
+
+esp_err_t nvs_flash_init(void)
+{
+    host_nvs_dir();
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void)
+{
+    host_nvs_dir();
+    pthread_mutex_lock(&s_nvs_lock);
+    erase_all();
+    pthread_mutex_unlock(&s_nvs_lock);
+    s_writes++;
+    return ESP_OK;
+}
+
+static const char *type_prefix(nvs_type_t type)
+{
+    return type == NVS_TYPE_U32 ? "u32" : "blob";
+}
+
+static void key_path(nvs_handle_t handle, nvs_type_t type, const char *key, char *path, size_t size)
+{
+    snprintf(path, size, "%s/%s/%s.%s", host_nvs_dir(), s_namespaces[handle], type_prefix(type), key);
+}
+
+esp_err_t nvs_open(const char *namespace_name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+{
+    if (strlen(namespace_name) >= HOST_NVS_KEY_LEN) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    char dir[PATH_MAX];
+    snprintf(dir, sizeof(dir), "%s/%s", host_nvs_dir(), namespace_name);
+    struct stat st;
+    if (stat(dir, &st) != 0) {
+        if (open_mode == NVS_READONLY) {
+            return ESP_ERR_NVS_NOT_FOUND;
+        }
+        mkdir(dir, 0755);
+    }
+    
+    esp_err_t ret = ESP_OK;
+    pthread_mutex_lock(&s_nvs_lock);
+    int handle = 0;
+    while (handle < s_namespace_count && strcmp(s_namespaces[handle], namespace_name) != 0) {
+        handle++;
+    }
+    if (handle == s_namespace_count) {
+        if (s_namespace_count == HOST_NVS_MAX_HANDLES) {
+            ret = ESP_ERR_NO_MEM;
+        } else {
+            strcpy(s_namespaces[s_namespace_count++], namespace_name);
+        }
+    }
+    pthread_mutex_unlock(&s_nvs_lock);
+    
+    *out_handle = (nvs_handle_t)handle;
+    return ret;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+    (void)handle;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    (void)handle;
+    return ESP_OK;
+}
+
+static esp_err_t write_key(nvs_handle_t handle, nvs_type_t type, const char *key,
+                           const void *value, size_t length)
+{
+    char path[PATH_MAX];
+    char tmp[PATH_MAX + 4];
+    key_path(handle, type, key, path, sizeof(path));
+    snprintf(tmp, sizeof(tmp), "%s.new", path);
+    
+    FILE *file = fopen(tmp, "wb");
+    if (file == NULL) {
+        return ESP_FAIL;
+    }
+    size_t written = fwrite(value, 1, length, file);
+    if (fclose(file) != 0 || written != length || rename(tmp, path) != 0) {
+        unlink(tmp);
+        return ESP_FAIL;
+    }
+    s_writes++;
+    return ESP_OK;
+}
+
+static esp_err_t read_key(nvs_handle_t handle, nvs_type_t type, const char *key,
+                          void *out_value, size_t *length)
+{
+    char path[PATH_MAX];
+    key_path(handle, type, key, path, sizeof(path));
+    
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    fseek(file, 0, SEEK_END);
+    size_t size = (size_t)ftell(file);
+    rewind(file);
+    
+    esp_err_t ret = ESP_OK;
+    if (out_value != NULL) {
+        if (*length < size) {
+            ret = ESP_ERR_INVALID_SIZE;
+        } else if (fread(out_value, 1, size, file) != size) {
+            ret = ESP_FAIL;
+        }
+    }
+    fclose(file);
+    *length = size;
+    return ret;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    return write_key(handle, NVS_TYPE_BLOB, key, value, length);
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length)
+{
+    return read_key(handle, NVS_TYPE_BLOB, key, out_value, length);
+}
+
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char *key, uint32_t value)
+{
+    return write_key(handle, NVS_TYPE_U32, key, &value, sizeof(value));
+}
+
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char *key, uint32_t *out_value)
+{
+    size_t length = sizeof(*out_value);
+    return read_key(handle, NVS_TYPE_U32, key, out_value, &length);
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key)
+{
+    char path[PATH_MAX];
+    const nvs_type_t types[] = { NVS_TYPE_BLOB, NVS_TYPE_U32 };
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        key_path(handle, types[i], key, path, sizeof(path));
+        if (unlink(path) == 0) {
+            s_writes++;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_entry_find(const char *part_name, const char *namespace_name, nvs_type_t type,
+                         nvs_iterator_t *output_iterator)
+{
+    (void)part_name;
+    *output_iterator = NULL;
+    
+    char dir_path[PATH_MAX];
+    snprintf(dir_path, sizeof(dir_path), "%s/%s", host_nvs_dir(), namespace_name);
+    DIR *dir = opendir(dir_path);
+    if (dir == NULL) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    
+    nvs_iterator_t it = calloc(1, sizeof(*it));
+    if (it == NULL) {
+        closedir(dir);
+        return ESP_ERR_NO_MEM;
+    }
+    snprintf(it->namespace_name, sizeof(it->namespace_name), "%s", namespace_name);
+    
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL && it->count < HOST_NVS_MAX_KEYS) {
+        char *dot = strchr(entry->d_name, '.');
+        if (dot == NULL || strchr(dot + 1, '.') != NULL || strlen(dot + 1) >= HOST_NVS_KEY_LEN) {
+            continue;
+        }
+        nvs_type_t entry_type = strncmp(entry->d_name, "u32", dot - entry->d_name) == 0 ?
+                                NVS_TYPE_U32 : NVS_TYPE_BLOB;
+        if (type != NVS_TYPE_ANY && type != entry_type) {
+            continue;
+        }
+        strcpy(it->keys[it->count], dot + 1);
+        it->types[it->count] = entry_type;
+        it->count++;
+    }
+    closedir(dir);
+    
+    if (it->count == 0) {
+        free(it);
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    *output_iterator = it;
+    return ESP_OK;
+}
+
+esp_err_t nvs_entry_next(nvs_iterator_t *iterator)
+{
+    if (++(*iterator)->index >= (*iterator)->count) {
+        free(*iterator);
+        *iterator = NULL;
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    return ESP_OK;
+}
+
+esp_err_t nvs_entry_info(const nvs_iterator_t iterator, nvs_entry_info_t *out_info)
+{
+    snprintf(out_info->namespace_name, sizeof(out_info->namespace_name), "%s", iterator->namespace_name);
+    snprintf(out_info->key, sizeof(out_info->key), "%s", iterator->keys[iterator->index]);
+    out_info->type = iterator->types[iterator->index];
+    return ESP_OK;
+}
+
+void nvs_release_iterator(nvs_iterator_t iterator)
+{
+    free(iterator);
+}
@@ -0,0 +1,498 @@
+/*
+ * Host implementation of the ESP-IDF and FreeRTOS calls the components make,
+ * declared by the headers under stubs/. Only what the benchmarks exercise is
+ * modelled: simulated esp_timer time, GPIO/LEDC levels, FreeRTOS queues on
+ * pthreads and mutex semaphores.
+ */
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "esp_err.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "nvs_flash.h"
+#include "driver/gpio.h"
+#include "driver/ledc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "host_port.h"
+
+#define HOST_MAX_TIMERS     32
+#define HOST_MAX_GPIO       64
+#define HOST_MAX_SHUTDOWN   8
+
+int host_log_enabled = 0;
+
+__attribute__((constructor))
+static void host_log_init(void)
+{
+    host_log_enabled = getenv("HOST_LOG") != NULL;
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+        case ESP_OK:                    return "ESP_OK";
+        case ESP_FAIL:                  return "ESP_FAIL";
+        case ESP_ERR_NO_MEM:            return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG:       return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE:     return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE:      return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND:         return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED:     return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT:           return "ESP_ERR_TIMEOUT";
+        case ESP_ERR_INVALID_RESPONSE:  return "ESP_ERR_INVALID_RESPONSE";
+        case ESP_ERR_INVALID_VERSION:   return "ESP_ERR_INVALID_VERSION";
+        case ESP_ERR_NOT_FINISHED:      return "ESP_ERR_NOT_FINISHED";
+        default:                        return "UNKNOWN ERROR";
+    }
+}
+
+// ---------------------------------------------------------------------------
+// esp_timer on simulated time
+
+struct host_timer {
+    esp_timer_cb_t callback;
+    void *arg;
+    int64_t due;
+    int64_t period;
+    bool active;
+};
+
+static pthread_mutex_t s_timer_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct host_timer s_timers[HOST_MAX_TIMERS];
+static int s_timer_count;
+static _Atomic int64_t s_now_us;
+
+static void host_wait_all_idle(void);
+
+int64_t esp_timer_get_time(void)
+{
+    return s_now_us;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out_handle)
+{
+    pthread_mutex_lock(&s_timer_lock);
+    if (s_timer_count == HOST_MAX_TIMERS) {
+        pthread_mutex_unlock(&s_timer_lock);
+        return ESP_ERR_NO_MEM;
+    }
+    struct host_timer *timer = &s_timers[s_timer_count++];
+    timer->callback = args->callback;
+    timer->arg = args->arg;
+    timer->active = false;
+    pthread_mutex_unlock(&s_timer_lock);
+    *out_handle = timer;
+    return ESP_OK;
+}
+
+static esp_err_t timer_start(esp_timer_handle_t timer, uint64_t timeout_us, uint64_t period_us)
+{
+    esp_err_t ret = ESP_OK;
+    pthread_mutex_lock(&s_timer_lock);
+    if (timer->active) {
+        ret = ESP_ERR_INVALID_STATE;
+    } else {
+        timer->due = s_now_us + (int64_t)timeout_us;
+        timer->period = (int64_t)period_us;
+        timer->active = true;
+    }
+    pthread_mutex_unlock(&s_timer_lock);
+    return ret;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    return timer_start(timer, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period)
+{
+    return timer_start(timer, period, period);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    esp_err_t ret = ESP_OK;
+    pthread_mutex_lock(&s_timer_lock);
+    if (!timer->active) {
+        ret = ESP_ERR_INVALID_STATE;
+    }
+    timer->active = false;
+    pthread_mutex_unlock(&s_timer_lock);
+    return ret;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer)
+{
+    pthread_mutex_lock(&s_timer_lock);
+    bool active = timer->active;
+    pthread_mutex_unlock(&s_timer_lock);
+    return active;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    pthread_mutex_lock(&s_timer_lock);
+    timer->active = false;
+    timer->callback = NULL;
+    pthread_mutex_unlock(&s_timer_lock);
+    return ESP_OK;
+}
+
+void host_advance_to(int64_t time_us)
+{
+    while (1) {
+        pthread_mutex_lock(&s_timer_lock);
+        struct host_timer *next = NULL;
+        for (int i = 0; i < s_timer_count; i++) {
+            struct host_timer *timer = &s_timers[i];
+            if (timer->active && timer->due <= time_us && (next == NULL || timer->due < next->due)) {
+                next = timer;
+            }
+        }
+        if (next == NULL) {
+            s_now_us = time_us > s_now_us ? time_us : s_now_us;
+            pthread_mutex_unlock(&s_timer_lock);
+            return;
+        }
+        
+        s_now_us = next->due;
+        if (next->period > 0) {
+            next->due += next->period;
+        } else {
+            next->active = false;
+        }
+        esp_timer_cb_t callback = next->callback;
+        void *arg = next->arg;
+        pthread_mutex_unlock(&s_timer_lock);
+        
+        // Called unlocked, callbacks may re-arm their timer. Whatever the
+        // callback posted is handled before time moves on, as the consumer
+        // task would preempt the esp_timer task on the chip.
+        callback(arg);
+        host_wait_all_idle();
+    }
+}
+
+// Wall clock follows the simulated time, see -Dgettimeofday in the Makefile
+int host_gettimeofday(struct timeval *tv, void *tz)
+{
+    (void)tz;
+    int64_t now = s_now_us;
+    tv->tv_sec = HOST_EPOCH_BASE + now / 1000000;
+    tv->tv_usec = now % 1000000;
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// GPIO and LEDC
+
+static _Atomic int s_gpio_levels[HOST_MAX_GPIO];
+static _Atomic int64_t s_gpio_changes;
+
+esp_err_t gpio_config(const gpio_config_t *config)
+{
+    (void)config;
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level)
+{
+    if (gpio_num < 0 || gpio_num >= HOST_MAX_GPIO) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (atomic_exchange(&s_gpio_levels[gpio_num], (int)level) != (int)level) {
+        s_gpio_changes++;
+    }
+    return ESP_OK;
+}
+
+int host_gpio_level(int gpio_num)
+{
+    return s_gpio_levels[gpio_num];
+}
+
+int64_t host_gpio_changes(void)
+{
+    return s_gpio_changes;
+}
+
+esp_err_t ledc_timer_config(const ledc_timer_config_t *config)
+{
+    (void)config;
+    return ESP_OK;
+}
+
+esp_err_t ledc_channel_config(const ledc_channel_config_t *config)
+{
+    (void)config;
+    return ESP_OK;
+}
+
+esp_err_t ledc_set_duty(ledc_mode_t mode, ledc_channel_t channel, uint32_t duty)
+{
+    (void)mode;
+    (void)channel;
+    (void)duty;
+    return ESP_OK;
+}
+
+esp_err_t ledc_update_duty(ledc_mode_t mode, ledc_channel_t channel)
+{
+    (void)mode;
+    (void)channel;
+    return ESP_OK;
+}
+
+// ---------------------------------------------------------------------------
+// FreeRTOS
+
+struct host_queue {
+    struct host_queue *next;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t head;
+    UBaseType_t count;
+    bool consumer_waiting;
+    bool has_consumer;          // A task has blocked on the queue before
+    char *items;
+};
+
+static pthread_mutex_t s_queue_list_lock = PTHREAD_MUTEX_INITIALIZER;
+static QueueHandle_t s_queues;
+static _Atomic(QueueHandle_t) s_last_queue;
+static _Atomic int64_t s_queue_wakeups;
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    QueueHandle_t queue = calloc(1, sizeof(struct host_queue));
+    if (queue == NULL) {
+        return NULL;
+    }
+    queue->items = malloc((size_t)length * item_size);
+    if (queue->items == NULL) {
+        free(queue);
+        return NULL;
+    }
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->changed, NULL);
+    queue->length = length;
+    queue->item_size = item_size;
+    pthread_mutex_lock(&s_queue_list_lock);
+    queue->next = s_queues;
+    s_queues = queue;
+    pthread_mutex_unlock(&s_queue_list_lock);
+    s_last_queue = queue;
+    return queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks_to_wait)
+{
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == queue->length) {
+        if (ticks_to_wait == 0) {
+            pthread_mutex_unlock(&queue->lock);
+            return pdFALSE;
+        }
+        pthread_cond_wait(&queue->changed, &queue->lock);
+    }
+    UBaseType_t tail = (queue->head + queue->count) % queue->length;
+    memcpy(queue->items + (size_t)tail * queue->item_size, item, queue->item_size);
+    queue->count++;
+    pthread_cond_broadcast(&queue->changed);
+    pthread_mutex_unlock(&queue->lock);
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *buffer, TickType_t ticks_to_wait)
+{
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == 0) {
+        if (ticks_to_wait == 0) {
+            pthread_mutex_unlock(&queue->lock);
+            return pdFALSE;
+        }
+        queue->consumer_waiting = true;
+        queue->has_consumer = true;
+        pthread_cond_broadcast(&queue->changed);
+        pthread_cond_wait(&queue->changed, &queue->lock);
+    }
+    queue->consumer_waiting = false;
+    memcpy(buffer, queue->items + (size_t)queue->head * queue->item_size, queue->item_size);
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+    s_queue_wakeups++;
+    pthread_cond_broadcast(&queue->changed);
+    pthread_mutex_unlock(&queue->lock);
+    return pdTRUE;
+}
+
+QueueHandle_t host_last_queue(void)
+{
+    return s_last_queue;
+}
+
+void host_queue_wait_idle(QueueHandle_t queue)
+{
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count > 0 || !queue->consumer_waiting) {
+        pthread_cond_wait(&queue->changed, &queue->lock);
+    }
+    pthread_mutex_unlock(&queue->lock);
+}
+
+static void host_wait_all_idle(void)
+{
+    pthread_mutex_lock(&s_queue_list_lock);
+    for (QueueHandle_t queue = s_queues; queue != NULL; queue = queue->next) {
+        if (queue->has_consumer) {
+            host_queue_wait_idle(queue);
+        }
+    }
+    pthread_mutex_unlock(&s_queue_list_lock);
+}
+
+int64_t host_queue_wakeups(void)
+{
+    return s_queue_wakeups;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    SemaphoreHandle_t mutex = malloc(sizeof(pthread_mutex_t));
+    if (mutex != NULL) {
+        pthread_mutex_init(mutex, NULL);
+    }
+    return mutex;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t mutex, TickType_t ticks_to_wait)
+{
+    (void)ticks_to_wait;
+    pthread_mutex_lock(mutex);
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t mutex)
+{
+    pthread_mutex_unlock(mutex);
+    return pdTRUE;
+}
+
+struct host_task {
+    TaskFunction_t task;
+    void *arg;
+};
+
+static void *task_thread(void *arg)
+{
+    struct host_task start = *(struct host_task *)arg;
+    free(arg);
+    start.task(start.arg);
+    return NULL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t task, const char *name, uint32_t stack_depth, void *arg,
+                       UBaseType_t priority, TaskHandle_t *handle)
+{
+    struct host_task *start = malloc(sizeof(*start));
+    if (start == NULL) {
+        return pdFAIL;
+    }
+    start->task = task;
+    start->arg = arg;
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, task_thread, start) != 0) {
+        free(start);
+        return pdFAIL;
+    }
+    pthread_detach(thread);
+    if (handle != NULL) {
+        *handle = (TaskHandle_t)thread;
+    }
+    return pdPASS;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    usleep(ticks * 1000u);
+}
+
+// ---------------------------------------------------------------------------
+// Restart
+
+static shutdown_handler_t s_shutdown[HOST_MAX_SHUTDOWN];
+static int s_shutdown_count;
+
+esp_err_t esp_register_shutdown_handler(shutdown_handler_t handle)
+{
+    for (int i = 0; i < s_shutdown_count; i++) {
+        if (s_shutdown[i] == handle) {
+            return ESP_ERR_INVALID_STATE;
+        }
+    }
+    if (s_shutdown_count == HOST_MAX_SHUTDOWN) {
+        return ESP_ERR_NO_MEM;
+    }
+    s_shutdown[s_shutdown_count++] = handle;
+    return ESP_OK;
+}
+
+void host_restart(void)
+{
+    for (int i = s_shutdown_count - 1; i >= 0; i--) {
+        s_shutdown[i]();
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Scenarios
+
+int host_run_isolated(void (*scenario)(void *arg, void *result), void *arg, void *result, size_t size)
+{
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return -1;
+    }
+    
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        memset(result, 0, size);
+        scenario(arg, result);
+        // exit() rather than _exit(), to remove an NVS directory the scenario made
+        exit(write(fds[1], result, size) == (ssize_t)size ? 0 : 1);
+    }
+    
+    close(fds[1]);
+    size_t got = 0;
+    while (got < size) {
+        ssize_t n = read(fds[0], (char *)result + got, size - got);
+        if (n <= 0) {
+            break;
+        }
+        got += (size_t)n;
+    }
+    close(fds[0]);
+    
+    int status;
+    waitpid(pid, &status, 0);
+    return got == size && WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
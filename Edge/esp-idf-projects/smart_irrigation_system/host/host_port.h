@@ -0,0 +1,109 @@
+/*
+ * Controls the benchmarks use to drive the host port: the simulated clock,
+ * relay levels and counters that a device build has no equivalent for.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "freertos/queue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Epoch seconds at simulated time zero, 2024-07-01 00:00 UTC
+#define HOST_EPOCH_BASE     1719792000LL
+
+/**
+ * @brief Move simulated time forward, firing due esp_timer callbacks in order
+ *
+ * After each callback, waits until every queue a task blocks on is drained.
+ *
+ * @param time_us Target esp_timer time in microseconds, never earlier than now
+ */
+void host_advance_to(int64_t time_us);
+
+/**
+ * @brief Current level of a GPIO driven through gpio_set_level()
+ */
+int host_gpio_level(int gpio_num);
+
+/**
+ * @brief Number of level changes of all GPIOs since start
+ */
+int64_t host_gpio_changes(void);
+
+/**
+ * @brief Queue most recently created with xQueueCreate()
+ */
+QueueHandle_t host_last_queue(void);
+
+/**
+ * @brief Block until a queue is empty and its consumer waits on it again
+ */
+void host_queue_wait_idle(QueueHandle_t queue);
+
+/**
+ * @brief Items taken from all queues since start, one per consumer wakeup
+ */
+int64_t host_queue_wakeups(void);
+
+/**
+ * @brief Run the esp_register_shutdown_handler() handlers, newest first
+ *
+ * What esp_restart() does before the reset. The scenario then returns to
+ * end the boot.
+ */
+void host_restart(void);
+
+/**
+ * @brief Run a scenario in a child process and collect its result
+ *
+ * The components keep static state, so every scenario that must start from
+ * a clean controller runs in its own process. The child starts with the
+ * parent's state, which should not have initialized any component yet.
+ *
+ * @param scenario Fills result, runs in the child
+ * @param arg Passed to scenario
+ * @param result Receives what the child filled in
+ * @param size Size of result
+ * @return 0 when the child finished and delivered its result
+ */
+int host_run_isolated(void (*scenario)(void *arg, void *result), void *arg, void *result, size_t size);
+
+/**
+ * @brief NVS writes (set calls) since start
+ */
+int64_t host_nvs_writes(void);
+
+/**
+ * @brief Directory holding the NVS files, from HOST_NVS_DIR or a fresh one
+ */
+const char *host_nvs_dir(void);
+
+/**
+ * @brief Receives every message the device publishes, on the publishing thread
+ */
+typedef void (*host_mqtt_observer_t)(const char *topic, const char *data, int len, int qos, int retain);
+
+/**
+ * @brief Set the observer for device publishes, NULL for none
+ */
+void host_mqtt_observe(host_mqtt_observer_t observer);
+
+/**
+ * @brief Send a message to the device as if another client published it
+ *
+ * @return 0 if the device subscribed to the topic, -1 otherwise
+ */
+int host_mqtt_deliver(const char *topic, const char *data, int len);
+
+/**
+ * @brief Block until the MQTT client thread has handled every pending event
+ */
+void host_mqtt_wait_idle(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,300 @@
+/*
+ * MQTT outbox under link drops and reboots
+ *
+ * Runs mqtt_outbox.c against a simulated broker on a 1 ms clock. PUBLISH and
+ * PUBACK each take half the round trip. The producer either keeps 48
+ * messages queued or queues one every interval, about one in 200 an alarm.
+ * A link drop loses everything on the wire and reconnects 0.5-3.5 s later.
+ * A reboot ends the process the device runs in: host_run_isolated() starts
+ * the next boot in a fresh one, and only NVS and the broker survive. A
+ * restart runs the shutdown handlers first, a power cut does not and may
+ * lose the messages younger than the persist delay, no other loss passes.
+ * The broker drops repeats by the "seq" member, the way consumers do, and
+ * counts them. NVS writes are reported per message.
+ *
+ *    make sim_outbox && ./sim_outbox
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "nvs_flash.h"
+#include "mqtt_outbox.h"
+#include "host_port.h"
+
+#define MAX_MESSAGES    4096
+#define MAX_SEQ         (1 << 17)
+#define QUEUE_TARGET    48
+#define ALARM_EVERY     200
+#define MAX_PACKETS     1024
+#define MAX_CUTS        256
+#define ALARM_TOPIC     "irrigation/dev/alarm"
+#define SENSOR_TOPIC    "irrigation/dev/sensors"
+
+typedef struct {
+    int window;
+    int rtt_ms;
+    uint32_t total;
+    int interval_ms;            // Between messages, 0 to keep QUEUE_TARGET queued
+    double drop_p;              // Per millisecond
+    double restart_p;
+    double power_p;
+} run_config_t;
+
+// Everything outside the device, carried from one boot to the next
+typedef struct {
+    int64_t now_ms;
+    uint32_t rng;
+    uint32_t produced;
+    int drops;
+    int restarts;
+    int cuts;
+    int64_t cut_ms[MAX_CUTS];
+    int64_t nvs_writes;
+    bool done;
+    long publishes;             // PUBLISH packets the broker received
+    long repeats;               // Of those, already seen by seq
+    uint8_t seen[MAX_SEQ];
+    uint8_t received[MAX_MESSAGES];
+    uint8_t alarm[MAX_MESSAGES];
+    int64_t created_ms[MAX_MESSAGES];
+    int64_t delivered_ms[MAX_MESSAGES];
+} world_t;
+
+// A packet on the simulated link
+typedef struct {
+    int64_t at_ms;
+    bool to_broker;
+    int msg_id;
+    uint32_t k;
+    uint32_t seq;
+} packet_t;
+
+static const run_config_t *s_config;
+static world_t *s_world;
+static packet_t s_wire[MAX_PACKETS];
+static int s_wire_count;
+static bool s_link_up;
+static int s_next_msg_id = 1;
+
+static uint32_t next_random(void)
+{
+    uint32_t x = s_world->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return s_world->rng = x;
+}
+
+static double uniform(void)
+{
+    return (next_random() & 0xffffff) / (double)0x1000000;
+}
+
+static int publish(const char *topic, const char *data, int len, bool retain, void *arg)
+{
+    if (!s_link_up || s_wire_count == MAX_PACKETS) {
+        return -1;
+    }
+    unsigned k = 0;
+    unsigned seq = 0;
+    sscanf(data, "{\"k\":%u,\"seq\":%u", &k, &seq);
+    int msg_id = s_next_msg_id;
+    s_next_msg_id = s_next_msg_id % 65535 + 1;
+    s_wire[s_wire_count++] = (packet_t){ s_world->now_ms + s_config->rtt_ms / 2, true, msg_id, k, seq };
+    return msg_id;
+}
+
+static void produce(void)
+{
+    mqtt_outbox_stats_t stats;
+    mqtt_outbox_get_stats(&stats);
+    if (s_world->produced >= s_config->total || stats.queued >= QUEUE_TARGET) {
+        return;
+    }
+    if (s_config->interval_ms && s_world->produced &&
+        s_world->now_ms - s_world->created_ms[s_world->produced - 1] < s_config->interval_ms) {
+        return;
+    }
+
+    uint32_t k = s_world->produced;
+    bool alarm = next_random() % ALARM_EVERY == 0;
+    uint32_t seq = mqtt_outbox_reserve_seq();
+    char payload[160];
+    int len = snprintf(payload, sizeof(payload), "{\"k\":%u,\"seq\":%u,\"temperature\":21.5,"
+                       "\"humidity\":55.2,\"soil_moisture\":33.1}", (unsigned)k, (unsigned)seq);
+    if (mqtt_outbox_enqueue(alarm ? ALARM_TOPIC : SENSOR_TOPIC, payload, len, false, seq) == ESP_OK) {
+        s_world->created_ms[k] = s_world->now_ms;
+        s_world->alarm[k] = alarm;
+        s_world->produced++;
+    }
+}
+
+static void deliver_due(void)
+{
+    for (int i = 0; i < s_wire_count; ) {
+        if (s_wire[i].at_ms > s_world->now_ms) {
+            i++;
+            continue;
+        }
+        packet_t p = s_wire[i];
+        s_wire[i] = s_wire[--s_wire_count];
+        if (!p.to_broker) {
+            mqtt_outbox_acked(p.msg_id);
+            continue;
+        }
+        s_world->publishes++;
+        if (p.seq >= MAX_SEQ || s_world->seen[p.seq]) {
+            s_world->repeats++;
+        } else {
+            s_world->seen[p.seq] = 1;
+            s_world->received[p.k]++;
+            s_world->delivered_ms[p.k] = s_world->now_ms;
+        }
+        s_wire[s_wire_count++] = (packet_t){ s_world->now_ms + s_config->rtt_ms / 2, false, p.msg_id, 0, 0 };
+    }
+}
+
+// One boot of the device, until it reboots or everything is acknowledged
+static void boot(void *arg, void *result)
+{
+    s_world = result;
+    memcpy(s_world, arg, sizeof(*s_world));
+    int64_t nvs_writes = host_nvs_writes();
+    host_advance_to(s_world->now_ms * 1000);
+
+    mqtt_outbox_config_t config = { .window = s_config->window, .persist = true, .publish = publish };
+    if (mqtt_outbox_init(&config) != ESP_OK) {
+        abort();
+    }
+    mqtt_outbox_set_topic_priority(ALARM_TOPIC, MQTT_PRIORITY_HIGH);
+    int64_t link_up_at = s_world->now_ms + 200;
+
+    for (;;) {
+        s_world->now_ms++;
+        host_advance_to(s_world->now_ms * 1000);
+        if (!s_link_up && s_world->now_ms >= link_up_at) {
+            s_link_up = true;
+            mqtt_outbox_connected();
+        }
+        produce();
+        deliver_due();
+
+        if (s_link_up && uniform() < s_config->drop_p) {
+            s_link_up = false;
+            s_wire_count = 0;
+            s_world->drops++;
+            mqtt_outbox_disconnected();
+            link_up_at = s_world->now_ms + 500 + next_random() % 3000;
+        }
+        double reboot = uniform();
+        if (reboot < s_config->restart_p) {
+            s_world->restarts++;
+            host_restart();
+            break;
+        }
+        if (reboot < s_config->restart_p + s_config->power_p && s_world->cuts < MAX_CUTS) {
+            s_world->cut_ms[s_world->cuts++] = s_world->now_ms;
+            break;
+        }
+
+        mqtt_outbox_stats_t stats;
+        mqtt_outbox_get_stats(&stats);
+        if (s_world->produced == s_config->total && stats.queued == 0 && s_wire_count == 0) {
+            s_world->done = true;
+            break;
+        }
+    }
+    s_world->nvs_writes += host_nvs_writes() - nvs_writes;
+}
+
+static int run(const run_config_t *config)
+{
+    static world_t world;
+    static world_t last_boot;
+
+    s_config = config;
+    memset(&world, 0, sizeof(world));
+    world.rng = 12345;
+    nvs_flash_erase();
+    while (!world.done) {
+        last_boot = world;
+        if (host_run_isolated(boot, &last_boot, &world, sizeof(world)) != 0) {
+            printf("  window %2d: boot failed\n", config->window);
+            return 1;
+        }
+    }
+
+    long lost = 0;
+    long cut = 0;
+    int64_t telemetry_sum = 0;
+    int64_t telemetry_max = 0;
+    int64_t alarm_sum = 0;
+    int64_t alarm_max = 0;
+    int telemetry = 0;
+    int alarms = 0;
+    for (uint32_t k = 0; k < world.produced; k++) {
+        if (!world.received[k]) {
+            // Excused if a power cut came before the outbox had to store it
+            bool excused = false;
+            for (int c = 0; c < world.cuts; c++) {
+                int64_t age = world.cut_ms[c] - world.created_ms[k];
+                excused |= age >= 0 && age < MQTT_OUTBOX_PERSIST_DELAY_MS + config->rtt_ms;
+            }
+            excused ? cut++ : lost++;
+            continue;
+        }
+        int64_t latency = world.delivered_ms[k] - world.created_ms[k];
+        if (world.alarm[k]) {
+            alarm_sum += latency;
+            alarm_max = latency > alarm_max ? latency : alarm_max;
+            alarms++;
+        } else {
+            telemetry_sum += latency;
+            telemetry_max = latency > telemetry_max ? latency : telemetry_max;
+            telemetry++;
+        }
+    }
+    printf("  window %2d: %3d drops %2d restarts %2d cuts  %5.1f msg/s  lost %ld+%ld  repeats %4.1f%%  "
+           "NVS %4.2f/msg  latency telemetry avg %5.2f s max %5.2f s, alarm avg %4.2f s max %4.2f s\n",
+           config->window, world.drops, world.restarts, world.cuts, world.produced * 1000.0 / world.now_ms,
+           lost, cut, 100.0 * world.repeats / world.publishes, (double)world.nvs_writes / world.produced,
+           telemetry ? telemetry_sum / 1e3 / telemetry : 0.0, telemetry_max / 1e3,
+           alarms ? alarm_sum / 1e3 / alarms : 0.0, alarm_max / 1e3);
+    return lost != 0;
+}
+
+int main(void)
+{
+    static const run_config_t clean[] = {
+        { 1, 200, 2000, 0, 0, 0, 0 },
+        { 4, 200, 2000, 0, 0, 0, 0 },
+        { 8, 200, 2000, 0, 0, 0, 0 },
+        { 16, 200, 2000, 0, 0, 0, 0 },
+    };
+    static const run_config_t faulty[] = {
+        { 1, 200, 3000, 0, 1e-4, 1e-5, 1e-5 },
+        { 4, 200, 3000, 0, 1e-4, 1e-5, 1e-5 },
+        { 16, 200, 3000, 0, 1e-4, 1e-5, 1e-5 },
+    };
+    static const run_config_t paced[] = {
+        { 4, 200, 2000, 500, 0, 0, 0 },
+        { 4, 200, 2000, 500, 1e-4, 1e-5, 1e-5 },
+    };
+
+    ESP_ERROR_CHECK(nvs_flash_init());
+    int failures = 0;
+    printf("2000 messages, 200 ms RTT, no faults\n");
+    for (size_t i = 0; i < sizeof(clean) / sizeof(clean[0]); i++) {
+        failures += run(&clean[i]);
+    }
+    printf("3000 messages, 200 ms RTT, link drops, restarts and power cuts\n");
+    for (size_t i = 0; i < sizeof(faulty) / sizeof(faulty[0]); i++) {
+        failures += run(&faulty[i]);
+    }
+    printf("2000 messages 0.5 s apart, 200 ms RTT, without and with faults\n");
+    for (size_t i = 0; i < sizeof(paced) / sizeof(paced[0]); i++) {
+        failures += run(&paced[i]);
+    }
+    return failures != 0;
+}
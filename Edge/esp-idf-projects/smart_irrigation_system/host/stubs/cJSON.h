@@ -0,0 +1,51 @@
+/*
+ * Host stand-in for the cJSON API the components use, implemented in
+ * host_cjson.c. Objects, strings, numbers, booleans and null; arrays are
+ * not needed and not parsed.
+ */
+#pragma once
+
+#include <stddef.h>
+
+#define cJSON_Invalid   (0)
+#define cJSON_False     (1 << 0)
+#define cJSON_True      (1 << 1)
+#define cJSON_NULL      (1 << 2)
+#define cJSON_Number    (1 << 3)
+#define cJSON_String    (1 << 4)
+#define cJSON_Array     (1 << 5)
+#define cJSON_Object    (1 << 6)
+
+typedef struct cJSON {
+    struct cJSON *next;
+    struct cJSON *prev;
+    struct cJSON *child;
+    int type;
+    char *valuestring;
+    int valueint;
+    double valuedouble;
+    char *string;
+} cJSON;
+
+cJSON *cJSON_ParseWithLength(const char *value, size_t buffer_length);
+cJSON *cJSON_Parse(const char *value);
+void cJSON_Delete(cJSON *item);
+cJSON *cJSON_GetObjectItemCaseSensitive(const cJSON *object, const char *string);
+cJSON *cJSON_GetObjectItem(const cJSON *object, const char *string);
+cJSON *cJSON_CreateObject(void);
+cJSON *cJSON_AddStringToObject(cJSON *object, const char *name, const char *string);
+cJSON *cJSON_AddNumberToObject(cJSON *object, const char *name, double number);
+cJSON *cJSON_AddBoolToObject(cJSON *object, const char *name, int boolean);
+char *cJSON_PrintUnformatted(const cJSON *item);
+char *cJSON_Print(const cJSON *item);
+
+#define cJSON_IsObject(item)    ((item) != NULL && ((item)->type & cJSON_Object))
+#define cJSON_IsNull(item)      ((item) != NULL && ((item)->type & cJSON_NULL))
+#define cJSON_IsBool(item)      ((item) != NULL && ((item)->type & (cJSON_True | cJSON_False)))
+#define cJSON_IsTrue(item)      ((item) != NULL && ((item)->type & cJSON_True))
+#define cJSON_IsFalse(item)     ((item) != NULL && ((item)->type & cJSON_False))
+#define cJSON_IsNumber(item)    ((item) != NULL && ((item)->type & cJSON_Number))
+#define cJSON_IsString(item)    ((item) != NULL && ((item)->type & cJSON_String))
+
+#define cJSON_ArrayForEach(element, array) \
+    for (element = (array) != NULL ? (array)->child : NULL; element != NULL; element = element->next)
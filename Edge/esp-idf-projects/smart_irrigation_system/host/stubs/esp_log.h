@@ -0,0 +1,17 @@
+/*
+ * Host stand-in for esp_log.h. Logging is off unless HOST_LOG is set in
+ * the environment, so benchmarks measure the code rather than printf.
+ */
+#pragma once
+
+#include <stdio.h>
+
+extern int host_log_enabled;
+
+#define HOST_LOG(level, tag, format, ...) \
+    do { if (host_log_enabled) printf(level " (%s) " format "\n", tag, ##__VA_ARGS__); } while (0)
+
+#define ESP_LOGE(tag, format, ...) HOST_LOG("E", tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) HOST_LOG("W", tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) HOST_LOG("I", tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) do { if (0) printf(format, ##__VA_ARGS__); } while (0)
@@ -0,0 +1,11 @@
+/*
+ * Host stand-in for esp_system.h, the shutdown handlers only. A benchmark
+ * runs them with host_restart() where the device would call esp_restart().
+ */
+#pragma once
+
+#include "esp_err.h"
+
+typedef void (*shutdown_handler_t)(void);
+
+esp_err_t esp_register_shutdown_handler(shutdown_handler_t handle);
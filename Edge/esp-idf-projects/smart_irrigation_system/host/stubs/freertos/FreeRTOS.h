@@ -0,0 +1,27 @@
+/*
+ * Host stand-in for the FreeRTOS headers. Tasks are pthreads, critical
+ * sections are a mutex, ticks are milliseconds.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <pthread.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdTRUE              1
+#define pdFALSE             0
+#define pdPASS              pdTRUE
+#define pdFAIL              pdFALSE
+#define portMAX_DELAY       ((TickType_t)0xffffffffu)
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(ms))
+
+typedef pthread_mutex_t portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED    PTHREAD_MUTEX_INITIALIZER
+#define portENTER_CRITICAL(mux)         pthread_mutex_lock(mux)
+#define portEXIT_CRITICAL(mux)          pthread_mutex_unlock(mux)
+#define taskENTER_CRITICAL(mux)         pthread_mutex_lock(mux)
+#define taskEXIT_CRITICAL(mux)          pthread_mutex_unlock(mux)
@@ -0,0 +1,204 @@
+/*
+ * Remote configuration through MQTT
+ *
+ * Runs the device's MQTT client against the in-process broker and sends
+ * patches to irrigation/<id>/config/set the way a dashboard would. The
+ * validation and etag cases come first, each checked against the result
+ * message and the retained state. Then 10000 patches follow, every 4th with
+ * a stale etag, timed from the publish to the device's result message.
+ *
+ *    make test_config_mqtt && ./test_config_mqtt
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "cJSON.h"
+#include "esp_timer.h"
+#include "nvs_flash.h"
+#include "mqtt_client_manager.h"
+#include "system_config.h"
+#include "host_port.h"
+
+#define TOPIC_PREFIX        "irrigation/" CONFIG_DEVICE_ID
+#define PATCHES             10000
+#define STALE_EVERY         4
+
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_cond = PTHREAD_COND_INITIALIZER;
+static int s_results;
+static char s_result[256];
+static double s_result_ns;
+static int s_states;
+static char s_state[1024];
+static int s_failures;
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void observer(const char *topic, const char *data, int len, int qos, int retain)
+{
+    double t = now_ns();
+    pthread_mutex_lock(&s_lock);
+    if (strcmp(topic, TOPIC_PREFIX "/config/result") == 0) {
+        snprintf(s_result, sizeof(s_result), "%.*s", len, data);
+        s_result_ns = t;
+        s_results++;
+        pthread_cond_broadcast(&s_cond);
+    } else if (strcmp(topic, TOPIC_PREFIX "/config") == 0 && retain) {
+        snprintf(s_state, sizeof(s_state), "%.*s", len, data);
+        s_states++;
+    }
+    pthread_mutex_unlock(&s_lock);
+}
+
+// Publishes a patch and waits for the result, returns its status member
+static const char *send_patch(const char *patch, double *latency_ns)
+{
+    static char status[16];
+
+    pthread_mutex_lock(&s_lock);
+    int expected = s_results + 1;
+    pthread_mutex_unlock(&s_lock);
+
+    double start = now_ns();
+    if (host_mqtt_deliver(TOPIC_PREFIX "/config/set", patch, (int)strlen(patch)) != 0) {
+        return "undelivered";
+    }
+
+    pthread_mutex_lock(&s_lock);
+    while (s_results < expected) {
+        pthread_cond_wait(&s_cond, &s_lock);
+    }
+    if (latency_ns != NULL) {
+        *latency_ns = s_result_ns - start;
+    }
+    cJSON *json = cJSON_Parse(s_result);
+    pthread_mutex_unlock(&s_lock);
+
+    cJSON *member = cJSON_GetObjectItem(json, "status");
+    snprintf(status, sizeof(status), "%s", cJSON_IsString(member) ? member->valuestring : "?");
+    cJSON_Delete(json);
+
+    // The retained state is published from the same handler, before the result
+    host_mqtt_wait_idle();
+    return status;
+}
+
+static void check(const char *name, bool ok)
+{
+    printf("  %-48s %s\n", name, ok ? "ok" : "FAILED");
+    if (!ok) {
+        s_failures++;
+    }
+}
+
+static uint32_t current_etag(void)
+{
+    system_config_t config;
+    system_config_load(&config);
+    return system_config_etag(&config);
+}
+
+static bool state_has(const char *member)
+{
+    pthread_mutex_lock(&s_lock);
+    bool found = strstr(s_state, member) != NULL;
+    pthread_mutex_unlock(&s_lock);
+    return found;
+}
+
+int main(void)
+{
+    ESP_ERROR_CHECK(nvs_flash_init());
+    ESP_ERROR_CHECK(system_config_init());
+    host_mqtt_observe(observer);
+    ESP_ERROR_CHECK(mqtt_client_init());
+    ESP_ERROR_CHECK(mqtt_client_connect());
+    host_mqtt_wait_idle();
+
+    printf("patch handling\n");
+    check("retained state on connect", s_states == 1 && state_has("\"etag\""));
+
+    system_config_t before;
+    system_config_t after;
+    system_config_load(&before);
+    const char *status = send_patch("{\"soil_moisture_threshold\":25,\"bogus\":1}", NULL);
+    system_config_load(&after);
+    check("unknown field rejects the whole patch",
+          strcmp(status, "rejected") == 0 && memcmp(&before, &after, sizeof(before)) == 0);
+    check("out of range rejected", strcmp(send_patch("{\"soil_moisture_threshold\":250}", NULL), "rejected") == 0);
+    check("fraction for an integer rejected", strcmp(send_patch("{\"soil_moisture_threshold\":2.5}", NULL), "rejected") == 0);
+    check("malformed JSON rejected", strcmp(send_patch("{\"soil_moisture_threshold\":", NULL), "rejected") == 0);
+
+    char patch[160];
+    snprintf(patch, sizeof(patch), "{\"etag\":\"%08lx\",\"soil_moisture_threshold\":25,\"auto_mode_enabled\":false}",
+             (unsigned long)current_etag());
+    int states = s_states;
+    status = send_patch(patch, NULL);
+    system_config_load(&after);
+    char etag_member[32];
+    snprintf(etag_member, sizeof(etag_member), "\"etag\":\"%08lx\"", (unsigned long)current_etag());
+    check("matching etag applied", strcmp(status, "applied") == 0 &&
+          after.soil_moisture_threshold == 25 && !after.auto_mode_enabled);
+    check("retained state republished with the new etag", s_states == states + 1 && state_has(etag_member));
+    check("replayed etag is a conflict", strcmp(send_patch(patch, NULL), "conflict") == 0);
+
+    status = send_patch("{\"soil_moisture_threshold\":null}", NULL);
+    system_config_load(&after);
+    check("null restores the default", strcmp(status, "applied") == 0 &&
+          after.soil_moisture_threshold == CONFIG_SOIL_MOISTURE_THRESHOLD);
+
+    // Sustained load: patches back to back, each waiting for its result
+    static double latency[PATCHES];
+    int applied = 0;
+    int conflicts = 0;
+    int rejected = 0;
+    states = s_states;
+    int64_t writes = host_nvs_writes();
+    for (int i = 0; i < PATCHES; i++) {
+        if (i % STALE_EVERY == STALE_EVERY - 1) {
+            snprintf(patch, sizeof(patch), "{\"etag\":\"%08lx\",\"moisture_setpoint\":%d}",
+                     (unsigned long)(current_etag() ^ 1u), 30 + i % 20);
+        } else {
+            snprintf(patch, sizeof(patch), "{\"moisture_setpoint\":%d,\"mqtt_publish_interval_seconds\":%d}",
+                     30 + i % 20, 60 + i % 7);
+        }
+        status = send_patch(patch, &latency[i]);
+        if (strcmp(status, "applied") == 0) {
+            applied++;
+        } else if (strcmp(status, "conflict") == 0) {
+            conflicts++;
+        } else {
+            rejected++;
+        }
+    }
+    int retained = s_states - states;
+    host_advance_to(esp_timer_get_time() + 60000000LL);
+    int64_t burst_writes = host_nvs_writes() - writes;
+
+    qsort(latency, PATCHES, sizeof(latency[0]), compare_double);
+    printf("%d patches through the broker, 1 in %d with a stale etag\n", PATCHES, STALE_EVERY);
+    printf("  applied %d, conflict %d, rejected %d\n", applied, conflicts, rejected);
+    printf("  publish to result p50 %.1f us  p99 %.1f us  max %.1f us\n",
+           latency[PATCHES / 2] / 1e3, latency[PATCHES * 99 / 100] / 1e3, latency[PATCHES - 1] / 1e3);
+    printf("  retained state updates %d, NVS writes once settled %lld\n", retained, (long long)burst_writes);
+    check("every stale etag a conflict, every other patch applied",
+          conflicts == PATCHES / STALE_EVERY && applied == PATCHES - PATCHES / STALE_EVERY && rejected == 0);
+
+    mqtt_client_disconnect();
+    return s_failures != 0;
+}
@@ -18,6 +18,7 @@
 #include "mqtt_client_manager.h"
 #include "sensor_manager.h"
 #include "irrigation_controller.h"
+#include "system_config.h"
 
 static const char *TAG = "SMART_IRRIGATION_MAIN";
 
@@ -41,17 +42,39 @@ static EventGroupHandle_t s_mqtt_event_group;
 #define WIFI_CONNECTED_BIT BIT0
 #define MQTT_CONNECTED_BIT BIT0
 
+// Intervals from system_config, updated on change
+static volatile uint32_t s_sensor_interval_seconds = CONFIG_SENSOR_READ_INTERVAL;
+static volatile uint32_t s_publish_interval_seconds = CONFIG_SENSOR_READ_INTERVAL;
+
+static void config_listener(const system_config_t *config, void *arg)
+{
+    s_sensor_interval_seconds = config->sensor_read_interval_seconds;
+    s_publish_interval_seconds = config->mqtt_publish_interval_seconds;
+    sensor_manager_set_calibration(config->soil_moisture_calibration_dry,
+                                   config->soil_moisture_calibration_wet);
+}
+
 static void time_sync_notification_cb(struct timeval *tv)
 {
-    ESP_LOGI(TAG, "Notification of a time synchronization event");
+    ESP_LOGI(TAG, "Time synchronized: %lld.%06ld", (long long)tv->tv_sec, (long)tv->tv_usec);
 }
 
 static void initialize_sntp(void)
 {
+    // SNTP keeps polling across reconnects, a new address only asks for a
+    // fresh poll
+    if (sntp_enabled()) {
+        sntp_restart();
+        return;
+    }
+    
     ESP_LOGI(TAG, "Initializing SNTP");
     sntp_setoperatingmode(SNTP_OPMODE_POLL);
     sntp_setservername(0, "pool.ntp.org");
     sntp_set_time_sync_notification_cb(time_sync_notification_cb);
+    // Once set, the clock is slewed rather than stepped, so sample times
+    // never jump backwards
+    sntp_set_sync_mode(SNTP_SYNC_MODE_SMOOTH);
     sntp_init();
 }
 
@@ -60,7 +83,9 @@ static void sensor_task(void *pvParameters)
     ESP_LOGI(TAG, "Starting sensor task");
     
     TickType_t xLastWakeTime = xTaskGetTickCount();
-    const TickType_t xFrequency = pdMS_TO_TICKS(30000); // 30 seconds
+    TickType_t xLastPublish = 0;
+    bool published = false;
+    bool fault_reported = false;
     
     while (1) {
         // Wait for WiFi connection
@@ -76,18 +101,29 @@ static void sensor_task(void *pvParameters)
                      sensor_data.temperature, sensor_data.humidity, sensor_data.soil_moisture, 
                      sensor_data.water_level, sensor_data.light_level);
             
-            // Send to MQTT if connected
-            if (xEventGroupGetBits(s_mqtt_event_group) & MQTT_CONNECTED_BIT) {
+            // Queue for MQTT once the publish interval has passed, the outbox
+            // holds readings until the broker is reachable
+            TickType_t now = xTaskGetTickCount();
+            bool publish_due = !published ||
+                               now - xLastPublish >= pdMS_TO_TICKS(s_publish_interval_seconds * 1000);
+            if (publish_due) {
                 mqtt_client_publish_sensor_data(&sensor_data);
+                xLastPublish = now;
+                published = true;
             }
             
             // Check if irrigation is needed
             irrigation_controller_check_conditions(&sensor_data);
+            fault_reported = false;
         } else {
             ESP_LOGE(TAG, "Failed to read sensors: %s", esp_err_to_name(ret));
+            irrigation_controller_report_fault(ret);
+            if (!fault_reported) {
+                fault_reported = mqtt_client_publish_alarm("sensor_fault", esp_err_to_name(ret)) == ESP_OK;
+            }
         }
         
-        vTaskDelayUntil(&xLastWakeTime, xFrequency);
+        vTaskDelayUntil(&xLastWakeTime, pdMS_TO_TICKS(s_sensor_interval_seconds * 1000));
     }
 }
 
@@ -95,15 +131,8 @@ static void irrigation_task(void *pvParameters)
 {
     ESP_LOGI(TAG, "Starting irrigation task");
     
-    TickType_t xLastWakeTime = xTaskGetTickCount();
-    const TickType_t xFrequency = pdMS_TO_TICKS(10000); // 10 seconds
-    
-    while (1) {
-        // Update irrigation controller
-        irrigation_controller_update();
-        
-        vTaskDelayUntil(&xLastWakeTime, xFrequency);
-    }
+    // Sleeps until a sample, command, timer expiry or fault is queued
+    irrigation_controller_run();
 }
 
 static void mqtt_task(void *pvParameters)
@@ -206,6 +235,14 @@ void app_main(void)
         return;
     }
     
+    ESP_LOGI(TAG, "Loading system configuration...");
+    ret = system_config_init();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize system configuration: %s", esp_err_to_name(ret));
+        return;
+    }
+    system_config_subscribe(config_listener, NULL);
+    
     ESP_LOGI(TAG, "Initializing irrigation controller...");
     ret = irrigation_controller_init();
     if (ret != ESP_OK) {
@@ -0,0 +1,245 @@
+// Cloud command ingress benchmark
+//
+// Checks parseCommand() on JSON objects and binary frames, good and bad.
+// Then it feeds +SMSUB lines into Serial1 and calls EdgeCellular::loop(),
+// so every command goes through the UART, the AT engine's URC dispatch and
+// the topic split. The callback routes it through a topic table and a
+// command-type table as EdgeEnhanced does. The "old" callback stands in for
+// the code this replaced: String topic and message, a String log line, a
+// 256-byte DynamicJsonDocument, a String command type and a String LoRa
+// packet. Both use the same scanner, so only the copies and allocations
+// differ. Allocations are counted through operator new, outside the host
+// UART.
+//
+//    make bench_command && ./bench_command
+
+#include <chrono>
+#include <new>
+#include "EdgeCellular.h"
+#include "EdgeCommand.h"
+#include "host_port.h"
+
+static const int COMMANDS = 1000000;
+
+static size_t s_allocs;
+static bool s_counting = true;
+
+void* operator new(size_t n)
+{
+    if (s_counting) s_allocs++;
+    void* p = malloc(n);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+static int s_failures;
+static volatile unsigned s_sink;
+static unsigned long s_commands;
+static unsigned long s_rejected;
+
+static void check(const char* name, bool ok)
+{
+    printf("  %-54s %s\n", name, ok ? "ok" : "FAILED");
+    if (!ok) s_failures++;
+}
+
+static bool parse(const char* s, EdgeCommand& cmd)
+{
+    return parseCommand((const uint8_t*)s, strlen(s), cmd);
+}
+
+static void actuate(const EdgeCommand& cmd)
+{
+    s_sink += cmd.targetDevice + cmd.action;
+    s_commands++;
+}
+
+// Stands in for the downlink queue, formats the LoRa command on the stack
+static void forward(const EdgeCommand& cmd)
+{
+    char packet[24];
+    s_sink += snprintf(packet, sizeof(packet), "CMD,VALVE,%u,%s", cmd.targetDevice, cmd.action ? "ON" : "OFF");
+    s_commands++;
+}
+
+static void handleValve(const EdgeCommand& cmd)
+{
+    if (cmd.nodeId == 0) actuate(cmd);
+    else forward(cmd);
+}
+
+struct CommandRoute {
+    uint8_t type;
+    void (*handler)(const EdgeCommand& cmd);
+};
+
+static const CommandRoute commandRoutes[] = {
+    { CMD_VALVE, handleValve },
+    { CMD_PUMP,  actuate },
+};
+
+static void processCommand(const char* payload, size_t length)
+{
+    EdgeCommand cmd;
+    if (!parseCommand((const uint8_t*)payload, length, cmd)) {
+        s_rejected++;
+        return;
+    }
+    for (const CommandRoute& route : commandRoutes) {
+        if (route.type == cmd.commandType) {
+            route.handler(cmd);
+            return;
+        }
+    }
+}
+
+static void processConfig(const char* payload, size_t length)
+{
+}
+
+struct TopicRoute {
+    const char* topic;
+    uint8_t length;
+    void (*handler)(const char* payload, size_t length);
+};
+
+static const TopicRoute topicRoutes[] = {
+    { MQTT_TOPIC_CMD,    sizeof(MQTT_TOPIC_CMD) - 1,    processCommand },
+    { MQTT_TOPIC_CONFIG, sizeof(MQTT_TOPIC_CONFIG) - 1, processConfig },
+};
+
+static void routeMessage(const char* topic, size_t topicLength, const uint8_t* payload, size_t length)
+{
+    for (const TopicRoute& route : topicRoutes) {
+        if (topicLength == route.length && memcmp(topic, route.topic, topicLength) == 0) {
+            route.handler((const char*)payload, length);
+            return;
+        }
+    }
+}
+
+static void routeMessageOld(const char* topic, size_t topicLength, const uint8_t* payload, size_t length)
+{
+    String topicString;
+    topicString.concat(topic, topicLength);
+    String message;
+    for (size_t i = 0; i < length; i++) {
+        message += (char)payload[i];
+    }
+    if (topicString != MQTT_TOPIC_CMD) return;
+
+    Serial.println("Processing cloud command: " + message);
+    void* doc = malloc(256);
+    s_allocs++;
+    EdgeCommand cmd;
+    if (!parseCommand((const uint8_t*)message.c_str(), message.length(), cmd)) {
+        s_rejected++;
+        free(doc);
+        return;
+    }
+    String cmdType(cmd.commandType == CMD_PUMP ? "pump" : "valve");
+    if (cmdType == "valve" && cmd.nodeId) {
+        String packet = "CMD,VALVE," + String((unsigned)cmd.targetDevice) + "," + (cmd.action ? "ON" : "OFF");
+        s_sink += packet.length();
+    }
+    s_sink += cmd.targetDevice + cmd.action;
+    s_commands++;
+    free(doc);
+}
+
+static void parserChecks()
+{
+    EdgeCommand cmd;
+    printf("parser\n");
+    check("valve object", parse("{\"type\":\"valve\",\"nodeId\":3,\"valve\":2,\"state\":true}", cmd) &&
+          cmd.commandType == CMD_VALVE && cmd.nodeId == 3 && cmd.targetDevice == 2 && cmd.action);
+    check("whitespace, 1 for true, nodeId defaults to 0", parse(" { \"type\" : \"pump\" , \"state\" : 1 } ", cmd) &&
+          cmd.commandType == CMD_PUMP && cmd.action && cmd.nodeId == 0);
+    check("nested values and escaped strings skipped",
+          parse("{\"meta\":{\"a\":[1,{\"b\":\"}\"}]},\"type\":\"valve\",\"valve\":4,\"state\":false,\"note\":\"x\\\"y\"}", cmd) &&
+          cmd.targetDevice == 4 && !cmd.action);
+    check("unknown type rejected", !parse("{\"type\":\"flood\"}", cmd));
+    check("missing type rejected", !parse("{\"nodeId\":3}", cmd));
+    check("out of range rejected", !parse("{\"type\":\"valve\",\"nodeId\":300}", cmd));
+    check("quoted number rejected", !parse("{\"type\":\"valve\",\"nodeId\":\"3\"}", cmd));
+    check("truncated object rejected", !parse("{\"type\":\"valve\"", cmd));
+    check("empty object and empty payload rejected", !parse("{}", cmd) && !parse("", cmd));
+
+    const EdgeCommand in = { 7, CMD_VALVE, 3, true, 0 };
+    uint8_t frame[CMD_FRAME_SIZE];
+    encodeCommandFrame(in, frame);
+    check("raw frame", parseCommand(frame, sizeof(frame), cmd) &&
+          cmd.nodeId == 7 && cmd.targetDevice == 3 && cmd.action && cmd.commandType == CMD_VALVE);
+    char hex[CMD_FRAME_SIZE * 2 + 1];
+    for (int i = 0; i < CMD_FRAME_SIZE; i++) snprintf(hex + 2 * i, 3, "%02X", frame[i]);
+    check("hex frame", parse(hex, cmd) && cmd.nodeId == 7 && cmd.targetDevice == 3);
+    hex[11] ^= 1;
+    check("hex frame with a bad CRC rejected", !parse(hex, cmd));
+    frame[3] ^= 1;
+    check("raw frame with a flipped bit rejected", !parseCommand(frame, sizeof(frame), cmd));
+}
+
+// The deque standing in for the UART allocates blocks as it goes, which the
+// device's ring buffer does not, so those are not counted
+static void feed(const std::string& s)
+{
+    s_counting = false;
+    Serial1.rx.insert(Serial1.rx.end(), s.begin(), s.end());
+    s_counting = true;
+}
+
+static void ingress(EdgeCellular& cell, const char* name, const std::string& line)
+{
+    static const MessageCallback callbacks[] = { routeMessageOld, routeMessage };
+    static const char* paths[] = { "old", "new" };
+
+    for (int path = 0; path < 2; path++) {
+        cell.setMessageCallback(callbacks[path]);
+        s_commands = s_rejected = 0;
+        s_allocs = 0;
+        const auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < COMMANDS; i++) {
+            feed(line);
+            cell.loop();
+        }
+        const double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        Serial1.tx.clear();
+        printf("  %-22s %s  %5.2f M cmd/s  %.2f allocs/cmd\n",
+               name, paths[path], COMMANDS / s / 1e6, double(s_allocs) / COMMANDS);
+        check("every command handled", s_commands == (unsigned long)COMMANDS && s_rejected == 0);
+    }
+}
+
+int main()
+{
+    parserChecks();
+
+    EdgeCommand cmd = { 7, CMD_VALVE, 3, true, 0 };
+    uint8_t frame[CMD_FRAME_SIZE];
+    encodeCommandFrame(cmd, frame);
+    char hex[CMD_FRAME_SIZE * 2 + 1];
+    for (int i = 0; i < CMD_FRAME_SIZE; i++) snprintf(hex + 2 * i, 3, "%02X", frame[i]);
+
+    // The simulated clock stands still, so the modem never needs to answer
+    EdgeCellular cell("EDGE_001");
+    cell.begin("apn");
+    cell.loop();
+
+    const std::string prefix = "+SMSUB: \"" MQTT_TOPIC_CMD "\",\"";
+    printf("%d commands through Serial1, EdgeAT and EdgeCellular\n", COMMANDS);
+    ingress(cell, "json valve, forwarded", prefix + "{\"type\":\"valve\",\"nodeId\":3,\"valve\":2,\"state\":true}\"\r\n");
+    ingress(cell, "json valve, local", prefix + "{\"type\":\"valve\",\"nodeId\":0,\"valve\":1,\"state\":false}\"\r\n");
+    ingress(cell, "json pump", prefix + "{\"type\":\"pump\",\"state\":true}\"\r\n");
+    ingress(cell, "hex frame, forwarded", prefix + hex + "\"\r\n");
+    return s_failures != 0;
+}
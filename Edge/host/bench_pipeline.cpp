@@ -0,0 +1,191 @@
+// Reading pipeline latency benchmark
+//
+// Nodes sample at a Poisson rate, take 20-60 ms to build their frame and
+// 70 ms on air, with clocks within +/-20 ms of UTC. The Edge's radio keeps
+// only the newest frame. Receiving a frame blocks the Edge's loop() for the
+// RX LED blink, the logging and the SD append, then forwardDataToCloud()
+// queues it with its TraceContext and blinks the TX LED. EdgeCellular
+// publishes it through the simulated modem, whose broker acks take a
+// lognormal 250 ms, with 1% stalls of 1-4 s. Each rate runs for 30
+// simulated minutes. The report gives EdgeLatency's per-stage p50/p99
+// against exact nearest-rank percentiles of the same traces, and fails if
+// an estimate is off by more than the histogram's 6.25%.
+//
+//    make bench_pipeline && ./bench_pipeline
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "EdgeCellular.h"
+#include "EdgeLatency.h"
+#include "EdgeTime.h"
+#include "host_port.h"
+#include "sim_modem.h"
+
+static const uint64_t EPOCH_MS = 1792000000000ULL;     // UTC at millis() 0
+static const unsigned long RUN_MS = 1800000;
+static const double RATES[] = { 0.5, 1, 2, 3, 4 };     // Readings per second
+
+static SimModem modem;
+static EdgeClock edgeClock;
+static EdgeLatency latency;
+static std::vector<unsigned long> exact[STAGE_COUNT];
+static std::mt19937 s_rng(7);
+
+static double uniform()
+{
+    return std::uniform_real_distribution<double>(0, 1)(s_rng);
+}
+
+static unsigned long brokerAck()
+{
+    if (uniform() < 0.01) return 1000 + (unsigned long)(uniform() * 3000);
+    return (unsigned long)(250 * std::exp(0.5 * std::normal_distribution<double>(0, 1)(s_rng)));
+}
+
+static void onPublished(const TraceContext& trace)
+{
+    latency.addTrace(trace, edgeClock);
+    exact[STAGE_EDGE].push_back(trace.queuedAt - trace.rxAt);
+    exact[STAGE_QUEUE].push_back(trace.sentAt - trace.queuedAt);
+    exact[STAGE_PUBLISH].push_back(trace.ackedAt - trace.sentAt);
+    const uint64_t rx = edgeClock.toUtc(trace.rxAt);
+    const uint64_t acked = edgeClock.toUtc(trace.ackedAt);
+    if (rx >= trace.sampleTime) exact[STAGE_RADIO].push_back(rx - trace.sampleTime);
+    if (acked >= trace.sampleTime) exact[STAGE_TOTAL].push_back(acked - trace.sampleTime);
+}
+
+static unsigned long nearestRank(std::vector<unsigned long> v, int percent)
+{
+    if (v.empty()) return 0;
+    std::sort(v.begin(), v.end());
+    const size_t rank = (v.size() * percent + 99) / 100;
+    return v[rank ? rank - 1 : 0];
+}
+
+// The network time the modem would report, read on the Edge's schedule
+static void readClock(unsigned long now, unsigned long& nextReading)
+{
+    if ((long)(now - nextReading) < 0) return;
+    const unsigned long roundTrip = 30 + random(40);
+    edgeClock.addReading((EPOCH_MS + now + roundTrip / 2) / 1000, now, now + roundTrip);
+    nextReading = edgeClock.nextReadingAt(now + roundTrip);
+}
+
+struct Frame {
+    unsigned long doneAt;       // End of transmission
+    uint64_t sampleTime;        // As the Node's clock stamped it
+};
+
+static bool within(unsigned long estimate, unsigned long exactValue)
+{
+    const double error = std::fabs((double)estimate - (double)exactValue);
+    return error <= 1 || error <= exactValue * 0.0625;
+}
+
+int main()
+{
+    Serial1.onWrite = [](void*) { modem.onWrite(); };
+    host_pin_observe([](int pin, int level) { modem.onPin(pin, level); });
+    modem.ackDelay = brokerAck;
+
+    EdgeCellular cell("EDGE_001");
+    cell.begin("apn");
+    cell.connectMQTT("broker", 1883);
+    cell.setPublishedCallback(onPublished);
+
+    // Connect and sync the clock first
+    unsigned long now = 0;
+    unsigned long nextReading = 0;
+    for (; now < 60000; now++) {
+        host_set_millis(now);
+        readClock(now, nextReading);
+        modem.tick();
+        cell.loop();
+    }
+    printf("connected %d, clock synced %d to %lu ms\n", cell.isMQTTConnected(), edgeClock.isSynced(),
+           edgeClock.getUncertainty());
+
+    int failures = 0;
+    const std::string message(300, 'x');
+    for (double rate : RATES) {
+        latency.reset();
+        for (std::vector<unsigned long>& e : exact) e.clear();
+        std::exponential_distribution<double> gap(rate / 1000.0);
+
+        std::vector<Frame> air;
+        bool fifoFull = false;
+        Frame fifo = {};
+        TraceContext trace = {};
+        bool publishPending = false;
+        unsigned long publishAt = 0;
+        unsigned long busyUntil = now;
+        unsigned long readings = 0;
+        unsigned long overwritten = 0;
+        unsigned long rejected = 0;
+        double nextSample = now;
+
+        for (const unsigned long end = now + RUN_MS; now < end; now++) {
+            host_set_millis(now);
+            readClock(now, nextReading);
+            for (; nextSample <= now; nextSample += gap(s_rng)) {
+                const long nodeError = (long)(uniform() * 40) - 20;
+                air.push_back({ (unsigned long)nextSample + 20 + (unsigned long)(uniform() * 40) + 70,
+                                EPOCH_MS + (unsigned long)nextSample + nodeError });
+                readings++;
+            }
+            for (size_t i = 0; i < air.size(); ) {
+                if (air[i].doneAt > now) {
+                    i++;
+                    continue;
+                }
+                if (fifoFull) overwritten++;
+                fifo = air[i];
+                fifoFull = true;
+                air.erase(air.begin() + i);
+            }
+            modem.tick();
+
+            if ((long)(now - busyUntil) < 0) continue;      // loop() is blocked
+            if (publishPending && now >= publishAt) {
+                // forwardDataToCloud(), then the TX LED blink
+                if (!cell.publish("SmartIrrigation/data", String(message), false, &trace)) rejected++;
+                publishPending = false;
+                busyUntil = now + 50;
+                continue;
+            }
+            if (fifoFull) {
+                // handleLoRaReceive(): RX LED blink, logging, parsing, SD append
+                fifoFull = false;
+                trace = { fifo.sampleTime, now, 0, 0, 0 };
+                publishAt = now + 50 + 3 + 5 + (unsigned long)(uniform() * 20);
+                publishPending = true;
+                busyUntil = publishAt;
+                continue;
+            }
+            cell.loop();
+        }
+        // Let the outbox drain
+        for (const unsigned long end = now + 60000; now < end; now++) {
+            host_set_millis(now);
+            modem.tick();
+            cell.loop();
+        }
+
+        printf("%.1f readings/s: %lu sampled, %lu overwritten in the radio FIFO, %lu rejected by a full outbox, "
+               "%zu acked\n", rate, readings, overwritten, rejected, exact[STAGE_PUBLISH].size());
+        printf("  %-8s %7s %15s %15s %8s\n", "stage", "n", "p50 est/exact", "p99 est/exact", "max");
+        for (int s = 0; s < STAGE_COUNT; s++) {
+            const LatencySummary summary = latency.summary((LatencyStage)s);
+            const unsigned long p50 = nearestRank(exact[s], 50);
+            const unsigned long p99 = nearestRank(exact[s], 99);
+            const bool ok = within(summary.p50, p50) && within(summary.p99, p99);
+            printf("  %-8s %7u %7lu/%-7lu %7lu/%-7lu %8lu%s\n", EdgeLatency::stageName((LatencyStage)s),
+                   summary.count, summary.p50, p50, summary.p99, p99, summary.max, ok ? "" : "  OFF");
+            if (!ok) failures++;
+        }
+        if (exact[STAGE_PUBLISH].empty()) failures++;
+    }
+    return failures != 0;
+}
@@ -0,0 +1,101 @@
+// The Arduino core functions behind stubs/Arduino.h, on a simulated clock
+
+#include <Arduino.h>
+#include "host_port.h"
+
+#define HOST_PINS   64
+
+HostConsole Serial;
+HardwareSerial Serial1;
+HardwareSerial Serial2;
+
+static unsigned long s_millis;
+static int s_pins[HOST_PINS];
+static host_pin_observer_t s_pin_observer;
+
+static bool console_enabled()
+{
+    static const bool enabled = getenv("HOST_LOG") != nullptr;
+    return enabled;
+}
+
+size_t HostConsole::log(const char* format, ...)
+{
+    if (!console_enabled()) return 0;
+    va_list args;
+    va_start(args, format);
+    const int n = vprintf(format, args);
+    va_end(args);
+    return n > 0 ? n : 0;
+}
+
+size_t HostConsole::printf(const char* format, ...)
+{
+    if (!console_enabled()) return 0;
+    va_list args;
+    va_start(args, format);
+    const int n = vprintf(format, args);
+    va_end(args);
+    return n > 0 ? n : 0;
+}
+
+unsigned long millis()
+{
+    return s_millis;
+}
+
+unsigned long micros()
+{
+    return s_millis * 1000UL;
+}
+
+void delay(unsigned long ms)
+{
+    s_millis += ms;
+}
+
+void pinMode(int pin, int mode)
+{
+}
+
+void digitalWrite(int pin, int level)
+{
+    if (pin < 0 || pin >= HOST_PINS) return;
+    s_pins[pin] = level;
+    if (s_pin_observer) s_pin_observer(pin, level);
+}
+
+int digitalRead(int pin)
+{
+    return host_pin_level(pin);
+}
+
+long random(long howbig)
+{
+    return howbig > 0 ? ::random() % howbig : 0;
+}
+
+long random(long howsmall, long howbig)
+{
+    return howbig > howsmall ? howsmall + random(howbig - howsmall) : howsmall;
+}
+
+void host_set_millis(unsigned long ms)
+{
+    if (ms > s_millis) s_millis = ms;
+}
+
+void host_advance_millis(unsigned long ms)
+{
+    s_millis += ms;
+}
+
+void host_pin_observe(host_pin_observer_t observer)
+{
+    s_pin_observer = observer;
+}
+
+int host_pin_level(int pin)
+{
+    return pin >= 0 && pin < HOST_PINS ? s_pins[pin] : LOW;
+}
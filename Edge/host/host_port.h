@@ -0,0 +1,21 @@
+// Controls the harnesses use to drive the host Arduino port: the simulated
+// clock and the pins the firmware writes, which a device has no equivalent
+// for.
+#pragma once
+
+#include <stdint.h>
+
+// Set the simulated clock millis() and micros() read. Never moves backwards.
+void host_set_millis(unsigned long ms);
+
+// Advance the simulated clock, delay() does the same
+void host_advance_millis(unsigned long ms);
+
+// Receives every digitalWrite(), after the pin took the level
+typedef void (*host_pin_observer_t)(int pin, int level);
+
+// Set the observer for pin writes, nullptr for none
+void host_pin_observe(host_pin_observer_t observer);
+
+// Level last written to a pin, LOW before the first write
+int host_pin_level(int pin);
@@ -0,0 +1,114 @@
+// Cellular link simulation
+//
+// Runs EdgeCellular against a scripted SIM7080/SIM7000 stand-in on Serial1,
+// calling loop() once per simulated millisecond for 12 minutes. The modem
+// boots on a PWRKEY pulse, registers 8 s after boot, brings the bearer up
+// 1.5 s after AT+CNACT and answers the native MQTT commands. Every two
+// minutes the script breaks the link a different way. A 300-byte message is
+// queued every 5 s. The report gives the time from each fault to connected
+// and the wall time loop() took while reconnecting and while connected.
+//
+//    make sim_cellular && ./sim_cellular [seed]
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include "EdgeCellular.h"
+#include "host_port.h"
+#include "sim_modem.h"
+
+static const unsigned long RUN_MS = 12UL * 60 * 1000;
+static const unsigned long FAULT_EVERY_MS = 2UL * 60 * 1000;
+static const unsigned long PUBLISH_EVERY_MS = 5000;
+
+static SimModem modem;
+
+struct Phase {
+    const char* name;
+    unsigned long start;
+    bool down;                  // The firmware has noticed the fault
+    unsigned long connectedAt;
+    std::vector<double> loopUs;
+};
+
+static void report(const char* name, std::vector<double>& us)
+{
+    std::sort(us.begin(), us.end());
+    printf("    loop() %-18s p50 %5.2f us  p99 %5.2f us  max %7.1f us  (%zu calls)\n",
+           name, us[us.size() / 2], us[us.size() * 99 / 100], us.back(), us.size());
+}
+
+int main(int argc, char** argv)
+{
+    srandom(argc > 1 ? atoi(argv[1]) : 1);
+    Serial1.onWrite = [](void*) { modem.onWrite(); };
+    host_pin_observe([](int pin, int level) { modem.onPin(pin, level); });
+
+    EdgeCellular cell("EDGE_001");
+    cell.begin("apn");
+    cell.connectMQTT("broker", 1883);
+    cell.subscribe("SmartIrrigation/cmd");
+    cell.subscribe("SmartIrrigation/config");
+
+    std::vector<Phase> phases;
+    phases.push_back({"cold start", 0, true, 0, {}});
+    std::vector<double> connectedUs;
+    unsigned long queued = 0;
+    unsigned long refused = 0;
+    const std::string message(300, 'x');
+
+    for (unsigned long now = 0; now < RUN_MS; now++) {
+        host_set_millis(now);
+        if (now && now % FAULT_EVERY_MS == 0) {
+            switch (now / FAULT_EVERY_MS) {
+            case 1: phases.push_back({"bearer drop", now, false, 0, {}}); modem.dropBearer(); break;
+            case 2: phases.push_back({"MQTT drop, 2 refusals", now, false, 0, {}}); modem.dropMqtt(2); break;
+            case 3: phases.push_back({"modem power loss", now, false, 0, {}}); modem.losePower(); break;
+            case 4: phases.push_back({"MQTT refused 6 times", now, false, 0, {}}); modem.dropMqtt(6); break;
+            }
+        }
+        if (now % PUBLISH_EVERY_MS == 0) {
+            if (cell.publish("SmartIrrigation/data", String(message))) {
+                queued++;
+            } else {
+                refused++;
+            }
+        }
+        modem.tick();
+
+        const auto t0 = std::chrono::steady_clock::now();
+        cell.loop();
+        const double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+
+        Phase& phase = phases.back();
+        if (phase.connectedAt) {
+            connectedUs.push_back(us);
+        } else {
+            phase.loopUs.push_back(us);
+            if (!cell.isMQTTConnected()) {
+                phase.down = true;
+            } else if (phase.down) {
+                phase.connectedAt = now;
+            }
+        }
+    }
+
+    printf("EdgeCellular against the scripted modem, %lu s simulated\n", RUN_MS / 1000);
+    for (Phase& phase : phases) {
+        if (phase.connectedAt) {
+            printf("  %-24s connected after %6.1f s\n", phase.name, (phase.connectedAt - phase.start) / 1000.0);
+        } else {
+            printf("  %-24s not connected\n", phase.name);
+        }
+        report("reconnecting", phase.loopUs);
+    }
+    printf("  connected\n");
+    report("connected", connectedUs);
+    printf("  published %lu of %lu queued, %lu refused while down, connected %lu s\n",
+           cell.getMessagesPublished(), queued, refused, cell.getTotalConnectedTime() / 1000);
+    printf("  %lu AT commands on %lu command lines\n", modem.commands, modem.commandLines);
+
+    bool ok = cell.getMessagesPublished() == queued;
+    for (const Phase& phase : phases) ok = ok && phase.connectedAt;
+    return ok ? 0 : 1;
+}
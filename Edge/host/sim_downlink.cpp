@@ -0,0 +1,294 @@
+// Downlink channel simulation
+//
+// Ten Nodes uplink every 60 s +/- 1 s and listen for 1 s after each uplink.
+// Airtime is SF12, 125 kHz, CR 4/5. Frames that overlap are lost, and 5% of
+// the rest too; the Edge is half duplex, so it misses uplinks while it
+// transmits. The cloud sends a valve command every 30 s on average, and a
+// third of them are toggled again 1-3 times within ~20 s. Three ways of
+// getting them to the Nodes run for 24 simulated hours, 5 seeds each:
+// sending at once to sleeping Nodes, sending at once to Nodes that always
+// listen, and EdgeDownlink sending after each uplink. Frames are decoded
+// the way the Node's applyCommandFrame() reads them.
+//
+//    make sim_downlink && ./sim_downlink
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "EdgeCommand.h"
+#include "EdgeDownlink.h"
+#include "host_port.h"
+
+static const int NODES = 10;
+static const int VALVES = 4;
+static const unsigned long PERIOD_MS = 60000;
+static const unsigned long RX_WINDOW_MS = 1000;
+static const unsigned long RUN_MS = 24UL * 3600 * 1000;
+static const unsigned long STEP_MS = 10;
+static const size_t UPLINK_BYTES = 48;
+static const double LOSS = 0.05;
+static const int SEEDS = 5;
+
+enum Mode { IMMEDIATE_SLEEPING, IMMEDIATE_LISTENING, QUEUED };
+
+// Time on air of a LoRa frame: SF12, 125 kHz, CR 4/5, 8 symbol preamble,
+// explicit header, CRC, low data rate optimization
+static double airtimeMs(size_t length)
+{
+    const int sf = 12;
+    const int lowRate = 1;
+    const int codingRate = 1;
+    const double symbolMs = std::pow(2, sf) / 125.0;
+    const double payloadSymbols = 8 + std::max(std::ceil((8.0 * length - 4 * sf + 28 + 16) /
+                                                         (4.0 * (sf - 2 * lowRate))) * (codingRate + 4), 0.0);
+    return (8 + 4.25) * symbolMs + payloadSymbols * symbolMs;
+}
+
+struct Transmission {
+    unsigned long start;
+    unsigned long end;
+    int node;                   // -1 for the Edge
+};
+
+struct NodeState {
+    bool valve[VALVES];
+    unsigned long valveAt[VALVES];
+    unsigned long nextUplink;
+    unsigned long lastUplinkEnd;
+    unsigned long heardAt;      // When the Edge handles the last uplink, 0 once done
+};
+
+struct Result {
+    long issued;
+    long frames;
+    long applied;
+    long malformed;
+    long lostUplinks;           // Missed because the Edge was transmitting
+    long stale;                 // Valves left different from the last command
+    double airtimeMs;
+    std::vector<double> latencyMs;
+};
+
+class Channel {
+public:
+    std::mt19937 rng;
+    std::vector<Transmission> air;
+    NodeState nodes[NODES];
+    bool target[NODES][VALVES];
+    unsigned long targetAt[NODES][VALVES];
+    unsigned long now;
+    Result result;
+
+    explicit Channel(unsigned seed)
+        : rng(seed), now(0), result() {
+        memset(nodes, 0, sizeof(nodes));
+        memset(target, 0, sizeof(target));
+        memset(targetAt, 0, sizeof(targetAt));
+        for (NodeState& node : nodes) {
+            node.nextUplink = (unsigned long)(uniform() * PERIOD_MS);
+        }
+    }
+
+    double uniform() {
+        return std::uniform_real_distribution<double>(0, 1)(rng);
+    }
+
+    // Nodes listen for RX_WINDOW_MS after each uplink
+    bool listening(int node) const {
+        const unsigned long end = nodes[node].lastUplinkEnd;
+        return end && now >= end && now < end + RX_WINDOW_MS;
+    }
+
+    bool overlaps(unsigned long start, unsigned long end, int exceptNode) const {
+        for (const Transmission& t : air) {
+            if (t.node != exceptNode && t.start < end && start < t.end) return true;
+        }
+        return false;
+    }
+
+    // The Edge sends a frame now; the Node hears it if listening and the air is clear
+    void edgeSend(int node, const char* frame, size_t length, bool listening) {
+        const double ms = airtimeMs(length);
+        const unsigned long end = now + (unsigned long)ms;
+        result.airtimeMs += ms;
+        result.frames++;
+        for (const Transmission& t : air) {
+            if (t.node >= 0 && t.start < end && now < t.end) result.lostUplinks++;
+        }
+        const bool heard = listening && !overlaps(now, end, -2) && uniform() >= LOSS;
+        air.push_back({ now, end, -1 });
+        if (heard) receive(node, frame, end);
+    }
+
+    // The Node's side: CMD,<node>,<type>,<target>,<action>[;<type>,<target>,<action>...]
+    void receive(int node, const char* frame, unsigned long at) {
+        char* p;
+        if (strncmp(frame, "CMD,", 4) != 0 || (int)strtoul(frame + 4, &p, 10) != node + 1) {
+            result.malformed++;
+            return;
+        }
+        char separator = ',';
+        while (*p == separator) {
+            unsigned type, valve, action;
+            int used;
+            if (sscanf(p + 1, "%u,%u,%u%n", &type, &valve, &action, &used) != 3 ||
+                type != CMD_VALVE || valve < 1 || valve > VALVES || action > 1) {
+                result.malformed++;
+                return;
+            }
+            nodes[node].valve[valve - 1] = action;
+            nodes[node].valveAt[valve - 1] = at;
+            result.applied++;
+            result.latencyMs.push_back(at - targetAt[node][valve - 1]);
+            p += 1 + used;
+            separator = ';';
+        }
+        if (*p != '\0') result.malformed++;
+    }
+};
+
+static Channel* s_channel;
+
+static void sendQueued(void* context, const char* frame, size_t length)
+{
+    const int node = atoi(frame + 4) - 1;
+    s_channel->edgeSend(node, frame, length, s_channel->listening(node));
+}
+
+struct CloudCommand {
+    int node;
+    int valve;
+    bool on;
+    unsigned long at;
+};
+
+static std::vector<CloudCommand> cloudCommands(Channel& ch)
+{
+    std::vector<CloudCommand> commands;
+    for (double t = 0; t < RUN_MS - 600000; ) {
+        t += -std::log(1 - ch.uniform()) * 30000;
+        CloudCommand c = { (int)(ch.uniform() * NODES), (int)(ch.uniform() * VALVES), ch.uniform() < 0.5,
+                           (unsigned long)t };
+        commands.push_back(c);
+        if (ch.uniform() < 0.33) {
+            const int toggles = 1 + (int)(ch.uniform() * 3);
+            for (int i = 0; i < toggles; i++) {
+                c.at += 1000 + (unsigned long)(ch.uniform() * 6000);
+                c.on = !c.on;
+                commands.push_back(c);
+            }
+        }
+    }
+    std::sort(commands.begin(), commands.end(),
+              [](const CloudCommand& a, const CloudCommand& b) { return a.at < b.at; });
+    return commands;
+}
+
+static Result run(Mode mode, unsigned seed)
+{
+    Channel ch(seed);
+    s_channel = &ch;
+    // millis() never goes back, each run starts where the last one ended
+    const unsigned long base = millis();
+    const std::vector<CloudCommand> commands = cloudCommands(ch);
+
+    EdgeDownlink downlink;
+    downlink.begin(sendQueued);
+
+    size_t next = 0;
+    for (unsigned long now = 0; now < RUN_MS; now += STEP_MS) {
+        ch.now = now;
+        host_set_millis(base + now);
+        ch.air.erase(std::remove_if(ch.air.begin(), ch.air.end(),
+                                    [now](const Transmission& t) { return t.end + 60000 < now; }), ch.air.end());
+
+        for (; next < commands.size() && commands[next].at <= now; next++) {
+            const CloudCommand& c = commands[next];
+            ch.result.issued++;
+            ch.target[c.node][c.valve] = c.on;
+            ch.targetAt[c.node][c.valve] = c.at;
+            const EdgeCommand cmd = { (uint8_t)(c.node + 1), CMD_VALVE, (uint8_t)(c.valve + 1), c.on, millis() };
+            if (mode == QUEUED) {
+                downlink.queue(cmd);
+                continue;
+            }
+            char frame[24];
+            const int length = snprintf(frame, sizeof(frame), "CMD,%u,%u,%u,%u",
+                                        cmd.nodeId, cmd.commandType, cmd.targetDevice, cmd.action ? 1 : 0);
+            ch.edgeSend(c.node, frame, length, mode == IMMEDIATE_LISTENING || ch.listening(c.node));
+        }
+
+        for (int n = 0; n < NODES; n++) {
+            NodeState& node = ch.nodes[n];
+            if (node.nextUplink > now) continue;
+            const unsigned long end = now + (unsigned long)airtimeMs(UPLINK_BYTES);
+            bool edgeBusy = false;
+            for (const Transmission& t : ch.air) {
+                if (t.node == -1 && t.start < end && now < t.end) edgeBusy = true;
+            }
+            const bool lost = edgeBusy || ch.overlaps(now, end, n) || ch.uniform() < LOSS;
+            ch.air.push_back({ now, end, n });
+            node.lastUplinkEnd = end;
+            node.nextUplink = now + PERIOD_MS + (unsigned long)(ch.uniform() * 2000) - 1000;
+            if (lost) {
+                if (edgeBusy) ch.result.lostUplinks++;
+                continue;
+            }
+            // handleLoRaReceive() runs once the uplink is in
+            node.heardAt = end + 60;
+        }
+        for (int n = 0; n < NODES; n++) {
+            NodeState& node = ch.nodes[n];
+            if (node.heardAt && node.heardAt <= now) {
+                node.heardAt = 0;
+                if (mode == QUEUED) downlink.onUplink(n + 1);
+            }
+        }
+        if (mode == QUEUED && now % 1000 == 0) downlink.loop();
+    }
+
+    for (int n = 0; n < NODES; n++) {
+        for (int v = 0; v < VALVES; v++) {
+            if (ch.targetAt[n][v] && (ch.nodes[n].valve[v] != ch.target[n][v] ||
+                                      ch.nodes[n].valveAt[v] < ch.targetAt[n][v])) {
+                ch.result.stale++;
+            }
+        }
+    }
+    return ch.result;
+}
+
+int main()
+{
+    static const char* names[] = { "immediate, Nodes sleep", "immediate, Nodes listen", "queued, Nodes sleep" };
+
+    printf("%d Nodes, SF12, 1 s RX window, 24 h, %d seeds\n", NODES, SEEDS);
+    long malformed = 0;
+    for (int mode = IMMEDIATE_SLEEPING; mode <= QUEUED; mode++) {
+        Result total = Result();
+        for (int seed = 1; seed <= SEEDS; seed++) {
+            Result r = run((Mode)mode, seed);
+            total.issued += r.issued;
+            total.frames += r.frames;
+            total.applied += r.applied;
+            total.malformed += r.malformed;
+            total.lostUplinks += r.lostUplinks;
+            total.stale += r.stale;
+            total.airtimeMs += r.airtimeMs;
+            total.latencyMs.insert(total.latencyMs.end(), r.latencyMs.begin(), r.latencyMs.end());
+        }
+        std::vector<double>& latency = total.latencyMs;
+        std::sort(latency.begin(), latency.end());
+        printf("  %-24s %6ld commands %6ld frames %6ld applied  airtime/applied %6.0f ms  "
+               "latency p50 %5.1f s p95 %5.1f s  uplinks lost to the Edge %5ld  stale valves %4.1f/%d\n",
+               names[mode], total.issued, total.frames, total.applied,
+               total.airtimeMs / std::max(1L, total.applied),
+               latency.empty() ? 0.0 : latency[latency.size() / 2] / 1e3,
+               latency.empty() ? 0.0 : latency[latency.size() * 95 / 100] / 1e3,
+               total.lostUplinks, double(total.stale) / SEEDS, NODES * VALVES);
+        malformed += total.malformed;
+    }
+    if (malformed) printf("  %ld frames the Node could not read\n", malformed);
+    return malformed != 0;
+}
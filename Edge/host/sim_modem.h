@@ -0,0 +1,193 @@
+// SIM7000/SIM7080 stand-in for the host simulations
+//
+// Plays the modem end of Serial1 on the simulated clock. It boots on a
+// PWRKEY pulse of at least 1 s, registers 8 s after boot, brings the bearer
+// up 1.5 s after AT+CNACT and answers the native MQTT commands. Call
+// onWrite() from Serial1.onWrite, onPin() from host_pin_observe() and
+// tick() before each loop() of the firmware.
+#pragma once
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include "Arduino.h"
+#include "edge_board_def.h"
+
+// The modem end of Serial1. Replies are scheduled on the simulated clock and
+// pushed into the UART when due.
+class SimModem {
+public:
+    SimModem()
+        : commandLines(0), commands(0), ackDelay(nullptr), powered(false), bootAt(-1), registeredAt(0),
+          bearer(false), bearerAt(-1), mqtt(false), refusals(0), echo(true),
+          payloadLen(-1), consumed(0), pwrkeyHighAt(-1) {}
+
+    // Break the link: the bearer, the MQTT session or the power
+    void dropBearer() {
+        bearer = mqtt = false;
+        reply("\r\n+APP PDP: DEACTIVE\r\n", 0);
+    }
+    void dropMqtt(int refuse) {
+        mqtt = false;
+        refusals = refuse;
+        reply("\r\n+SMSTATE: 0\r\n", 0);
+    }
+    void losePower() {
+        powered = bearer = mqtt = false;
+        pending.clear();
+    }
+
+    void tick() {
+        const long now = millis();
+        if (bootAt >= 0 && now >= bootAt) {
+            powered = true;
+            echo = true;
+            bootAt = -1;
+            registeredAt = now + 8000;
+            bearer = mqtt = false;
+        }
+        if (bearerAt >= 0 && now >= bearerAt) {
+            bearer = true;
+            bearerAt = -1;
+        }
+        while (!pending.empty() && pending.begin()->first <= (unsigned long)now) {
+            for (char c : pending.begin()->second) Serial1.rx.push_back(c);
+            pending.erase(pending.begin());
+        }
+    }
+
+    void onPin(int pin, int level) {
+        if (pin != MODEM_PWRKEY) return;
+        if (level == HIGH) {
+            pwrkeyHighAt = millis();
+        } else if (pwrkeyHighAt >= 0) {
+            if ((long)millis() - pwrkeyHighAt >= 1000 && !powered) {
+                bootAt = millis() + 2500;
+            }
+            pwrkeyHighAt = -1;
+        }
+    }
+
+    void onWrite() {
+        const std::string& tx = Serial1.tx;
+        while (consumed < tx.size()) {
+            if (payloadLen >= 0) {
+                const size_t n = std::min((size_t)payloadLen - payload.size(), tx.size() - consumed);
+                payload.append(tx, consumed, n);
+                consumed += n;
+                if ((long)payload.size() == payloadLen) {
+                    payloadLen = -1;
+                    reply("\r\nOK\r\n", ackDelay ? ackDelay() : 100);
+                }
+                continue;
+            }
+            const size_t end = tx.find("\r\n", consumed);
+            if (end == std::string::npos) return;
+            const std::string line = tx.substr(consumed, end - consumed);
+            consumed = end + 2;
+            if (powered) handle(line);
+        }
+    }
+
+    unsigned long commandLines;
+    unsigned long commands;
+    unsigned long (*ackDelay)();    // Publish to broker ack, ms; 100 when null
+
+private:
+    void reply(const std::string& s, unsigned long delayMs = 20) {
+        pending.emplace(millis() + delayMs, s);
+    }
+
+    // One command, false for ERROR. info receives its information line.
+    bool exec(const std::string& c, std::string& info, unsigned long& delayMs) {
+        const bool registered = (long)millis() >= registeredAt;
+        commands++;
+        if (c == "AT") return true;
+        if (c == "ATE0") { echo = false; return true; }
+        if (c == "AT+GSN") { info = "861234567890123"; return true; }
+        if (c == "AT+CIMI") { info = "001010123456789"; return true; }
+        if (c == "AT+CFUN=1,1") { powered = false; bootAt = millis() + 6000; return true; }
+        if (c == "AT+CEREG?") { info = std::string("+CEREG: 0,") + (registered ? "1" : "2"); return true; }
+        if (c == "AT+CREG?") { info = std::string("+CREG: 0,") + (registered ? "1" : "2"); return true; }
+        if (c == "AT+COPS?") { info = "+COPS: 0,0,\"SimNet\",7"; return true; }
+        if (c == "AT+CSQ") { info = "+CSQ: 18,99"; return true; }
+        if (c == "AT+CNACT?") { info = bearer ? "+CNACT: 1,\"10.0.0.2\"" : "+CNACT: 0,\"0.0.0.0\""; return true; }
+        if (c.compare(0, 7, "AT+CSTT") == 0) return true;
+        if (c.compare(0, 10, "AT+CNACT=1") == 0) {
+            if (!bearer) bearerAt = millis() + 1500;
+            return true;
+        }
+        if (c.compare(0, 9, "AT+SMCONF") == 0) return true;
+        if (c == "AT+SMCONN") {
+            if (!bearer || refusals > 0) {
+                if (refusals > 0) refusals--;
+                delayMs = 3000;
+                return false;
+            }
+            mqtt = true;
+            delayMs = 800;
+            return true;
+        }
+        if (c == "AT+SMDISC") {
+            const bool was = mqtt;
+            mqtt = false;
+            return was;
+        }
+        if (c.compare(0, 8, "AT+SMSUB") == 0) return true;
+        if (c.compare(0, 10, "AT+SMUNSUB") == 0) return true;
+        if (c == "AT+SMSTATE?") { info = mqtt ? "+SMSTATE: 1" : "+SMSTATE: 0"; return true; }
+        return false;
+    }
+
+    void handle(const std::string& line) {
+        commandLines++;
+        const std::string echoed = echo ? line + "\r\n" : "";
+        if (line.compare(0, 8, "AT+SMPUB") == 0) {
+            commands++;
+            if (!mqtt) {
+                reply(echoed + "\r\nERROR\r\n");
+                return;
+            }
+            payloadLen = atol(line.c_str() + line.find("\",") + 2);
+            payload.clear();
+            reply(echoed + "\r\n>", 10);
+            return;
+        }
+        if (line == "AT+CPOWD=1") {
+            commands++;
+            reply("\r\nNORMAL POWER DOWN\r\n");
+            powered = false;
+            return;
+        }
+
+        // "AT+CSQ;+CREG?" runs each command in turn and ends in one result
+        std::string out = echoed;
+        unsigned long delayMs = 20;
+        bool ok = true;
+        for (size_t pos = 0; ok; ) {
+            const size_t semi = line.find(';', pos);
+            const std::string one = (pos ? "AT" : "") +
+                line.substr(pos, semi == std::string::npos ? std::string::npos : semi - pos);
+            std::string info;
+            ok = exec(one, info, delayMs);
+            if (ok && !info.empty()) out += "\r\n" + info + "\r\n";
+            if (semi == std::string::npos) break;
+            pos = semi + 1;
+        }
+        reply(out + (ok ? "\r\nOK\r\n" : "\r\nERROR\r\n"), delayMs);
+    }
+
+    bool powered;
+    long bootAt;
+    long registeredAt;
+    bool bearer;
+    long bearerAt;
+    bool mqtt;
+    int refusals;
+    bool echo;
+    long payloadLen;
+    std::string payload;
+    std::multimap<unsigned long, std::string> pending;
+    size_t consumed;
+    long pwrkeyHighAt;
+};
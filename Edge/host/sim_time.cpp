@@ -0,0 +1,185 @@
+// Time service simulation
+//
+// The modem's clock, set by NTP to within 20 ms every 6 h and drifting
+// 5 ppm in between, feeds EdgeClock through whole-second readings. The Edge
+// runs 30 ppm fast with a 110 ms loop. 100 Nodes drift N(0, 20) ppm, capped
+// at 50, plus a daily 2-10 ppm temperature swing. Each uplinks every
+// 60 s +/- 1 s at SF12 and gets a beacon at most once per beacon interval,
+// through NodeClock as the Node runs it. 5% of uplinks and of beacons are
+// lost. Over 48 h the report gives the error of the Edge's clock, of
+// stamping samples when the Edge receives them, and of the Nodes' stamps
+// at acquisition, counted from the second hour. Fails if the Nodes' p99 is
+// not under a second.
+//
+//    make sim_time && ./sim_time [beacon interval ms]
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "EdgeTime.h"
+#include "node_clock.h"
+#include "host_port.h"
+
+static const double EPOCH_MS = 1760781234567.0;    // UTC at simulated time zero
+static const int NODES = 100;
+static const double RUN_MS = 48 * 3600000.0;
+static const double LOOP_MS = 110;
+static const double UPLINK_PERIOD_MS = 60000;
+static const size_t UPLINK_BYTES = 60;
+static const double LOSS = 0.05;
+
+// The Edge's millis() at true time t, and back
+static const double EDGE_OFFSET_MS = 12345;
+static const double EDGE_RATE = 1 + 30e-6;
+
+static double edgeLocal(double t)
+{
+    return EDGE_OFFSET_MS + t * EDGE_RATE;
+}
+
+static double edgeTrue(double local)
+{
+    return (local - EDGE_OFFSET_MS) / EDGE_RATE;
+}
+
+static std::mt19937_64 s_rng(7);
+
+static double uniform(double low, double high)
+{
+    return std::uniform_real_distribution<double>(low, high)(s_rng);
+}
+
+static double normal(double mean, double deviation)
+{
+    return std::normal_distribution<double>(mean, deviation)(s_rng);
+}
+
+struct SimNode {
+    double ppm;
+    double swingPpm;            // Daily temperature swing
+    double phase;
+    double nextUplink;
+    double lastBeacon;
+    double t;                   // True time millis() was last advanced to
+    double local;               // millis() at t
+    NodeClock clock;
+
+    // millis() at true time t, integrating the drifting rate in 10 s steps
+    double localAt(double to) {
+        while (t < to) {
+            const double dt = std::min(10000.0, to - t);
+            const double mid = t + dt / 2;
+            local += dt * (1 + (ppm + swingPpm * std::sin(2 * M_PI * mid / 86400000 + phase)) * 1e-6);
+            t += dt;
+        }
+        return local;
+    }
+};
+
+static void report(const char* name, std::vector<double>& errors, double* p99 = nullptr)
+{
+    for (double& e : errors) e = std::fabs(e);
+    std::sort(errors.begin(), errors.end());
+    auto q = [&](double p) { return errors[(size_t)(p * (errors.size() - 1))]; };
+    printf("  %-34s n=%-7zu |err| p50 %6.1f  p90 %6.1f  p99 %6.1f  max %6.1f ms\n",
+           name, errors.size(), q(0.5), q(0.9), q(0.99), errors.back());
+    if (p99) *p99 = q(0.99);
+}
+
+int main(int argc, char** argv)
+{
+    const double beaconInterval = argc > 1 ? strtoul(argv[1], NULL, 10) : TIME_BEACON_INTERVAL;
+    const double beaconAirtime = loraAirtime(TIME_BEACON_SIZE, 12, 125E3, 5);
+    const double uplinkAirtime = loraAirtime(UPLINK_BYTES, 12, 125E3, 5);
+
+    EdgeClock edge;
+    edge.setBeaconAirtime(beaconAirtime);
+
+    std::vector<SimNode> nodes(NODES);
+    for (SimNode& n : nodes) {
+        n.ppm = std::max(-50.0, std::min(50.0, normal(0, 20)));
+        n.swingPpm = uniform(2, 10);
+        n.phase = uniform(0, 2 * M_PI);
+        n.nextUplink = uniform(0, UPLINK_PERIOD_MS);
+        n.lastBeacon = -1e18;
+        n.t = 0;
+        n.local = uniform(0, 1e6);
+    }
+
+    double modemError = uniform(-20, 20);
+    double modemSetAt = 0;
+    auto modemUtc = [&](double t) { return EPOCH_MS + t + modemError + (t - modemSetAt) * 5e-6; };
+
+    std::vector<double> edgeErrors;
+    std::vector<double> receiveErrors;
+    std::vector<double> nodeErrors;
+    double nextReading = 5000;  // Edge millis()
+    long beacons = 0;
+    long readings = 0;
+
+    for (double t = 0; t < RUN_MS; ) {
+        const double readingAt = edgeTrue(nextReading);
+        SimNode* uplinking = &*std::min_element(nodes.begin(), nodes.end(),
+            [](const SimNode& a, const SimNode& b) { return a.nextUplink < b.nextUplink; });
+
+        if (readingAt < uplinking->nextUplink) {
+            // AT+CCLK? leaves on the first loop() after it is due
+            const double sent = std::ceil(edgeLocal(readingAt) / LOOP_MS) * LOOP_MS;
+            t = edgeTrue(sent);
+            if (t - modemSetAt > 6 * 3600000.0) {
+                modemSetAt = t;
+                modemError = uniform(-20, 20);
+            }
+            const uint32_t seconds = (uint32_t)std::floor(modemUtc(t + uniform(5, 15)) / 1000);
+            const double received = std::ceil((sent + 25) / LOOP_MS) * LOOP_MS + uniform(0, 3);
+            host_set_millis((unsigned long)received);
+            edge.addReading(seconds, (unsigned long)sent, (unsigned long)received);
+            nextReading = edge.nextReadingAt((unsigned long)received);
+            readings++;
+            if (edge.isValid()) {
+                edgeErrors.push_back((double)edge.toUtc((unsigned long)received) - (EPOCH_MS + edgeTrue(received)));
+            }
+            continue;
+        }
+
+        SimNode& n = *uplinking;
+        t = n.nextUplink;
+        n.nextUplink = t + UPLINK_PERIOD_MS + uniform(-1000, 1000);
+
+        // Stamped at acquisition, then on air; the Edge sees it on its next
+        // loop(), after the RX LED blink
+        const uint64_t stamp = n.clock.toUtc((uint32_t)n.localAt(t));
+        const double seen = edgeTrue(std::ceil(edgeLocal(t + uplinkAirtime) / LOOP_MS) * LOOP_MS) + 50;
+        if (edge.isSynced()) {
+            receiveErrors.push_back((double)edge.toUtc((unsigned long)edgeLocal(seen)) - (EPOCH_MS + t));
+            if (n.clock.isSynced() && t > 3600000) nodeErrors.push_back((double)stamp - (EPOCH_MS + t));
+        }
+        if (uniform(0, 1) < LOSS) continue;
+        host_set_millis((unsigned long)edgeLocal(seen));
+        if (!edge.isSynced() || seen - n.lastBeacon < beaconInterval) continue;
+
+        // Stamped for the end of the frame; the SPI write delays the start
+        n.lastBeacon = seen;
+        const double txStartLocal = std::floor(edgeLocal(seen));
+        char frame[24];
+        edge.buildBeacon(frame, sizeof(frame), (unsigned long)txStartLocal);
+        const double txEnd = edgeTrue(txStartLocal + uniform(0, 1)) + beaconAirtime;
+        edge.beaconSent((unsigned long)txStartLocal, (unsigned long)std::floor(edgeLocal(txEnd)) + 1);
+        beacons++;
+        if (uniform(0, 1) < LOSS) continue;
+        // RxDone is polled by the Node's loop()
+        n.clock.onBeacon(strtoull(frame + 2, NULL, 16), (uint32_t)n.localAt(txEnd + uniform(0, 2)));
+    }
+
+    printf("%d Nodes, 48 h, beacon interval %.0f ms: %ld beacons of %.0f ms airtime, %ld clock readings\n",
+           NODES, beaconInterval, beacons, beaconAirtime, readings);
+    double nodeP99;
+    report("Edge clock vs UTC", edgeErrors);
+    report("stamped on receipt by the Edge", receiveErrors);
+    report("stamped at acquisition by the Node", nodeErrors, &nodeP99);
+    double rateError = 0;
+    for (const SimNode& n : nodes) rateError += std::fabs(n.clock.getDriftPpm() + n.ppm);
+    printf("  mean |rate estimate - static drift| %.1f ppm, temperature swings 2-10 ppm on top\n", rateError / NODES);
+    return nodeP99 < 1000 ? 0 : 1;
+}
@@ -0,0 +1,154 @@
+// Host stand-in for the parts of the Arduino core the Edge sources use.
+// millis() reads a simulated clock that only host_port.h moves, Serial is a
+// log that stays quiet unless HOST_LOG is set, and Serial1 is a byte pipe to
+// whatever the harness puts on the other end of it.
+#pragma once
+
+#include <ctype.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <deque>
+#include <string>
+
+#define HIGH        1
+#define LOW         0
+#define INPUT       0
+#define OUTPUT      1
+#define SERIAL_8N1  0x800001c
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void pinMode(int pin, int mode);
+void digitalWrite(int pin, int level);
+int digitalRead(int pin);
+long random(long howbig);
+long random(long howsmall, long howbig);
+
+inline bool isAlphaNumeric(char c) { return isalnum((unsigned char)c) != 0; }
+inline bool isDigit(char c) { return isdigit((unsigned char)c) != 0; }
+
+class String {
+public:
+    String() {}
+    String(const char* s) : s(s ? s : "") {}
+    String(const std::string& s) : s(s) {}
+    String(char c) : s(1, c) {}
+    String(int v) : s(std::to_string(v)) {}
+    String(unsigned v) : s(std::to_string(v)) {}
+    String(long v) : s(std::to_string(v)) {}
+    String(unsigned long v) : s(std::to_string(v)) {}
+    String(float v, unsigned decimals = 2) : s(format(v, decimals)) {}
+    String(double v, unsigned decimals = 2) : s(format(v, decimals)) {}
+
+    unsigned length() const { return s.size(); }
+    const char* c_str() const { return s.c_str(); }
+    char operator[](unsigned i) const { return i < s.size() ? s[i] : '\0'; }
+    char charAt(unsigned i) const { return (*this)[i]; }
+    bool reserve(unsigned n) { s.reserve(n); return true; }
+    bool concat(const char* c, unsigned n) { s.append(c, n); return true; }
+    bool startsWith(const String& p) const { return s.compare(0, p.s.size(), p.s) == 0; }
+    bool endsWith(const String& p) const {
+        return s.size() >= p.s.size() && s.compare(s.size() - p.s.size(), p.s.size(), p.s) == 0;
+    }
+    int indexOf(char c, unsigned from = 0) const { return found(s.find(c, from)); }
+    int indexOf(const String& t, unsigned from = 0) const { return found(s.find(t.s, from)); }
+    int lastIndexOf(char c) const { return found(s.rfind(c)); }
+    String substring(unsigned from) const { return from >= s.size() ? String() : String(s.substr(from)); }
+    String substring(unsigned from, unsigned to) const {
+        return from >= s.size() || to <= from ? String() : String(s.substr(from, to - from));
+    }
+    long toInt() const { return atol(s.c_str()); }
+    float toFloat() const { return (float)atof(s.c_str()); }
+    void trim() {
+        size_t a = s.find_first_not_of(" \t\r\n");
+        size_t b = s.find_last_not_of(" \t\r\n");
+        s = a == std::string::npos ? std::string() : s.substr(a, b - a + 1);
+    }
+    void toUpperCase() { for (char& c : s) c = toupper((unsigned char)c); }
+
+    bool operator==(const String& o) const { return s == o.s; }
+    bool operator==(const char* o) const { return s == o; }
+    bool operator!=(const String& o) const { return s != o.s; }
+    bool operator!=(const char* o) const { return s != o; }
+    String& operator+=(const String& o) { s += o.s; return *this; }
+    String& operator+=(const char* o) { s += o; return *this; }
+    String& operator+=(char c) { s += c; return *this; }
+
+    friend String operator+(const String& a, const String& b) { return String(a.s + b.s); }
+    friend String operator+(const String& a, const char* b) { return String(a.s + b); }
+    friend String operator+(const char* a, const String& b) { return String(a + b.s); }
+
+    std::string s;
+
+private:
+    static int found(size_t pos) { return pos == std::string::npos ? -1 : (int)pos; }
+    static std::string format(double v, unsigned decimals) {
+        char buf[48];
+        snprintf(buf, sizeof(buf), "%.*f", (int)decimals, v);
+        return buf;
+    }
+};
+
+// Debug console, written to stdout only when HOST_LOG is set
+class HostConsole {
+public:
+    void begin(unsigned long) {}
+    size_t print(const String& s) { return log("%s", s.c_str()); }
+    size_t println(const String& s = String()) { return log("%s\n", s.c_str()); }
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+private:
+    size_t log(const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+extern HostConsole Serial;
+
+// UART to a peripheral. The harness plays the peripheral: it pushes bytes
+// into rx and reads what the firmware wrote from tx, onWrite tells it when.
+class HardwareSerial {
+public:
+    HardwareSerial() : onWrite(nullptr), onWriteContext(nullptr) {}
+
+    void begin(unsigned long, uint32_t = SERIAL_8N1, int = -1, int = -1) {}
+    void end() {}
+    int available() { return (int)rx.size(); }
+    int availableForWrite() { return 128; }
+    int peek() { return rx.empty() ? -1 : (uint8_t)rx.front(); }
+    int read() {
+        if (rx.empty()) return -1;
+        const uint8_t c = rx.front();
+        rx.pop_front();
+        return c;
+    }
+    size_t read(uint8_t* buf, size_t len) {
+        size_t n = 0;
+        for (; n < len && !rx.empty(); n++) {
+            buf[n] = rx.front();
+            rx.pop_front();
+        }
+        return n;
+    }
+    size_t write(uint8_t c) { return write(&c, 1); }
+    size_t write(const uint8_t* buf, size_t len) {
+        tx.append((const char*)buf, len);
+        if (onWrite) onWrite(onWriteContext);
+        return len;
+    }
+    size_t print(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+    size_t print(const String& s) { return write((const uint8_t*)s.c_str(), s.length()); }
+    size_t println(const String& s) { return print(s) + print("\r\n"); }
+    void flush() {}
+
+    std::deque<char> rx;
+    std::string tx;
+    void (*onWrite)(void* context);
+    void* onWriteContext;
+};
+
+extern HardwareSerial Serial1;
+extern HardwareSerial Serial2;
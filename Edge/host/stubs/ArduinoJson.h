@@ -0,0 +1,57 @@
+// Host stand-in for the ArduinoJson document API the Edge sources use:
+// flat objects of strings and numbers, serialized in insertion order.
+#pragma once
+
+#include <Arduino.h>
+#include <utility>
+#include <vector>
+
+class DynamicJsonDocument {
+public:
+    class Member {
+    public:
+        Member(std::string& json) : json(json) {}
+        Member& operator=(const String& v) { return quoted(v.s); }
+        Member& operator=(const char* v) { return quoted(v); }
+        Member& operator=(bool v) { json = v ? "true" : "false"; return *this; }
+        Member& operator=(int v) { json = std::to_string(v); return *this; }
+        Member& operator=(unsigned v) { json = std::to_string(v); return *this; }
+        Member& operator=(long v) { json = std::to_string(v); return *this; }
+        Member& operator=(unsigned long v) { json = std::to_string(v); return *this; }
+        Member& operator=(double v) { json = String(v, 2).s; return *this; }
+
+    private:
+        Member& quoted(const std::string& v) {
+            json = "\"";
+            for (char c : v) {
+                if (c == '"' || c == '\\') json += '\\';
+                json += c;
+            }
+            json += '"';
+            return *this;
+        }
+        std::string& json;
+    };
+
+    explicit DynamicJsonDocument(size_t) {}
+
+    Member operator[](const char* key) {
+        for (auto& m : members) {
+            if (m.first == key) return Member(m.second);
+        }
+        members.emplace_back(key, "null");
+        return Member(members.back().second);
+    }
+
+    std::vector<std::pair<std::string, std::string>> members;
+};
+
+inline size_t serializeJson(const DynamicJsonDocument& doc, String& out) {
+    out = "{";
+    for (size_t i = 0; i < doc.members.size(); i++) {
+        if (i) out += ",";
+        out += "\"" + String(doc.members[i].first) + "\":" + String(doc.members[i].second);
+    }
+    out += "}";
+    return out.length();
+}
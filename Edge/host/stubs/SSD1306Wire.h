@@ -0,0 +1,6 @@
+// Host stand-in, the harnesses have no display
+#pragma once
+
+#include <Wire.h>
+
+class SSD1306Wire {};
@@ -0,0 +1,4 @@
+// Host stand-in, the harnesses have no I2C devices
+#pragma once
+
+#include <Arduino.h>
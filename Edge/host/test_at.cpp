@@ -0,0 +1,203 @@
+// AT engine transcript test and benchmark
+//
+// Plays the modem's side of Serial1 by hand against EdgeAT. It checks echo,
+// a URC in the middle of a reply, a pipelined batch split across polls,
+// ERROR part way through a batch, the data prompt, a raw information line,
+// a timeout and an overlong line. Then it measures commands per second
+// through send/poll/callback, one per line and three per line, and the
+// parser's CPU per byte of URC traffic.
+//
+//    make test_at && ./test_at
+
+#include <chrono>
+#include <vector>
+#include "EdgeAT.h"
+#include "host_port.h"
+
+static std::vector<std::string> s_log;
+static int s_failures;
+
+static void onResult(void* context, AtResult result, const char* reply)
+{
+    static const char* names[] = { "IDLE", "PENDING", "OK", "ERROR", "TIMEOUT" };
+    s_log.push_back(std::string(names[result]) + "|" + reply);
+}
+
+static void onUrc(void* context, const char* line)
+{
+    s_log.push_back(std::string("URC|") + line);
+}
+
+static void ignoreUrc(void* context, const char* line)
+{
+}
+
+static void feed(const std::string& s)
+{
+    Serial1.rx.insert(Serial1.rx.end(), s.begin(), s.end());
+}
+
+// What the engine wrote since the last call
+static std::string sent()
+{
+    std::string s;
+    s.swap(Serial1.tx);
+    return s;
+}
+
+static void check(const char* name, bool ok)
+{
+    printf("  %-54s %s\n", name, ok ? "ok" : "FAILED");
+    if (!ok) s_failures++;
+}
+
+static void transcript()
+{
+    EdgeAT at;
+    at.begin(&Serial1);
+    at.onUrc("+SMSUB: ", onUrc, nullptr);
+    at.onUrc("+APP PDP:", onUrc, nullptr);
+    printf("transcript\n");
+
+    at.send("+CSQ", 1000, onResult, nullptr);
+    at.poll();
+    bool ok = sent() == "AT+CSQ\r\n";
+    feed("AT+CSQ\r\r\n+SMSUB: \"t\",\"p\"\r\n+CSQ: 18,99\r\n\r\nOK\r\n");
+    at.poll();
+    check("echo skipped, URC mid-reply dispatched", ok && s_log.size() == 2 &&
+          s_log[0] == "URC|+SMSUB: \"t\",\"p\"" && s_log[1] == "OK|+CSQ: 18,99");
+    s_log.clear();
+
+    at.send("+CSQ", 1000, onResult, nullptr, AT_BATCH);
+    at.send("+CREG?", 1000, onResult, nullptr, AT_BATCH);
+    at.send("+COPS?", 1000, onResult, nullptr, AT_BATCH);
+    at.send("+SMSUB=\"x\",1", 1000, onResult, nullptr);
+    at.poll();
+    ok = sent() == "AT+CSQ;+CREG?;+COPS?\r\n";
+    feed("\r\n+CSQ: 20,99\r\n\r\n+CR");
+    at.poll();
+    feed("EG: 0,5\r\n\r\n+COPS: 0,0,\"Op\",7\r\n\r\nOK\r\n");
+    at.poll();
+    check("three queries on one line, reply split across polls", ok && s_log.size() == 3 &&
+          s_log[0] == "OK|+CSQ: 20,99" && s_log[1] == "OK|+CREG: 0,5" && s_log[2] == "OK|+COPS: 0,0,\"Op\",7");
+    check("next command sent in the same poll", sent() == "AT+SMSUB=\"x\",1\r\n");
+    feed("\r\n+SMSUB: \"a\",\"b\"\r\nOK\r\n");
+    at.poll();
+    check("URC with the command's own prefix still a URC", s_log.size() == 5 &&
+          s_log[3] == "URC|+SMSUB: \"a\",\"b\"" && s_log[4] == "OK|");
+    s_log.clear();
+
+    at.send("+CSQ", 1000, onResult, nullptr, AT_BATCH);
+    at.send("+CBAD?", 1000, onResult, nullptr, AT_BATCH);
+    at.send("+COPS?", 1000, onResult, nullptr, AT_BATCH);
+    at.poll();
+    ok = sent() == "AT+CSQ;+CBAD?;+COPS?\r\n";
+    feed("\r\n+CSQ: 1,2\r\n\r\nERROR\r\n");
+    at.poll();
+    check("ERROR mid-batch fails the first unanswered query", ok && s_log.size() == 2 &&
+          s_log[0] == "OK|+CSQ: 1,2" && s_log[1] == "ERROR|");
+    ok = sent() == "AT+COPS?\r\n";
+    feed("\r\n+COPS: 0\r\n\r\nOK\r\n");
+    at.poll();
+    check("the rest of the batch retried alone", ok && s_log.size() == 3 && s_log[2] == "OK|+COPS: 0");
+    s_log.clear();
+
+    const char* payload = "{\"a\":1}";
+    at.sendData("+SMPUB=\"t\",7,1,0", (const uint8_t*)payload, 7, 1000, onResult, nullptr);
+    at.send("+GSN", 1000, onResult, nullptr);
+    at.poll();
+    ok = sent() == "AT+SMPUB=\"t\",7,1,0\r\n";
+    feed("\r\n> ");
+    at.poll();
+    check("payload sent after the prompt", ok && sent() == payload);
+    feed("\r\nOK\r\n");
+    at.poll();
+    ok = sent() == "AT+GSN\r\n";
+    feed("\r\n861234567890123\r\n\r\nOK\r\n");
+    at.poll();
+    check("raw information line taken as the reply", ok && s_log.size() == 2 &&
+          s_log[0] == "OK|" && s_log[1] == "OK|861234567890123");
+    s_log.clear();
+
+    at.send("+CSQ", 100, onResult, nullptr);
+    at.poll();
+    sent();
+    host_advance_millis(101);
+    at.poll();
+    check("timeout", s_log.size() == 1 && s_log[0] == "TIMEOUT|" && at.getTimeouts() == 1);
+
+    const unsigned long dropped = at.getLinesDropped();
+    feed(std::string(2000, 'x') + "\r\n+APP PDP: DEACTIVE\r\n");
+    for (int i = 0; i < 20; i++) at.poll();
+    check("overlong line dropped, the next URC still dispatched", s_log.size() == 2 &&
+          s_log[1] == "URC|+APP PDP: DEACTIVE" && at.getLinesDropped() == dropped + 1);
+    s_log.clear();
+}
+
+// Status queries answered at once, as fast as the engine takes them
+static void commandRate(bool batch)
+{
+    static const int COMMANDS = 300000;
+    EdgeAT at;
+    at.begin(&Serial1);
+    Serial1.rx.clear();
+    Serial1.tx.clear();
+
+    const uint8_t flags = batch ? AT_BATCH : 0;
+    const auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < COMMANDS; i += 3) {
+        at.send("+CSQ", 1000, nullptr, nullptr, flags);
+        at.send("+CREG?", 1000, nullptr, nullptr, flags);
+        at.send("+COPS?", 1000, nullptr, nullptr, flags);
+        while (!at.idle()) {
+            at.poll();
+            if (Serial1.tx.empty()) continue;
+            const std::string line = sent();
+            if (line.find("+CSQ") != std::string::npos) feed("\r\n+CSQ: 18,99\r\n");
+            if (line.find("+CREG") != std::string::npos) feed("\r\n+CREG: 0,1\r\n");
+            if (line.find("+COPS") != std::string::npos) feed("\r\n+COPS: 0,0,\"SimNet\",7\r\n");
+            feed("\r\nOK\r\n");
+        }
+    }
+    const double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    printf("  %-22s %5.2f M commands/s, %lu command lines for %lu commands\n",
+           batch ? "three per line" : "one per line", at.getCommandsCompleted() / s / 1e6,
+           at.getLinesSent(), at.getCommandsCompleted());
+}
+
+// Parser cost on a stream of incoming messages and signal reports
+static void parserCost()
+{
+    static const int REPEATS = 2000;
+    EdgeAT at;
+    at.begin(&Serial1);
+    at.onUrc("+SMSUB: ", ignoreUrc, nullptr);
+    at.onUrc("+CSQ: ", ignoreUrc, nullptr);
+
+    std::string chunk;
+    for (int i = 0; i < 100; i++) {
+        chunk += "\r\n+SMSUB: \"SmartIrrigation/cmd\",\"{\\\"node\\\":3,\\\"valve\\\":1,\\\"on\\\":true}\"\r\n"
+                 "\r\n+CSQ: 18,99\r\n";
+    }
+    double ns = 0;
+    size_t bytes = 0;
+    for (int i = 0; i < REPEATS; i++) {
+        feed(chunk);
+        const auto t0 = std::chrono::steady_clock::now();
+        while (Serial1.available()) at.poll();
+        ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+        bytes += chunk.size();
+    }
+    printf("  parser                 %5.2f ns/byte over %zu bytes, %lu URCs\n",
+           ns / bytes, bytes, at.getUrcsDispatched());
+}
+
+int main()
+{
+    transcript();
+    printf("benchmark, the modem answering at once\n");
+    commandRate(false);
+    commandRate(true);
+    parserCost();
+    return s_failures != 0;
+}
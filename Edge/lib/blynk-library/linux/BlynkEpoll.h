@@ -0,0 +1,490 @@
+/**
+ * @file       BlynkEpoll.h
+ * @license    This project is released under the MIT License (MIT)
+ * @date       Oct 2026
+ * @brief      Many Blynk devices on one epoll event loop
+ *
+ * Each BlynkEpollDevice is a full Blynk session with its own auth token.
+ * A BlynkEpollLoop multiplexes the sessions over non-blocking sockets and
+ * sleeps until a socket is ready, a timer is due or the next housekeeping
+ * tick comes up.
+ *
+ * Handlers (BLYNK_WRITE etc.) are shared by all devices, use
+ * BlynkEpollLoop::current() inside a handler to reply to the device that
+ * received the command. A loop and its devices belong to one thread; to
+ * use more cores, run one loop per thread with its own devices.
+ */
+
+#ifndef BlynkEpoll_h
+#define BlynkEpoll_h
+
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <vector>
+
+#include <Blynk/BlynkProtocol.h>
+#include <Blynk/BlynkTimer.h>
+
+// Bytes buffered per device in each direction, input holds at least one message
+#ifndef BLYNK_EPOLL_RX_BUFFER
+#define BLYNK_EPOLL_RX_BUFFER   (BLYNK_MAX_READBYTES + 512)
+#endif
+
+#ifndef BLYNK_EPOLL_TX_BUFFER
+#define BLYNK_EPOLL_TX_BUFFER   2048
+#endif
+
+// Heartbeats and reconnects are serviced at this interval
+#ifndef BLYNK_EPOLL_TICK_MS
+#define BLYNK_EPOLL_TICK_MS     100
+#endif
+
+// Events taken from the kernel per wakeup
+#ifndef BLYNK_EPOLL_EVENTS
+#define BLYNK_EPOLL_EVENTS      256
+#endif
+
+#if BLYNK_EPOLL_RX_BUFFER < BLYNK_MAX_READBYTES + 5
+#error "BLYNK_EPOLL_RX_BUFFER must hold a full message"
+#endif
+
+class BlynkEpollLoop;
+class BlynkEpollDevice;
+
+class BlynkTransportEpoll
+{
+    friend class BlynkEpollLoop;
+public:
+    BlynkTransportEpoll(BlynkEpollLoop& l, BlynkEpollDevice& d)
+        : loop(l), device(d), sockfd(-1), connecting(false), events(0)
+        , domain(NULL), port(0), addr(), addrLen(0)
+        , rxPos(0), rxLen(0), txLen(0)
+    {}
+
+    void begin(const char* h, uint16_t p) {
+        this->domain = h;
+        this->port = p;
+        addrLen = 0;
+    }
+
+    bool connect();
+    void disconnect();
+
+    // Only complete messages are reported, so the protocol never sees a
+    // header without its body
+    int available() {
+        const size_t have = rxLen - rxPos;
+        if (have < sizeof(BlynkHeader)) {
+            return 0;
+        }
+        const uint8_t* hdr = rx + rxPos;
+        const size_t len = (size_t(hdr[3]) << 8) | hdr[4];
+        size_t need = sizeof(BlynkHeader);
+        if (hdr[0] != BLYNK_CMD_RESPONSE && len <= BLYNK_MAX_READBYTES) {
+            need += len;
+        }
+        return (have >= need) ? int(have) : 0;
+    }
+
+    size_t read(void* buf, size_t len) {
+        len = BlynkMin(len, rxLen - rxPos);
+        memcpy(buf, rx + rxPos, len);
+        rxPos += len;
+        if (rxPos == rxLen) {
+            rxPos = rxLen = 0;
+        }
+        return len;
+    }
+
+    // Data is queued and sent as the socket allows, 0 means the peer
+    // stopped reading and the queue is full
+    size_t write(const void* buf, size_t len) {
+        if (sockfd < 0) {
+            return 0;
+        }
+        if (txLen + len > sizeof(tx)) {
+            drain();
+            if (sockfd < 0 || txLen + len > sizeof(tx)) {
+                return 0;
+            }
+        }
+        memcpy(tx + txLen, buf, len);
+        txLen += len;
+        drain();
+        return len;
+    }
+
+    bool connected() {
+        return sockfd >= 0;
+    }
+
+private:
+    bool resolve();
+    void handleEvent(uint32_t ev);
+    void fill();
+    void drain();
+    void updateEvents();
+
+    BlynkEpollLoop&   loop;
+    BlynkEpollDevice& device;
+    int         sockfd;
+    bool        connecting;
+    uint32_t    events;
+    const char* domain;
+    uint16_t    port;
+    struct sockaddr_storage addr;  // Resolved once per begin()
+    socklen_t   addrLen;
+    size_t      rxPos;
+    size_t      rxLen;
+    size_t      txLen;
+    uint8_t     rx[BLYNK_EPOLL_RX_BUFFER];
+    uint8_t     tx[BLYNK_EPOLL_TX_BUFFER];
+};
+
+// The transport must be constructed before the protocol that refers to it
+struct BlynkEpollDeviceConn {
+    BlynkEpollDeviceConn(BlynkEpollLoop& loop, BlynkEpollDevice& device)
+        : transport(loop, device)
+    {}
+
+    BlynkTransportEpoll transport;
+};
+
+class BlynkEpollDevice
+    : private BlynkEpollDeviceConn
+    , public BlynkProtocol<BlynkTransportEpoll>
+{
+    typedef BlynkProtocol<BlynkTransportEpoll> Base;
+public:
+    explicit BlynkEpollDevice(BlynkEpollLoop& loop);
+    ~BlynkEpollDevice();
+
+    void begin(const char* auth,
+               const char* domain = BLYNK_DEFAULT_DOMAIN,
+               uint16_t    port   = BLYNK_DEFAULT_PORT)
+    {
+        Base::begin(auth);
+        this->conn.begin(domain, port);
+    }
+
+private:
+    BlynkEpollLoop& loop;
+};
+
+class BlynkEpollLoop
+{
+    friend class BlynkTransportEpoll;
+    friend class BlynkEpollDevice;
+public:
+    BlynkEpollLoop()
+        : epfd(::epoll_create1(EPOLL_CLOEXEC))
+        , nextTick(0)
+        , timer(NULL)
+        , devices()
+    {
+        if (epfd < 0) {
+            BLYNK_LOG1(BLYNK_F("Can't create epoll"));
+        }
+    }
+
+    ~BlynkEpollLoop() {
+        if (epfd >= 0) {
+            ::close(epfd);
+        }
+    }
+
+    // The loop wakes up for the timer's next deadline
+    void setTimer(BlynkTimer& t) {
+        timer = &t;
+    }
+
+    size_t deviceCount() const {
+        return devices.size();
+    }
+
+    // Device being served, for use inside handlers
+    static BlynkEpollDevice* current() {
+        return active();
+    }
+
+    void runOnce();
+
+    void run() {
+        for (;;) {
+            runOnce();
+        }
+    }
+
+private:
+    BlynkEpollLoop(const BlynkEpollLoop&);
+    BlynkEpollLoop& operator=(const BlynkEpollLoop&);
+
+    static BlynkEpollDevice*& active() {
+        static __thread BlynkEpollDevice* dev = NULL;
+        return dev;
+    }
+
+    void dispatch(BlynkEpollDevice& dev) {
+        active() = &dev;
+        dev.run();
+        active() = NULL;
+    }
+
+    int         epfd;
+    millis_time_t nextTick;
+    BlynkTimer* timer;
+    std::vector<BlynkEpollDevice*> devices;
+};
+
+inline
+BlynkEpollDevice::BlynkEpollDevice(BlynkEpollLoop& l)
+    : BlynkEpollDeviceConn(l, *this)
+    , Base(transport)
+    , loop(l)
+{
+    loop.devices.push_back(this);
+}
+
+inline
+BlynkEpollDevice::~BlynkEpollDevice()
+{
+    conn.disconnect();
+    for (size_t i = 0; i < loop.devices.size(); i++) {
+        if (loop.devices[i] == this) {
+            loop.devices.erase(loop.devices.begin() + i);
+            break;
+        }
+    }
+}
+
+inline
+bool BlynkTransportEpoll::resolve()
+{
+    if (addrLen) {
+        return true;
+    }
+
+    struct addrinfo hints;
+    struct addrinfo *res = NULL;
+
+    memset(&hints, 0, sizeof hints);
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    char port_str[8];
+    snprintf(port_str, sizeof(port_str), "%u", port);
+    if (getaddrinfo(domain, port_str, &hints, &res) != 0 || res == NULL) {
+        BLYNK_LOG1(BLYNK_F("Cannot get addr info"));
+        return false;
+    }
+
+    memcpy(&addr, res->ai_addr, res->ai_addrlen);
+    addrLen = res->ai_addrlen;
+    freeaddrinfo(res);
+    return true;
+}
+
+inline
+bool BlynkTransportEpoll::connect()
+{
+    BLYNK_LOG4(BLYNK_F("Connecting to "), domain, ':', port);
+
+    if (!resolve()) {
+        return false;
+    }
+
+    sockfd = ::socket(addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (sockfd < 0) {
+        BLYNK_LOG1(BLYNK_F("Can't create socket"));
+        return false;
+    }
+
+    int one = 1;
+    setsockopt(sockfd, SOL_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    // The login written right after this is queued until the connect completes
+    if (::connect(sockfd, (struct sockaddr*)&addr, addrLen) < 0) {
+        if (errno != EINPROGRESS) {
+            BLYNK_LOG2(BLYNK_F("Can't connect to "), domain);
+            ::close(sockfd);
+            sockfd = -1;
+            return false;
+        }
+        connecting = true;
+    }
+
+    events = EPOLLIN | (connecting ? uint32_t(EPOLLOUT) : 0);
+    struct epoll_event ev;
+    ev.events = events;
+    ev.data.ptr = this;
+    if (::epoll_ctl(loop.epfd, EPOLL_CTL_ADD, sockfd, &ev) < 0) {
+        BLYNK_LOG1(BLYNK_F("Can't watch socket"));
+        disconnect();
+        return false;
+    }
+    return true;
+}
+
+inline
+void BlynkTransportEpoll::disconnect()
+{
+    if (sockfd != -1) {
+        ::epoll_ctl(loop.epfd, EPOLL_CTL_DEL, sockfd, NULL);
+        ::close(sockfd);
+        sockfd = -1;
+    }
+    connecting = false;
+    events = 0;
+    rxPos = rxLen = txLen = 0;
+}
+
+inline
+void BlynkTransportEpoll::handleEvent(uint32_t ev)
+{
+    if (sockfd < 0) {
+        return;
+    }
+    if (connecting) {
+        if (!(ev & (EPOLLOUT | EPOLLERR | EPOLLHUP))) {
+            return;
+        }
+        int err = 0;
+        socklen_t len = sizeof(err);
+        if (::getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err) {
+            BLYNK_LOG2(BLYNK_F("Can't connect to "), domain);
+            disconnect();
+            return;
+        }
+        connecting = false;
+    }
+
+    if (ev & EPOLLOUT) {
+        drain();
+    }
+    if (sockfd >= 0 && (ev & (EPOLLIN | EPOLLERR | EPOLLHUP))) {
+        fill();
+    }
+}
+
+inline
+void BlynkTransportEpoll::fill()
+{
+    if (rxPos) {
+        memmove(rx, rx + rxPos, rxLen - rxPos);
+        rxLen -= rxPos;
+        rxPos = 0;
+    }
+
+    while (rxLen < sizeof(rx)) {
+        const ssize_t rlen = ::read(sockfd, rx + rxLen, sizeof(rx) - rxLen);
+        if (rlen > 0) {
+            rxLen += rlen;
+        } else if (rlen < 0 && errno == EINTR) {
+            continue;
+        } else if (rlen < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;
+        } else {
+            // Closed by peer or failed
+            disconnect();
+            return;
+        }
+    }
+}
+
+inline
+void BlynkTransportEpoll::drain()
+{
+    if (connecting || sockfd < 0) {
+        return;
+    }
+
+    size_t sent = 0;
+    while (sent < txLen) {
+        const ssize_t wlen = ::send(sockfd, tx + sent, txLen - sent, MSG_NOSIGNAL);
+        if (wlen > 0) {
+            sent += wlen;
+        } else if (wlen < 0 && errno == EINTR) {
+            continue;
+        } else if (wlen < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else {
+            disconnect();
+            return;
+        }
+    }
+
+    if (sent) {
+        memmove(tx, tx + sent, txLen - sent);
+        txLen -= sent;
+    }
+    updateEvents();
+}
+
+inline
+void BlynkTransportEpoll::updateEvents()
+{
+    // Write readiness is only watched while something is left to send
+    const uint32_t want = EPOLLIN | ((txLen || connecting) ? uint32_t(EPOLLOUT) : 0);
+    if (want == events) {
+        return;
+    }
+    struct epoll_event ev;
+    ev.events = want;
+    ev.data.ptr = this;
+    if (::epoll_ctl(loop.epfd, EPOLL_CTL_MOD, sockfd, &ev) == 0) {
+        events = want;
+    }
+}
+
+inline
+void BlynkEpollLoop::runOnce()
+{
+    int32_t timeout = nextTick - BlynkMillis();
+    if (timeout < 0) {
+        timeout = 0;
+    } else if (timeout > BLYNK_EPOLL_TICK_MS) {
+        timeout = BLYNK_EPOLL_TICK_MS;
+    }
+    if (timer) {
+        const long next = timer->getNextTimeout();
+        if (next >= 0 && next < timeout) {
+            timeout = next;
+        }
+    }
+
+    struct epoll_event ready[BLYNK_EPOLL_EVENTS];
+    const int n = ::epoll_wait(epfd, ready, BLYNK_EPOLL_EVENTS, timeout);
+
+    for (int i = 0; i < n; i++) {
+        BlynkTransportEpoll* tr = (BlynkTransportEpoll*)ready[i].data.ptr;
+        tr->handleEvent(ready[i].events);
+        dispatch(tr->device);
+    }
+
+    if (timer && timer->getNextTimeout() == 0) {
+        timer->run();
+        // Send what the timers wrote without waiting for the tick
+        for (size_t i = 0; i < devices.size(); i++) {
+            devices[i]->flush();
+        }
+    }
+
+    const millis_time_t t = BlynkMillis();
+    if (int32_t(t - nextTick) >= 0) {
+        nextTick = t + BLYNK_EPOLL_TICK_MS;
+        for (size_t i = 0; i < devices.size(); i++) {
+            dispatch(*devices[i]);
+        }
+    }
+}
+
+#endif
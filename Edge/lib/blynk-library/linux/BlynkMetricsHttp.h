@@ -0,0 +1,179 @@
+/**
+ * @file       BlynkMetricsHttp.h
+ * @license    This project is released under the MIT License (MIT)
+ * @date       Oct 2026
+ * @brief      Serves BlynkMetrics to Prometheus over HTTP
+ *
+ * GET /metrics answers with every registered series in the Prometheus text
+ * format, anything else with 404. Requests are served one at a time on a
+ * thread of their own, so a scrape never stalls the event loop: the
+ * exporter only reads the cells the loop writes.
+ */
+
+#ifndef BlynkMetricsHttp_h
+#define BlynkMetricsHttp_h
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string>
+#include <thread>
+
+#include <Blynk/BlynkMetrics.h>
+
+// A client that sends nothing for this long is dropped
+#ifndef BLYNK_METRICS_HTTP_TIMEOUT_MS
+#define BLYNK_METRICS_HTTP_TIMEOUT_MS 2000
+#endif
+
+#ifdef BLYNK_USE_METRICS
+
+class BlynkMetricsServer
+{
+public:
+    BlynkMetricsServer()
+        : listenfd(-1)
+        , head()
+        , body()
+    {}
+
+    // Listens on port, on all interfaces unless addr is given
+    bool begin(uint16_t port, const char* addr = NULL) {
+        BlynkMetricsBuiltin();  // Library series are there from the first scrape
+
+        listenfd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listenfd < 0) {
+            BLYNK_LOG1(BLYNK_F("Can't create metrics socket"));
+            return false;
+        }
+        int one = 1;
+        setsockopt(listenfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+        struct sockaddr_in sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sin_family = AF_INET;
+        sa.sin_port = htons(port);
+        sa.sin_addr.s_addr = addr ? inet_addr(addr) : htonl(INADDR_ANY);
+        if (::bind(listenfd, (struct sockaddr*)&sa, sizeof(sa)) < 0 ||
+            ::listen(listenfd, 8) < 0)
+        {
+            BLYNK_LOG2(BLYNK_F("Can't listen for metrics on port "), port);
+            ::close(listenfd);
+            listenfd = -1;
+            return false;
+        }
+
+        BLYNK_LOG2(BLYNK_F("Metrics on port "), port);
+        std::thread(&BlynkMetricsServer::run, this).detach();
+        return true;
+    }
+
+    // Headers and body answering one request, also used by the benchmark
+    void respond(const char* req, size_t len) {
+        body.clear();
+        static const char get[] = "GET /metrics";
+        const size_t n = sizeof(get) - 1;
+        if (len > n && !memcmp(req, get, n) && (req[n] == ' ' || req[n] == '?')) {
+            StringOut out = { body };
+            BlynkMetricsWrite(out);
+            snprintf(head, sizeof(head),
+                     "HTTP/1.1 200 OK\r\n"
+                     "Content-Type: text/plain; version=0.0.4\r\n"
+                     "Content-Length: %lu\r\n"
+                     "Connection: close\r\n\r\n", (unsigned long)body.size());
+        } else {
+            snprintf(head, sizeof(head),
+                     "HTTP/1.1 404 Not Found\r\n"
+                     "Content-Length: 0\r\n"
+                     "Connection: close\r\n\r\n");
+        }
+    }
+
+    const char* headers() const { return head; }
+    const std::string& text() const { return body; }
+
+private:
+    struct StringOut {
+        std::string& s;
+        void write(const uint8_t* buf, size_t len) {
+            s.append((const char*)buf, len);
+        }
+    };
+
+    void run() {
+        for (;;) {
+            const int fd = ::accept4(listenfd, NULL, NULL, SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) {
+                    continue;
+                }
+                BLYNK_LOG1(BLYNK_F("Metrics server stopped"));
+                return;
+            }
+            serve(fd);
+            ::close(fd);
+        }
+    }
+
+    void serve(int fd) {
+        struct timeval tv;
+        tv.tv_sec  = BLYNK_METRICS_HTTP_TIMEOUT_MS / 1000;
+        tv.tv_usec = (BLYNK_METRICS_HTTP_TIMEOUT_MS % 1000) * 1000;
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+        // Only the request line matters, read up to the end of the headers
+        char req[1024];
+        size_t len = 0;
+        while (len < sizeof(req) - 1) {
+            const ssize_t r = ::read(fd, req + len, sizeof(req) - 1 - len);
+            if (r <= 0) {
+                if (r < 0 && errno == EINTR) {
+                    continue;
+                }
+                return;
+            }
+            len += r;
+            req[len] = '\0';
+            if (strstr(req, "\r\n\r\n") || strstr(req, "\n\n")) {
+                break;
+            }
+        }
+
+        respond(req, len);
+        if (sendAll(fd, head, strlen(head))) {
+            sendAll(fd, body.data(), body.size());
+        }
+    }
+
+    static bool sendAll(int fd, const char* buf, size_t len) {
+        while (len) {
+            const ssize_t w = ::send(fd, buf, len, MSG_NOSIGNAL);
+            if (w > 0) {
+                buf += w;
+                len -= w;
+            } else if (w < 0 && errno == EINTR) {
+                continue;
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    BlynkMetricsServer(const BlynkMetricsServer&);
+    BlynkMetricsServer& operator=(const BlynkMetricsServer&);
+
+    int         listenfd;
+    char        head[160];
+    std::string body;   // Reused, so a scrape allocates only when the text grows
+};
+
+#endif
+
+#endif
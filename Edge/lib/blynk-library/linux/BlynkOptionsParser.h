@@ -6,12 +6,14 @@ static
 void parse_options(int argc, char* argv[],
                    const char*& auth,
                    const char*& serv,
-                   uint16_t&    port)
+                   uint16_t&    port,
+                   uint16_t&    metrics)
 {
     static struct option long_options[] = {
         {"token",   required_argument,   0, 't'},
         {"server",  required_argument,   0, 's'},
         {"port",    required_argument,   0, 'p'},
+        {"metrics", required_argument,   0, 'm'},
         {0, 0, 0, 0}
     };
 
@@ -19,6 +21,7 @@ void parse_options(int argc, char* argv[],
     auth = NULL;
     serv = BLYNK_DEFAULT_DOMAIN;
     port = BLYNK_DEFAULT_PORT;
+    metrics = 0;
 
     const char* usage =
         "Usage: blynk [options]\n"
@@ -27,14 +30,16 @@ void parse_options(int argc, char* argv[],
         "  -t auth, --token=auth    Your auth token\n"
         "  -s addr, --server=addr   Server name (default: " BLYNK_DEFAULT_DOMAIN ")\n"
         "  -p num,  --port=num      Server port (default: " BLYNK_TOSTRING(BLYNK_DEFAULT_PORT) ")\n"
+        "  -m num,  --metrics=num   Serve Prometheus metrics on this port (default: off)\n"
         "\n";
 
     int rez;
-    while (-1 != (rez = getopt_long(argc, argv,"t:s:p:", long_options, NULL))) {
+    while (-1 != (rez = getopt_long(argc, argv,"t:s:p:m:", long_options, NULL))) {
         switch (rez) {
         case 't': auth = optarg; break;
         case 's': serv = optarg; break;
         case 'p': port = atoi(optarg); break;
+        case 'm': metrics = atoi(optarg); break;
         default : printf(usage); exit(1);
         };
     };
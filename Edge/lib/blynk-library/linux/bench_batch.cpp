@@ -0,0 +1,193 @@
+/**
+ * @file       bench_batch.cpp
+ * @license    This project is released under the MIT License (MIT)
+ * @date       Oct 2026
+ * @brief      Messages and bytes sent with and without write batching
+ *
+ * A device writes 20 virtual pins in two patterns: a sensor loop updating
+ * every pin 10 times a second at random moments, and a dashboard timer
+ * writing all 20 pins once a second. The transport counts what leaves,
+ * the clock is simulated and run() is called every 10 ms for 60 seconds.
+ * "off" marks every pin immediate, which sends each write as before.
+ */
+
+#define BLYNK_TEMPLATE_ID             "TMPLbench"
+#define BLYNK_TEMPLATE_NAME           "Bench"
+#define BLYNK_NO_DEFAULT_BANNER
+#define BLYNK_VW_BATCH                1024
+#define BLYNK_MSG_LIMIT               0
+#define BLYNK_HEARTBEAT               3600
+
+#include <arpa/inet.h>
+#include <BlynkApiLinux.h>
+#include <Blynk/BlynkProtocol.h>
+#include "../src/utility/BlynkHandlers.cpp"
+#include <stdio.h>
+#include <stdlib.h>
+
+static millis_time_t simulatedMillis = 0;
+
+millis_time_t BlynkMillis()
+{
+    return simulatedMillis;
+}
+
+void BlynkDelay(millis_time_t ms)
+{
+    simulatedMillis += ms;
+}
+
+size_t BlynkFreeRam()
+{
+    return 0;
+}
+
+void BlynkReset()
+{
+    exit(1);
+}
+
+void BlynkFatal()
+{
+    exit(1);
+}
+
+// Accepts the login, then counts writes, messages and bytes
+class BlynkTransportCount
+{
+public:
+    BlynkTransportCount()
+        : isConnected(false), rxLen(0), writes(0), messages(0), bytes(0)
+    {}
+
+    void begin(const char*, uint16_t) {}
+
+    bool connect() {
+        // Login response: OK for message 1
+        static const uint8_t ok[] = { BLYNK_CMD_RESPONSE, 0, 1, 0, BLYNK_SUCCESS };
+        memcpy(rx, ok, sizeof(ok));
+        rxLen = sizeof(ok);
+        isConnected = true;
+        return true;
+    }
+
+    void disconnect() { isConnected = false; }
+    bool connected()  { return isConnected; }
+    int available()   { return rxLen; }
+
+    size_t read(void* buf, size_t len) {
+        len = BlynkMin(len, rxLen);
+        memcpy(buf, rx, len);
+        memmove(rx, rx + len, rxLen - len);
+        rxLen -= len;
+        return len;
+    }
+
+    size_t write(const void* buf, size_t len) {
+        writes++;
+        bytes += len;
+        const uint8_t* p = (const uint8_t*)buf;
+        for (size_t i = 0; i + sizeof(BlynkHeader) <= len; ) {
+            messages++;
+            i += sizeof(BlynkHeader) + ((p[i + 3] << 8) | p[i + 4]);
+        }
+        return len;
+    }
+
+    void reset() { writes = messages = bytes = 0; }
+
+    bool   isConnected;
+    uint8_t rx[16];
+    size_t rxLen;
+    long   writes;
+    long   messages;
+    long   bytes;
+};
+
+class BlynkCountDevice
+    : public BlynkProtocol<BlynkTransportCount>
+{
+    typedef BlynkProtocol<BlynkTransportCount> Base;
+public:
+    BlynkCountDevice(BlynkTransportCount& transp)
+        : Base(transp)
+    {}
+
+    void begin() {
+        Base::begin("bench-token-0123456789abcdefghij");
+        this->conn.connect();
+        while (!connected()) {
+            run();
+            simulatedMillis++;
+        }
+    }
+};
+
+static void report(const char* name, const BlynkTransportCount& t, long calls)
+{
+    printf("  %-22s %6ld writes  %6ld messages  %7ld bytes  (%ld virtualWrite calls)\n",
+           name, t.writes, t.messages, t.bytes, calls);
+}
+
+static void sensorLoop(const char* name, bool batching)
+{
+    BlynkTransportCount transport;
+    BlynkCountDevice dev(transport);
+    dev.begin();
+    for (int pin = 0; pin < 20; pin++) {
+        dev.setImmediate(pin, !batching);
+    }
+    transport.reset();
+
+    srand(1);
+    long calls = 0;
+    const millis_time_t end = simulatedMillis + 60000;
+    while (simulatedMillis < end) {
+        // On average 200 writes a second over 20 pins
+        for (int i = 0; i < 2; i++) {
+            dev.virtualWrite(rand() % 20, 20.0 + (rand() % 1000) / 100.0);
+            calls++;
+        }
+        dev.run();
+        simulatedMillis += 10;
+    }
+    report(name, transport, calls);
+}
+
+static void dashboard(const char* name, bool batching)
+{
+    BlynkTransportCount transport;
+    BlynkCountDevice dev(transport);
+    dev.begin();
+    for (int pin = 0; pin < 20; pin++) {
+        dev.setImmediate(pin, !batching);
+    }
+    transport.reset();
+
+    long calls = 0;
+    const millis_time_t end = simulatedMillis + 60000;
+    millis_time_t next = simulatedMillis;
+    while (simulatedMillis < end) {
+        if (simulatedMillis >= next) {
+            next += 1000;
+            for (int pin = 0; pin < 20; pin++) {
+                dev.virtualWrite(pin, pin * 1.5);
+                calls++;
+            }
+        }
+        dev.run();
+        simulatedMillis += 10;
+    }
+    report(name, transport, calls);
+}
+
+int main()
+{
+    printf("20 pins, 10 Hz each, 60 s (batch every %d ms)\n", BLYNK_VW_BATCH_MS);
+    sensorLoop("off", false);
+    sensorLoop("batched", true);
+    printf("20 pins written together once a second, 60 s\n");
+    dashboard("off", false);
+    dashboard("batched", true);
+    return 0;
+}
@@ -0,0 +1,114 @@
+/**
+ * @file       bench_console.cpp
+ * @license    This project is released under the MIT License (MIT)
+ * @date       Oct 2026
+ * @brief      BlynkConsole dispatch cost
+ *
+ * 40 commands of all three handler kinds plus a sub-console, 100000 lines
+ * run through runCommand(). Heap allocations are counted separately for
+ * registration and dispatch.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <new>
+
+// Just enough of the Arduino Stream for the console
+class Stream
+{
+public:
+    int  available()           { return 0; }
+    int  read()                { return -1; }
+    void print(const char*)    {}
+    void print(char)           {}
+    void println(const char*)  {}
+    void println()             {}
+};
+
+#include <Blynk/BlynkConsole.h>
+
+static long allocations = 0;
+
+void* operator new(size_t size)
+{
+    allocations++;
+    void* p = malloc(size);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+static double wallTime()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static char names[40][16];
+
+int main()
+{
+    long calls = 0;
+    long argSum = 0;
+
+    allocations = 0;
+    static BlynkConsole console;
+    static BlynkConsole sub;
+    for (int i = 0; i < 40; i++) {
+        snprintf(names[i], sizeof(names[i]), "cmd%02d_%c", (i * 7) % 40, 'a' + i % 26);
+        switch (i % 3) {
+        case 0: console.addCommand(names[i], [&]() { calls++; }); break;
+        case 1: console.addCommand(names[i], [&](int argc, const char** argv) {
+                    calls++;
+                    argSum += argc ? argv[argc-1][0] : 0;
+                });
+                break;
+        case 2: console.addCommand(names[i], [&](const BlynkParam& param) {
+                    calls++;
+                    argSum += param[1].asInt();
+                });
+                break;
+        }
+    }
+    sub.addCommand("get", [&](int argc, const char**) { calls += argc; });
+    console.addCommand("sys", sub);
+    const long setupAllocs = allocations;
+
+    // Lines as they would come from a terminal
+    char lines[64][64];
+    for (int i = 0; i < 64; i++) {
+        const int c = (i * 13) % 41;
+        if (c == 40) {
+            snprintf(lines[i], sizeof(lines[i]), "sys get heap\n");
+        } else {
+            snprintf(lines[i], sizeof(lines[i]), "%s %d %d \"quoted\\tvalue\"\n",
+                     names[c], i, i * 3);
+        }
+    }
+
+    const long n = 100000;
+    allocations = 0;
+    const double t = wallTime();
+    long found = 0;
+    for (long i = 0; i < n; i++) {
+        found += (console.runCommand(lines[i % 64]) == BlynkConsole::EXECUTED);
+    }
+    const double dt = wallTime() - t;
+
+    printf("%ld commands: %.0f ns per command, %ld dispatched, %ld calls\n",
+           n, dt / n * 1e9, found, calls);
+    printf("heap allocations: %ld registering, %ld dispatching\n",
+           setupAllocs, allocations);
+    return argSum == 42 ? 1 : 0;
+}
@@ -0,0 +1,110 @@
+/**
+ * @file       bench_epoll.cpp
+ * @license    This project is released under the MIT License (MIT)
+ * @date       Oct 2026
+ * @brief      Load test: many simulated devices on one event loop
+ *
+ * Run against tests/pseudo-server-load.py. Every device echoes V1 to V2
+ * and reports V0 once a second, the loop's CPU use is printed periodically.
+ */
+
+#define BLYNK_TEMPLATE_ID             "TMPLbench"
+#define BLYNK_TEMPLATE_NAME           "Bench"
+#define BLYNK_NO_DEFAULT_BANNER
+
+#include <BlynkApiLinux.h>
+#include <BlynkEpoll.h>
+#include <getopt.h>
+#include <time.h>
+
+static BlynkEpollLoop loop;
+static std::vector<BlynkEpollDevice*> devices;
+static std::vector<char*> tokens;
+BlynkTimer tmr;
+
+BLYNK_WRITE(V1)
+{
+    BlynkEpollLoop::current()->virtualWrite(V2, param.asStr());
+}
+
+static double cpuTime()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char* argv[])
+{
+    static struct option long_options[] = {
+        {"server",   required_argument, 0, 's'},
+        {"port",     required_argument, 0, 'p'},
+        {"devices",  required_argument, 0, 'n'},
+        {"duration", required_argument, 0, 'd'},
+        {0, 0, 0, 0}
+    };
+
+    const char* serv = "127.0.0.1";
+    uint16_t port = 8888;
+    int count = 1000;
+    int duration = 30;
+
+    int rez;
+    while (-1 != (rez = getopt_long(argc, argv, "s:p:n:d:", long_options, NULL))) {
+        switch (rez) {
+        case 's': serv = optarg; break;
+        case 'p': port = atoi(optarg); break;
+        case 'n': count = atoi(optarg); break;
+        case 'd': duration = atoi(optarg); break;
+        default :
+            printf("Usage: bench_epoll [--server=addr] [--port=num] [--devices=num] [--duration=sec]\n");
+            return 1;
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        char* token = (char*)malloc(33);
+        snprintf(token, 33, "bench%027d", i);
+        tokens.push_back(token);
+
+        BlynkEpollDevice* dev = new BlynkEpollDevice(loop);
+        dev->begin(token, serv, port);
+        devices.push_back(dev);
+    }
+
+    tmr.setInterval(1000L, []() {
+        for (size_t i = 0; i < devices.size(); i++) {
+            devices[i]->virtualWrite(V0, BlynkMillis() / 1000);
+        }
+    });
+    loop.setTimer(tmr);
+
+    const millis_time_t started = BlynkMillis();
+    millis_time_t lastReport = started;
+    double lastCpu = cpuTime();
+
+    while (BlynkMillis() - started < duration * 1000UL) {
+        loop.runOnce();
+
+        const millis_time_t t = BlynkMillis();
+        if (t - lastReport >= 5000) {
+            int online = 0;
+            for (size_t i = 0; i < devices.size(); i++) {
+                online += devices[i]->connected();
+            }
+            const double cpu = cpuTime();
+            printf("[%6lu] %d/%d devices online, CPU %.1f%%\n",
+                   (unsigned long)(t - started), online, count,
+                   100.0 * (cpu - lastCpu) / ((t - lastReport) / 1000.0));
+            fflush(stdout);
+            lastReport = t;
+            lastCpu = cpu;
+        }
+    }
+
+    for (size_t i = 0; i < devices.size(); i++) {
+        delete devices[i];
+        free(tokens[i]);
+    }
+    return 0;
+}
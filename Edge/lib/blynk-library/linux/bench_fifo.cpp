@@ -0,0 +1,105 @@
+/**
+ * @file       bench_fifo.cpp
+ * @license    This project is released under the MIT License (MIT)
+ * @date       Oct 2026
+ * @brief      BlynkFifo vs BlynkFifoSPSC between two threads
+ *
+ * A producer thread streams a byte sequence through a 1 KB FIFO in chunks,
+ * the main thread reads and checks it. The last test feeds 32 bytes per
+ * millisecond and shows what a blocking get() costs while waiting.
+ */
+
+#include <Blynk/BlynkDebug.h>
+#include <utility/BlynkFifo.h>
+#include <thread>
+#include <stdio.h>
+#include <unistd.h>
+#include <time.h>
+
+static double clockTime(clockid_t id)
+{
+    struct timespec ts;
+    clock_gettime(id, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+template <class F>
+static void throughput(const char* name, F& fifo, size_t total, int chunk, bool blocking)
+{
+    const double t = clockTime(CLOCK_MONOTONIC);
+    std::thread producer([&]() {
+        uint8_t buf[256];
+        uint8_t v = 0;
+        for (size_t sent = 0; sent < total; ) {
+            const int n = BlynkMin<size_t>(chunk, total - sent);
+            for (int i = 0; i < n; i++) {
+                buf[i] = v++;
+            }
+            for (int k = 0; k < n; ) {
+                k += fifo.put(buf + k, n - k, blocking);
+            }
+            sent += n;
+        }
+    });
+
+    uint8_t buf[256];
+    uint8_t expect = 0;
+    bool ok = true;
+    for (size_t got = 0; got < total; ) {
+        int k = fifo.get(buf, chunk, false);
+        if (!k && blocking) {
+            k = fifo.get(buf, 1, true);
+        }
+        for (int i = 0; i < k; i++) {
+            ok &= (buf[i] == expect++);
+        }
+        got += k;
+    }
+    producer.join();
+
+    const double dt = clockTime(CLOCK_MONOTONIC) - t;
+    printf("%-28s chunk %3d: %8.1f MB/s%s\n", name, chunk, total / dt / 1e6, ok ? "" : " CORRUPT");
+}
+
+template <class F>
+static void slowProducer(const char* name, F& fifo)
+{
+    const double t = clockTime(CLOCK_MONOTONIC);
+    const double cpu = clockTime(CLOCK_PROCESS_CPUTIME_ID);
+    std::thread producer([&]() {
+        uint8_t buf[32] = { 0 };
+        for (int i = 0; i < 2000; i++) {
+            fifo.put(buf, sizeof(buf), true);
+            usleep(1000);
+        }
+    });
+
+    uint8_t buf[32];
+    for (size_t got = 0; got < 2000 * sizeof(buf); ) {
+        got += fifo.get(buf, sizeof(buf), true);
+    }
+    producer.join();
+
+    printf("%-28s slow producer: CPU %.0f%%\n", name,
+           100.0 * (clockTime(CLOCK_PROCESS_CPUTIME_ID) - cpu) / (clockTime(CLOCK_MONOTONIC) - t));
+}
+
+static BlynkFifo<uint8_t, 1024>     fifo;
+static BlynkFifoSPSC<uint8_t, 1024> spsc;
+
+int main()
+{
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    const int chunks[] = { 1, 16, 64, 256 };
+    for (unsigned c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++) {
+        const size_t total = (4u << 20) / (chunks[c] == 1 ? 8 : 1);
+        fifo.clear(); throughput("BlynkFifo",                fifo, total, chunks[c], false);
+        spsc.clear(); throughput("BlynkFifoSPSC",            spsc, total, chunks[c], false);
+        spsc.clear(); throughput("BlynkFifoSPSC (blocking)", spsc, total, chunks[c], true);
+    }
+
+    fifo.clear(); slowProducer("BlynkFifo",     fifo);
+    spsc.clear(); slowProducer("BlynkFifoSPSC", spsc);
+    return 0;
+}
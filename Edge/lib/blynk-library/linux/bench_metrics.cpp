@@ -0,0 +1,187 @@
+/**
+ * @file       bench_metrics.cpp
+ * @license    This project is released under the MIT License (MIT)
+ * @date       Oct 2026
+ * @brief      BlynkMetrics update cost and scrape time with 10k series
+ *
+ * Updates are timed on one thread and on several threads hitting the same
+ * counter, next to a plain increment and a shared atomic. The scrape renders
+ * 10000 series (8000 counters, 1000 gauges, 1000 histograms with 10 bounds)
+ * the way the HTTP exporter does, idle and while four threads keep counting.
+ */
+
+// 10k series, whatever the Makefile sets
+#undef BLYNK_METRICS
+#define BLYNK_METRICS       10240
+#define BLYNK_METRICS_CELLS 24576
+
+#include <Blynk/BlynkDebug.h>
+#include <BlynkMetricsHttp.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double wallTime()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static const long rounds = 100000000;
+
+// Keeps the compiler from folding the loops away
+static volatile unsigned long sink;
+
+template <class F>
+static double perCall(F f, long n)
+{
+    const double t = wallTime();
+    for (long i = 0; i < n; i++) {
+        f(i);
+    }
+    return (wallTime() - t) / n * 1e9;
+}
+
+template <class F>
+static double perCallThreads(int threads, F f, long n)
+{
+    std::vector<std::thread> pool;
+    std::atomic<int> ready(0);
+    const double t = wallTime();
+    for (int k = 0; k < threads; k++) {
+        pool.push_back(std::thread([&]() {
+            ready++;
+            while (ready < threads) {}
+            for (long i = 0; i < n; i++) {
+                f(i);
+            }
+        }));
+    }
+    for (size_t k = 0; k < pool.size(); k++) {
+        pool[k].join();
+    }
+    return (wallTime() - t) / (n * threads) * 1e9;
+}
+
+static const char* counterNames[] = {
+    "edge_lora_rx_packets_total", "edge_lora_tx_packets_total",
+    "edge_lora_rx_invalid_total", "edge_lora_tx_failed_total",
+    "edge_uplink_published_total", "edge_uplink_failed_total",
+    "edge_downlink_queued_total", "edge_downlink_expired_total"
+};
+
+static char labels[1000][16];
+static BlynkCounter   nodeCounters[8][1000];
+static BlynkGauge     nodeRssi[1000];
+static BlynkHistogram nodeLatency[1000];
+
+static const BlynkMetricValue latencyBounds[] = { 5, 10, 25, 50, 100, 250, 500, 1000, 2500, 5000 };
+
+static void registerSeries()
+{
+    for (int n = 0; n < 1000; n++) {
+        snprintf(labels[n], sizeof(labels[n]), "node=\"%d\"", n);
+    }
+    // Node by node, so the exporter has to gather each name's series
+    for (int n = 0; n < 1000; n++) {
+        for (int c = 0; c < 8; c++) {
+            nodeCounters[c][n] = BlynkMetricsCounter(counterNames[c], "Per-node counter", labels[n]);
+        }
+        nodeRssi[n] = BlynkMetricsGauge("edge_lora_rssi_dbm", "Last packet RSSI", labels[n]);
+        nodeLatency[n] = BlynkMetricsHistogram("edge_uplink_latency_seconds", "Publish latency",
+                                               latencyBounds, 10, 3, labels[n]);
+    }
+}
+
+static void fill()
+{
+    for (int n = 0; n < 1000; n++) {
+        for (int c = 0; c < 8; c++) {
+            nodeCounters[c][n].inc(n * 8 + c);
+        }
+        nodeRssi[n].set(-40 - n % 80);
+        nodeLatency[n].observe(n * 7 % 6000);
+    }
+}
+
+static void scrape(BlynkMetricsServer& server, const char* what, int times)
+{
+    static const char req[] = "GET /metrics HTTP/1.1\r\nHost: gateway\r\n\r\n";
+    double best = 1e9, sum = 0;
+    for (int i = 0; i < times; i++) {
+        const double t = wallTime();
+        server.respond(req, sizeof(req) - 1);
+        const double dt = wallTime() - t;
+        best = (dt < best) ? dt : best;
+        sum += dt;
+    }
+    size_t lines = 0;
+    const std::string& text = server.text();
+    for (size_t i = 0; i < text.size(); i++) {
+        lines += (text[i] == '\n');
+    }
+    printf("  %-34s %6.2f ms (best %.2f), %zu lines, %zu bytes\n",
+           what, sum / times * 1e3, best * 1e3, lines, text.size());
+}
+
+int main()
+{
+    registerSeries();
+    const BlynkCounter counter = nodeCounters[0][0];
+    const BlynkHistogram hist = nodeLatency[0];
+
+    printf("Update cost, one thread:\n");
+    unsigned long plain = 0;
+    printf("  plain unsigned long ++      %5.2f ns\n",
+           perCall([&](long) { plain++; sink = plain; }, rounds));
+    std::atomic<unsigned long> shared(0);
+    printf("  shared atomic fetch_add     %5.2f ns\n",
+           perCall([&](long) { shared.fetch_add(1, std::memory_order_relaxed); }, rounds));
+    printf("  BlynkCounter::inc           %5.2f ns\n",
+           perCall([&](long) { counter.inc(); }, rounds));
+    printf("  BlynkHistogram::observe     %5.2f ns\n",
+           perCall([&](long i) { hist.observe(i & 4095); }, rounds));
+
+    const int threads = 4;
+    const long each = rounds / 4;
+    printf("Update cost, %d threads on one counter (wall time over all updates, %u CPUs):\n",
+           threads, std::thread::hardware_concurrency());
+    printf("  shared atomic fetch_add     %5.2f ns\n",
+           perCallThreads(threads, [&](long) { shared.fetch_add(1, std::memory_order_relaxed); }, each));
+    printf("  BlynkCounter::inc           %5.2f ns\n",
+           perCallThreads(threads, [&](long) { counter.inc(); }, each));
+
+    // Every count is there once the threads are done
+    BlynkMetricsServer server;
+    static const char req[] = "GET /metrics HTTP/1.1\r\n\r\n";
+    server.respond(req, sizeof(req) - 1);
+    static const char key[] = "edge_lora_rx_packets_total{node=\"0\"} ";
+    const char* line = strstr(server.text().c_str(), key);
+    printf("  counter total               %ld of %ld\n",
+           line ? atol(line + sizeof(key) - 1) : -1L, rounds + threads * each);
+
+    fill();
+    printf("Scrape, %u series:\n", BlynkMetricsCount());
+    scrape(server, "idle", 50);
+
+    std::atomic<bool> stop(false);
+    std::vector<std::thread> writers;
+    for (int k = 0; k < threads; k++) {
+        writers.push_back(std::thread([&, k]() {
+            for (unsigned long i = 0; !stop.load(std::memory_order_relaxed); i++) {
+                nodeCounters[i & 7][(i >> 3) % 1000].inc();
+                nodeLatency[(i * 7 + k) % 1000].observe(i & 4095);
+            }
+        }));
+    }
+    scrape(server, "4 threads updating", 50);
+    stop = true;
+    for (size_t k = 0; k < writers.size(); k++) {
+        writers[k].join();
+    }
+    return 0;
+}
@@ -0,0 +1,136 @@
+/**
+ * @file       bench_param.cpp
+ * @license    This project is released under the MIT License (MIT)
+ * @date       Oct 2026
+ * @brief      BlynkParam access and formatting costs
+ *
+ * Compares reading values through BlynkParam::operator[] with atof/atoi
+ * against BlynkParamView, and add() against the snprintf formatting it
+ * replaced.
+ */
+
+#include <Blynk/BlynkParamView.h>
+#include <stdio.h>
+#include <time.h>
+
+static double wallTime()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static volatile double sink;
+
+// ns per call of f(i)
+template <class F>
+static double measure(long iterations, F f)
+{
+    const double t = wallTime();
+    double acc = 0;
+    for (long i = 0; i < iterations; i++) {
+        acc += f(i);
+    }
+    sink = acc;
+    return (wallTime() - t) / iterations * 1e9;
+}
+
+static void readValues(int count)
+{
+    char buf[1024];
+    BlynkParam param(buf, 0, sizeof(buf));
+    for (int i = 0; i < count; i++) {
+        param.add(20.0 + i * 0.125);
+    }
+    const long n = 2000000 / count;
+
+    const double indexed = measure(n, [&](long) {
+        double sum = 0;
+        for (int i = 0; i < count; i++) {
+            sum += param[i].asDouble();
+        }
+        return sum;
+    });
+    const double view = measure(n, [&](long) {
+        BlynkParamView v(param);
+        double sum = 0;
+        for (int i = 0; i < count; i++) {
+            sum += v.asDouble(i);
+        }
+        return sum;
+    });
+    printf("  read %2d doubles:   param[i].asDouble() %7.0f ns   BlynkParamView %6.0f ns\n",
+           count, indexed, view);
+}
+
+static void formatValues()
+{
+    char buf[64];
+    char out[64];
+    const long n = 1000000;
+    BlynkParam param(buf, 0, sizeof(buf));
+
+    const double legacyInt = measure(n, [&](long i) {
+        return snprintf(out, sizeof(out), "%li", i * 7919 - 5000000);
+    });
+    const double newInt = measure(n, [&](long i) {
+        param.clear();
+        param.add(i * 7919 - 5000000);
+        return param.getLength();
+    });
+    printf("  add(long):         snprintf %7.0f ns   add() %6.0f ns\n", legacyInt, newInt);
+
+    const double legacyFloat = measure(n, [&](long i) {
+        return snprintf(out, sizeof(out), "%2.3f", (double)(float)(i * 0.0137 - 3000));
+    });
+    const double newFloat = measure(n, [&](long i) {
+        param.clear();
+        param.add((float)(i * 0.0137 - 3000));
+        return param.getLength();
+    });
+    printf("  add(float):        snprintf %7.0f ns   add() %6.0f ns\n", legacyFloat, newFloat);
+
+    const double legacyDouble = measure(n, [&](long i) {
+        return snprintf(out, sizeof(out), "%2.7f", i * 0.0137 - 3000);
+    });
+    const double newDouble = measure(n, [&](long i) {
+        param.clear();
+        param.add(i * 0.0137 - 3000);
+        return param.getLength();
+    });
+    printf("  add(double):       snprintf %7.0f ns   add() %6.0f ns\n", legacyDouble, newDouble);
+
+#if defined(BLYNK_USE_INTERNAL_DTOSTRF)
+    const double internal = measure(n, [&](long i) {
+        dtostrf_internal(i * 0.0137 - 3000, 5, 7, out);
+        return out[0];
+    });
+    printf("  dtostrf_internal:  %7.0f ns\n", internal);
+#endif
+}
+
+static void parseValues()
+{
+    const char text[] = "vw\0" "12\0" "-1234.5678";
+    BlynkParam param(text, sizeof(text) - 1);
+    const long n = 2000000;
+
+    const double atoiTime = measure(n, [&](long) { return param[1].asInt(); });
+    const double viewInt  = measure(n, [&](long) { return BlynkParamView(param).asInt(1); });
+    printf("  one int:           param[1].asInt()    %7.0f ns   BlynkParamView %6.0f ns\n", atoiTime, viewInt);
+
+    const double atofTime = measure(n, [&](long) { return param[2].asDouble(); });
+    const double viewDbl  = measure(n, [&](long) { return BlynkParamView(param).asDouble(2); });
+    printf("  one double:        param[2].asDouble() %7.0f ns   BlynkParamView %6.0f ns\n", atofTime, viewDbl);
+}
+
+int main()
+{
+    printf("BlynkParam\n");
+    parseValues();
+    readValues(4);
+    readValues(16);
+    readValues(64);
+    formatValues();
+    return 0;
+}
@@ -0,0 +1,166 @@
+/**
+ * @file       bench_rate.cpp
+ * @license    This project is released under the MIT License (MIT)
+ * @date       Oct 2026
+ * @brief      Caller latency and CPU with writes above BLYNK_MSG_LIMIT
+ *
+ * The device writes 100 values a second over 8 virtual pins for 5 seconds.
+ * That is well above the limit of 15 messages a second. Between writes the
+ * loop calls run(), and the transport's idle poll sleeps as usual.
+ * BlynkTransportSocket connects to a local server that answers the login
+ * and timestamps every message. The bench reports how long virtualWrite()
+ * holds the caller, the process CPU use, and the peak message rate on the
+ * wire, and fails if any one second on the wire holds more than the limit.
+ *
+ * The Makefile builds the bench twice, both with BLYNK_MULTITHREADED so the
+ * send mutex is real. bench_rate uses the BLYNK_MSG_QUEUE queue.
+ * bench_rate_wait uses BLYNK_MSG_QUEUE=0, which makes the caller wait in
+ * run() for its slot.
+ */
+
+#define BLYNK_TEMPLATE_ID             "TMPLbench"
+#define BLYNK_TEMPLATE_NAME           "Bench"
+#define BLYNK_NO_DEFAULT_BANNER
+#define BLYNK_MSG_LIMIT               15
+#define BLYNK_HEARTBEAT               3600
+
+#include <netinet/in.h>
+#include <BlynkApiLinux.h>
+#include <BlynkSocket.h>
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <time.h>
+
+static const int    SECONDS      = 5;
+static const int    WRITES_PER_S = 100;
+static const int    PINS         = 8;
+
+static double monoTime()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double cpuTime()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Answers the login and ping, records when each rate-limited message arrived
+static void server(int listener, std::vector<double>& arrivals)
+{
+    const int fd = ::accept(listener, NULL, NULL);
+    if (fd < 0) {
+        return;
+    }
+    std::vector<uint8_t> in(65536);
+    size_t have = 0;
+    for (;;) {
+        const ssize_t r = ::read(fd, in.data() + have, in.size() - have);
+        if (r <= 0) {
+            break;
+        }
+        have += r;
+        const double t = monoTime();
+
+        size_t off = 0;
+        while (have - off >= sizeof(BlynkHeader)) {
+            const uint8_t* hdr = in.data() + off;
+            const size_t len = (hdr[3] << 8) | hdr[4];
+            if (have - off < sizeof(BlynkHeader) + len) {
+                break;
+            }
+            if (hdr[0] == BLYNK_CMD_HW_LOGIN || hdr[0] == BLYNK_CMD_PING) {
+                const uint8_t ok[] = { BLYNK_CMD_RESPONSE, hdr[1], hdr[2], 0, BLYNK_SUCCESS };
+                if (::write(fd, ok, sizeof(ok)) != sizeof(ok)) {
+                    break;
+                }
+            } else if (hdr[0] >= BLYNK_CMD_BRIDGE && hdr[0] <= BLYNK_CMD_HARDWARE) {
+                arrivals.push_back(t);
+            }
+            off += sizeof(BlynkHeader) + len;
+        }
+        memmove(in.data(), in.data() + off, have - off);
+        have -= off;
+    }
+    ::close(fd);
+}
+
+int main()
+{
+    const int listener = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addrLen = sizeof(addr);
+    if (listener < 0 || ::bind(listener, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+        ::listen(listener, 1) < 0 || ::getsockname(listener, (struct sockaddr*)&addr, &addrLen) < 0) {
+        perror("listen");
+        return 1;
+    }
+
+    std::vector<double> arrivals;
+    std::thread srv(server, listener, std::ref(arrivals));
+
+    BlynkTransportSocket transport;
+    BlynkSocket dev(transport);
+    dev.begin("bench-token-0123456789abcdefghij", "127.0.0.1", ntohs(addr.sin_port));
+    while (!dev.connected()) {
+        dev.run();
+    }
+
+    std::vector<double> latency;
+    const double start = monoTime();
+    const double cpu0 = cpuTime();
+    double next = start;
+    long value = 0;
+    while (monoTime() - start < SECONDS) {
+        if (monoTime() >= next) {
+            const double t = monoTime();
+            dev.virtualWrite(int(value % PINS), value);
+            latency.push_back(monoTime() - t);
+            value++;
+            next += 1.0 / WRITES_PER_S;
+        }
+        dev.run();
+    }
+    const double wall = monoTime() - start;
+    const double cpu = cpuTime() - cpu0;
+
+    dev.disconnect();
+    srv.join();
+    ::close(listener);
+
+    // Peak number of messages within any one second
+    size_t peak = 0;
+    for (size_t i = 0, j = 0; i < arrivals.size(); i++) {
+        while (arrivals[i] - arrivals[j] >= 1.0) {
+            j++;
+        }
+        peak = std::max(peak, i - j + 1);
+    }
+
+    std::sort(latency.begin(), latency.end());
+#if defined(BLYNK_USE_MSG_QUEUE)
+    printf("Queue, %d bytes, limit %d msgs/s\n", BLYNK_MSG_QUEUE, BLYNK_MSG_LIMIT);
+#else
+    printf("Waiting in run(), limit %d msgs/s\n", BLYNK_MSG_LIMIT);
+#endif
+    printf("  %zu writes in %.1f s (%d/s asked), %zu messages sent, peak %zu in one second\n",
+           latency.size(), wall, WRITES_PER_S, arrivals.size(), peak);
+    printf("  virtualWrite() p50 %.1f us  p99 %.1f us  max %.1f us\n",
+           latency[latency.size() / 2] * 1e6, latency[latency.size() * 99 / 100] * 1e6,
+           latency.back() * 1e6);
+    printf("  CPU %.1f%%\n", 100.0 * cpu / wall);
+    if (peak > BLYNK_MSG_LIMIT) {
+        printf("  FAILED: more than %d messages in one second\n", BLYNK_MSG_LIMIT);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,172 @@
+/**
+ * @file       bench_recv.cpp
+ * @license    This project is released under the MIT License (MIT)
+ * @date       Oct 2026
+ * @brief      Inbound hardware write throughput
+ *
+ * A thread pushes virtual pin writes through a socket pair as fast as it
+ * can, the device handles them in BLYNK_WRITE. Built twice by the
+ * Makefile: bench_recv reads through BLYNK_RECV_BUFFER, bench_recv_legacy
+ * reads every header and body straight from the socket.
+ */
+
+#define BLYNK_TEMPLATE_ID             "TMPLbench"
+#define BLYNK_TEMPLATE_NAME           "Bench"
+#define BLYNK_NO_DEFAULT_BANNER
+#define BLYNK_HEARTBEAT               3600
+
+#include <arpa/inet.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <BlynkApiLinux.h>
+#include <Blynk/BlynkProtocol.h>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <time.h>
+
+static long handled = 0;
+static long handledBytes = 0;
+
+BLYNK_WRITE(V1)
+{
+    handled++;
+    handledBytes += param.getLength();
+}
+
+// One end of a socket pair, without the idle sleep of BlynkTransportSocket
+class BlynkTransportPair
+{
+public:
+    BlynkTransportPair(int fd)
+        : sockfd(fd)
+    {}
+
+    void begin(const char*, uint16_t) {}
+    bool connect()    { return true; }
+    void disconnect() {}
+    bool connected()  { return sockfd >= 0; }
+
+    int available() {
+        int count = 0;
+        return (0 == ioctl(sockfd, FIONREAD, &count)) ? count : 0;
+    }
+
+    size_t read(void* buf, size_t len) {
+        size_t got = 0;
+        while (got < len) {
+            const ssize_t r = ::read(sockfd, (uint8_t*)buf + got, len - got);
+            if (r <= 0) {
+                return r < 0 ? -1 : got;
+            }
+            got += r;
+        }
+        return got;
+    }
+
+    size_t write(const void* buf, size_t len) {
+        return ::write(sockfd, buf, len);
+    }
+
+private:
+    int sockfd;
+};
+
+class BlynkPairDevice
+    : public BlynkProtocol<BlynkTransportPair>
+{
+    typedef BlynkProtocol<BlynkTransportPair> Base;
+public:
+    BlynkPairDevice(BlynkTransportPair& transp)
+        : Base(transp)
+    {}
+
+    void begin() {
+        Base::begin("bench-token-0123456789abcdefghij");
+    }
+};
+
+static double wallTime()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void appendMsg(std::vector<uint8_t>& out, uint8_t type, uint16_t id, const char* body, size_t len)
+{
+    const uint8_t hdr[5] = { type, uint8_t(id >> 8), uint8_t(id), uint8_t(len >> 8), uint8_t(len) };
+    out.insert(out.end(), hdr, hdr + sizeof(hdr));
+    out.insert(out.end(), body, body + len);
+}
+
+static void run(size_t valueLen, long count)
+{
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+        perror("socketpair");
+        return;
+    }
+
+    // Login reply, then the writes
+    std::vector<uint8_t> stream;
+    appendMsg(stream, BLYNK_CMD_RESPONSE, 1, NULL, 0);
+    stream[3] = 0;
+    stream[4] = BLYNK_SUCCESS;
+    std::vector<char> body(5 + valueLen);
+    memcpy(body.data(), "vw\0" "1\0", 5);
+    memset(body.data() + 5, '7', valueLen);
+    for (long i = 0; i < count; i++) {
+        appendMsg(stream, BLYNK_CMD_HARDWARE, uint16_t(i % 65535 + 1), body.data(), body.size());
+    }
+
+    BlynkTransportPair transport(fds[0]);
+    BlynkPairDevice dev(transport);
+    dev.begin();
+    handled = handledBytes = 0;
+
+    std::thread server([&]() {
+        // Drain what the device sends so it never blocks
+        std::thread sink([&]() {
+            char buf[4096];
+            while (::read(fds[1], buf, sizeof(buf)) > 0) {}
+        });
+        for (size_t off = 0; off < stream.size(); ) {
+            const ssize_t w = ::write(fds[1], stream.data() + off, BlynkMin<size_t>(65536, stream.size() - off));
+            if (w <= 0) {
+                break;
+            }
+            off += w;
+        }
+        ::shutdown(fds[1], SHUT_WR);
+        sink.join();
+    });
+
+    const double t = wallTime();
+    while (handled < count) {
+        dev.run();
+    }
+    const double dt = wallTime() - t;
+    ::shutdown(fds[0], SHUT_RDWR);
+    server.join();
+    ::close(fds[0]);
+    ::close(fds[1]);
+
+    printf("  %4zu byte values: %8.0f msgs/s  %7.1f MB/s\n",
+           valueLen, count / dt, handledBytes / dt / 1e6);
+}
+
+int main()
+{
+#if defined(BLYNK_USE_RECV_BUFFER)
+    printf("Receive buffer, %d bytes\n", BLYNK_RECV_BUFFER);
+#else
+    printf("Direct reads\n");
+#endif
+    run(4, 1000000);
+    run(64, 500000);
+    run(1000, 100000);
+    run(3000, 30000);
+    return 0;
+}
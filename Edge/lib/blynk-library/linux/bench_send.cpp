@@ -0,0 +1,226 @@
+/**
+ * @file       bench_send.cpp
+ * @license    This project is released under the MIT License (MIT)
+ * @date       Oct 2026
+ * @brief      Outbound syscalls and throughput, with and without the send buffer
+ *
+ * The device connects over TCP to a local echo server. The server answers
+ * the login and echoes every other message back, so the device gets each
+ * virtual write back in BLYNK_WRITE and can check that all of them arrived
+ * in order. Each round makes N virtualWrite calls and then one run(). The
+ * transport counts the device's socket syscalls (read, write and the
+ * FIONREAD ioctl). Throughput is measured against the device thread's CPU
+ * time. Built twice by the Makefile: bench_send with BLYNK_SEND_BUFFER,
+ * bench_send_direct with one write per message.
+ */
+
+#define BLYNK_TEMPLATE_ID             "TMPLbench"
+#define BLYNK_TEMPLATE_NAME           "Bench"
+#define BLYNK_NO_DEFAULT_BANNER
+#define BLYNK_MSG_LIMIT               0
+#define BLYNK_HEARTBEAT               3600
+
+#include <netinet/in.h>
+#include <BlynkApiLinux.h>
+#include <BlynkSocket.h>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <time.h>
+
+static const int ROUNDS = 2000;
+
+static long echoed = 0;
+static long outOfOrder = 0;
+
+BLYNK_WRITE(V1)
+{
+    if (param.asLong() != echoed) {
+        outOfOrder++;
+    }
+    echoed++;
+}
+
+// BlynkTransportSocket that counts its syscalls. available() skips the
+// 10 ms idle sleep, which would otherwise dominate every round.
+class BlynkTransportCounting
+    : public BlynkTransportSocket
+{
+public:
+    BlynkTransportCounting()
+        : reads(0), writes(0), ioctls(0)
+    {}
+
+    size_t read(void* buf, size_t len) {
+        reads++;
+        return BlynkTransportSocket::read(buf, len);
+    }
+
+    size_t write(const void* buf, size_t len) {
+        writes++;
+        return BlynkTransportSocket::write(buf, len);
+    }
+
+    int available() {
+        if (!connected()) {
+            return 0;
+        }
+        ioctls++;
+        int count = 0;
+        return (0 == ioctl(sockfd, FIONREAD, &count)) ? count : 0;
+    }
+
+    long reads;
+    long writes;
+    long ioctls;
+};
+
+class BlynkCountingDevice
+    : public BlynkProtocol<BlynkTransportCounting>
+{
+    typedef BlynkProtocol<BlynkTransportCounting> Base;
+public:
+    BlynkCountingDevice(BlynkTransportCounting& transp)
+        : Base(transp)
+    {}
+
+    void begin(uint16_t port) {
+        Base::begin("bench-token-0123456789abcdefghij");
+        this->conn.begin("127.0.0.1", port);
+    }
+};
+
+static double cpuTime()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static bool readFull(int fd, uint8_t* buf, size_t len, long& reads)
+{
+    for (size_t got = 0; got < len; ) {
+        const ssize_t r = ::read(fd, buf + got, len - got);
+        reads++;
+        if (r <= 0) {
+            return false;
+        }
+        got += r;
+    }
+    return true;
+}
+
+// Answers login and ping, echoes everything else, one connection at a time
+static void echoServer(int listener, long& serverReads, long& messages)
+{
+    const int fd = ::accept(listener, NULL, NULL);
+    if (fd < 0) {
+        return;
+    }
+    std::vector<uint8_t> in(65536);
+    size_t have = 0;
+    for (;;) {
+        const ssize_t r = ::read(fd, in.data() + have, in.size() - have);
+        serverReads++;
+        if (r <= 0) {
+            break;
+        }
+        have += r;
+
+        std::vector<uint8_t> out;
+        size_t off = 0;
+        while (have - off >= sizeof(BlynkHeader)) {
+            const uint8_t* hdr = in.data() + off;
+            const size_t len = (hdr[3] << 8) | hdr[4];
+            if (have - off < sizeof(BlynkHeader) + len) {
+                break;
+            }
+            if (hdr[0] == BLYNK_CMD_HW_LOGIN || hdr[0] == BLYNK_CMD_PING) {
+                const uint8_t ok[] = { BLYNK_CMD_RESPONSE, hdr[1], hdr[2], 0, BLYNK_SUCCESS };
+                out.insert(out.end(), ok, ok + sizeof(ok));
+            } else {
+                out.insert(out.end(), hdr, hdr + sizeof(BlynkHeader) + len);
+                messages++;
+            }
+            off += sizeof(BlynkHeader) + len;
+        }
+        memmove(in.data(), in.data() + off, have - off);
+        have -= off;
+
+        for (size_t w = 0; w < out.size(); ) {
+            const ssize_t n = ::write(fd, out.data() + w, out.size() - w);
+            if (n <= 0) {
+                break;
+            }
+            w += n;
+        }
+    }
+    ::close(fd);
+}
+
+static void run(int burst)
+{
+    const int listener = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addrLen = sizeof(addr);
+    if (listener < 0 || ::bind(listener, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+        ::listen(listener, 1) < 0 || ::getsockname(listener, (struct sockaddr*)&addr, &addrLen) < 0) {
+        perror("listen");
+        return;
+    }
+
+    long serverReads = 0;
+    long messages = 0;
+    std::thread server(echoServer, listener, std::ref(serverReads), std::ref(messages));
+
+    BlynkTransportCounting transport;
+    BlynkCountingDevice dev(transport);
+    dev.begin(ntohs(addr.sin_port));
+    while (!dev.connected()) {
+        dev.run();
+    }
+    echoed = outOfOrder = 0;
+
+    const long total = long(ROUNDS) * burst;
+    const long reads0 = transport.reads, writes0 = transport.writes, ioctls0 = transport.ioctls;
+    const double t = cpuTime();
+    long sent = 0;
+    for (int round = 0; round < ROUNDS; round++) {
+        for (int i = 0; i < burst; i++) {
+            dev.virtualWrite(V1, sent++);
+        }
+        dev.run();
+    }
+    const double dt = cpuTime() - t;
+    const long writes = transport.writes - writes0;
+    const long syscalls = writes + transport.reads - reads0 + transport.ioctls - ioctls0;
+
+    // Collect the rest of the echoes, outside the measurement
+    while (echoed < total && dev.connected()) {
+        dev.run();
+    }
+    dev.disconnect();
+    server.join();
+    ::close(listener);
+
+    printf("  burst %2d: %5.2f writes/msg  %5.2f syscalls/msg  %8.0f msgs/s CPU  "
+           "server %5.2f reads/msg, %ld/%ld echoed, %ld out of order\n",
+           burst, double(writes) / total, double(syscalls) / total, total / dt,
+           double(serverReads) / messages, echoed, total, outOfOrder);
+}
+
+int main()
+{
+#if defined(BLYNK_USE_SEND_BUFFER)
+    printf("Send buffer, %d bytes, %d rounds of N writes and one run()\n", BLYNK_SEND_BUFFER, ROUNDS);
+#else
+    printf("One write per message, %d rounds of N writes and one run()\n", ROUNDS);
+#endif
+    run(1);
+    run(5);
+    run(20);
+    return 0;
+}
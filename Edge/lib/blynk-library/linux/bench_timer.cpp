@@ -0,0 +1,75 @@
+/**
+ * @file       bench_timer.cpp
+ * @license    This project is released under the MIT License (MIT)
+ * @date       Oct 2026
+ * @brief      BlynkTimer cost with many timers
+ *
+ * 10000 interval timers between 100 ms and 10 s. The clock is simulated:
+ * run() is called once per millisecond for 60 seconds.
+ */
+
+#define BLYNK_MAX_TIMERS 10000
+
+// Built in, so the timer code sees the same BLYNK_MAX_TIMERS
+#include "../src/utility/BlynkTimer.cpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static millis_time_t simulatedMillis = 0;
+static long callbacks = 0;
+
+millis_time_t BlynkMillis()
+{
+    return simulatedMillis;
+}
+
+static void onTimer(void*)
+{
+    callbacks++;
+}
+
+static double wallTime()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static BlynkTimer timer;
+
+int main()
+{
+    const int count = BLYNK_MAX_TIMERS;
+    const int runs = 60000;
+    srand(1);
+
+    double t = wallTime();
+    for (int i = 0; i < count; i++) {
+        timer.setInterval(100 + rand() % 9900, onTimer, NULL);
+    }
+    const double insert = wallTime() - t;
+
+    t = wallTime();
+    long idle = 0;
+    for (int i = 0; i < runs; i++) {
+        simulatedMillis++;
+        idle += (timer.getNextTimeout() > 0);
+        timer.run();
+    }
+    const double run = wallTime() - t;
+
+    t = wallTime();
+    for (int i = 0; i < count; i += 2) {
+        timer.deleteTimer(i);
+    }
+    const double remove = wallTime() - t;
+
+    printf("%d timers\n", count);
+    printf("  setInterval:  %.0f ns\n", insert / count * 1e9);
+    printf("  run():        %.2f us average, %ld callbacks, %.0f ns per callback\n",
+           run / runs * 1e6, callbacks, run / callbacks * 1e9);
+    printf("  nothing due:  %ld of %d calls\n", idle, runs);
+    printf("  deleteTimer:  %.0f ns\n", remove / (count / 2) * 1e9);
+    return 0;
+}
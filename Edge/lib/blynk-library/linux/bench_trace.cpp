@@ -0,0 +1,185 @@
+/**
+ * @file       bench_trace.cpp
+ * @license    This project is released under the MIT License (MIT)
+ * @date       Oct 2026
+ * @brief      Cost of tracing messages
+ *
+ * A thread pushes virtual pin writes through a socket pair, the device
+ * answers each one with a virtualWrite, so every round traces one received
+ * and one sent message. Built three times by the Makefile: bench_trace_off
+ * without tracing, bench_trace with BLYNK_TRACE and bench_trace_debug with
+ * BLYNK_DEBUG_ALL printing to stdout. Results go to stderr, so the debug
+ * output can be sent elsewhere:
+ *
+ *   ./bench_trace_debug > /dev/null
+ *   ./bench_trace /tmp/trace.bin && ../scripts/blynk_trace.py --tail=10 /tmp/trace.bin
+ */
+
+#define BLYNK_TEMPLATE_ID             "TMPLbench"
+#define BLYNK_TEMPLATE_NAME           "Bench"
+#define BLYNK_NO_DEFAULT_BANNER
+#define BLYNK_MSG_LIMIT               0
+#define BLYNK_HEARTBEAT               3600
+
+#include <arpa/inet.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <BlynkApiLinux.h>
+#include <Blynk/BlynkProtocol.h>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <time.h>
+
+class BlynkTransportPair
+{
+public:
+    BlynkTransportPair(int fd)
+        : sockfd(fd)
+    {}
+
+    void begin(const char*, uint16_t) {}
+    bool connect()    { return true; }
+    void disconnect() {}
+    bool connected()  { return sockfd >= 0; }
+
+    int available() {
+        int count = 0;
+        return (0 == ioctl(sockfd, FIONREAD, &count)) ? count : 0;
+    }
+
+    size_t read(void* buf, size_t len) {
+        size_t got = 0;
+        while (got < len) {
+            const ssize_t r = ::read(sockfd, (uint8_t*)buf + got, len - got);
+            if (r <= 0) {
+                return r < 0 ? -1 : got;
+            }
+            got += r;
+        }
+        return got;
+    }
+
+    size_t write(const void* buf, size_t len) {
+        return ::write(sockfd, buf, len);
+    }
+
+private:
+    int sockfd;
+};
+
+class BlynkPairDevice
+    : public BlynkProtocol<BlynkTransportPair>
+{
+    typedef BlynkProtocol<BlynkTransportPair> Base;
+public:
+    BlynkPairDevice(BlynkTransportPair& transp)
+        : Base(transp)
+    {}
+
+    void begin() {
+        Base::begin("bench-token-0123456789abcdefghij");
+    }
+};
+
+static BlynkPairDevice* device = NULL;
+static long handled = 0;
+
+BLYNK_WRITE(V1)
+{
+    handled++;
+    device->virtualWrite(2, param.asInt() + 1);
+}
+
+static double wallTime()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void appendMsg(std::vector<uint8_t>& out, uint8_t type, uint16_t id, const char* body, size_t len)
+{
+    const uint8_t hdr[5] = { type, uint8_t(id >> 8), uint8_t(id), uint8_t(len >> 8), uint8_t(len) };
+    out.insert(out.end(), hdr, hdr + sizeof(hdr));
+    out.insert(out.end(), body, body + len);
+}
+
+int main(int argc, char* argv[])
+{
+    const long count = 200000;
+
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+        perror("socketpair");
+        return 1;
+    }
+
+    // Login reply, then the writes
+    std::vector<uint8_t> stream;
+    appendMsg(stream, BLYNK_CMD_RESPONSE, 1, NULL, 0);
+    stream[3] = 0;
+    stream[4] = BLYNK_SUCCESS;
+    for (long i = 0; i < count; i++) {
+        char body[32];
+        const int len = snprintf(body, sizeof(body), "vw%c1%c%ld", 0, 0, 1000000 + i);
+        appendMsg(stream, BLYNK_CMD_HARDWARE, uint16_t(i % 65535 + 1), body, len);
+    }
+
+    BlynkTransportPair transport(fds[0]);
+    BlynkPairDevice dev(transport);
+    device = &dev;
+    dev.begin();
+
+    std::thread server([&]() {
+        // Drain what the device sends so it never blocks
+        std::thread sink([&]() {
+            char buf[4096];
+            while (::read(fds[1], buf, sizeof(buf)) > 0) {}
+        });
+        for (size_t off = 0; off < stream.size(); ) {
+            const ssize_t w = ::write(fds[1], stream.data() + off, BlynkMin<size_t>(65536, stream.size() - off));
+            if (w <= 0) {
+                break;
+            }
+            off += w;
+        }
+        ::shutdown(fds[1], SHUT_WR);
+        sink.join();
+    });
+
+    const double t = wallTime();
+    while (handled < count) {
+        dev.run();
+    }
+    const double dt = wallTime() - t;
+    ::shutdown(fds[0], SHUT_RDWR);
+    server.join();
+    ::close(fds[0]);
+    ::close(fds[1]);
+
+#if defined(BLYNK_USE_TRACE)
+    const char* mode = "BLYNK_TRACE";
+#elif defined(BLYNK_DEBUG_ALL)
+    const char* mode = "BLYNK_DEBUG_ALL";
+#else
+    const char* mode = "no tracing";
+#endif
+    fprintf(stderr, "%-16s %ld rounds: %6.0f ns per round (one message in, one out)\n",
+            mode, count, dt / count * 1e9);
+
+#if defined(BLYNK_USE_TRACE)
+    if (argc > 1) {
+        if (!BlynkTraceDumpFile(argv[1])) {
+            perror(argv[1]);
+            return 1;
+        }
+        fprintf(stderr, "trace saved to %s\n", argv[1]);
+    }
+#else
+    (void)argc;
+    (void)argv;
+#endif
+    return 0;
+}
@@ -20,14 +20,20 @@
 #else
   #include <BlynkApiLinux.h>
 #endif
-#include <BlynkSocket.h>
+#include <BlynkEpoll.h>
 #include <BlynkOptionsParser.h>
+#include <BlynkMetricsHttp.h>
 
-static BlynkTransportSocket _blynkTransport;
-BlynkSocket Blynk(_blynkTransport);
+static BlynkEpollLoop _blynkLoop;
+BlynkEpollDevice Blynk(_blynkLoop);
 
 static const char *auth, *serv;
 static uint16_t port;
+static uint16_t metricsPort;
+
+#ifdef BLYNK_USE_METRICS
+static BlynkMetricsServer _metrics;
+#endif
 
 #include <BlynkWidgets.h>
 
@@ -41,21 +47,27 @@ BLYNK_WRITE(V1)
 void setup()
 {
     Blynk.begin(auth, serv, port);
+#ifdef BLYNK_USE_METRICS
+    if (metricsPort) {
+        _metrics.begin(metricsPort);
+    }
+#endif
     tmr.setInterval(1000, [](){
       Blynk.virtualWrite(V0, BlynkMillis()/1000);
     });
+    _blynkLoop.setTimer(tmr);
 }
 
 void loop()
 {
-    Blynk.run();
-    tmr.run();
+    // Sleeps until the server sends something or a timer is due
+    _blynkLoop.runOnce();
 }
 
 
 int main(int argc, char* argv[])
 {
-    parse_options(argc, argv, auth, serv, port);
+    parse_options(argc, argv, auth, serv, port, metricsPort);
 
     setup();
     while(true) {
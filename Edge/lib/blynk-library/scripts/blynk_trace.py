@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+'''
+Decodes a trace ring dump written by BlynkTraceDump (see BlynkTrace.h).
+
+examples:
+
+  Dump saved by BlynkTraceDumpFile / BlynkTraceDumpOnCrash:
+    python3 blynk_trace.py trace.bin
+
+  Only the last 50 records, times relative to the first one shown:
+    python3 blynk_trace.py --tail=50 --relative trace.bin
+
+  Raw dump captured from a serial port:
+    python3 blynk_trace.py --skip-to-magic serial.log
+
+ License:  The MIT license
+'''
+from __future__ import print_function
+
+import argparse
+import struct
+import sys
+
+MAGIC = b'BTRC'
+HEADER = struct.Struct('<4sBBHIHH')
+
+EVENTS = {
+    1: 'rx',
+    2: 'tx',
+    3: 'rx-skip',
+    4: 'connect',
+    5: 'disconnect',
+}
+
+COMMANDS = {
+    0:  'response',
+    6:  'ping',
+    15: 'bridge',
+    16: 'hw_sync',
+    17: 'internal',
+    19: 'property',
+    20: 'hardware',
+    21: 'group',
+    29: 'hw_login',
+    41: 'redirect',
+    55: 'debug_print',
+    64: 'event_log',
+    65: 'event_clear',
+}
+
+
+def render(data):
+    # Same notation as BLYNK_DBG_DUMP: text as is, other bytes as [hex|hex]
+    out = []
+    prev_print = True
+    for c in bytearray(data):
+        if 32 < c < 127:
+            if not prev_print:
+                out.append(']')
+            out.append(chr(c))
+            prev_print = True
+        else:
+            out.append('[' if prev_print else '|')
+            out.append('%02x' % c)
+            prev_print = False
+    if not prev_print:
+        out.append(']')
+    return ''.join(out)
+
+
+def decode(blob, args):
+    if args.skip_to_magic:
+        pos = blob.find(MAGIC)
+        if pos < 0:
+            sys.exit('No trace dump found')
+        blob = blob[pos:]
+
+    if len(blob) < HEADER.size:
+        sys.exit('Dump too short')
+    magic, version, record_size, data_size, count, capacity, records = HEADER.unpack_from(blob)
+    if magic != MAGIC or version != 1:
+        sys.exit('Not a trace dump (or unknown version)')
+
+    record = struct.Struct('<IBBHH%ds' % data_size)
+    if record.size > record_size:
+        sys.exit('Record size mismatch')
+
+    print('%d records written, %d kept (ring of %d), %d data bytes each'
+          % (count, records, capacity, data_size))
+    if count > records:
+        print('%d older records were overwritten' % (count - records))
+
+    first = max(0, records - args.tail) if args.tail else 0
+    base = None
+    prev = None
+    for i in range(first, records):
+        off = HEADER.size + i * record_size
+        if off + record_size > len(blob):
+            print('Dump truncated after %d records' % (i - first))
+            break
+        time, event, cmd, msg_id, length, data = record.unpack_from(blob, off)
+
+        if base is None:
+            base = time if args.relative else 0
+        dt = '' if prev is None else '+%d' % ((time - prev) & 0xFFFFFFFF)
+        prev = time
+
+        name = EVENTS.get(event, 'user+%d' % (event - 0x80) if event >= 0x80 else 'event%d' % event)
+        line = '%10d %8s  %-10s' % ((time - base) & 0xFFFFFFFF, dt, name)
+        if event in (1, 2, 3):
+            line += ' %-11s id=%-5d' % (COMMANDS.get(cmd, 'cmd%d' % cmd), msg_id)
+            if cmd == 0:
+                line += ' status=%d' % length
+            else:
+                shown = data[:min(length, data_size)]
+                line += ' len=%-4d %s%s' % (length, render(shown), '...' if length > data_size else '')
+        elif event >= 0x80:
+            line += ' cmd=%d id=%d len=%d %s' % (cmd, msg_id, length, render(data[:min(length, data_size)]))
+        print(line)
+
+
+parser = argparse.ArgumentParser(
+    formatter_class=argparse.RawTextHelpFormatter,
+    description='Decodes a Blynk trace ring dump.',
+    epilog=__doc__
+)
+parser.add_argument('dump', nargs='?', help='dump file (stdin if omitted)')
+parser.add_argument('--tail', type=int, default=0, metavar='N', help='only show the last N records')
+parser.add_argument('--relative', action='store_true', help='times relative to the first record shown')
+parser.add_argument('--skip-to-magic', action='store_true', help='skip anything before the dump header')
+
+if __name__ == '__main__':
+    args = parser.parse_args()
+    if args.dump:
+        with open(args.dump, 'rb') as f:
+            blob = f.read()
+    else:
+        blob = getattr(sys.stdin, 'buffer', sys.stdin).read()
+    decode(blob, args)
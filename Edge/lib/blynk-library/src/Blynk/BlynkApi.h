@@ -50,6 +50,11 @@
     #include <Blynk/BlynkEveryN.h>
 #endif
 
+#if defined(BLYNK_VW_BATCH) && BLYNK_VW_BATCH > 0
+    #define BLYNK_USE_VW_BATCH
+    #include <Blynk/BlynkCmdQueue.h>
+#endif
+
 /**
  * Represents high-level functions of Blynk
  */
@@ -60,7 +65,13 @@ public:
     BlynkApi()
         : groupState(GROUP_NONE)
         , groupTs(0)
+#ifdef BLYNK_USE_VW_BATCH
+        , batchStarted(0)
+#endif
     {
+#ifdef BLYNK_USE_VW_BATCH
+        memset(immediatePins, 0, sizeof(immediatePins));
+#endif
     }
 
 #ifdef DOXYGEN // These API here are only for the documentation
@@ -110,7 +121,7 @@ public:
         cmd.add("vw");
         cmd.add(pin);
         cmd.add_multi(values...);
-        static_cast<Proto*>(this)->sendCmd(BLYNK_CMD_HARDWARE, 0, cmd.getBuffer(), cmd.getLength()-1);
+        sendVirtualWrite(pin, cmd.getBuffer(), cmd.getLength()-1, NULL, 0);
     }
 
     /**
@@ -125,7 +136,7 @@ public:
         BlynkParam cmd(mem, 0, sizeof(mem));
         cmd.add("vw");
         cmd.add(pin);
-        static_cast<Proto*>(this)->sendCmd(BLYNK_CMD_HARDWARE, 0, cmd.getBuffer(), cmd.getLength(), buff, len);
+        sendVirtualWrite(pin, cmd.getBuffer(), cmd.getLength(), buff, len);
     }
 
     /**
@@ -146,17 +157,15 @@ public:
      * Command grouping
      */
     void beginGroup() {
-        if (GROUP_STARTED != groupState) {
-            groupState = GROUP_PENDING;
-            groupTs    = 0;
-        }
+        beginGroup(0);
     }
 
     void beginGroup(uint64_t timestamp) {
-        if (GROUP_STARTED != groupState) {
-            groupState = GROUP_PENDING;
-            groupTs    = timestamp;
-        }
+#ifdef BLYNK_USE_VW_BATCH
+        // Staged writes are older than anything in the group
+        flushBatch();
+#endif
+        openGroup(timestamp);
     }
 
     void endGroup() {
@@ -169,6 +178,35 @@ public:
         groupState = GROUP_NONE;
     }
 
+#ifdef BLYNK_USE_VW_BATCH
+    /**
+     * Write batching
+     *
+     * Virtual pin writes are staged and sent every BLYNK_VW_BATCH_MS by
+     * run(), as one group when there are several. A pin written again
+     * before that only sends its last value. Writes inside a manual group,
+     * larger than BLYNK_MAX_SENDBYTES, or to an immediate pin go out right
+     * away, and so do all other commands: they may overtake staged writes.
+     */
+    void setImmediate(int pin, bool immediate = true) {
+        if (pin < 0 || pin >= 256) {
+            return;
+        }
+        if (immediate) {
+            immediatePins[pin / 8] |=  (1 << (pin % 8));
+        } else {
+            immediatePins[pin / 8] &= ~(1 << (pin % 8));
+        }
+    }
+
+    bool isImmediate(int pin) const {
+        return pin < 0 || pin >= 256 || (immediatePins[pin / 8] & (1 << (pin % 8)));
+    }
+
+    // Send staged writes now
+    void flushBatch();
+#endif
+
     /**
      * Handler helpers
      */
@@ -341,6 +379,45 @@ protected:
     void processCmd(const void* buff, size_t len);
     void sendInfo();
 
+    void openGroup(uint64_t timestamp) {
+        if (GROUP_STARTED != groupState) {
+            groupState = GROUP_PENDING;
+            groupTs    = timestamp;
+        }
+    }
+
+    void sendVirtualWrite(int pin, const void* data, size_t length, const void* data2, size_t length2) {
+#ifdef BLYNK_USE_VW_BATCH
+        if (stageWrite(pin, data, length, data2, length2)) {
+            return;
+        }
+#else
+        (void)pin;
+#endif
+        static_cast<Proto*>(this)->sendCmd(BLYNK_CMD_HARDWARE, 0, data, length, data2, length2);
+    }
+
+#ifdef BLYNK_USE_VW_BATCH
+    bool stageWrite(int pin, const void* data, size_t length, const void* data2, size_t length2);
+
+    // Called by run(), flushes the batch once it is due
+    void runBatch() {
+        bool due;
+        {
+            BLYNK_MUTEX_GUARD(batchMutex);
+            due = !batch.empty() && BlynkMillis() - batchStarted >= BLYNK_VW_BATCH_MS;
+        }
+        if (due) {
+            flushBatch();
+        }
+    }
+
+    void clearBatch() {
+        BLYNK_MUTEX_GUARD(batchMutex);
+        batch.clear();
+    }
+#endif
+
     void sendPendingGroup() {
         if (GROUP_PENDING == groupState) {
             // Set groupState here as sendCmd is recursive
@@ -368,7 +445,76 @@ protected:
     } groupState;
     uint64_t groupTs;
 
+#ifdef BLYNK_USE_VW_BATCH
+    BlynkCmdQueue<BLYNK_VW_BATCH> batch;
+    millis_time_t batchStarted;
+    uint8_t       immediatePins[32];
+    BLYNK_MUTEX_DECL(batchMutex);
+#endif
+
 };
 
+#ifdef BLYNK_USE_VW_BATCH
+
+template <class Proto>
+bool BlynkApi<Proto>::stageWrite(int pin, const void* data, size_t length, const void* data2, size_t length2)
+{
+    const size_t total = length + (data2 ? length2 : 0);
+    if (GROUP_NONE != groupState || isImmediate(pin) || total > BLYNK_MAX_SENDBYTES) {
+        return false;
+    }
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        {
+            BLYNK_MUTEX_GUARD(batchMutex);
+            if (batch.fits(total)) {
+                if (batch.empty()) {
+                    batchStarted = BlynkMillis();
+                }
+                return batch.push(BLYNK_CMD_HARDWARE, 0, data, length, data2, length2);
+            }
+        }
+        // No room left: send what is staged and try again
+        flushBatch();
+    }
+    return false;
+}
+
+template <class Proto>
+void BlynkApi<Proto>::flushBatch()
+{
+    bool grouped;
+    {
+        BLYNK_MUTEX_GUARD(batchMutex);
+        if (batch.empty()) {
+            return;
+        }
+        grouped = !batch.single() && GROUP_NONE == groupState;
+    }
+
+    if (grouped) {
+        openGroup(0);
+    }
+    // Entries are copied out, so writes made while sending can't upset the batch
+    char mem[BLYNK_MAX_SENDBYTES];
+    for (;;) {
+        size_t len;
+        {
+            BLYNK_MUTEX_GUARD(batchMutex);
+            if (batch.empty()) {
+                break;
+            }
+            len = batch.front().length;
+            memcpy(mem, batch.frontData(), len);
+            batch.pop();
+        }
+        static_cast<Proto*>(this)->sendCmd(BLYNK_CMD_HARDWARE, 0, mem, len);
+    }
+    if (grouped) {
+        endGroup();
+    }
+}
+
+#endif
 
 #endif
@@ -0,0 +1,201 @@
+/**
+ * @file       BlynkCmdQueue.h
+ * @license    This project is released under the MIT License (MIT)
+ * @date       Oct 2026
+ * @brief      Bounded queue of outgoing commands
+ *
+ */
+
+#ifndef BlynkCmdQueue_h
+#define BlynkCmdQueue_h
+
+#include <string.h>
+#include <stdlib.h>
+#include <Blynk/BlynkProtocolDefs.h>
+
+/*
+ * Commands are stored back to back in a fixed byte pool, each as a small
+ * header followed by the body. A virtual pin write replaces the queued
+ * write to the same pin (last value wins), unless a group marker lies
+ * between them: grouped values are history and must all be kept. When the
+ * pool is full the oldest commands make room for the newest, a complete
+ * group counting as one so its begin and end markers go together. A group
+ * still being written is never cut: a command that would need that is
+ * rejected, and an end marker that does not fit drops the whole group.
+ */
+template <size_t N>
+class BlynkCmdQueue
+{
+public:
+    struct Entry {
+        uint8_t  cmd;
+        uint16_t id;
+        uint16_t length;
+        int16_t  pin;       // Virtual pin of a "vw" command, -1 otherwise
+    } BLYNK_ATTR_PACKED;
+
+    BlynkCmdQueue()
+        : used(0), dropped(0)
+    {}
+
+    bool empty() const { return used == 0; }
+    size_t size() const { return used; }
+    size_t droppedCount() const { return dropped; }
+
+    // True if a command with this much data is queued without dropping any
+    bool fits(size_t length) const { return used + sizeof(Entry) + length <= N; }
+    bool single() const { return used && used == sizeof(Entry) + front().length; }
+
+    void clear() { used = 0; }
+
+    const Entry& front() const { return *(const Entry*)pool; }
+    const uint8_t* frontData() const { return pool + sizeof(Entry); }
+
+    void pop() {
+        if (used) {
+            remove(0);
+        }
+    }
+
+    bool push(uint8_t cmd, uint16_t id, const void* data, size_t length, const void* data2, size_t length2) {
+        length  = data  ? length  : 0;
+        length2 = data2 ? length2 : 0;
+        const size_t total = sizeof(Entry) + length + length2;
+        if (total > N) {
+            dropped++;
+            return false;
+        }
+
+        const int16_t pin = vwPin(cmd, (const char*)data, length);
+        if (pin >= 0) {
+            size_t match = N;
+            for (size_t pos = 0; pos < used; pos += entrySize(pos)) {
+                const Entry& e = at(pos);
+                if (e.cmd == BLYNK_CMD_GROUP) {
+                    match = N;
+                } else if (e.cmd == cmd && e.pin == pin) {
+                    match = pos;
+                }
+            }
+            if (match != N) {
+                remove(match);
+            }
+        }
+
+        while (used + total > N) {
+            if (!evictOldest()) {
+                if (isGroupEnd(cmd, (const uint8_t*)data, length)) {
+                    dropOpenGroup();
+                }
+                dropped++;
+                return false;
+            }
+        }
+
+        Entry e;
+        e.cmd = cmd;
+        e.id = id;
+        e.length = length + length2;
+        e.pin = pin;
+        memcpy(pool + used, &e, sizeof(e));
+        if (length) {
+            memcpy(pool + used + sizeof(e), data, length);
+        }
+        if (length2) {
+            memcpy(pool + used + sizeof(e) + length, data2, length2);
+        }
+        used += total;
+        return true;
+    }
+
+private:
+    static int16_t vwPin(uint8_t cmd, const char* data, size_t length) {
+        if (cmd != BLYNK_CMD_HARDWARE || length < 4 || memcmp(data, "vw\0", 3) != 0 ||
+            !memchr(data + 3, '\0', length - 3))
+        {
+            return -1;
+        }
+        return atoi(data + 3);
+    }
+
+    static bool isGroupStart(uint8_t cmd, const uint8_t* data, size_t length) {
+        return cmd == BLYNK_CMD_GROUP && length && data[0] != 'e';
+    }
+
+    static bool isGroupEnd(uint8_t cmd, const uint8_t* data, size_t length) {
+        return cmd == BLYNK_CMD_GROUP && length && data[0] == 'e';
+    }
+
+    bool isGroupStart(size_t pos) const {
+        return isGroupStart(at(pos).cmd, pool + pos + sizeof(Entry), at(pos).length);
+    }
+
+    bool isGroupEnd(size_t pos) const {
+        return isGroupEnd(at(pos).cmd, pool + pos + sizeof(Entry), at(pos).length);
+    }
+
+    // Drops the oldest command, or the oldest group as a whole. An end marker
+    // in front closes a group that is already on the wire, so it stays.
+    bool evictOldest() {
+        size_t pos = 0;
+        if (used && isGroupEnd(pos)) {
+            pos += entrySize(pos);
+        }
+        if (pos >= used) {
+            return false;
+        }
+
+        size_t end = pos + entrySize(pos);
+        if (isGroupStart(pos)) {
+            while (end < used && !isGroupEnd(end)) {
+                end += entrySize(end);
+            }
+            if (end >= used) {
+                return false; // Still being written
+            }
+            end += entrySize(end);
+        }
+        dropped += removeRange(pos, end);
+        return true;
+    }
+
+    // Drops the group still being written, from its begin marker on
+    void dropOpenGroup() {
+        size_t start = used;
+        for (size_t pos = 0; pos < used; pos += entrySize(pos)) {
+            if (isGroupStart(pos)) {
+                start = pos;
+            } else if (isGroupEnd(pos)) {
+                start = used;
+            }
+        }
+        dropped += removeRange(start, used);
+    }
+
+    const Entry& at(size_t pos) const { return *(const Entry*)(pool + pos); }
+
+    size_t entrySize(size_t pos) const {
+        return sizeof(Entry) + at(pos).length;
+    }
+
+    void remove(size_t pos) {
+        removeRange(pos, pos + entrySize(pos));
+    }
+
+    // Removes the commands between two entry offsets, returns how many
+    size_t removeRange(size_t pos, size_t end) {
+        size_t count = 0;
+        for (size_t p = pos; p < end; p += entrySize(p)) {
+            count++;
+        }
+        memmove(pool + pos, pool + end, used - end);
+        used -= end - pos;
+        return count;
+    }
+
+    uint8_t pool[N];
+    size_t  used;
+    size_t  dropped;
+};
+
+#endif
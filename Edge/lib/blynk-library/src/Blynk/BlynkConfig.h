@@ -43,6 +43,23 @@
 #define BLYNK_MSG_LIMIT      15
 #endif
 
+// Commands over the limit wait in a queue drained by run() (in bytes),
+// the oldest are dropped when it is full. 0 blocks the caller until the
+// command may be sent instead.
+#ifndef BLYNK_MSG_QUEUE
+#define BLYNK_MSG_QUEUE      0
+#endif
+
+// Stage virtual pin writes and send them together every BLYNK_VW_BATCH_MS,
+// the last value per pin wins (in bytes, 0 sends each write right away).
+#ifndef BLYNK_VW_BATCH
+#define BLYNK_VW_BATCH       0
+#endif
+
+#ifndef BLYNK_VW_BATCH_MS
+#define BLYNK_VW_BATCH_MS    100
+#endif
+
 // Limit the incoming command length.
 #ifndef BLYNK_MAX_READBYTES
 #define BLYNK_MAX_READBYTES  256
@@ -87,4 +104,20 @@
 // Wait after sending each chunk (in milliseconds)
 //#define BLYNK_SEND_THROTTLE 10
 
+// Coalesce outgoing commands into one write (in bytes, flushed by run())
+//#define BLYNK_SEND_BUFFER 1024
+
+// Read input in chunks and handle messages in place (in bytes, must hold
+// BLYNK_MAX_READBYTES + 6), larger messages are skipped instead of
+// dropping the connection
+//#define BLYNK_RECV_BUFFER 1024
+
+// Record sent and received messages into a binary ring of this many
+// entries (a power of two), see BlynkTrace.h
+//#define BLYNK_TRACE 256
+
+// Keep counters, gauges and histograms for up to this many series, see
+// BlynkMetrics.h. Define it for the whole build, not here.
+//#define BLYNK_METRICS 64
+
 #endif
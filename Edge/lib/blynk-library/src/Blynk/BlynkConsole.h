@@ -13,28 +13,32 @@
 
 #include <Blynk/BlynkDebug.h>
 #include <Blynk/BlynkParam.h>
+#include <Blynk/BlynkUtility.h>
 
 #define BLYNK_CONSOLE_MAX_COMMANDS 64
 #define BLYNK_CONSOLE_INPUT_BUFFER 256
 #define BLYNK_CONSOLE_USE_STREAM
 
+// Room for a handler's captures, bigger callables are allocated once
+#ifndef BLYNK_CONSOLE_HANDLER_SIZE
+#define BLYNK_CONSOLE_HANDLER_SIZE (2*sizeof(void*))
+#endif
+
 #ifdef BLYNK_CONSOLE_USE_STREAM
   #include <stdarg.h>
 #endif
 
+/*
+ * Commands are kept sorted by name, so a line is dispatched with a binary
+ * search instead of comparing it to every command. Handlers may be plain
+ * functions or lambdas, captures are stored inside the command table.
+ * Input is tokenized in place: arguments are unescaped and packed back to
+ * back in the input buffer, which then doubles as the BlynkParam buffer.
+ */
 class BlynkConsole
 {
 private:
 
-#ifdef BLYNK_HAS_FUNCTIONAL_H
-    typedef std::function<void(void)> HandlerSimp;
-    typedef std::function<void(int argc, const char** argv)> HandlerArgs;
-    typedef std::function<void(const BlynkParam &param)> HandlerParams;
-#else
-    typedef void (*HandlerSimp)();
-    typedef void (*HandlerArgs)(int argc, const char** argv);
-    typedef void (*HandlerParams)(const BlynkParam &param);
-#endif
     enum HandlerType {
         SIMPLE,
         WITH_ARGS,
@@ -42,31 +46,30 @@ private:
         SUB_CONSOLE
     };
 
+    typedef void (*Invoker)(void* fn, int argc, const char** argv, const char* end);
+
     class CmdHandler {
     public:
         const char* cmd;
         HandlerType type;
+        Invoker     invoke;
         union {
-            HandlerSimp*    f_simp;
-            HandlerArgs*    f_args;
-            HandlerParams*  f_params;
-            BlynkConsole*   f_cons;
+            BlynkConsole* f_cons;
+            void*         f_ptr;
+            long long     f_align;
+            double        f_alignd;
+            uint8_t       fn[BLYNK_CONSOLE_HANDLER_SIZE];
         };
-        CmdHandler() = default;
-        CmdHandler(const char* s, HandlerSimp* f)
-            : cmd(s), type(SIMPLE), f_simp(f)
-        {}
-        CmdHandler(const char* s, HandlerArgs* f)
-            : cmd(s), type(WITH_ARGS), f_args(f)
-        {}
-        CmdHandler(const char* s, HandlerParams* f)
-            : cmd(s), type(WITH_PARAMS), f_params(f)
-        {}
-        CmdHandler(const char* s, BlynkConsole* f)
-            : cmd(s), type(SUB_CONSOLE), f_cons(f)
-        {}
     };
 
+    template <typename F>
+    struct FitsInline {
+        static const bool value = sizeof(F) <= BLYNK_CONSOLE_HANDLER_SIZE &&
+                                  __is_trivially_copyable(F);
+    };
+
+    template <bool B> struct Tag {};
+
 public:
     
     enum ProcessResult {
@@ -79,20 +82,9 @@ public:
     BlynkConsole() {
         reset_buff();
 
-#if defined(BLYNK_CONSOLE_USE_STREAM) && defined(BLYNK_HAS_FUNCTIONAL_H)
-        help = [=]() {
-            if (!stream) return;
-            stream->print("Available commands: ");
-            for (size_t i=0; i<commandsQty; i++) {
-                CmdHandler& handler = commands[i];
-                stream->print(handler.cmd);
-                if (i < commandsQty-1) { stream->print(", "); }
-            }
-            stream->println();
-        };
-        
-        addCommand("help", help);
-        addCommand("?", help);
+#if defined(BLYNK_CONSOLE_USE_STREAM)
+        addCommand("help", [this]() { printHelp(); });
+        addCommand("?",    [this]() { printHelp(); });
 #endif
 
     }
@@ -122,27 +114,34 @@ public:
     }
 #endif
 
-    void addCommand(const char* cmd, HandlerSimp h) {
-        if (commandsQty >= BLYNK_CONSOLE_MAX_COMMANDS) return;
-        commands[commandsQty++] = CmdHandler(cmd, new HandlerSimp(h));
+    // void handler()
+    template <typename F>
+    auto addCommand(const char* cmd, F h) -> decltype(h(), void()) {
+        add(cmd, SIMPLE, h, &callSimp<F>);
     }
 
-    void addCommand(const char* cmd, HandlerArgs h) {
-        if (commandsQty >= BLYNK_CONSOLE_MAX_COMMANDS) return;
-        commands[commandsQty++] = CmdHandler(cmd, new HandlerArgs(h));
+    // void handler(int argc, const char** argv)
+    template <typename F>
+    auto addCommand(const char* cmd, F h) -> decltype(h(0, (const char**)NULL), void()) {
+        add(cmd, WITH_ARGS, h, &callArgs<F>);
     }
 
-    void addCommand(const char* cmd, HandlerParams h) {
-        if (commandsQty >= BLYNK_CONSOLE_MAX_COMMANDS) return;
-        commands[commandsQty++] = CmdHandler(cmd, new HandlerParams(h));
+    // void handler(const BlynkParam& param)
+    template <typename F>
+    auto addCommand(const char* cmd, F h) -> decltype(h(*(const BlynkParam*)NULL), void()) {
+        add(cmd, WITH_PARAMS, h, &callParams<F>);
     }
 
     void addCommand(const char* cmd, BlynkConsole* h) {
-        if (commandsQty >= BLYNK_CONSOLE_MAX_COMMANDS || !h) return;
+        if (!h) return;
+        CmdHandler* handler = insert(cmd);
+        if (!handler) return;
 #ifdef BLYNK_CONSOLE_USE_STREAM
         h->begin(stream);
 #endif
-        commands[commandsQty++] = CmdHandler(cmd, h);
+        handler->type = SUB_CONSOLE;
+        handler->invoke = NULL;
+        handler->f_cons = h;
     }
 
     void addCommand(const char* cmd, BlynkConsole& h) {
@@ -150,7 +149,7 @@ public:
     }
 
     ProcessResult process(char c) {
-        if (cmdPtr >= cmdBuff+sizeof(cmdBuff)) {
+        if (cmdPtr >= cmdBuff+sizeof(cmdBuff)-1) {
             reset_buff();
         }
 
@@ -162,59 +161,117 @@ public:
     }
 
     ProcessResult runCommand(const char* cmd) {
-        strncpy(cmdBuff, cmd, sizeof(cmdBuff));
-        cmdBuff[sizeof(cmdBuff)-1] = '\0';
-        cmdPtr = cmdBuff + strlen(cmdBuff);
+        const size_t len = BlynkMin(strlen(cmd), sizeof(cmdBuff)-1);
+        memcpy(cmdBuff, cmd, len);
+        cmdPtr = cmdBuff + len;
         return runCommandInBuff();
     }
 
 private:
 
     ProcessResult runCommandInBuff() {
+        *cmdPtr = '\0';
         char* argv[16];
-        int argc = split_argv(cmdBuff, argv, 16);
+        char* end;
+        int argc = split_argv(cmdBuff, argv, 16, &end);
         if (argc <= 0) {
+            reset_buff();
             return SKIPPED;
         }
 #ifdef BLYNK_CONSOLE_USE_STREAM
         if (stream) stream->println();
 #endif
-        ProcessResult ret = runCommand(argc, (const char**)argv);
+        ProcessResult ret = runCommand(argc, (const char**)argv, end);
         reset_buff();
         return ret;
     }
 
-    ProcessResult runCommand(int argc, const char** argv) {
-        for (size_t i=0; i<commandsQty; i++) {
-            CmdHandler& handler = commands[i];
-            if (!strncasecmp(argv[0], handler.cmd, strlen(handler.cmd)+1)) {
-                switch (handler.type) {
-                case SIMPLE:
-                    (*(handler.f_simp))();
-                    break;
-                case WITH_ARGS:
-                    (*(handler.f_args))(argc-1, (const char**)(argv+1));
-                    break;
-                case WITH_PARAMS: {
-                    size_t len = (cmdPtr - cmdBuff);
-                    if (len > 0 && len < BLYNK_CONSOLE_INPUT_BUFFER) {
-                        char mem[len];
-                        BlynkParam param(mem, 0, sizeof(mem));
-                        for (int i = 1; i < argc; i++) {
-                            param.add(argv[i]);
-                        }
-                        (*(handler.f_params))(param);
-                    }
-                    break;
-                }
-                case SUB_CONSOLE:
-                    if (argc < 2) return NOT_FOUND;
-                    return handler.f_cons->runCommand(argc-1, (const char**)(argv+1));
-                }
-                return EXECUTED;
+    ProcessResult runCommand(int argc, const char** argv, const char* end) {
+        bool found;
+        const size_t i = lower_bound(argv[0], found);
+        if (!found) {
+            return NOT_FOUND;
+        }
+        CmdHandler& handler = commands[i];
+        if (handler.type == SUB_CONSOLE) {
+            if (argc < 2) return NOT_FOUND;
+            return handler.f_cons->runCommand(argc-1, argv+1, end);
+        }
+        handler.invoke(handler.fn, argc-1, argv+1, end);
+        return EXECUTED;
+    }
+
+    // Index of cmd, or of the slot where it belongs
+    size_t lower_bound(const char* cmd, bool& found) const {
+        size_t lo = 0, hi = commandsQty;
+        while (lo < hi) {
+            const size_t mid = (lo + hi) / 2;
+            const int c = strcasecmp(commands[mid].cmd, cmd);
+            if (c == 0) {
+                found = true;
+                return mid;
+            }
+            if (c < 0) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
             }
         }
-        return NOT_FOUND;
+        found = false;
+        return lo;
+    }
+
+    // First registration of a name wins, as it did with the linear scan
+    CmdHandler* insert(const char* cmd) {
+        if (commandsQty >= BLYNK_CONSOLE_MAX_COMMANDS) return NULL;
+        bool found;
+        const size_t i = lower_bound(cmd, found);
+        if (found) return NULL;
+        memmove(&commands[i+1], &commands[i], (commandsQty-i)*sizeof(CmdHandler));
+        commandsQty++;
+        commands[i].cmd = cmd;
+        return &commands[i];
+    }
+
+    template <typename F>
+    void add(const char* cmd, HandlerType type, const F& h, Invoker invoke) {
+        CmdHandler* handler = insert(cmd);
+        if (!handler) return;
+        handler->type = type;
+        handler->invoke = invoke;
+        store(handler->fn, h, Tag<FitsInline<F>::value>());
+    }
+
+    template <typename F>
+    static void store(uint8_t* fn, const F& h, Tag<true>) {
+        memcpy(fn, &h, sizeof(F));
+    }
+
+    template <typename F>
+    static void store(uint8_t* fn, const F& h, Tag<false>) {
+        F* p = new F(h);
+        memcpy(fn, &p, sizeof(p));
+    }
+
+    template <typename F>
+    static F& target(void* fn) {
+        return FitsInline<F>::value ? *(F*)fn : **(F**)fn;
+    }
+
+    template <typename F>
+    static void callSimp(void* fn, int, const char**, const char*) {
+        target<F>(fn)();
+    }
+
+    template <typename F>
+    static void callArgs(void* fn, int argc, const char** argv, const char*) {
+        target<F>(fn)(argc, argv);
+    }
+
+    template <typename F>
+    static void callParams(void* fn, int argc, const char** argv, const char* end) {
+        const BlynkParam param(argc ? argv[0] : "", argc ? end - argv[0] : 0);
+        target<F>(fn)(param);
     }
 
 public:
@@ -261,71 +318,73 @@ private:
 
 #ifdef BLYNK_CONSOLE_USE_STREAM
     Stream* stream = nullptr;
-    HandlerSimp help;
+
+    void printHelp() {
+        if (!stream) return;
+        stream->print("Available commands: ");
+        for (size_t i=0; i<commandsQty; i++) {
+            stream->print(commands[i].cmd);
+            if (i < commandsQty-1) { stream->print(", "); }
+        }
+        stream->println();
+    }
 #endif
 
     void reset_buff() {
-        memset(cmdBuff, 0, sizeof(cmdBuff));
+        cmdBuff[0] = '\0';
         cmdPtr = cmdBuff;
     }
 
     static
-    void unescape(char* buff)
+    bool is_space(char c) {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+    }
+
+    /*
+     * Splits str into unescaped arguments, moving each one down so they
+     * follow each other with a single '\0' between them. end is set past
+     * the last '\0'. Writing never overtakes reading, so no copy is needed.
+     */
+    static
+    int split_argv(char *str, char** argv, int argv_capacity, char** end)
     {
-        char* outp = buff;
-        while (*buff) {
-            if (*buff == '\\') {
-                switch (*(buff+1)) {
-                case '0':  *outp++ = '\0'; break;
-                case 'b':  *outp++ = '\b'; break;
-                case 'n':  *outp++ = '\n'; break;
-                case 'r':  *outp++ = '\r'; break;
-                case 't':  *outp++ = '\t'; break;
+        int result = 0;
+        const char* in = str;
+        char* out = str;
+        while (result < (argv_capacity-1)) {
+            while (is_space(*in)) in++;
+            if (!*in) break;
+
+            argv[result++] = out;
+            while (*in && !is_space(*in)) {
+                if (*in != '\\' || !in[1]) {
+                    *out++ = *in++;
+                    continue;
+                }
+                switch (in[1]) {
+                case '0':  *out++ = '\0'; break;
+                case 'b':  *out++ = '\b'; break;
+                case 'n':  *out++ = '\n'; break;
+                case 'r':  *out++ = '\r'; break;
+                case 't':  *out++ = '\t'; break;
                 case 'x': {
-                    char hex[3] = { *(buff+2), *(buff+3), '\0' };
-                    *outp = strtol(hex, NULL, 16);
-                    buff += 2; outp += 1;
+                    char hex[3] = { in[2], in[2] ? in[3] : '\0', '\0' };
+                    char* hexEnd;
+                    *out++ = strtol(hex, &hexEnd, 16);
+                    in += hexEnd - hex;
                     break;
                 }
                 // Otherwise just pass the letter
                 // Also handles '\\'
-                default: *outp++ = *(buff+1); break;
+                default: *out++ = in[1]; break;
                 }
-                buff += 2;
-            } else {
-                *outp++ = *buff++;
+                in += 2;
             }
+            if (*in) in++;
+            *out++ = '\0';
         }
-        *outp = '\0';
-    }
-    
-    static
-    int split_argv(char *str, char** argv, int argv_capacity)
-    {
-        int result = 0;
-        char* curr = str;
-        int len = 0;
-        memset(argv, 0, sizeof(char*)*argv_capacity);
-        for (int i = 0; str[i] != '\0' && result < (argv_capacity-1); i++) {
-            if (strchr(" \n\r\t", str[i])) {
-                if (len) {  // Found space after non-space
-                    str[i] = '\0';
-                    unescape(curr);
-                    argv[result++] = curr;
-                    len = 0;
-                }
-            } else {
-                if (!len) { // Found non-space after space
-                    curr = &str[i];
-                }
-                len++;
-            }
-        }
-        // Add final argument, if needed
-        if (len && result < (argv_capacity-1)) {
-            unescape(curr);
-            argv[result++] = curr;
-        }
+        argv[result] = NULL;
+        *end = out;
         return result;
     }
 
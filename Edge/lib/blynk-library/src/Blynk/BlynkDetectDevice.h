@@ -108,6 +108,18 @@
         #define BLYNK_INFO_DEVICE  "Linux"
         #define BLYNK_USE_128_VPINS
         #define BLYNK_BUFFERS_SIZE 4096
+        #ifndef BLYNK_SEND_BUFFER
+        #define BLYNK_SEND_BUFFER  1024
+        #endif
+        #ifndef BLYNK_RECV_BUFFER
+        #define BLYNK_RECV_BUFFER  (BLYNK_MAX_READBYTES * 2)
+        #endif
+        #ifndef BLYNK_MSG_QUEUE
+        #define BLYNK_MSG_QUEUE    256
+        #endif
+        #ifndef BLYNK_MAX_TIMERS
+        #define BLYNK_MAX_TIMERS   256
+        #endif
 
     #elif defined(SPARK) || defined(PARTICLE)
 
@@ -225,6 +237,12 @@
 
         #if defined(ESP32)
             #define BLYNK_NO_ANALOG_PINS
+            #ifndef BLYNK_MAX_TIMERS
+            #define BLYNK_MAX_TIMERS 64
+            #endif
+            #ifndef BLYNK_MSG_QUEUE
+            #define BLYNK_MSG_QUEUE  256
+            #endif
         #endif
 
         #if defined(ARDUINO_ARCH_AVR)
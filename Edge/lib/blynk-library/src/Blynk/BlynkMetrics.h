@@ -0,0 +1,634 @@
+/**
+ * @file       BlynkMetrics.h
+ * @license    This project is released under the MIT License (MIT)
+ * @date       Oct 2026
+ * @brief      Counters, gauges and histograms with Prometheus text output
+ *
+ */
+
+#ifndef BlynkMetrics_h
+#define BlynkMetrics_h
+
+#include <string.h>
+#include <stdint.h>
+
+/*
+ * With BLYNK_METRICS set, up to that many series can be registered:
+ * counters, gauges and histograms with fixed bucket bounds. Registering
+ * returns a small handle, updating through it is an add to a memory cell,
+ * nothing is locked or formatted. BlynkMetricsWrite() prints all series in
+ * the Prometheus text format, linux/BlynkMetricsHttp.h serves that to a
+ * scraper.
+ *
+ * Values are integers. A series registered with decimals = 3 (up to 9) is
+ * printed divided by 1000, so a time kept in ms is exported in seconds, as
+ * Prometheus expects, without floating point on the device.
+ *
+ * Under LINUX or BLYNK_MULTITHREADED each thread adds into cells of its own,
+ * allocated on its first update, and the exporter sums them: writers share
+ * no cache lines and need no locked read-modify-write. Gauges are set, not
+ * summed, so they live in one shared set of cells.
+ *
+ * Without BLYNK_METRICS the handles are empty and updates compile to
+ * nothing, so instrumented code needs no #ifdefs. Define it for the whole
+ * build (BlynkTimer.cpp records too), not in one source file.
+ */
+
+typedef uint8_t BlynkMetricDecimals;
+
+#if defined(LINUX)
+typedef int64_t BlynkMetricValue;
+#else
+typedef long BlynkMetricValue;
+#endif
+
+#if defined(BLYNK_METRICS) && BLYNK_METRICS > 0
+#define BLYNK_USE_METRICS
+
+#include <Blynk/BlynkDebug.h>
+#include <Blynk/BlynkNumber.h>
+
+// Value cells, a histogram takes its bucket count plus two
+#ifndef BLYNK_METRICS_CELLS
+#define BLYNK_METRICS_CELLS (BLYNK_METRICS * 2)
+#endif
+
+// Distinct metric names
+#ifndef BLYNK_METRICS_FAMILIES
+#define BLYNK_METRICS_FAMILIES 32
+#endif
+
+#ifndef BLYNK_METRICS_BUCKETS
+#define BLYNK_METRICS_BUCKETS 16
+#endif
+
+// Text is formatted in chunks of this size before it is handed to the output
+#ifndef BLYNK_METRICS_WRITE_BUFFER
+#define BLYNK_METRICS_WRITE_BUFFER 256
+#endif
+
+#if defined(__has_include)
+    #if __has_include(<atomic>)
+        #define BLYNK_HAS_ATOMIC_H
+    #endif
+#endif
+
+#if defined(BLYNK_HAS_ATOMIC_H) && (defined(BLYNK_MULTITHREADED) || defined(LINUX))
+    #include <atomic>
+    #include <mutex>
+    #define BLYNK_METRICS_THREADS
+#endif
+
+enum BlynkMetricType {
+    BLYNK_METRIC_COUNTER   = 0,
+    BLYNK_METRIC_GAUGE     = 1,
+    BLYNK_METRIC_HISTOGRAM = 2
+};
+
+// Cell 0 and 1 take the updates of handles that could not be registered
+#define BLYNK_METRICS_DISCARD 2
+
+template <class T>
+struct BlynkMetricAtomic {
+#ifdef BLYNK_METRICS_THREADS
+    std::atomic<T> v;
+
+    T get() const { return v.load(std::memory_order_relaxed); }
+    void set(T x) { v.store(x, std::memory_order_relaxed); }
+    // Only the thread owning the cell adds to it, a plain load and store do
+    void add(T x) { v.store(v.load(std::memory_order_relaxed) + x, std::memory_order_relaxed); }
+    void addShared(T x) { v.fetch_add(x, std::memory_order_relaxed); }
+    T acquire() const { return v.load(std::memory_order_acquire); }
+    void release(T x) { v.store(x, std::memory_order_release); }
+#else
+    volatile T v;
+
+    T get() const { return v; }
+    void set(T x) { v = x; }
+    void add(T x) { v = v + x; }
+    void addShared(T x) { v = v + x; }
+    T acquire() const { return v; }
+    void release(T x) { v = x; }
+#endif
+};
+
+typedef BlynkMetricAtomic<BlynkMetricValue> BlynkMetricCell;
+
+struct BlynkMetricShard {
+    BlynkMetricShard* next;
+    BlynkMetricCell   cells[BLYNK_METRICS_CELLS];
+};
+
+struct BlynkMetricSeries {
+    const char* name;
+    const char* help;
+    const char* labels;     // Without braces, e.g. "node=\"3\"", or NULL
+    const BlynkMetricValue* bounds; // Histogram bucket upper bounds, ascending
+    uint32_t    cell;       // First value cell
+    BlynkMetricAtomic<int32_t> next; // Next series with the same name, -1 ends
+    uint8_t     type;
+    uint8_t     buckets;    // Histogram bounds, the +Inf bucket comes on top
+    uint8_t     decimals;
+    bool        first;      // First series with its name, prints HELP and TYPE
+};
+
+struct BlynkMetricsRegistry {
+    BlynkMetricSeries series[BLYNK_METRICS];
+    BlynkMetricAtomic<uint32_t> count;  // Series visible to the exporter
+    uint32_t cells;                     // Value cells handed out
+    uint32_t families;
+    int32_t  familyTail[BLYNK_METRICS_FAMILIES];
+    BlynkMetricShard shared;            // Gauges, and everything without threads
+#ifdef BLYNK_METRICS_THREADS
+    std::atomic<BlynkMetricShard*> shards;
+    std::mutex lock;
+#endif
+};
+
+// A template, so the header alone defines the registry once per program
+template <int N>
+struct BlynkMetricsStorage {
+    static BlynkMetricsRegistry registry;
+};
+
+template <int N>
+BlynkMetricsRegistry BlynkMetricsStorage<N>::registry;
+
+#ifdef BLYNK_METRICS_THREADS
+
+inline
+BlynkMetricShard* BlynkMetricsAddShard()
+{
+    BlynkMetricsRegistry& reg = BlynkMetricsStorage<0>::registry;
+    BlynkMetricShard* shard = new BlynkMetricShard();
+    shard->next = reg.shards.load(std::memory_order_relaxed);
+    while (!reg.shards.compare_exchange_weak(shard->next, shard,
+                                             std::memory_order_release,
+                                             std::memory_order_relaxed))
+    {}
+    return shard;
+}
+
+// Cells of the calling thread. They stay in the sums after the thread ends.
+inline
+BlynkMetricShard& BlynkMetricsLocal()
+{
+    static __thread BlynkMetricShard* mine = NULL;
+    if (!mine) {
+        mine = BlynkMetricsAddShard();
+    }
+    return *mine;
+}
+
+#else
+
+inline
+BlynkMetricShard& BlynkMetricsLocal()
+{
+    return BlynkMetricsStorage<0>::registry.shared;
+}
+
+#endif
+
+inline
+BlynkMetricShard& BlynkMetricsShared()
+{
+    return BlynkMetricsStorage<0>::registry.shared;
+}
+
+class BlynkCounter
+{
+public:
+    BlynkCounter() : cell(0) {}
+    explicit BlynkCounter(uint32_t c) : cell(c) {}
+
+    void inc(BlynkMetricValue n = 1) const {
+        BlynkMetricsLocal().cells[cell].add(n);
+    }
+
+private:
+    uint32_t cell;
+};
+
+class BlynkGauge
+{
+public:
+    BlynkGauge() : cell(0) {}
+    explicit BlynkGauge(uint32_t c) : cell(c) {}
+
+    void set(BlynkMetricValue v) const {
+        BlynkMetricsShared().cells[cell].set(v);
+    }
+
+    void inc(BlynkMetricValue n = 1) const {
+        BlynkMetricsShared().cells[cell].addShared(n);
+    }
+
+    void dec(BlynkMetricValue n = 1) const {
+        BlynkMetricsShared().cells[cell].addShared(-n);
+    }
+
+private:
+    uint32_t cell;
+};
+
+class BlynkHistogram
+{
+public:
+    BlynkHistogram() : bounds(NULL), cell(0), buckets(0) {}
+    BlynkHistogram(const BlynkMetricValue* b, uint8_t n, uint32_t c)
+        : bounds(b), cell(c), buckets(n)
+    {}
+
+    void observe(BlynkMetricValue v) const {
+        unsigned i = 0;
+        while (i < buckets && v > bounds[i]) {
+            i++;
+        }
+        BlynkMetricShard& shard = BlynkMetricsLocal();
+        shard.cells[cell + i].add(1);
+        shard.cells[cell + buckets + 1].add(v);
+    }
+
+private:
+    const BlynkMetricValue* bounds;
+    uint32_t cell;
+    uint8_t  buckets;
+};
+
+// Returns the first cell of a new series, 0 when the registry is full
+inline
+uint32_t BlynkMetricsAdd(uint8_t type, const char* name, const char* help,
+                         const char* labels, const BlynkMetricValue* bounds,
+                         uint8_t buckets, BlynkMetricDecimals decimals)
+{
+    BlynkMetricsRegistry& reg = BlynkMetricsStorage<0>::registry;
+#ifdef BLYNK_METRICS_THREADS
+    std::lock_guard<std::mutex> guard(reg.lock);
+#endif
+    if (reg.cells < BLYNK_METRICS_DISCARD) {
+        reg.cells = BLYNK_METRICS_DISCARD;
+    }
+
+    const uint32_t index = reg.count.get();
+    const uint32_t width = (type == BLYNK_METRIC_HISTOGRAM) ? buckets + 2 : 1;
+    if (index >= BLYNK_METRICS || reg.cells + width > BLYNK_METRICS_CELLS ||
+        buckets > BLYNK_METRICS_BUCKETS || decimals > 9)
+    {
+        BLYNK_LOG2(BLYNK_F("No room for metric "), name);
+        return 0;
+    }
+
+    // Series of one name are printed together, whatever order they come in
+    uint32_t family = 0;
+    while (family < reg.families &&
+           strcmp(reg.series[reg.familyTail[family]].name, name))
+    {
+        family++;
+    }
+    if (family == reg.families && family >= BLYNK_METRICS_FAMILIES) {
+        BLYNK_LOG2(BLYNK_F("No room for metric "), name);
+        return 0;
+    }
+
+    BlynkMetricSeries& s = reg.series[index];
+    s.name     = name;
+    s.help     = help;
+    s.labels   = (labels && *labels) ? labels : NULL;
+    s.bounds   = bounds;
+    s.cell     = reg.cells;
+    s.next.set(-1);
+    s.type     = type;
+    s.buckets  = (type == BLYNK_METRIC_HISTOGRAM) ? buckets : 0;
+    s.decimals = decimals;
+    s.first    = (family == reg.families);
+
+    if (s.first) {
+        reg.families++;
+    } else {
+        reg.series[reg.familyTail[family]].next.release(index);
+    }
+    reg.familyTail[family] = index;
+    reg.cells += width;
+    reg.count.release(index + 1);
+    return s.cell;
+}
+
+// name and labels must stay valid, labels are given without braces
+inline
+BlynkCounter BlynkMetricsCounter(const char* name, const char* help,
+                                 const char* labels = NULL)
+{
+    return BlynkCounter(BlynkMetricsAdd(BLYNK_METRIC_COUNTER, name, help,
+                                        labels, NULL, 0, 0));
+}
+
+inline
+BlynkGauge BlynkMetricsGauge(const char* name, const char* help,
+                             const char* labels = NULL,
+                             BlynkMetricDecimals decimals = 0)
+{
+    return BlynkGauge(BlynkMetricsAdd(BLYNK_METRIC_GAUGE, name, help,
+                                      labels, NULL, 0, decimals));
+}
+
+// bounds must stay valid, they are read by every observe()
+inline
+BlynkHistogram BlynkMetricsHistogram(const char* name, const char* help,
+                                     const BlynkMetricValue* bounds, uint8_t buckets,
+                                     BlynkMetricDecimals decimals = 0,
+                                     const char* labels = NULL)
+{
+    const uint32_t cell = BlynkMetricsAdd(BLYNK_METRIC_HISTOGRAM, name, help,
+                                          labels, bounds, buckets, decimals);
+    return cell ? BlynkHistogram(bounds, buckets, cell) : BlynkHistogram();
+}
+
+// Sum of one cell over all threads
+inline
+BlynkMetricValue BlynkMetricsSum(uint32_t cell)
+{
+    BlynkMetricValue v = BlynkMetricsShared().cells[cell].get();
+#ifdef BLYNK_METRICS_THREADS
+    const BlynkMetricShard* shard = BlynkMetricsStorage<0>::registry.shards.load(std::memory_order_acquire);
+    for (; shard; shard = shard->next) {
+        v += shard->cells[cell].get();
+    }
+#endif
+    return v;
+}
+
+inline
+uint32_t BlynkMetricsCount()
+{
+    return BlynkMetricsStorage<0>::registry.count.acquire();
+}
+
+template <class Out>
+class BlynkMetricsText
+{
+public:
+    explicit BlynkMetricsText(Out& o) : out(o), len(0) {}
+
+    ~BlynkMetricsText() {
+        flush();
+    }
+
+    void put(const char* s, size_t n) {
+        if (len + n > sizeof(buf)) {
+            flush();
+            if (n > sizeof(buf)) {
+                out.write((const uint8_t*)s, n);
+                return;
+            }
+        }
+        memcpy(buf + len, s, n);
+        len += n;
+    }
+
+    void put(const char* s) {
+        put(s, strlen(s));
+    }
+
+    // v / 10^decimals, without trailing zeros
+    void number(BlynkMetricValue v, BlynkMetricDecimals decimals) {
+        char tmp[24 + 20];
+        char* p = tmp;
+        unsigned long long u = (unsigned long long)v;
+        if (v < 0) {
+            *p++ = '-';
+            u = 0ULL - u;
+        }
+        if (!decimals) {
+            put(tmp, (p - tmp) + BlynkFormatUInt(p, u));
+            return;
+        }
+        char digits[24];
+        size_t n = BlynkFormatUInt(digits, u);
+        size_t whole = (n > decimals) ? n - decimals : 0;
+        if (whole) {
+            memcpy(p, digits, whole);
+            p += whole;
+        } else {
+            *p++ = '0';
+        }
+        size_t frac = n - whole;
+        while (frac && digits[whole + frac - 1] == '0') {
+            frac--;
+        }
+        if (frac) {
+            *p++ = '.';
+            for (size_t z = n - whole; z < decimals; z++) {
+                *p++ = '0';
+            }
+            memcpy(p, digits + whole, frac);
+            p += frac;
+        }
+        put(tmp, p - tmp);
+    }
+
+    void flush() {
+        if (len) {
+            out.write((const uint8_t*)buf, len);
+            len = 0;
+        }
+    }
+
+private:
+    Out&   out;
+    size_t len;
+    char   buf[BLYNK_METRICS_WRITE_BUFFER];
+};
+
+template <class Out>
+void BlynkMetricsWriteSample(BlynkMetricsText<Out>& text, const BlynkMetricSeries& s,
+                             const char* suffix, const char* le, size_t leLen,
+                             BlynkMetricValue v, BlynkMetricDecimals decimals)
+{
+    text.put(s.name);
+    text.put(suffix);
+    if (s.labels || le) {
+        text.put("{", 1);
+        if (s.labels) {
+            text.put(s.labels);
+        }
+        if (le) {
+            text.put(s.labels ? ",le=\"" : "le=\"");
+            text.put(le, leLen);
+            text.put("\"", 1);
+        }
+        text.put("}", 1);
+    }
+    text.put(" ", 1);
+    text.number(v, decimals);
+    text.put("\n", 1);
+}
+
+template <class Out>
+void BlynkMetricsWriteSeries(BlynkMetricsText<Out>& text, const BlynkMetricSeries& s)
+{
+    if (s.type != BLYNK_METRIC_HISTOGRAM) {
+        BlynkMetricsWriteSample(text, s, "", NULL, 0, BlynkMetricsSum(s.cell), s.decimals);
+        return;
+    }
+
+    // Buckets are counted separately and printed cumulative, as Prometheus
+    // wants them
+    struct LeOut {
+        char   buf[32];
+        size_t len;
+        // A bound is at most 22 characters, never more than fits
+        void write(const uint8_t* p, size_t n) {
+            if (n > sizeof(buf) - len) {
+                return;
+            }
+            memcpy(buf + len, p, n);
+            len += n;
+        }
+    };
+
+    BlynkMetricValue total = 0;
+    for (unsigned i = 0; i <= s.buckets; i++) {
+        total += BlynkMetricsSum(s.cell + i);
+        if (i < s.buckets) {
+            LeOut le;
+            le.len = 0;
+            {
+                BlynkMetricsText<LeOut> t(le);
+                t.number(s.bounds[i], s.decimals);
+            }
+            BlynkMetricsWriteSample(text, s, "_bucket", le.buf, le.len, total, 0);
+        } else {
+            BlynkMetricsWriteSample(text, s, "_bucket", "+Inf", 4, total, 0);
+        }
+    }
+    BlynkMetricsWriteSample(text, s, "_sum", NULL, 0,
+                            BlynkMetricsSum(s.cell + s.buckets + 1), s.decimals);
+    BlynkMetricsWriteSample(text, s, "_count", NULL, 0, total, 0);
+}
+
+// Prometheus text format 0.0.4. out needs write(const uint8_t*, size_t),
+// as Arduino streams have.
+template <class Out>
+void BlynkMetricsWrite(Out& out)
+{
+    static const char* const types[] = { "counter", "gauge", "histogram" };
+
+    const BlynkMetricsRegistry& reg = BlynkMetricsStorage<0>::registry;
+    const uint32_t count = BlynkMetricsCount();
+    BlynkMetricsText<Out> text(out);
+
+    for (uint32_t i = 0; i < count; i++) {
+        const BlynkMetricSeries& head = reg.series[i];
+        if (!head.first) {
+            continue;
+        }
+        text.put("# HELP ");
+        text.put(head.name);
+        text.put(" ", 1);
+        text.put(head.help ? head.help : "");
+        text.put("\n# TYPE ");
+        text.put(head.name);
+        text.put(" ", 1);
+        text.put(types[head.type]);
+        text.put("\n", 1);
+
+        for (int32_t j = i; j >= 0 && (uint32_t)j < count; j = reg.series[j].next.acquire()) {
+            BlynkMetricsWriteSeries(text, reg.series[j]);
+        }
+    }
+}
+
+/*
+ * Series of the library itself, registered on first use
+ */
+
+struct BlynkMetricsBuiltins {
+    BlynkCounter   rxMessages;
+    BlynkCounter   rxBytes;
+    BlynkCounter   rxSkipped;
+    BlynkCounter   txMessages;
+    BlynkCounter   txBytes;
+    BlynkCounter   connects;
+    BlynkCounter   disconnects;
+    BlynkCounter   timerRuns;
+    BlynkHistogram timerLag;
+
+    BlynkMetricsBuiltins()
+        : rxMessages (BlynkMetricsCounter("blynk_rx_messages_total", "Messages received from the server"))
+        , rxBytes    (BlynkMetricsCounter("blynk_rx_bytes_total", "Message bodies received from the server, bytes"))
+        , rxSkipped  (BlynkMetricsCounter("blynk_rx_skipped_total", "Messages too large to handle"))
+        , txMessages (BlynkMetricsCounter("blynk_tx_messages_total", "Messages sent to the server"))
+        , txBytes    (BlynkMetricsCounter("blynk_tx_bytes_total", "Message bodies sent to the server, bytes"))
+        , connects   (BlynkMetricsCounter("blynk_connects_total", "Sessions logged in"))
+        , disconnects(BlynkMetricsCounter("blynk_disconnects_total", "Sessions closed or lost"))
+        , timerRuns  (BlynkMetricsCounter("blynk_timer_runs_total", "Timer callbacks run"))
+        , timerLag   (BlynkMetricsHistogram("blynk_timer_lag_seconds", "Time from a timer's deadline to its run",
+                                            lagBounds(), 10, 3))
+    {}
+
+    static const BlynkMetricValue* lagBounds() {
+        static const BlynkMetricValue ms[] = { 1, 5, 10, 25, 50, 100, 250, 500, 1000, 5000 };
+        return ms;
+    }
+};
+
+inline
+BlynkMetricsBuiltins& BlynkMetricsBuiltin()
+{
+    static BlynkMetricsBuiltins m;
+    return m;
+}
+
+#define BLYNK_METRIC_INC(metric, n)     BlynkMetricsBuiltin().metric.inc(n)
+#define BLYNK_METRIC_OBSERVE(metric, v) BlynkMetricsBuiltin().metric.observe(v)
+
+#else
+
+class BlynkCounter
+{
+public:
+    void inc(BlynkMetricValue = 1) const {}
+};
+
+class BlynkGauge
+{
+public:
+    void set(BlynkMetricValue) const {}
+    void inc(BlynkMetricValue = 1) const {}
+    void dec(BlynkMetricValue = 1) const {}
+};
+
+class BlynkHistogram
+{
+public:
+    void observe(BlynkMetricValue) const {}
+};
+
+inline
+BlynkCounter BlynkMetricsCounter(const char*, const char*, const char* = NULL)
+{
+    return BlynkCounter();
+}
+
+inline
+BlynkGauge BlynkMetricsGauge(const char*, const char*, const char* = NULL,
+                             BlynkMetricDecimals = 0)
+{
+    return BlynkGauge();
+}
+
+inline
+BlynkHistogram BlynkMetricsHistogram(const char*, const char*,
+                                     const BlynkMetricValue*, uint8_t,
+                                     BlynkMetricDecimals = 0, const char* = NULL)
+{
+    return BlynkHistogram();
+}
+
+#define BLYNK_METRIC_INC(metric, n)
+#define BLYNK_METRIC_OBSERVE(metric, v)
+
+#endif
+
+#endif
@@ -0,0 +1,246 @@
+/**
+ * @file       BlynkNumber.h
+ * @license    This project is released under the MIT License (MIT)
+ * @date       Oct 2026
+ * @brief      Allocation-free number parsing and formatting
+ *
+ */
+
+#ifndef BlynkNumber_h
+#define BlynkNumber_h
+
+#include <string.h>
+#include <stdlib.h>
+#include <Blynk/BlynkHelpers.h>
+
+/*
+ * Parsing follows std::from_chars: the text in [first, last) is read as far
+ * as it forms a number and the returned pointer is one past the last
+ * character used, or first when there is no number at all (value is left
+ * alone then). Unlike from_chars, leading spaces and '+' are accepted, so
+ * results match atoi/atof on the same text.
+ */
+
+inline
+bool BlynkIsDigit(char c)
+{
+    return (unsigned char)(c - '0') < 10;
+}
+
+inline
+const char* BlynkFromChars(const char* first, const char* last, long long& value)
+{
+    const char* p = first;
+    while (p < last && (*p == ' ' || *p == '\t')) {
+        p++;
+    }
+    bool neg = false;
+    if (p < last && (*p == '-' || *p == '+')) {
+        neg = (*p++ == '-');
+    }
+    if (p >= last || !BlynkIsDigit(*p)) {
+        return first;
+    }
+
+    // Saturate like strtoll does
+    const unsigned long long limit = neg ? 9223372036854775808ULL : 9223372036854775807ULL;
+    unsigned long long v = 0;
+    for (; p < last && BlynkIsDigit(*p); p++) {
+        const unsigned d = *p - '0';
+        v = (v > (limit - d) / 10) ? limit : v * 10 + d;
+    }
+    value = neg ? (long long)(0 - v) : (long long)v;
+    return p;
+}
+
+#if !defined(BLYNK_NO_FLOAT)
+
+// Exact conversion of short numbers, NULL when strtod has to do it
+inline
+const char* BlynkFromCharsFast(const char* p, const char* last, double& value)
+{
+    static const double pow10[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    while (p < last && (*p == ' ' || *p == '\t')) {
+        p++;
+    }
+    bool neg = false;
+    if (p < last && (*p == '-' || *p == '+')) {
+        neg = (*p++ == '-');
+    }
+
+    unsigned long long mant = 0;
+    int digits = 0;
+    int exp10 = 0;
+    bool any = false;
+    for (; p < last && BlynkIsDigit(*p); p++) {
+        if (mant || *p != '0') {
+            mant = mant * 10 + (*p - '0');
+            digits++;
+        }
+        any = true;
+    }
+    if (p < last && *p == '.') {
+        for (p++; p < last && BlynkIsDigit(*p); p++) {
+            if (mant || *p != '0') {
+                mant = mant * 10 + (*p - '0');
+                digits++;
+            }
+            exp10--;
+            any = true;
+        }
+    }
+    if (!any || digits > 15 || (p < last && (*p == 'x' || *p == 'X'))) {
+        return NULL;
+    }
+    if (p < last && (*p == 'e' || *p == 'E')) {
+        const char* e = p + 1;
+        bool eneg = false;
+        if (e < last && (*e == '-' || *e == '+')) {
+            eneg = (*e++ == '-');
+        }
+        if (e < last && BlynkIsDigit(*e)) {
+            int ev = 0;
+            for (; e < last && BlynkIsDigit(*e); e++) {
+                if (ev < 10000) ev = ev * 10 + (*e - '0');
+            }
+            exp10 += eneg ? -ev : ev;
+            p = e;
+        }
+    }
+    if (exp10 < -22 || exp10 > 22) {
+        return NULL;
+    }
+
+    double v = (double)mant;
+    v = (exp10 < 0) ? v / pow10[-exp10] : v * pow10[exp10];
+    value = neg ? -v : v;
+    return p;
+}
+
+/*
+ * Numbers with up to 15 significant digits and a decimal exponent within
+ * +-22 are converted exactly with one multiplication or division, as both
+ * operands are exact doubles. Everything else (long mantissas, hex, nan,
+ * inf) goes to strtod, which needs the text to end in a non-number
+ * character such as the '\0' separating Blynk parameters.
+ */
+inline
+const char* BlynkFromChars(const char* first, const char* last, double& value)
+{
+    const char* p = BlynkFromCharsFast(first, last, value);
+    if (p) {
+        return p;
+    }
+    char* end;
+    const double v = strtod(first, &end);
+    if (end == first) {
+        return first;
+    }
+    value = v;
+    return end;
+}
+
+#endif
+
+/*
+ * Formatting writes a NUL-terminated string and returns its length,
+ * out needs room for 21 characters (22 for BlynkFormatFixed).
+ */
+
+inline
+size_t BlynkFormatUInt(char* out, unsigned long long v)
+{
+    static const char pairs[] =
+        "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+        "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+
+    char tmp[20];
+    char* p = tmp + sizeof(tmp);
+    while (v >= 100) {
+        const unsigned i = (unsigned)(v % 100) * 2;
+        v /= 100;
+        *--p = pairs[i + 1];
+        *--p = pairs[i];
+    }
+    if (v >= 10) {
+        const unsigned i = (unsigned)v * 2;
+        *--p = pairs[i + 1];
+        *--p = pairs[i];
+    } else {
+        *--p = '0' + (char)v;
+    }
+    const size_t len = tmp + sizeof(tmp) - p;
+    memcpy(out, p, len);
+    out[len] = '\0';
+    return len;
+}
+
+inline
+size_t BlynkFormatInt(char* out, long long v)
+{
+    if (v < 0) {
+        *out = '-';
+        return 1 + BlynkFormatUInt(out + 1, 0ULL - (unsigned long long)v);
+    }
+    return BlynkFormatUInt(out, v);
+}
+
+#if !defined(BLYNK_NO_FLOAT)
+
+/*
+ * Same digits as printf("%.<prec>f"), prec up to 9. The value is scaled
+ * and rounded in double, which can only disagree with printf when the
+ * scaled value lies within rounding error of a half. Such values, and
+ * ones too large or not finite, return 0 so the caller can fall back.
+ */
+inline
+size_t BlynkFormatFixed(char* out, double v, unsigned prec)
+{
+    static const unsigned long pow10[] = {
+        1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+    };
+
+    if (prec > 9 || v != v) {
+        return 0;
+    }
+    const bool neg = (v < 0) || (v == 0 && 1 / v < 0);
+    const double scaled = (neg ? -v : v) * pow10[prec];
+    if (!(scaled < 1e15)) {
+        return 0;
+    }
+    unsigned long long r = (unsigned long long)scaled;
+    const double frac = scaled - (double)r;
+    const double margin = scaled * 4.5e-16 + 1e-12;
+    if (frac > 0.5 - margin && frac < 0.5 + margin) {
+        return 0;
+    }
+    if (frac > 0.5) {
+        r++;
+    }
+
+    char* p = out;
+    if (neg) {
+        *p++ = '-';
+    }
+    p += BlynkFormatUInt(p, r / pow10[prec]);
+    if (prec) {
+        *p++ = '.';
+        unsigned long f = (unsigned long)(r % pow10[prec]);
+        for (unsigned i = prec; i > 0; i--) {
+            p[i - 1] = '0' + f % 10;
+            f /= 10;
+        }
+        p += prec;
+        *p = '\0';
+    }
+    return p - out;
+}
+
+#endif
+
+#endif
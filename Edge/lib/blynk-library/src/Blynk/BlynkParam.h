@@ -14,6 +14,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <Blynk/BlynkHelpers.h>
+#include <Blynk/BlynkNumber.h>
 
 #define BLYNK_PARAM_KV(k, v) k "\0" v "\0"
 #define BLYNK_PARAM_PLACEHOLDER_64 "PlaceholderPlaceholderPlaceholderPlaceholderPlaceholderPlaceholder"
@@ -349,48 +350,54 @@ void BlynkParam::add(const __FlashStringHelper* ifsh)
     inline
     void BlynkParam::add(int value)
     {
-        len += snprintf(buff+len, buff_size-len, "%i", value)+1;
+        add((long long)value);
     }
 
     inline
     void BlynkParam::add(unsigned int value)
     {
-        len += snprintf(buff+len, buff_size-len, "%u", value)+1;
+        add((unsigned long long)value);
     }
 
     inline
     void BlynkParam::add(long value)
     {
-        len += snprintf(buff+len, buff_size-len, "%li", value)+1;
+        add((long long)value);
     }
 
     inline
     void BlynkParam::add(unsigned long value)
     {
-        len += snprintf(buff+len, buff_size-len, "%lu", value)+1;
+        add((unsigned long long)value);
     }
 
     inline
     void BlynkParam::add(long long value)
     {
-        len += snprintf(buff+len, buff_size-len, "%lli", value)+1;
+        char str[2 + 3 * sizeof(value)];
+        add_raw(str, BlynkFormatInt(str, value) + 1);
     }
 
     inline
     void BlynkParam::add(unsigned long long value)
     {
-        len += snprintf(buff+len, buff_size-len, "%llu", value)+1;
+        char str[1 + 3 * sizeof(value)];
+        add_raw(str, BlynkFormatUInt(str, value) + 1);
     }
 
 #ifndef BLYNK_NO_FLOAT
 
+    // BlynkFormatFixed covers the common range, the rest goes the old way
+
 #if defined(BLYNK_USE_INTERNAL_DTOSTRF)
 
     inline
     void BlynkParam::add(float value)
     {
         char str[33];
-        dtostrf_internal(value, 5, 3, str);
+        if (!BlynkFormatFixed(str, value, 3)) {
+            dtostrf_internal(value, 5, 3, str);
+        }
         add(str);
     }
 
@@ -398,7 +405,9 @@ void BlynkParam::add(const __FlashStringHelper* ifsh)
     void BlynkParam::add(double value)
     {
         char str[33];
-        dtostrf_internal(value, 5, 7, str);
+        if (!BlynkFormatFixed(str, value, 7)) {
+            dtostrf_internal(value, 5, 7, str);
+        }
         add(str);
     }
 
@@ -407,12 +416,22 @@ void BlynkParam::add(const __FlashStringHelper* ifsh)
     inline
     void BlynkParam::add(float value)
     {
+        char str[33];
+        if (BlynkFormatFixed(str, value, 3)) {
+            add(str);
+            return;
+        }
         len += snprintf(buff+len, buff_size-len, "%2.3f", value)+1;
     }
 
     inline
     void BlynkParam::add(double value)
     {
+        char str[33];
+        if (BlynkFormatFixed(str, value, 7)) {
+            add(str);
+            return;
+        }
         len += snprintf(buff+len, buff_size-len, "%2.7f", value)+1;
     }
 
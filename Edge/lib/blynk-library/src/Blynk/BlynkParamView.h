@@ -0,0 +1,172 @@
+/**
+ * @file       BlynkParamView.h
+ * @license    This project is released under the MIT License (MIT)
+ * @date       Oct 2026
+ * @brief      Indexed, read-only view of handler parameters
+ *
+ */
+
+#ifndef BlynkParamView_h
+#define BlynkParamView_h
+
+#include <Blynk/BlynkParam.h>
+#include <Blynk/BlynkNumber.h>
+#include <Blynk/BlynkUtility.h>
+#include <limits.h>
+
+#ifndef BLYNK_PARAM_VIEW_SIZE
+#define BLYNK_PARAM_VIEW_SIZE 16
+#endif
+
+/*
+ * BlynkParam finds a value by walking the buffer from the start, so
+ * reading param[0] .. param[k] is quadratic. The view splits the buffer
+ * once and then reaches any of the first BLYNK_PARAM_VIEW_SIZE values in
+ * constant time. Later ones are found by scanning on from the last
+ * indexed or last looked up value, so walking them in order stays linear.
+ * Typed getters parse in place without atoi/atof.
+ *
+ *   BLYNK_WRITE(V1) {
+ *     BlynkParamView v(param);
+ *     for (int i = 0; i < v.count(); i++) { total += v.asFloat(i); }
+ *   }
+ *
+ * The view points into the param buffer and must not outlive it.
+ */
+class BlynkParamView
+{
+public:
+    explicit
+    BlynkParamView(const BlynkParam& param)
+    {
+        build((const char*)param.getBuffer(), param.getLength());
+    }
+
+    BlynkParamView(const void* addr, size_t length)
+    {
+        build((const char*)addr, length);
+    }
+
+    // Number of values in the buffer
+    int count() const { return total; }
+
+    BlynkParam::iterator operator[](int index) const {
+        const char* p = find(index);
+        return p ? BlynkParam::iterator(p, buff + len) : BlynkParam::iterator::invalid();
+    }
+
+    BlynkParam::iterator operator[](const char* key) const {
+        for (int i = 0; i + 1 < total; i += 2) {
+            const char* k = find(i);
+            if (!strcmp(k, key)) {
+                return (*this)[i + 1];
+            }
+        }
+        return BlynkParam::iterator::invalid();
+    }
+
+    const char* asStr(int index) const {
+        return find(index);
+    }
+
+    size_t length(int index) const {
+        const char* p = find(index);
+        return p ? end(index, p) - p : 0;
+    }
+
+    long long asLongLong(int index, long long def = 0) const {
+        const char* p = find(index);
+        long long v = def;
+        if (p) {
+            BlynkFromChars(p, end(index, p), v);
+        }
+        return v;
+    }
+
+    long asLong(int index, long def = 0) const {
+        const long long v = asLongLong(index, def);
+        return (long)BlynkMathClamp(v, (long long)LONG_MIN, (long long)LONG_MAX);
+    }
+
+    int asInt(int index, int def = 0) const {
+        const long long v = asLongLong(index, def);
+        return (int)BlynkMathClamp(v, (long long)INT_MIN, (long long)INT_MAX);
+    }
+
+#if !defined(BLYNK_NO_FLOAT)
+    double asDouble(int index, double def = 0) const {
+        const char* p = find(index);
+        double v = def;
+        if (p) {
+            BlynkFromChars(p, end(index, p), v);
+        }
+        return v;
+    }
+
+    float asFloat(int index, float def = 0) const {
+        return asDouble(index, def);
+    }
+#endif
+
+private:
+    void build(const char* addr, size_t length) {
+        buff = addr;
+        len = length;
+        total = 0;
+        indexed = 0;
+        offs[0] = 0;
+
+        const char* p = buff;
+        const char* const e = buff + len;
+        while (p < e) {
+            const char* z = (const char*)memchr(p, '\0', e - p);
+            const char* next = z ? z + 1 : e;
+            if (indexed < BLYNK_PARAM_VIEW_SIZE && next - buff <= 0xFFFF) {
+                offs[indexed++] = p - buff;
+                offs[indexed] = next - buff;
+            }
+            total++;
+            p = next;
+        }
+        cursorIndex = indexed;
+        cursor = buff + offs[indexed];
+    }
+
+    const char* find(int index) const {
+        if (index < 0 || index >= total) {
+            return NULL;
+        }
+        if (index < indexed) {
+            return buff + offs[index];
+        }
+        if (index < cursorIndex) {
+            cursorIndex = indexed;
+            cursor = buff + offs[indexed];
+        }
+        for (; cursorIndex < index; cursorIndex++) {
+            cursor += strlen(cursor) + 1;
+        }
+        return cursor;
+    }
+
+    // The last value may run to the end of the buffer without a '\0'
+    const char* end(int index, const char* p) const {
+        if (index >= indexed) {
+            return p + strlen(p);
+        }
+        const char* e = buff + offs[index + 1];
+        return (e[-1] == '\0') ? e - 1 : e;
+    }
+
+    const char* buff;
+    size_t      len;
+    int         total;
+    int         indexed;
+    uint16_t    offs[BLYNK_PARAM_VIEW_SIZE + 1];
+
+    // Scan position past the index
+    mutable int         cursorIndex;
+    mutable const char* cursor;
+};
+
+#endif
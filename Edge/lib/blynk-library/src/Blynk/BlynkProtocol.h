@@ -16,6 +16,24 @@
 #include <Blynk/BlynkUtility.h>
 #include <Blynk/BlynkProtocolDefs.h>
 #include <Blynk/BlynkApi.h>
+#include <Blynk/BlynkTrace.h>
+#include <Blynk/BlynkMetrics.h>
+
+#if defined(BLYNK_SEND_BUFFER) && BLYNK_SEND_BUFFER > 0
+#define BLYNK_USE_SEND_BUFFER
+#endif
+
+#if defined(BLYNK_RECV_BUFFER) && BLYNK_RECV_BUFFER > 0
+#define BLYNK_USE_RECV_BUFFER
+#if BLYNK_RECV_BUFFER < BLYNK_MAX_READBYTES + 6
+#error "BLYNK_RECV_BUFFER must hold a full message and a terminator"
+#endif
+#endif
+
+#if defined(BLYNK_MSG_LIMIT) && BLYNK_MSG_LIMIT > 0 && defined(BLYNK_MSG_QUEUE) && BLYNK_MSG_QUEUE > 0
+#define BLYNK_USE_MSG_QUEUE
+#include <Blynk/BlynkCmdQueue.h>
+#endif
 
 template <class Transp>
 class BlynkProtocol
@@ -40,6 +58,20 @@ public:
         , msgIdOut(0)
         , msgIdOutOverride(0)
         , nesting(0)
+#ifdef BLYNK_USE_SEND_BUFFER
+        , sendBuffLen(0)
+#endif
+#ifdef BLYNK_USE_RECV_BUFFER
+        , recvHead(0)
+        , recvLen(0)
+        , recvSkip(0)
+        , recvBusy(0)
+#endif
+#ifdef BLYNK_USE_MSG_QUEUE
+        , msgSentHead(0)
+        , msgSentCount(0)
+        , msgUnflushed(0)
+#endif
         , state(CONNECTING)
     {}
 
@@ -61,7 +93,10 @@ public:
 
     void disconnect() {
         conn.disconnect();
+        clearBuffers();
         state = DISCONNECTED;
+        BLYNK_TRACE_EVENT(BLYNK_TRACE_DISCONNECT, 0, 0, 0);
+        BLYNK_METRIC_INC(disconnects, 1);
         BLYNK_LOG1(BLYNK_F("Disconnected"));
     }
 
@@ -70,6 +105,7 @@ public:
     // TODO: Fixme
     void startSession() {
         conn.connect();
+        clearBuffers();
         state = CONNECTING;
         msgIdOut = 0;
         lastHeartbeat = lastActivityIn = lastActivityOut = (BlynkMillis() - 5000UL);
@@ -81,6 +117,12 @@ public:
         sendCmd(BLYNK_CMD_RESPONSE, id, NULL, rsp);
     }
 
+    // Write out commands queued in the send buffer (if enabled)
+    bool flush() {
+        BLYNK_MUTEX_GUARD(mutex);
+        return flushSendBuffer();
+    }
+
     void printBanner() {
 #if defined(BLYNK_NO_FANCY_LOGO)
         BLYNK_LOG1(BLYNK_F("Blynk v" BLYNK_VERSION " on " BLYNK_INFO_DEVICE
@@ -108,15 +150,66 @@ private:
 
     void internalReconnect() {
         state = CONNECTING;
+        BLYNK_TRACE_EVENT(BLYNK_TRACE_DISCONNECT, 0, 0, 0);
+        BLYNK_METRIC_INC(disconnects, 1);
         conn.disconnect();
+        clearBuffers();
         BlynkOnDisconnected();
     }
 
     int readHeader(BlynkHeader& hdr);
+    bool processMsg(const BlynkHeader& hdr, uint8_t* inputBuffer);
+
+#ifdef BLYNK_USE_RECV_BUFFER
+    bool inputPending() {
+        return !recvBusy && (recvReady() || conn.available() > 0);
+    }
+
+    bool recvReady() const;
+    int  recvFill();
+#else
+    bool inputPending() {
+        return conn.available() > 0;
+    }
+#endif
+
+    void writeCmd(uint8_t cmd, uint16_t id, const void* data, size_t length, const void* data2, size_t length2);
+    size_t packCmd(uint8_t* buff, uint8_t cmd, uint16_t id, const void* data, size_t length, const void* data2, size_t length2);
+    bool writeBuff(const uint8_t* buff, size_t len);
+    bool flushSendBuffer();
+
+    // Everything buffered belongs to the session being left
+    void clearBuffers() {
+#ifdef BLYNK_USE_SEND_BUFFER
+        sendBuffLen = 0;
+#endif
+#ifdef BLYNK_USE_RECV_BUFFER
+        recvHead = recvLen = recvSkip = 0;
+#endif
+#ifdef BLYNK_USE_MSG_QUEUE
+        msgQueue.clear();
+        msgUnflushed = 0;
+#endif
+#ifdef BLYNK_USE_VW_BATCH
+        BlynkApi< BlynkProtocol<Transp> >::clearBatch();
+#endif
+    }
+
+#ifdef BLYNK_USE_MSG_QUEUE
+    static bool isLimitedCmd(uint8_t cmd) {
+        return cmd >= BLYNK_CMD_BRIDGE && cmd <= BLYNK_CMD_HARDWARE;
+    }
+
+    bool takeMsgToken();
+    void drainMsgQueue();
+#endif
 
 protected:
     void begin(const char* auth) {
         this->authkey = auth;
+#ifdef BLYNK_USE_TRACE
+        BlynkTraceBegin();
+#endif
         lastHeartbeat = lastActivityIn = lastActivityOut = (BlynkMillis() - 5000UL);
 #if !defined(BLYNK_NO_DEFAULT_BANNER)
         printBanner();
@@ -139,6 +232,30 @@ private:
     uint16_t msgIdOut;
     uint16_t msgIdOutOverride;
     uint8_t  nesting;
+#ifdef BLYNK_USE_SEND_BUFFER
+    // Consecutive commands are coalesced here and leave in one write
+    size_t   sendBuffLen;
+    uint8_t  sendBuff[BLYNK_SEND_BUFFER];
+#endif
+#ifdef BLYNK_USE_RECV_BUFFER
+    // Input is read in chunks and messages are handled where they lie
+    size_t   recvHead;
+    size_t   recvLen;
+    size_t   recvSkip;      // Rest of an oversized message to discard
+    uint8_t  recvBusy;
+    uint8_t  recvBuff[BLYNK_RECV_BUFFER];
+#endif
+#ifdef BLYNK_USE_MSG_QUEUE
+    // Send times of the last BLYNK_MSG_LIMIT limited commands, a ring whose
+    // head is the oldest once full: no one second holds more than the limit.
+    // The newest msgUnflushed still wait in the send buffer and are stamped
+    // again when it is written.
+    BlynkCmdQueue<BLYNK_MSG_QUEUE> msgQueue;
+    millis_time_t msgSentAt[BLYNK_MSG_LIMIT];
+    uint16_t      msgSentHead;
+    uint16_t      msgSentCount;
+    uint16_t      msgUnflushed;
+#endif
     BLYNK_MUTEX_DECL(mutex);
 protected:
     BlynkState state;
@@ -161,11 +278,12 @@ bool BlynkProtocol<Transp>::run(bool avail)
     }
 
     if (conn.connected()) {
-        while (avail || conn.available() > 0) {
+        while (avail || inputPending()) {
             //BLYNK_LOG2(BLYNK_F("Available: "), conn.available());
             //const unsigned long t = micros();
             if (!processInput()) {
                 conn.disconnect();
+                clearBuffers();
 // TODO: Only when in direct mode?
 #ifdef BLYNK_USE_DIRECT_CONNECT
                 state = CONNECTING;
@@ -178,6 +296,25 @@ bool BlynkProtocol<Transp>::run(bool avail)
         }
     }
 
+#ifdef BLYNK_USE_VW_BATCH
+    if (state == CONNECTED) {
+        BlynkApi< BlynkProtocol<Transp> >::runBatch();
+    }
+#endif
+
+#ifdef BLYNK_USE_MSG_QUEUE
+    if (state == CONNECTED) {
+        drainMsgQueue();
+    }
+#endif
+
+#ifdef BLYNK_USE_SEND_BUFFER
+    // Replies and writes queued since the last run() leave together
+    if (!flush()) {
+        return false;
+    }
+#endif
+
     const millis_time_t t = BlynkMillis();
 
     // Update connection status after running commands
@@ -209,8 +346,10 @@ bool BlynkProtocol<Transp>::run(bool avail)
         }
     } else if (state == CONNECTING) {
 #ifdef BLYNK_USE_DIRECT_CONNECT
-        if (!tconn)
+        if (!tconn) {
+            clearBuffers();
             conn.connect();
+        }
 #else
         if (tconn && (t - lastLogin > BLYNK_TIMEOUT_MS)) {
             BLYNK_LOG1(BLYNK_F("Login timeout"));
@@ -219,6 +358,7 @@ bool BlynkProtocol<Transp>::run(bool avail)
             return false;
         } else if (!tconn && (t - lastLogin > 5000UL)) {
             conn.disconnect();
+            clearBuffers();
             if (!conn.connect()) {
                 lastLogin = t;
                 return false;
@@ -238,6 +378,70 @@ template <class Transp>
 BLYNK_FORCE_INLINE
 bool BlynkProtocol<Transp>::processInput(void)
 {
+#ifdef BLYNK_USE_RECV_BUFFER
+    // A handler is still using the buffer, leave the rest for later
+    if (recvBusy) {
+        return true;
+    }
+    if (!recvReady()) {
+        if (recvFill() < 0) {
+            return false;
+        }
+        if (!recvReady()) {
+            return true; // Considered OK (no complete message yet)
+        }
+    }
+
+    if (recvSkip) {
+        const size_t n = BlynkMin(recvSkip, recvLen);
+        recvHead += n;
+        recvLen  -= n;
+        recvSkip -= n;
+        return true;
+    }
+
+    BlynkHeader hdr;
+    memcpy(&hdr, recvBuff + recvHead, sizeof(hdr));
+    BLYNK_DBG_DUMP(">", &hdr, sizeof(BlynkHeader));
+    hdr.msg_id = ntohs(hdr.msg_id);
+    hdr.length = ntohs(hdr.length);
+    recvHead += sizeof(hdr);
+    recvLen  -= sizeof(hdr);
+
+    if (hdr.msg_id == 0) {
+#ifdef BLYNK_DEBUG
+        BLYNK_LOG1(BLYNK_F("Bad hdr"));
+#endif
+        return false;
+    }
+
+    if (hdr.type == BLYNK_CMD_RESPONSE) {
+        return processMsg(hdr, NULL);
+    }
+
+    if (hdr.length > BLYNK_MAX_READBYTES) {
+        // Stream it through the buffer instead of dropping the connection
+        BLYNK_LOG2(BLYNK_F("Packet too big: "), hdr.length);
+        BLYNK_TRACE_EVENT(BLYNK_TRACE_RX_SKIP, hdr.type, hdr.msg_id, hdr.length);
+        BLYNK_METRIC_INC(rxSkipped, 1);
+        recvSkip = hdr.length;
+        return true;
+    }
+
+    uint8_t* body = recvBuff + recvHead;
+    recvHead += hdr.length;
+    recvLen  -= hdr.length;
+
+    // The byte after the body starts the next message, it is put back
+    // once the handlers are done (recvFill keeps one byte spare for this)
+    const uint8_t next = body[hdr.length];
+    body[hdr.length] = '\0';
+    recvBusy++;
+    const bool ok = processMsg(hdr, body);
+    recvBusy--;
+    body[hdr.length] = next;
+    return ok;
+#else
     BlynkHeader hdr;
     const int ret = readHeader(hdr);
 
@@ -252,6 +456,40 @@ bool BlynkProtocol<Transp>::processInput(void)
         return false;
     }
 
+    if (hdr.type == BLYNK_CMD_RESPONSE) {
+        return processMsg(hdr, NULL);
+    }
+
+    if (hdr.length > BLYNK_MAX_READBYTES) {
+        BLYNK_LOG2(BLYNK_F("Packet too big: "), hdr.length);
+        BLYNK_TRACE_EVENT(BLYNK_TRACE_RX_SKIP, hdr.type, hdr.msg_id, hdr.length);
+        BLYNK_METRIC_INC(rxSkipped, 1);
+        // TODO: Flush
+        internalReconnect();
+        return true;
+    }
+
+    uint8_t inputBuffer[hdr.length+1]; // Add 1 to zero-terminate
+    if (hdr.length != conn.read(inputBuffer, hdr.length)) {
+#ifdef BLYNK_DEBUG
+        BLYNK_LOG1(BLYNK_F("Can't read body"));
+#endif
+        return false;
+    }
+    inputBuffer[hdr.length] = '\0';
+
+    return processMsg(hdr, inputBuffer);
+#endif
+}
+
+template <class Transp>
+bool BlynkProtocol<Transp>::processMsg(const BlynkHeader& hdr, uint8_t* inputBuffer)
+{
+    BLYNK_TRACE_EVENT(BLYNK_TRACE_RX, hdr.type, hdr.msg_id, hdr.length,
+                      inputBuffer, inputBuffer ? hdr.length : 0);
+    BLYNK_METRIC_INC(rxMessages, 1);
+    BLYNK_METRIC_INC(rxBytes, inputBuffer ? hdr.length : 0);
+
     if (hdr.type == BLYNK_CMD_RESPONSE) {
         lastActivityIn = BlynkMillis();
 
@@ -263,6 +501,8 @@ bool BlynkProtocol<Transp>::processInput(void)
                 BLYNK_LOG3(BLYNK_F("Ready (ping: "), lastActivityIn-lastHeartbeat, BLYNK_F("ms)."));
                 lastHeartbeat = lastActivityIn;
                 state = CONNECTED;
+                BLYNK_TRACE_EVENT(BLYNK_TRACE_CONNECT, 0, 0, 0);
+                BLYNK_METRIC_INC(connects, 1);
 #ifdef BLYNK_DEBUG
                 if (size_t ram = BlynkFreeRam()) {
                     BLYNK_LOG2(BLYNK_F("Free RAM: "), ram);
@@ -289,22 +529,6 @@ bool BlynkProtocol<Transp>::processInput(void)
         return true;
     }
 
-    if (hdr.length > BLYNK_MAX_READBYTES) {
-        BLYNK_LOG2(BLYNK_F("Packet too big: "), hdr.length);
-        // TODO: Flush
-        internalReconnect();
-        return true;
-    }
-
-    uint8_t inputBuffer[hdr.length+1]; // Add 1 to zero-terminate
-    if (hdr.length != conn.read(inputBuffer, hdr.length)) {
-#ifdef BLYNK_DEBUG
-        BLYNK_LOG1(BLYNK_F("Can't read body"));
-#endif
-        return false;
-    }
-    inputBuffer[hdr.length] = '\0';
-
     BLYNK_DBG_DUMP(">", inputBuffer, hdr.length);
 
     lastActivityIn = BlynkMillis();
@@ -322,6 +546,8 @@ bool BlynkProtocol<Transp>::processInput(void)
         if (state == CONNECTING) {
             BLYNK_LOG1(BLYNK_F("Ready"));
             state = CONNECTED;
+            BLYNK_TRACE_EVENT(BLYNK_TRACE_CONNECT, 0, 0, 0);
+            BLYNK_METRIC_INC(connects, 1);
 #ifdef BLYNK_DEBUG
             if (size_t ram = BlynkFreeRam()) {
                 BLYNK_LOG2(BLYNK_F("Free RAM: "), ram);
@@ -432,6 +658,51 @@ int BlynkProtocol<Transp>::readHeader(BlynkHeader& hdr)
     return rlen;
 }
 
+#ifdef BLYNK_USE_RECV_BUFFER
+
+template <class Transp>
+bool BlynkProtocol<Transp>::recvReady() const
+{
+    if (recvSkip) {
+        return recvLen > 0;
+    }
+    if (recvLen < sizeof(BlynkHeader)) {
+        return false;
+    }
+    const uint8_t* hdr = recvBuff + recvHead;
+    const size_t len = (size_t(hdr[3]) << 8) | hdr[4];
+    if (hdr[0] == BLYNK_CMD_RESPONSE || len > BLYNK_MAX_READBYTES) {
+        return true;
+    }
+    return recvLen >= sizeof(BlynkHeader) + len;
+}
+
+template <class Transp>
+int BlynkProtocol<Transp>::recvFill()
+{
+    if (recvHead) {
+        memmove(recvBuff, recvBuff + recvHead, recvLen);
+        recvHead = 0;
+    }
+    const int avail = conn.available();
+    const size_t room = sizeof(recvBuff) - 1 - recvLen;
+    if (avail <= 0 || !room) {
+        return 0;
+    }
+    const size_t want = BlynkMin((size_t)avail, room);
+    const size_t got = conn.read(recvBuff + recvLen, want);
+    if (got > want) {
+#ifdef BLYNK_DEBUG
+        BLYNK_LOG1(BLYNK_F("Can't read input"));
+#endif
+        return -1;
+    }
+    recvLen += got;
+    return got;
+}
+
+#endif
+
 #ifndef BLYNK_SEND_THROTTLE
 #define BLYNK_SEND_THROTTLE 0
 #endif
@@ -450,7 +721,10 @@ void BlynkProtocol<Transp>::sendCmd(uint8_t cmd, uint16_t id, const void* data,
         return;
     }
 
-#if defined(BLYNK_MSG_LIMIT) && BLYNK_MSG_LIMIT > 0
+    BlynkApi< BlynkProtocol<Transp> >::sendPendingGroup();
+
+#if !defined(BLYNK_USE_MSG_QUEUE) && defined(BLYNK_MSG_LIMIT) && BLYNK_MSG_LIMIT > 0
+    // Waits in run(), which takes the mutex itself, so not under the guard
     if (cmd >= BLYNK_CMD_BRIDGE && cmd <= BLYNK_CMD_HARDWARE) {
         const millis_time_t allowed_time = BlynkMax(lastActivityOut, lastActivityIn) + 1000/BLYNK_MSG_LIMIT;
         int32_t wait_time = allowed_time - BlynkMillis();
@@ -468,53 +742,77 @@ void BlynkProtocol<Transp>::sendCmd(uint8_t cmd, uint16_t id, const void* data,
     }
 #endif
 
-    BlynkApi< BlynkProtocol<Transp> >::sendPendingGroup();
-
     BLYNK_MUTEX_GUARD(mutex);
 
+#if defined(BLYNK_USE_MSG_QUEUE)
+    // Once anything waits, everything but control messages queues up behind it
+    if (cmd != BLYNK_CMD_RESPONSE && cmd != BLYNK_CMD_PING && cmd != BLYNK_CMD_HW_LOGIN &&
+        (!msgQueue.empty() || (isLimitedCmd(cmd) && !takeMsgToken())))
+    {
+        if (0 == id) {
+            id = msgIdOutOverride;
+        }
+        if (!msgQueue.push(cmd, id, data, length, data2, length2)) {
+#ifdef BLYNK_DEBUG
+            BLYNK_LOG2(BLYNK_F("Cmd dropped:"), cmd);
+#endif
+        }
+        return;
+    }
+#endif
+
+    writeCmd(cmd, id, data, length, data2, length2);
+}
+
+template <class Transp>
+void BlynkProtocol<Transp>::writeCmd(uint8_t cmd, uint16_t id, const void* data, size_t length, const void* data2, size_t length2)
+{
     if (0 == id) {
         id = getNextMsgId();
     }
 
+    BLYNK_TRACE_EVENT(BLYNK_TRACE_TX, cmd, id, length+length2,
+                      data, data ? length : 0);
+    BLYNK_METRIC_INC(txMessages, 1);
+    BLYNK_METRIC_INC(txBytes, (data ? length : 0) + (data2 ? length2 : 0));
+
     const size_t full_length = (sizeof(BlynkHeader)) +
                                (data  ? length  : 0) +
                                (data2 ? length2 : 0);
 
-#if defined(BLYNK_SEND_ATOMIC) || defined(ESP8266) || defined(ESP32) || defined(SPARK) || defined(PARTICLE) || defined(ENERGIA)
-    // Those have more RAM and like single write at a time...
-
-    uint8_t buff[full_length];
+#ifdef BLYNK_USE_SEND_BUFFER
+    if (full_length <= sizeof(sendBuff)) {
+        if (cmd == BLYNK_CMD_HW_LOGIN) {
+            // Login starts a new session, anything queued for the old one is stale
+            sendBuffLen = 0;
+        } else if (sendBuffLen + full_length > sizeof(sendBuff) && !flushSendBuffer()) {
+            return;
+        }
 
-    BlynkHeader* hdr = (BlynkHeader*)buff;
-    hdr->type = cmd;
-    hdr->msg_id = htons(id);
-    hdr->length = htons(length+length2);
+        sendBuffLen += packCmd(sendBuff + sendBuffLen, cmd, id, data, length, data2, length2);
+        lastActivityOut = BlynkMillis();
 
-    size_t pos = sizeof(BlynkHeader);
-    if (data && length) {
-        memcpy(buff + pos, data, length);
-        pos += length;
-    }
-    if (data2 && length2) {
-        memcpy(buff + pos, data2, length2);
+        // Login and ping wait for a reply, so don't hold them back
+        if (cmd == BLYNK_CMD_HW_LOGIN || cmd == BLYNK_CMD_PING) {
+            flushSendBuffer();
+        }
+        return;
     }
 
-    size_t wlen = 0;
-    while (wlen < full_length) {
-        const size_t chunk = BlynkMin(size_t(BLYNK_SEND_CHUNK), full_length - wlen);
-        BLYNK_DBG_DUMP("<", buff + wlen, chunk);
-        const size_t w = conn.write(buff + wlen, chunk);
-        BlynkDelay(BLYNK_SEND_THROTTLE);
-        if (w == 0) {
-#ifdef BLYNK_DEBUG
-            BLYNK_LOG1(BLYNK_F("Cmd error"));
+    // Too big to queue: keep the order by writing out what is queued first
+    if (!flushSendBuffer()) {
+        return;
+    }
 #endif
-            conn.disconnect();
-            state = CONNECTING;
-            BlynkOnDisconnected();
-            return;
-        }
-        wlen += w;
+
+#if defined(BLYNK_SEND_ATOMIC) || defined(ESP8266) || defined(ESP32) || defined(SPARK) || defined(PARTICLE) || defined(ENERGIA)
+    // Those have more RAM and like single write at a time...
+
+    uint8_t buff[full_length];
+    packCmd(buff, cmd, id, data, length, data2, length2);
+
+    if (!writeBuff(buff, full_length)) {
+        return;
     }
 
 #else
@@ -541,8 +839,6 @@ void BlynkProtocol<Transp>::sendCmd(uint8_t cmd, uint16_t id, const void* data,
         }
     }
 
-#endif
-
     if (wlen != full_length) {
 #ifdef BLYNK_DEBUG
         BLYNK_LOG4(BLYNK_F("Sent "), wlen, '/', full_length);
@@ -551,10 +847,116 @@ void BlynkProtocol<Transp>::sendCmd(uint8_t cmd, uint16_t id, const void* data,
         return;
     }
 
+#endif
+
     lastActivityOut = BlynkMillis();
 
 }
 
+template <class Transp>
+size_t BlynkProtocol<Transp>::packCmd(uint8_t* buff, uint8_t cmd, uint16_t id, const void* data, size_t length, const void* data2, size_t length2)
+{
+    BlynkHeader* hdr = (BlynkHeader*)buff;
+    hdr->type = cmd;
+    hdr->msg_id = htons(id);
+    hdr->length = htons(length+length2);
+
+    size_t pos = sizeof(BlynkHeader);
+    if (data && length) {
+        memcpy(buff + pos, data, length);
+        pos += length;
+    }
+    if (data2 && length2) {
+        memcpy(buff + pos, data2, length2);
+        pos += length2;
+    }
+    return pos;
+}
+
+template <class Transp>
+bool BlynkProtocol<Transp>::writeBuff(const uint8_t* buff, size_t len)
+{
+    size_t wlen = 0;
+    while (wlen < len) {
+        const size_t chunk = BlynkMin(size_t(BLYNK_SEND_CHUNK), len - wlen);
+        BLYNK_DBG_DUMP("<", buff + wlen, chunk);
+        const size_t w = conn.write(buff + wlen, chunk);
+        BlynkDelay(BLYNK_SEND_THROTTLE);
+        if (w == 0 || w > chunk) {
+#ifdef BLYNK_DEBUG
+            BLYNK_LOG4(BLYNK_F("Sent "), wlen, '/', len);
+#endif
+            internalReconnect();
+            return false;
+        }
+        wlen += w;
+    }
+    return true;
+}
+
+template <class Transp>
+bool BlynkProtocol<Transp>::flushSendBuffer()
+{
+#ifdef BLYNK_USE_SEND_BUFFER
+    if (sendBuffLen == 0 || !conn.connected()) {
+        return true;
+    }
+    const size_t len = sendBuffLen;
+    sendBuffLen = 0;
+#ifdef BLYNK_USE_MSG_QUEUE
+    const millis_time_t t = BlynkMillis();
+    for (; msgUnflushed > 0; msgUnflushed--) {
+        msgSentAt[(msgSentHead + BLYNK_MSG_LIMIT - msgUnflushed) % BLYNK_MSG_LIMIT] = t;
+    }
+#endif
+    return writeBuff(sendBuff, len);
+#else
+    return true;
+#endif
+}
+
+#ifdef BLYNK_USE_MSG_QUEUE
+
+template <class Transp>
+bool BlynkProtocol<Transp>::takeMsgToken()
+{
+    const millis_time_t t = BlynkMillis();
+    // A millisecond tick can be up to 1 ms short, so the slot frees only
+    // once more than a second has passed on the clock
+    if (msgSentCount == BLYNK_MSG_LIMIT && millis_time_t(t - msgSentAt[msgSentHead]) <= 1000) {
+        return false;
+    }
+    msgSentAt[msgSentHead] = t;
+    msgSentHead = (msgSentHead + 1) % BLYNK_MSG_LIMIT;
+    if (msgSentCount < BLYNK_MSG_LIMIT) {
+        msgSentCount++;
+    }
+#ifdef BLYNK_USE_SEND_BUFFER
+    if (msgUnflushed < msgSentCount) {
+        msgUnflushed++;
+    }
+#endif
+    return true;
+}
+
+template <class Transp>
+void BlynkProtocol<Transp>::drainMsgQueue()
+{
+    BLYNK_MUTEX_GUARD(mutex);
+
+    while (!msgQueue.empty()) {
+        const typename BlynkCmdQueue<BLYNK_MSG_QUEUE>::Entry& e = msgQueue.front();
+        if (isLimitedCmd(e.cmd) && !takeMsgToken()) {
+            break;
+        }
+        // A failed write reconnects and clears the queue, pop() copes with that
+        writeCmd(e.cmd, e.id, msgQueue.frontData(), e.length, NULL, 0);
+        msgQueue.pop();
+    }
+}
+
+#endif
+
 template <class Transp>
 uint16_t BlynkProtocol<Transp>::getNextMsgId()
 {
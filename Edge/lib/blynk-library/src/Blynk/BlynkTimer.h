@@ -39,6 +39,10 @@
   #define BLYNK_MAX_TIMERS 16
 #endif
 
+#if BLYNK_MAX_TIMERS > 65535
+  #error "BLYNK_MAX_TIMERS must fit in 16 bits"
+#endif
+
 class SimpleTimer {
 #ifdef BLYNK_HAS_FUNCTIONAL_H
     typedef std::function<void(void)> timer_callback;
@@ -185,6 +189,11 @@ public:
     // returns the number of available timers
     unsigned getNumAvailableTimers() { return MAX_TIMERS - numTimers; };
 
+    // returns the milliseconds until the next timer is due,
+    // 0 if one is overdue or -1 if there are no timers,
+    // so the caller can sleep instead of calling run() in a loop
+    long getNextTimeout();
+
 private:
     // deferred call constants
     const static int DEFCALL_DONTRUN = 0;       // don't call the callback function
@@ -201,9 +210,31 @@ private:
         return timer[id].callback || timer[id].callback_p;
     }
 
-    // find the first available slot
+    // take a free slot, -1 if none
     int findFirstFreeSlot();
 
+    // Pending timers are kept in a binary min-heap ordered by deadline,
+    // so run() only looks at the timers that are due
+    const static uint16_t NOT_QUEUED = 0xFFFF;
+
+    unsigned long deadline(unsigned id) {
+        return timer[id].prev_millis + timer[id].delay;
+    }
+
+    bool isEarlier(unsigned a, unsigned b) {
+        return (long)(deadline(a) - deadline(b)) < 0;
+    }
+
+    void heapInsert(unsigned id);
+    void heapRemove(unsigned id);
+    void heapUpdate(unsigned id);
+    void heapSiftUp(unsigned pos);
+    void heapSiftDown(unsigned pos);
+    void heapSet(unsigned pos, unsigned id) {
+        heap[pos] = id;
+        heapPos[id] = pos;
+    }
+
     typedef struct {
       unsigned long prev_millis;        // value returned by the millis() function in the previous run() call
 
@@ -221,6 +252,15 @@ private:
 
     timer_t timer[MAX_TIMERS];
 
+    uint16_t heap[MAX_TIMERS];      // timer ids, earliest deadline first
+    uint16_t heapPos[MAX_TIMERS];   // position of each timer in heap
+    uint16_t heapSize;
+
+    uint16_t freeSlots[MAX_TIMERS]; // stack of unused timer ids
+    uint16_t numFreeSlots;
+
+    uint16_t due[MAX_TIMERS];       // timers taken off the heap by run()
+
     // actual number of timers in use (-1 means uninitialized)
     int numTimers;
 };
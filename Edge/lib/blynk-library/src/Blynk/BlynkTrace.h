@@ -0,0 +1,236 @@
+/**
+ * @file       BlynkTrace.h
+ * @license    This project is released under the MIT License (MIT)
+ * @date       Oct 2026
+ * @brief      Binary event trace ring
+ *
+ */
+
+#ifndef BlynkTrace_h
+#define BlynkTrace_h
+
+#include <string.h>
+#include <Blynk/BlynkDebug.h>
+
+/*
+ * With BLYNK_TRACE set to a power of two, the protocol records every
+ * message it handles or sends into a ring of that many fixed-size records:
+ * time, event, command, message id, length and the first BLYNK_TRACE_DATA
+ * bytes of the body. Recording is a few stores and a short memcpy, nothing
+ * is formatted or printed, so timing stays close to a build without it.
+ *
+ * BlynkTraceDump() writes the ring out in one piece, scripts/blynk_trace.py
+ * turns that into text. On Linux, BlynkTraceDumpOnCrash() installs signal
+ * handlers that save it to a file. On boards with memory that survives a
+ * reset, define BLYNK_TRACE_ATTR to place the ring there (RTC_NOINIT_ATTR
+ * on ESP32) and dump it after a crash: BlynkTraceBegin() keeps a ring
+ * that is still valid.
+ *
+ * Records are written without locking. Sends from other threads under
+ * BLYNK_MULTITHREADED may overwrite each other, but never run out of
+ * the ring.
+ */
+
+#if defined(BLYNK_TRACE) && BLYNK_TRACE > 0
+#define BLYNK_USE_TRACE
+
+#if (BLYNK_TRACE & (BLYNK_TRACE - 1)) != 0 || BLYNK_TRACE > 32768
+#error "BLYNK_TRACE must be a power of two, up to 32768"
+#endif
+
+#ifndef BLYNK_TRACE_DATA
+#define BLYNK_TRACE_DATA 6
+#endif
+
+#ifndef BLYNK_TRACE_ATTR
+#define BLYNK_TRACE_ATTR
+#endif
+
+#define BLYNK_TRACE_MAGIC 0x43525442UL // "BTRC"
+
+enum BlynkTraceEvent {
+    BLYNK_TRACE_RX         = 1,    // Message from the server
+    BLYNK_TRACE_TX         = 2,    // Message to the server
+    BLYNK_TRACE_RX_SKIP    = 3,    // Oversized message dropped
+    BLYNK_TRACE_CONNECT    = 4,
+    BLYNK_TRACE_DISCONNECT = 5,
+    BLYNK_TRACE_USER       = 0x80  // First id free for the application
+};
+
+struct BlynkTraceRecord {
+    uint32_t time;
+    uint8_t  event;
+    uint8_t  cmd;
+    uint16_t id;
+    uint16_t length;
+    uint8_t  data[BLYNK_TRACE_DATA];
+};
+
+// Dump layout, records follow oldest first (little-endian as on the device)
+struct BlynkTraceHeader {
+    uint32_t magic;
+    uint8_t  version;
+    uint8_t  recordSize;
+    uint16_t dataSize;
+    uint32_t count;     // Records written in total
+    uint16_t capacity;
+    uint16_t records;   // Records in this dump
+};
+
+struct BlynkTraceRing {
+    uint32_t magic;
+    uint32_t head;
+    BlynkTraceRecord records[BLYNK_TRACE];
+};
+
+// A template, so the header alone defines the ring once per program
+template <int N>
+struct BlynkTraceStorage {
+    static BlynkTraceRing ring;
+};
+
+template <int N>
+BLYNK_TRACE_ATTR BlynkTraceRing BlynkTraceStorage<N>::ring;
+
+inline
+void BlynkTraceBegin()
+{
+    BlynkTraceRing& ring = BlynkTraceStorage<0>::ring;
+    if (ring.magic != BLYNK_TRACE_MAGIC) {
+        memset(&ring, 0, sizeof(ring));
+        ring.magic = BLYNK_TRACE_MAGIC;
+    }
+}
+
+inline
+void BlynkTraceClear()
+{
+    BlynkTraceStorage<0>::ring.head = 0;
+}
+
+inline
+void BlynkTrace(uint8_t event, uint8_t cmd, uint16_t id, uint16_t length,
+                const void* data = NULL, size_t avail = 0)
+{
+    BlynkTraceRing& ring = BlynkTraceStorage<0>::ring;
+    BlynkTraceRecord& r = ring.records[ring.head++ & (BLYNK_TRACE - 1)];
+    r.time   = BlynkMillis();
+    r.event  = event;
+    r.cmd    = cmd;
+    r.id     = id;
+    r.length = length;
+    const size_t n = (avail < BLYNK_TRACE_DATA) ? avail : BLYNK_TRACE_DATA;
+    if (n) {
+        memcpy(r.data, data, n);
+    }
+    if (n < BLYNK_TRACE_DATA) {
+        memset(r.data + n, 0, BLYNK_TRACE_DATA - n);
+    }
+}
+
+inline
+void BlynkTraceFill(BlynkTraceHeader& hdr, uint32_t& first)
+{
+    const BlynkTraceRing& ring = BlynkTraceStorage<0>::ring;
+    hdr.magic      = BLYNK_TRACE_MAGIC;
+    hdr.version    = 1;
+    hdr.recordSize = sizeof(BlynkTraceRecord);
+    hdr.dataSize   = BLYNK_TRACE_DATA;
+    hdr.count      = ring.head;
+    hdr.capacity   = BLYNK_TRACE;
+    hdr.records    = (ring.head < BLYNK_TRACE) ? ring.head : BLYNK_TRACE;
+    first          = ring.head - hdr.records;
+}
+
+// out needs write(const uint8_t*, size_t), as Arduino streams have
+template <class Out>
+void BlynkTraceDump(Out& out)
+{
+    const BlynkTraceRing& ring = BlynkTraceStorage<0>::ring;
+    BlynkTraceHeader hdr;
+    uint32_t first;
+    BlynkTraceFill(hdr, first);
+    out.write((const uint8_t*)&hdr, sizeof(hdr));
+    for (uint32_t i = 0; i < hdr.records; i++) {
+        const BlynkTraceRecord& r = ring.records[(first + i) & (BLYNK_TRACE - 1)];
+        out.write((const uint8_t*)&r, sizeof(r));
+    }
+}
+
+#if defined(LINUX)
+
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+
+// Plain write(2), so it may be called from a signal handler
+inline
+bool BlynkTraceDumpFd(int fd)
+{
+    struct FdOut {
+        int fd;
+        bool ok;
+        void write(const uint8_t* buf, size_t len) {
+            while (ok && len) {
+                const ssize_t w = ::write(fd, buf, len);
+                if (w <= 0) {
+                    ok = false;
+                    break;
+                }
+                buf += w;
+                len -= w;
+            }
+        }
+    } out = { fd, true };
+    BlynkTraceDump(out);
+    return out.ok;
+}
+
+inline
+bool BlynkTraceDumpFile(const char* path)
+{
+    const int fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    const bool ok = BlynkTraceDumpFd(fd);
+    ::close(fd);
+    return ok;
+}
+
+template <int N>
+struct BlynkTraceCrash {
+    static const char* path;
+
+    static void handler(int sig) {
+        BlynkTraceDumpFile(path);
+        signal(sig, SIG_DFL);
+        raise(sig);
+    }
+};
+
+template <int N>
+const char* BlynkTraceCrash<N>::path = NULL;
+
+// Save the ring to path when the process dies on a fatal signal
+inline
+void BlynkTraceDumpOnCrash(const char* path)
+{
+    BlynkTraceCrash<0>::path = path;
+    const int sigs[] = { SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT };
+    for (size_t i = 0; i < sizeof(sigs)/sizeof(sigs[0]); i++) {
+        signal(sigs[i], BlynkTraceCrash<0>::handler);
+    }
+}
+
+#endif
+
+#define BLYNK_TRACE_EVENT(...) BlynkTrace(__VA_ARGS__)
+
+#else
+
+#define BLYNK_TRACE_EVENT(...)
+
+#endif
+
+#endif
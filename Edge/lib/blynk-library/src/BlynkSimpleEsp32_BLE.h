@@ -147,7 +147,7 @@ private:
     BLECharacteristic *pCharacteristicTX;
     BLECharacteristic *pCharacteristicRX;
 
-    BlynkFifo<uint8_t, BLYNK_MAX_READBYTES*2> mBuffRX;
+    BlynkFifoSPSC<uint8_t, BLYNK_MAX_READBYTES*2> mBuffRX;
 };
 
 class BlynkEsp32_BLE
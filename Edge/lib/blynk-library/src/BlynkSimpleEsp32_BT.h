@@ -145,7 +145,7 @@ class BlynkTransportEsp32_BT
     bool mConn;
     const char* mName;
 
-    BlynkFifo<uint8_t, BLYNK_MAX_READBYTES * 2> mBuffRX;
+    BlynkFifoSPSC<uint8_t, BLYNK_MAX_READBYTES * 2> mBuffRX;
 
     static void esp_spp_cb(esp_spp_cb_event_t event, esp_spp_cb_param_t *param)
     {
@@ -11,8 +11,15 @@
 #ifndef BlynkFifo_h
 #define BlynkFifo_h
 
+#include <string.h>
 #include <Blynk/BlynkUtility.h>
 
+#if defined(__has_include)
+    #if __has_include(<atomic>)
+        #define BLYNK_HAS_ATOMIC_H
+    #endif
+#endif
+
 template <class T, unsigned N>
 class BlynkFifo
 {
@@ -155,4 +162,266 @@ private:
     volatile int  _r;
 };
 
+#ifdef BLYNK_HAS_ATOMIC_H
+
+#include <atomic>
+
+#if defined(BLYNK_MULTITHREADED) || defined(LINUX)
+    #include <mutex>
+    #include <condition_variable>
+    #include <chrono>
+    #define BLYNK_FIFO_USE_CONDVAR
+#endif
+
+#ifndef BLYNK_FIFO_WAIT_SLICE_MS
+    #define BLYNK_FIFO_WAIT_SLICE_MS 2
+#endif
+
+#ifndef BLYNK_CACHE_LINE
+    #if defined(LINUX)
+        #define BLYNK_CACHE_LINE 64
+    #else
+        #define BLYNK_CACHE_LINE 4
+    #endif
+#endif
+
+template <unsigned N, unsigned P = 1, bool Done = (P >= N)>
+struct BlynkFifoCapacity {
+    static const unsigned value = BlynkFifoCapacity<N, P * 2>::value;
+};
+
+template <unsigned N, unsigned P>
+struct BlynkFifoCapacity<N, P, true> {
+    static const unsigned value = P;
+};
+
+/*
+ * Single producer, single consumer FIFO with the same API as BlynkFifo,
+ * safe between two threads or a task and an ISR without locking.
+ *
+ * The indices run freely and are published with release/acquire, each on
+ * its own cache line next to the owner's cached copy of the other index.
+ * Capacity is N rounded up to a power of two, all of it usable.
+ *
+ * Blocking calls sleep on a condition variable where threads are
+ * available (Linux, BLYNK_MULTITHREADED), elsewhere they poll with
+ * BlynkDelay(1). Don't block on a FIFO whose other side is an ISR.
+ *
+ * The fast path doesn't pay for a full fence: a wakeup that races with a
+ * sleeper going to bed can be missed, so sleeps are cut into slices of
+ * BLYNK_FIFO_WAIT_SLICE_MS and such a miss costs at most one slice.
+ */
+template <class T, unsigned N>
+class BlynkFifoSPSC
+{
+public:
+    static const unsigned CAPACITY = BlynkFifoCapacity<N>::value;
+    static const uint32_t WAIT_FOREVER = 0xFFFFFFFF;
+
+    BlynkFifoSPSC()
+        : _w(0), _rCache(0), _r(0), _wCache(0)
+#ifdef BLYNK_FIFO_USE_CONDVAR
+        , _sleepers(0)
+#endif
+    {}
+
+    // only while neither side is active
+    void clear()
+    {
+        _w.store(0, std::memory_order_relaxed);
+        _r.store(0, std::memory_order_relaxed);
+        _rCache = _wCache = 0;
+    }
+
+    // writing thread/context API
+    //-------------------------------------------------------------
+
+    bool writeable(void)
+    {
+        return free() > 0;
+    }
+
+    int free(void)
+    {
+        const unsigned w = _w.load(std::memory_order_relaxed);
+        if (w - _rCache == CAPACITY) {
+            _rCache = _r.load(std::memory_order_acquire);
+        }
+        return CAPACITY - (w - _rCache);
+    }
+
+    T put(const T& c)
+    {
+        put(&c, 1, true);
+        return c;
+    }
+
+    int put(const T* p, int n, bool blocking = false)
+    {
+        int c = n;
+        while (c)
+        {
+            int f = free();
+            if (!f) {
+                if (!blocking || !waitWriteable(WAIT_FOREVER)) {
+                    break;
+                }
+                continue;
+            }
+            if (c < f) f = c;
+            const unsigned w = _w.load(std::memory_order_relaxed);
+            const unsigned i = w & (CAPACITY - 1);
+            // check wrap
+            const int m = CAPACITY - i;
+            if (f > m) f = m;
+            memcpy(&_b[i], p, f * sizeof(T));
+            _w.store(w + f, std::memory_order_release);
+            wake();
+            c -= f;
+            p += f;
+        }
+        return n - c;
+    }
+
+    // wait up to ms milliseconds for free space
+    bool waitWriteable(uint32_t ms)
+    {
+        return wait(false, ms);
+    }
+
+    // reading thread/context API
+    // --------------------------------------------------------
+
+    bool readable(void)
+    {
+        return size() > 0;
+    }
+
+    size_t size(void)
+    {
+        const unsigned r = _r.load(std::memory_order_relaxed);
+        if (_wCache == r) {
+            _wCache = _w.load(std::memory_order_acquire);
+        }
+        return _wCache - r;
+    }
+
+    T get(void)
+    {
+        T t;
+        get(&t, 1, true);
+        return t;
+    }
+
+    T peek(void)
+    {
+        while (!readable()) {
+            waitReadable(WAIT_FOREVER);
+        }
+        return _b[_r.load(std::memory_order_relaxed) & (CAPACITY - 1)];
+    }
+
+    int get(T* p, int n, bool blocking = false)
+    {
+        int c = n;
+        while (c)
+        {
+            int f = size();
+            if (!f) {
+                if (!blocking || !waitReadable(WAIT_FOREVER)) {
+                    break;
+                }
+                continue;
+            }
+            if (c < f) f = c;
+            const unsigned r = _r.load(std::memory_order_relaxed);
+            const unsigned i = r & (CAPACITY - 1);
+            // check wrap
+            const int m = CAPACITY - i;
+            if (f > m) f = m;
+            memcpy(p, &_b[i], f * sizeof(T));
+            _r.store(r + f, std::memory_order_release);
+            wake();
+            c -= f;
+            p += f;
+        }
+        return n - c;
+    }
+
+    // wait up to ms milliseconds for data
+    bool waitReadable(uint32_t ms)
+    {
+        return wait(true, ms);
+    }
+
+private:
+    bool ready(bool forData)
+    {
+        return forData ? readable() : writeable();
+    }
+
+#ifdef BLYNK_FIFO_USE_CONDVAR
+    bool wait(bool forData, uint32_t ms)
+    {
+        const millis_time_t started = BlynkMillis();
+        bool ok = ready(forData);
+        if (ok) {
+            return true;
+        }
+        _sleepers.fetch_add(1, std::memory_order_seq_cst);
+        std::unique_lock<std::mutex> lock(_lock);
+        while (!(ok = ready(forData))) {
+            uint32_t slice = BLYNK_FIFO_WAIT_SLICE_MS;
+            if (ms != WAIT_FOREVER) {
+                const uint32_t spent = BlynkMillis() - started;
+                if (spent >= ms) {
+                    break;
+                }
+                slice = BlynkMin(slice, ms - spent);
+            }
+            _cond.wait_for(lock, std::chrono::milliseconds(slice));
+        }
+        _sleepers.fetch_sub(1, std::memory_order_relaxed);
+        return ok;
+    }
+
+    void wake()
+    {
+        if (_sleepers.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(_lock);
+            _cond.notify_all();
+        }
+    }
+#else
+    bool wait(bool forData, uint32_t ms)
+    {
+        const millis_time_t started = BlynkMillis();
+        while (!ready(forData)) {
+            if (ms != WAIT_FOREVER && BlynkMillis() - started >= ms) {
+                return false;
+            }
+            BlynkDelay(1);
+        }
+        return true;
+    }
+
+    void wake() {}
+#endif
+
+    // producer side
+    alignas(BLYNK_CACHE_LINE) std::atomic<unsigned> _w;
+    unsigned      _rCache;
+    // consumer side
+    alignas(BLYNK_CACHE_LINE) std::atomic<unsigned> _r;
+    unsigned      _wCache;
+#ifdef BLYNK_FIFO_USE_CONDVAR
+    alignas(BLYNK_CACHE_LINE) std::atomic<int> _sleepers;
+    std::mutex    _lock;
+    std::condition_variable _cond;
+#endif
+    alignas(BLYNK_CACHE_LINE) T _b[CAPACITY];
+};
+
+#endif /* BLYNK_HAS_ATOMIC_H */
+
 #endif
@@ -28,6 +28,7 @@
 
 
 #include "Blynk/BlynkTimer.h"
+#include "Blynk/BlynkMetrics.h"
 #include <string.h>
 
 // Select time function:
@@ -36,7 +37,9 @@ static inline unsigned long elapsed() { return BlynkMillis(); }
 
 
 SimpleTimer::SimpleTimer()
-    : numTimers (-1)
+    : heapSize(0)
+    , numFreeSlots(0)
+    , numTimers (-1)
 {
 }
 
@@ -46,65 +49,85 @@ void SimpleTimer::init() {
     for (int i = 0; i < MAX_TIMERS; i++) {
         timer[i] = timer_t();
         timer[i].prev_millis = current_millis;
+        heapPos[i] = NOT_QUEUED;
+        // lowest ids are handed out first
+        freeSlots[i] = MAX_TIMERS - 1 - i;
     }
 
+    heapSize = 0;
+    numFreeSlots = MAX_TIMERS;
     numTimers = 0;
 }
 
 
 void SimpleTimer::run() {
-    int i;
+    unsigned i, k, numDue = 0;
     unsigned long current_millis;
 
     // get current time
     current_millis = elapsed();
 
-    for (i = 0; i < MAX_TIMERS; i++) {
+    // take every due timer off the heap before anything is rescheduled,
+    // so a zero delay timer runs once per call
+    while (heapSize && (long)(current_millis - deadline(heap[0])) >= 0) {
+        due[numDue++] = heap[0];
+        heapRemove(heap[0]);
+    }
+
+    for (k = 0; k < numDue; k++) {
+        i = due[k];
 
         timer[i].toBeCalled = DEFCALL_DONTRUN;
 
-        // jump over empty slots
-        if (isValidTimer(i)) {
+        if (timer[i].enabled) {
+            BLYNK_METRIC_OBSERVE(timerLag, (long)(current_millis - deadline(i)));
+        }
 
-            // is it time to process this timer ?
-            // see http://arduino.cc/forum/index.php/topic,124048.msg932592.html#msg932592
+        // is it time to process this timer ?
+        // see http://arduino.cc/forum/index.php/topic,124048.msg932592.html#msg932592
 
-            if ((current_millis - timer[i].prev_millis) >= timer[i].delay) {
+        if (timer[i].delay) {
+            unsigned long skipTimes = (current_millis - timer[i].prev_millis) / timer[i].delay;
+            // update time
+            timer[i].prev_millis += timer[i].delay * skipTimes;
+        } else {
+            timer[i].prev_millis = current_millis;
+        }
 
-                if (timer[i].delay) {
-                    unsigned long skipTimes = (current_millis - timer[i].prev_millis) / timer[i].delay;
-                    // update time
-                    timer[i].prev_millis += timer[i].delay * skipTimes;
-                } else {
-                    timer[i].prev_millis = current_millis;
-                }
+        // check if the timer callback has to be executed
+        if (timer[i].enabled) {
 
-                // check if the timer callback has to be executed
-                if (timer[i].enabled) {
-
-                    // "run forever" timers must always be executed
-                    if (timer[i].maxNumRuns == RUN_FOREVER) {
-                        timer[i].toBeCalled = DEFCALL_RUNONLY;
-                    }
-                    // other timers get executed the specified number of times
-                    else if (timer[i].numRuns < timer[i].maxNumRuns) {
-                        timer[i].toBeCalled = DEFCALL_RUNONLY;
-                        timer[i].numRuns++;
-
-                        // after the last run, delete the timer
-                        if (timer[i].numRuns >= timer[i].maxNumRuns) {
-                            timer[i].toBeCalled = DEFCALL_RUNANDDEL;
-                        }
-                    }
+            // "run forever" timers must always be executed
+            if (timer[i].maxNumRuns == RUN_FOREVER) {
+                timer[i].toBeCalled = DEFCALL_RUNONLY;
+            }
+            // other timers get executed the specified number of times
+            else if (timer[i].numRuns < timer[i].maxNumRuns) {
+                timer[i].toBeCalled = DEFCALL_RUNONLY;
+                timer[i].numRuns++;
+
+                // after the last run, delete the timer
+                if (timer[i].numRuns >= timer[i].maxNumRuns) {
+                    timer[i].toBeCalled = DEFCALL_RUNANDDEL;
                 }
             }
         }
+
+        // timers that stay are queued for their next deadline
+        if (timer[i].toBeCalled != DEFCALL_RUNANDDEL) {
+            heapInsert(i);
+        }
     }
 
-    for (i = 0; i < MAX_TIMERS; i++) {
+    for (k = 0; k < numDue; k++) {
+        i = due[k];
+
+        // a callback may have deleted this timer (which resets toBeCalled)
         if (timer[i].toBeCalled == DEFCALL_DONTRUN)
             continue;
 
+        BLYNK_METRIC_INC(timerRuns, 1);
+
         if (timer[i].hasParam)
             timer[i].callback_p(timer[i].param);
         else
@@ -116,23 +139,95 @@ void SimpleTimer::run() {
 }
 
 
-// find the first available slot
+long SimpleTimer::getNextTimeout() {
+    if (numTimers <= 0 || !heapSize) {
+        return -1;
+    }
+
+    long timeout = (long)(deadline(heap[0]) - elapsed());
+    return (timeout > 0) ? timeout : 0;
+}
+
+
+// take a slot from the free stack
 // return -1 if none found
 int SimpleTimer::findFirstFreeSlot() {
     // all slots are used
-    if (numTimers >= MAX_TIMERS) {
+    if (numTimers >= MAX_TIMERS || !numFreeSlots) {
         return -1;
     }
 
-    // return the first slot with no callback (i.e. free)
-    for (int i = 0; i < MAX_TIMERS; i++) {
-        if (!isValidTimer(i)) {
-            return i;
+    return freeSlots[--numFreeSlots];
+}
+
+
+void SimpleTimer::heapSiftUp(unsigned pos) {
+    unsigned id = heap[pos];
+    while (pos > 0) {
+        unsigned parent = (pos - 1) / 2;
+        if (!isEarlier(id, heap[parent])) {
+            break;
         }
+        heapSet(pos, heap[parent]);
+        pos = parent;
     }
+    heapSet(pos, id);
+}
 
-    // no free slots found
-    return -1;
+void SimpleTimer::heapSiftDown(unsigned pos) {
+    unsigned id = heap[pos];
+    for (;;) {
+        unsigned child = 2 * pos + 1;
+        if (child >= heapSize) {
+            break;
+        }
+        if (child + 1 < heapSize && isEarlier(heap[child + 1], heap[child])) {
+            child++;
+        }
+        if (!isEarlier(heap[child], id)) {
+            break;
+        }
+        heapSet(pos, heap[child]);
+        pos = child;
+    }
+    heapSet(pos, id);
+}
+
+void SimpleTimer::heapInsert(unsigned id) {
+    if (heapPos[id] != NOT_QUEUED) {
+        return;
+    }
+    heapSet(heapSize, id);
+    heapSiftUp(heapSize++);
+}
+
+void SimpleTimer::heapRemove(unsigned id) {
+    unsigned pos = heapPos[id];
+    if (pos == NOT_QUEUED) {
+        return;
+    }
+    heapPos[id] = NOT_QUEUED;
+
+    if (pos == --heapSize) {
+        return;
+    }
+    // move the last timer into the hole and restore the order
+    unsigned moved = heap[heapSize];
+    heapSet(pos, moved);
+    heapSiftUp(pos);
+    heapSiftDown(heapPos[moved]);
+}
+
+void SimpleTimer::heapUpdate(unsigned id) {
+    if (numTimers < 0) {
+        return;
+    }
+    unsigned pos = heapPos[id];
+    if (pos == NOT_QUEUED) {
+        return;
+    }
+    heapSiftUp(pos);
+    heapSiftDown(heapPos[id]);
 }
 
 
@@ -143,12 +238,12 @@ int SimpleTimer::setupTimer(unsigned long d, const timer_callback& f, unsigned n
         init();
     }
 
-    freeTimer = findFirstFreeSlot();
-    if (freeTimer < 0) {
+    if (f == NULL) {
         return -1;
     }
 
-    if (f == NULL) {
+    freeTimer = findFirstFreeSlot();
+    if (freeTimer < 0) {
         return -1;
     }
 
@@ -158,6 +253,7 @@ int SimpleTimer::setupTimer(unsigned long d, const timer_callback& f, unsigned n
     timer[freeTimer].maxNumRuns = n;
     timer[freeTimer].enabled = true;
     timer[freeTimer].prev_millis = elapsed();
+    heapInsert(freeTimer);
 
     numTimers++;
 
@@ -171,12 +267,12 @@ int SimpleTimer::setupTimer(unsigned long d, timer_callback_p f, void* p, unsign
         init();
     }
 
-    freeTimer = findFirstFreeSlot();
-    if (freeTimer < 0) {
+    if (f == NULL) {
         return -1;
     }
 
-    if (f == NULL) {
+    freeTimer = findFirstFreeSlot();
+    if (freeTimer < 0) {
         return -1;
     }
 
@@ -187,6 +283,7 @@ int SimpleTimer::setupTimer(unsigned long d, timer_callback_p f, void* p, unsign
     timer[freeTimer].maxNumRuns = n;
     timer[freeTimer].enabled = true;
     timer[freeTimer].prev_millis = elapsed();
+    heapInsert(freeTimer);
 
     numTimers++;
 
@@ -202,6 +299,7 @@ bool SimpleTimer::changeInterval(unsigned numTimer, unsigned long d) {
     if (isValidTimer(numTimer)) {
         timer[numTimer].delay = d;
         timer[numTimer].prev_millis = elapsed();
+        heapUpdate(numTimer);
         return true;
     }
     // false return for non-used numTimer, no callback
@@ -221,8 +319,10 @@ void SimpleTimer::deleteTimer(unsigned timerId) {
     // don't decrease the number of timers if the
     // specified slot is already empty
     if (isValidTimer(timerId)) {
+        heapRemove(timerId);
         timer[timerId] = timer_t();
         timer[timerId].prev_millis = elapsed();
+        freeSlots[numFreeSlots++] = timerId;
 
         // update number of timers
         numTimers--;
@@ -237,6 +337,7 @@ void SimpleTimer::restartTimer(unsigned numTimer) {
     }
 
     timer[numTimer].prev_millis = elapsed();
+    heapUpdate(numTimer);
 }
 
 void SimpleTimer::executeNow(unsigned numTimer) {
@@ -245,6 +346,7 @@ void SimpleTimer::executeNow(unsigned numTimer) {
     }
 
     timer[numTimer].prev_millis = elapsed() - timer[numTimer].delay;
+    heapUpdate(numTimer);
 }
 
 bool SimpleTimer::isEnabled(unsigned numTimer) {
@@ -0,0 +1,197 @@
+#!/usr/bin/env python3
+'''
+ This is a pseudo-server for load testing many devices at once.
+ It accepts any auth token, answers pings and sends every logged in device
+ a virtual pin write on V1 at the given rate. The device is expected to echo
+ the value back on V2, the round trip time is reported periodically.
+
+ Use it with linux/bench_epoll.cpp:
+
+   ./tests/pseudo-server-load.py --port 8888 --rate 1
+   ./linux/bench_epoll --serv 127.0.0.1 --port 8888 --devices 1000
+
+ License:  The MIT license
+'''
+import selectors, socket, struct
+import sys, time, getopt
+
+# Parse command line options
+opts, args = getopt.getopt(sys.argv[1:],
+    "hb:p:",
+    ["help", "bind=", "port=", "rate=", "report=", "duration="])
+
+HOST = ''       # Bind to all interfaces
+PORT = 8888     # Bind to port 8888
+RATE = 1.0      # Commands per device per second
+REPORT = 5.0    # Report interval
+DURATION = 0    # Run forever
+
+for o, v in opts:
+    if o in ("-h", "--help"):
+        print(__doc__)
+        sys.exit()
+    elif o in ("-b", "--bind"):
+        HOST = v
+    elif o in ("-p", "--port"):
+        PORT = int(v)
+    elif o in ("--rate",):
+        RATE = float(v)
+    elif o in ("--report",):
+        REPORT = float(v)
+    elif o in ("--duration",):
+        DURATION = float(v)
+
+# Blynk protocol helpers
+
+hdr = struct.Struct("!BHH")
+
+class MsgType:
+    RSP      = 0
+    LOGIN    = 2
+    PING     = 6
+    HW       = 20
+    HW_LOGIN = 29
+
+class MsgStatus:
+    OK     = 200
+
+start_time = time.time()
+def log(msg):
+    print("[{:7.3f}] {:}".format(float(time.time() - start_time), msg), flush=True)
+
+class Client:
+    def __init__(self, sock):
+        self.sock = sock
+        self.rx = b''
+        self.tx = b''
+        self.authenticated = False
+        self.msg_id = 1
+
+stats = { "msgs_in": 0, "cmds_out": 0, "echoes": 0 }
+rtts = []
+clients = {}
+sel = selectors.DefaultSelector()
+
+def send(c, data):
+    if not c.tx:
+        try:
+            n = c.sock.send(data)
+        except BlockingIOError:
+            n = 0
+        except OSError:
+            drop(c)
+            return
+        data = data[n:]
+        if data:
+            sel.modify(c.sock, selectors.EVENT_READ | selectors.EVENT_WRITE, c)
+    c.tx += data
+
+def drop(c):
+    if c.sock.fileno() in clients:
+        del clients[c.sock.fileno()]
+        sel.unregister(c.sock)
+    c.sock.close()
+
+def process(c, msg_type, msg_id, body):
+    stats["msgs_in"] += 1
+    if msg_type in (MsgType.LOGIN, MsgType.HW_LOGIN):
+        send(c, hdr.pack(MsgType.RSP, msg_id, MsgStatus.OK))
+        c.authenticated = True
+    elif msg_type == MsgType.PING:
+        send(c, hdr.pack(MsgType.RSP, msg_id, MsgStatus.OK))
+    elif msg_type == MsgType.HW:
+        args = body.split(b'\0')
+        if len(args) >= 3 and args[0] == b'vw' and args[1] == b'2':
+            rtts.append(time.monotonic_ns() - int(args[2]))
+            stats["echoes"] += 1
+
+def on_read(c):
+    try:
+        data = c.sock.recv(65536)
+    except BlockingIOError:
+        return
+    except OSError:
+        data = b''
+    if not data:
+        drop(c)
+        return
+    c.rx += data
+    while len(c.rx) >= hdr.size:
+        msg_type, msg_id, msg_len = hdr.unpack_from(c.rx)
+        body_len = 0 if msg_type == MsgType.RSP else msg_len
+        if len(c.rx) < hdr.size + body_len:
+            break
+        process(c, msg_type, msg_id, c.rx[hdr.size:hdr.size + body_len])
+        c.rx = c.rx[hdr.size + body_len:]
+
+def on_write(c):
+    try:
+        n = c.sock.send(c.tx)
+    except BlockingIOError:
+        return
+    except OSError:
+        drop(c)
+        return
+    c.tx = c.tx[n:]
+    if not c.tx:
+        sel.modify(c.sock, selectors.EVENT_READ, c)
+
+def send_commands():
+    now = str(time.monotonic_ns()).encode()
+    for c in list(clients.values()):
+        if c.authenticated:
+            c.msg_id = c.msg_id % 65535 + 1
+            body = b'vw\x001\x00' + now
+            send(c, hdr.pack(MsgType.HW, c.msg_id, len(body)) + body)
+            stats["cmds_out"] += 1
+
+def report():
+    authenticated = sum(1 for c in clients.values() if c.authenticated)
+    line = "clients {0}, logged in {1}, cmds out {2}, msgs in {3}, echoes {4}".format(
+        len(clients), authenticated, stats["cmds_out"], stats["msgs_in"], stats["echoes"])
+    if rtts:
+        rtts.sort()
+        line += ", rtt p50 {0:.2f} ms, p99 {1:.2f} ms".format(
+            rtts[len(rtts) // 2] / 1e6, rtts[len(rtts) * 99 // 100] / 1e6)
+        del rtts[:]
+    log(line)
+
+# Main code
+
+serv = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+serv.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+serv.bind((HOST, PORT))
+serv.listen(1024)
+serv.setblocking(False)
+sel.register(serv, selectors.EVENT_READ, None)
+log('Listening on port %d' % PORT)
+
+next_cmd = time.monotonic() + 1.0 / RATE
+next_report = time.monotonic() + REPORT
+end = time.monotonic() + DURATION if DURATION else None
+
+while end is None or time.monotonic() < end:
+    timeout = max(0, min(next_cmd, next_report) - time.monotonic())
+    for key, mask in sel.select(timeout):
+        if key.data is None:
+            try:
+                sock, addr = serv.accept()
+            except BlockingIOError:
+                continue
+            sock.setblocking(False)
+            sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+            c = Client(sock)
+            clients[sock.fileno()] = c
+            sel.register(sock, selectors.EVENT_READ, c)
+            continue
+        if mask & selectors.EVENT_READ:
+            on_read(key.data)
+        if mask & selectors.EVENT_WRITE and key.data.sock.fileno() in clients:
+            on_write(key.data)
+    now = time.monotonic()
+    if now >= next_cmd:
+        send_commands()
+        next_cmd += 1.0 / RATE
+    if now >= next_report:
+        report()
+        next_report += REPORT
@@ -33,6 +33,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <freertos/event_groups.h>
@@ -49,6 +50,7 @@
 #include <cJSON.h>
 #include <esp_netif.h>
 #include <esp_http_client.h>
+#include <esp_rom_crc.h>
 
 // Configuration constants
 #define WIFI_SSID               "YOUR_WIFI_SSID"
@@ -67,13 +69,17 @@
 #define STATUS_LED_PIN          GPIO_NUM_13
 #define BUTTON_PIN              GPIO_NUM_0
 
-// System configuration
+// System configuration defaults, changed at runtime through irrigation/config
 #define SOIL_MOISTURE_THRESHOLD     30      // Percentage below which irrigation starts
+#define MOISTURE_HYSTERESIS         10      // Irrigation stops this far above the threshold
 #define MAX_IRRIGATION_TIME_MS      300000  // 5 minutes maximum irrigation time
 #define SENSOR_READ_INTERVAL_MS     30000   // Read sensors every 30 seconds
 #define MQTT_PUBLISH_INTERVAL_MS    60000   // Publish data every minute
 #define MIN_IRRIGATION_INTERVAL_MS  1800000 // Minimum 30 minutes between irrigation cycles
 
+#define APP_CONFIG_NVS_NAMESPACE    "app_config"
+#define APP_CONFIG_NVS_KEY          "config"
+
 // Event bits
 #define WIFI_CONNECTED_BIT      BIT0
 #define MQTT_CONNECTED_BIT      BIT1
@@ -84,6 +90,43 @@
 // Global variables
 static adc_oneshot_unit_handle_t adc1_handle;
 
+// Runtime configuration, always replaced as a whole under s_config_lock
+typedef struct {
+    uint32_t soil_moisture_threshold;
+    uint32_t moisture_hysteresis;
+    uint32_t max_irrigation_time_ms;
+    uint32_t sensor_read_interval_ms;
+    uint32_t mqtt_publish_interval_ms;
+    uint32_t min_irrigation_interval_ms;
+} app_config_t;
+
+typedef struct {
+    const char *name;
+    size_t offset;
+    uint32_t min;
+    uint32_t max;
+} app_config_field_t;
+
+static const app_config_t s_default_config = {
+    .soil_moisture_threshold = SOIL_MOISTURE_THRESHOLD,
+    .moisture_hysteresis = MOISTURE_HYSTERESIS,
+    .max_irrigation_time_ms = MAX_IRRIGATION_TIME_MS,
+    .sensor_read_interval_ms = SENSOR_READ_INTERVAL_MS,
+    .mqtt_publish_interval_ms = MQTT_PUBLISH_INTERVAL_MS,
+    .min_irrigation_interval_ms = MIN_IRRIGATION_INTERVAL_MS,
+};
+
+static const app_config_field_t s_config_fields[] = {
+    { "soil_moisture_threshold", offsetof(app_config_t, soil_moisture_threshold), 1, 95 },
+    { "moisture_hysteresis", offsetof(app_config_t, moisture_hysteresis), 1, 50 },
+    { "max_irrigation_time_ms", offsetof(app_config_t, max_irrigation_time_ms), 10000, 3600000 },
+    { "sensor_read_interval_ms", offsetof(app_config_t, sensor_read_interval_ms), 1000, 3600000 },
+    { "mqtt_publish_interval_ms", offsetof(app_config_t, mqtt_publish_interval_ms), 5000, 86400000 },
+    { "min_irrigation_interval_ms", offsetof(app_config_t, min_irrigation_interval_ms), 0, 86400000 },
+};
+
+#define APP_CONFIG_FIELD_COUNT (sizeof(s_config_fields) / sizeof(s_config_fields[0]))
+
 // System state structure
 typedef struct {
     float soil_moisture;
@@ -111,6 +154,8 @@ static esp_mqtt_client_handle_t s_mqtt_client;
 static esp_timer_handle_t s_sensor_timer;
 static esp_timer_handle_t s_publish_timer;
 static esp_timer_handle_t s_safety_timer;
+static app_config_t s_config;
+static portMUX_TYPE s_config_lock = portMUX_INITIALIZER_UNLOCKED;
 
 // Function prototypes
 static void system_init(void);
@@ -137,6 +182,10 @@ static void toggle_manual_mode(void);
 static void publish_sensor_data(void);
 static void publish_status(const char* status);
 static void handle_mqtt_command(const char* topic, const char* data);
+static void get_config(app_config_t* config);
+static void load_config(void);
+static void apply_config_patch(const cJSON* patch);
+static void publish_config(void);
 // TODO: Implement sensor functions
 // static void dht22_send_start_signal(void);
 // static bool dht22_wait_for_response(void);
@@ -175,8 +224,10 @@ void app_main(void) {
     ESP_LOGI(TAG, "System initialized successfully!");
     
     // Start timers
-    esp_timer_start_periodic(s_sensor_timer, SENSOR_READ_INTERVAL_MS * 1000);
-    esp_timer_start_periodic(s_publish_timer, MQTT_PUBLISH_INTERVAL_MS * 1000);
+    app_config_t config;
+    get_config(&config);
+    esp_timer_start_periodic(s_sensor_timer, (uint64_t)config.sensor_read_interval_ms * 1000);
+    esp_timer_start_periodic(s_publish_timer, (uint64_t)config.mqtt_publish_interval_ms * 1000);
     
     // Main loop - monitor system health
     while (1) {
@@ -197,6 +248,9 @@ static void system_init(void) {
     }
     ESP_ERROR_CHECK(ret);
     
+    // Load the stored configuration over the defaults
+    load_config();
+    
     // Initialize system state
     memset(&g_system_state, 0, sizeof(system_state_t));
     g_system_state.manual_mode = false;
@@ -375,8 +429,9 @@ static void mqtt_event_handler(void* handler_args, esp_event_base_t base, int32_
             esp_mqtt_client_subscribe(s_mqtt_client, "irrigation/commands", 1);
             esp_mqtt_client_subscribe(s_mqtt_client, "irrigation/config", 1);
             
-            // Publish online status
+            // Publish online status and the active configuration
             publish_status("online");
+            publish_config();
             break;
             
         case MQTT_EVENT_DISCONNECTED:
@@ -460,20 +515,23 @@ static void irrigation_task(void* pvParameters) {
         // Check for new sensor data
         if (xQueueReceive(s_sensor_queue, &sensor_data, 0) == pdTRUE) {
             if (!g_system_state.manual_mode) {
+                app_config_t config;
+                get_config(&config);
+                
                 // Automatic irrigation control
                 if (!g_system_state.irrigation_active && 
-                    sensor_data.soil_moisture < SOIL_MOISTURE_THRESHOLD) {
+                    sensor_data.soil_moisture < config.soil_moisture_threshold) {
                     
                     // Check minimum interval between irrigation cycles
                     uint64_t current_time = esp_timer_get_time();
-                    if (current_time - g_system_state.last_irrigation_time > MIN_IRRIGATION_INTERVAL_MS * 1000) {
+                    if (current_time - g_system_state.last_irrigation_time > (uint64_t)config.min_irrigation_interval_ms * 1000) {
                         start_irrigation();
                     }
                 }
                 
                 // Stop irrigation when moisture is adequate
                 if (g_system_state.irrigation_active && 
-                    sensor_data.soil_moisture > (SOIL_MOISTURE_THRESHOLD + 10)) {
+                    sensor_data.soil_moisture > (config.soil_moisture_threshold + config.moisture_hysteresis)) {
                     stop_irrigation();
                 }
             }
@@ -561,7 +619,9 @@ static void start_irrigation(void) {
     gpio_set_level(VALVE_RELAY_PIN, 1);
     
     // Start safety timer
-    esp_timer_start_once(s_safety_timer, MAX_IRRIGATION_TIME_MS * 1000);
+    app_config_t config;
+    get_config(&config);
+    esp_timer_start_once(s_safety_timer, (uint64_t)config.max_irrigation_time_ms * 1000);
     
     publish_status("irrigating");
 }
@@ -683,7 +743,198 @@ static void handle_mqtt_command(const char* topic, const char* data) {
                 publish_sensor_data();
             }
         }
+    } else if (strcmp(topic, "irrigation/config") == 0) {
+        apply_config_patch(json);
+    }
+    
+    cJSON_Delete(json);
+}
+
+static void get_config(app_config_t* config) {
+    taskENTER_CRITICAL(&s_config_lock);
+    *config = s_config;
+    taskEXIT_CRITICAL(&s_config_lock);
+}
+
+static uint32_t config_etag(const app_config_t* config) {
+    return esp_rom_crc32_le(0, (const uint8_t*)config, sizeof(*config));
+}
+
+static bool config_valid(const app_config_t* config) {
+    for (size_t i = 0; i < APP_CONFIG_FIELD_COUNT; i++) {
+        const app_config_field_t *field = &s_config_fields[i];
+        uint32_t value = *(const uint32_t*)((const uint8_t*)config + field->offset);
+        if (value < field->min || value > field->max) {
+            return false;
+        }
+    }
+    return config->soil_moisture_threshold + config->moisture_hysteresis <= 100;
+}
+
+static void load_config(void) {
+    s_config = s_default_config;
+    
+    nvs_handle_t nvs;
+    if (nvs_open(APP_CONFIG_NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+        return;
+    }
+    
+    app_config_t stored;
+    size_t size = sizeof(stored);
+    if (nvs_get_blob(nvs, APP_CONFIG_NVS_KEY, &stored, &size) == ESP_OK &&
+        size == sizeof(stored) && config_valid(&stored)) {
+        s_config = stored;
+        ESP_LOGI(TAG, "Configuration loaded, etag %08lx", (unsigned long)config_etag(&stored));
+    }
+    nvs_close(nvs);
+}
+
+static void save_config(const app_config_t* config) {
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(APP_CONFIG_NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err == ESP_OK) {
+        err = nvs_set_blob(nvs, APP_CONFIG_NVS_KEY, config, sizeof(*config));
+        if (err == ESP_OK) {
+            err = nvs_commit(nvs);
+        }
+        nvs_close(nvs);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save configuration: %s", esp_err_to_name(err));
+    }
+}
+
+static void publish_config_result(const char* status, uint32_t etag, const char* error) {
+    char etag_string[9];
+    snprintf(etag_string, sizeof(etag_string), "%08lx", (unsigned long)etag);
+    
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddStringToObject(json, "device_id", DEVICE_ID);
+    cJSON_AddStringToObject(json, "status", status);
+    cJSON_AddStringToObject(json, "etag", etag_string);
+    if (error != NULL) {
+        cJSON_AddStringToObject(json, "error", error);
+    }
+    
+    char *json_string = cJSON_PrintUnformatted(json);
+    esp_mqtt_client_publish(s_mqtt_client, "irrigation/config/result", json_string, 0, 1, 0);
+    
+    ESP_LOGI(TAG, "Config %s: %s", status, error != NULL ? error : etag_string);
+    
+    free(json_string);
+    cJSON_Delete(json);
+}
+
+static void publish_config(void) {
+    app_config_t config;
+    get_config(&config);
+    
+    char etag_string[9];
+    snprintf(etag_string, sizeof(etag_string), "%08lx", (unsigned long)config_etag(&config));
+    
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddStringToObject(json, "device_id", DEVICE_ID);
+    cJSON_AddStringToObject(json, "etag", etag_string);
+    for (size_t i = 0; i < APP_CONFIG_FIELD_COUNT; i++) {
+        const app_config_field_t *field = &s_config_fields[i];
+        cJSON_AddNumberToObject(json, field->name, *(const uint32_t*)((const uint8_t*)&config + field->offset));
     }
     
+    // Retained so a dashboard gets the current values and etag on subscribe
+    char *json_string = cJSON_PrintUnformatted(json);
+    esp_mqtt_client_publish(s_mqtt_client, "irrigation/config/state", json_string, 0, 1, 1);
+    
+    free(json_string);
     cJSON_Delete(json);
 }
+
+/*
+ * Apply a JSON merge patch to the configuration. Members are field names,
+ * null restores a default and an optional "etag" guards against patches
+ * built from an outdated view. The patch is validated on a copy and swapped
+ * in only if nothing changed meanwhile, so tasks never see a partial update.
+ */
+static void apply_config_patch(const cJSON* patch) {
+    app_config_t current;
+    get_config(&current);
+    uint32_t base = config_etag(&current);
+    
+    if (!cJSON_IsObject(patch)) {
+        publish_config_result("rejected", base, "patch is not an object");
+        return;
+    }
+    
+    const cJSON *etag = cJSON_GetObjectItemCaseSensitive(patch, "etag");
+    if (etag != NULL && (!cJSON_IsString(etag) || strtoul(etag->valuestring, NULL, 16) != base)) {
+        publish_config_result("conflict", base, "stale etag");
+        return;
+    }
+    
+    app_config_t updated = current;
+    const char *error = NULL;
+    const cJSON *item;
+    cJSON_ArrayForEach(item, patch) {
+        if (strcmp(item->string, "etag") == 0) {
+            continue;
+        }
+        
+        const app_config_field_t *field = NULL;
+        for (size_t i = 0; i < APP_CONFIG_FIELD_COUNT; i++) {
+            if (strcmp(s_config_fields[i].name, item->string) == 0) {
+                field = &s_config_fields[i];
+                break;
+            }
+        }
+        if (field == NULL) {
+            error = "unknown field";
+            break;
+        }
+        
+        uint32_t *value = (uint32_t*)((uint8_t*)&updated + field->offset);
+        if (cJSON_IsNull(item)) {
+            *value = *(const uint32_t*)((const uint8_t*)&s_default_config + field->offset);
+        } else if (cJSON_IsNumber(item) && item->valuedouble >= field->min &&
+                   item->valuedouble <= field->max && item->valuedouble == (uint32_t)item->valuedouble) {
+            *value = (uint32_t)item->valuedouble;
+        } else {
+            error = "value out of range";
+            break;
+        }
+    }
+    if (error == NULL && !config_valid(&updated)) {
+        error = "threshold plus hysteresis above 100";
+    }
+    if (error != NULL) {
+        publish_config_result("rejected", base, error);
+        return;
+    }
+    
+    bool swapped = false;
+    taskENTER_CRITICAL(&s_config_lock);
+    if (memcmp(&s_config, &current, sizeof(current)) == 0) {
+        s_config = updated;
+        swapped = true;
+    }
+    taskEXIT_CRITICAL(&s_config_lock);
+    if (!swapped) {
+        publish_config_result("conflict", base, "configuration changed concurrently");
+        return;
+    }
+    
+    if (memcmp(&updated, &current, sizeof(current)) != 0) {
+        save_config(&updated);
+    }
+    
+    // Periodic timers pick up new intervals only when restarted
+    if (updated.sensor_read_interval_ms != current.sensor_read_interval_ms) {
+        esp_timer_stop(s_sensor_timer);
+        esp_timer_start_periodic(s_sensor_timer, (uint64_t)updated.sensor_read_interval_ms * 1000);
+    }
+    if (updated.mqtt_publish_interval_ms != current.mqtt_publish_interval_ms) {
+        esp_timer_stop(s_publish_timer);
+        esp_timer_start_periodic(s_publish_timer, (uint64_t)updated.mqtt_publish_interval_ms * 1000);
+    }
+    
+    publish_config_result("applied", config_etag(&updated), NULL);
+    publish_config();
+}
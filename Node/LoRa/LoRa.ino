@@ -1,8 +1,10 @@
 #include <SPI.h>
 #include <LoRa.h>
 #include "ds3231.h"
+#include "node_clock.h"
 #include <WiFi.h>
 #include <SD.h>
+#include <Preferences.h>
 
 OLED_CLASS_OBJ display(OLED_ADDRESS, OLED_SDA, OLED_SCL);
 
@@ -15,6 +17,38 @@ OLED_CLASS_OBJ display(OLED_ADDRESS, OLED_SDA, OLED_SCL);
 const int valvePins[NUM_VALVES] = {16, 17, 18, 19}; // Example GPIOs for valves
 const int soilMoisturePins[NUM_VALVES] = {32, 33, 34, 35}; // Example analog pins for soil sensors
 const int tempSensorPin = 36; // Example analog pin for temperature sensor
+#define SOIL_RAW_DRY 4095 // Soil sensor reading in dry air
+#define SOIL_RAW_WET 1500 // Soil sensor reading in water
+#define VALVE_COOLDOWN_PERIOD 300000UL // Soak time after an automatic run before the next
+#define CMD_TYPE_VALVE 0        // EdgeCommand::commandType of a valve command
+#define MAX_FRAME_COMMANDS 8    // DOWNLINK_PER_NODE on the Edge
+
+// --- Settings pushed by the Edge in CFG frames, kept across resets ---
+struct NodeSettings {
+    uint32_t sensorIntervalMs;  // si
+    uint32_t txIntervalMs;      // tx
+    uint16_t moistureLow;       // lo, % below which a valve opens
+    uint16_t moistureHigh;      // hi, % at which it closes again
+    uint32_t valveDurationMs;   // vd, longest automatic run
+    bool autoIrrigation;        // ai, off until a CFG frame enables it
+};
+NodeSettings settings = { 5000, 10000, 30, 70, 30000, false }; // Edge defaults
+Preferences prefs;
+
+// --- Latest readings and valve state ---
+int soilMoisture[NUM_VALVES];
+int temperature = 0;
+uint32_t sampledAt = 0;
+bool valveOpen[NUM_VALVES];
+bool valveAuto[NUM_VALVES];         // Opened by the moisture check rather than a command
+uint32_t valveOpenedAt[NUM_VALVES];
+uint32_t valveClosedAt[NUM_VALVES]; // End of the last automatic run, 0 if none
+
+// --- Time ---
+#define RTC_SET_INTERVAL 86400000UL // DS3231 re-set from the Edge's time daily
+NodeClock nodeClock;
+bool rtcSetPending = false;
+uint32_t rtcSetAt = 0;
 
 void setup()
 {
@@ -27,6 +61,12 @@ void setup()
         digitalWrite(valvePins[i], LOW); // Valves off by default
     }
 
+    prefs.begin("node", false);
+    NodeSettings stored;
+    if (prefs.getBytes("settings", &stored, sizeof(stored)) == sizeof(stored)) {
+        settings = stored;
+    }
+
     // ...existing code for OLED, SD card, and WiFi setup...
 
     WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
@@ -53,11 +93,20 @@ void setup()
         Serial.println("Starting LoRa failed!");
         while (1);
     }
+
+    // The DS3231 keeps time across resets, good enough until the Edge's first beacon
+    uint32_t rtcSeconds;
+    if (ds3231_read_unix(&rtcSeconds)) {
+        nodeClock.setCoarse((uint64_t)rtcSeconds * 1000 + 500, millis());
+    }
     if (!LORA_SENDER) {
         display.clear();
         display.drawString(display.getWidth() / 2, display.getHeight() / 2, "LoraRecv Ready");
         display.display();
     }
+
+    readSensors(soilMoisture, temperature);
+    sampledAt = millis();
 }
 
 int count = 0;
@@ -74,13 +123,101 @@ void readSensors(int* soilMoisture, int& temperature) {
 void controlValve(int valveIndex, bool open) {
     if (valveIndex >= 0 && valveIndex < NUM_VALVES) {
         digitalWrite(valvePins[valveIndex], open ? HIGH : LOW);
+        valveOpen[valveIndex] = open;
+        valveAuto[valveIndex] = false;
+    }
+}
+
+int moisturePercent(int raw) {
+    return constrain(map(raw, SOIL_RAW_DRY, SOIL_RAW_WET, 0, 100), 0, 100);
+}
+
+// Automatic watering: open below lo, close at hi or after vd. Valves opened
+// by a command are left to the Edge.
+void checkValves() {
+    uint32_t now = millis();
+    for (int i = 0; i < NUM_VALVES; i++) {
+        int moisture = moisturePercent(soilMoisture[i]);
+        if (valveAuto[i]) {
+            if (!settings.autoIrrigation || moisture >= settings.moistureHigh ||
+                now - valveOpenedAt[i] >= settings.valveDurationMs) {
+                controlValve(i, false);
+                valveClosedAt[i] = now | 1;
+            }
+        } else if (settings.autoIrrigation && !valveOpen[i] && moisture < settings.moistureLow &&
+                   (valveClosedAt[i] == 0 || now - valveClosedAt[i] >= VALVE_COOLDOWN_PERIOD)) {
+            controlValve(i, true);
+            valveAuto[i] = true;
+            valveOpenedAt[i] = now;
+        }
+    }
+}
+
+bool setSetting(NodeSettings& s, const char* key, size_t keyLen, uint32_t value) {
+    if (keyLen != 2) {
+        return false;
+    }
+    if (strncmp(key, "si", 2) == 0 && value >= 1000) {
+        s.sensorIntervalMs = value;
+    } else if (strncmp(key, "tx", 2) == 0 && value >= 1000) {
+        s.txIntervalMs = value;
+    } else if (strncmp(key, "lo", 2) == 0 && value <= 100) {
+        s.moistureLow = value;
+    } else if (strncmp(key, "hi", 2) == 0 && value <= 100) {
+        s.moistureHigh = value;
+    } else if (strncmp(key, "vd", 2) == 0 && value >= 1000) {
+        s.valveDurationMs = value;
+    } else if (strncmp(key, "ai", 2) == 0 && value <= 1) {
+        s.autoIrrigation = value != 0;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// CFG,<etag>;<target>:<key>=<value>,...;... with target NODE_ID or *. A bad
+// setting anywhere rejects the whole frame.
+void applyConfigFrame(const char* frame) {
+    NodeSettings updated = settings;
+    const char* section = strchr(frame, ';');
+    while (section != NULL) {
+        section++;
+        const char* end = strchr(section, ';');
+        if (end == NULL) {
+            end = section + strlen(section);
+        }
+        const char* colon = (const char*)memchr(section, ':', end - section);
+        if (colon == NULL) {
+            Serial.println("Malformed config frame");
+            return;
+        }
+        bool forUs = (colon - section == 1 && section[0] == '*') || atoi(section) == NODE_ID;
+        const char* p = colon + 1;
+        while (forUs && p < end) {
+            const char* eq = (const char*)memchr(p, '=', end - p);
+            char* next = NULL;
+            uint32_t value = eq != NULL ? strtoul(eq + 1, &next, 10) : 0;
+            if (eq == NULL || next == eq + 1 || !setSetting(updated, p, eq - p, value)) {
+                Serial.println("Rejected config frame: bad setting");
+                return;
+            }
+            p = (*next == ',') ? next + 1 : next;
+        }
+        section = (*end != '\0') ? end : NULL;
+    }
+    if (updated.moistureLow >= updated.moistureHigh) {
+        Serial.println("Rejected config frame: thresholds out of order");
+        return;
+    }
+    if (memcmp(&updated, &settings, sizeof(updated)) != 0) {
+        settings = updated;
+        prefs.putBytes("settings", &settings, sizeof(settings));
+        checkValves();
     }
 }
 
 void sendSensorData() {
-    int soilMoisture[NUM_VALVES];
-    int temperature;
-    readSensors(soilMoisture, temperature);
+    uint64_t sampledAtUtc = nodeClock.toUtc(sampledAt);
     LoRa.beginPacket();
     LoRa.print("DATA,");
     for (int i = 0; i < NUM_VALVES; i++) {
@@ -89,10 +226,63 @@ void sendSensorData() {
     }
     LoRa.print(",");
     LoRa.print(temperature);
+    if (sampledAtUtc) {
+        // UTC ms in hex, as in the Edge's time beacons
+        char stamp[20];
+        snprintf(stamp, sizeof(stamp), ",%llx", (unsigned long long)sampledAtUtc);
+        LoRa.print(stamp);
+    }
     LoRa.endPacket();
 }
 
-void parseCommand(String cmd) {
+// Reads <sep><decimal> and moves past it
+bool readNumber(const char*& p, char sep, uint32_t& value) {
+    if (*p != sep || !isDigit(p[1])) {
+        return false;
+    }
+    char* end;
+    value = strtoul(p + 1, &end, 10);
+    p = end;
+    return true;
+}
+
+// CMD,<node>,<type>,<target>,<action>[;<type>,<target>,<action>...] from the
+// Edge's downlink queue, sent while our receiver is open after an uplink.
+// Type 0 is a valve, numbered from 1; this Node has nothing else to switch.
+// A malformed frame is ignored whole.
+void applyCommandFrame(const char* frame) {
+    const char* p = frame + 3;
+    uint32_t node;
+    if (!readNumber(p, ',', node) || node != NODE_ID) {
+        return;
+    }
+    uint32_t commands[MAX_FRAME_COMMANDS][3];
+    int count = 0;
+    while (*p != '\0') {
+        uint32_t* c = commands[count];
+        if (count == MAX_FRAME_COMMANDS || !readNumber(p, count ? ';' : ',', c[0]) ||
+            !readNumber(p, ',', c[1]) || !readNumber(p, ',', c[2]) || c[2] > 1) {
+            Serial.println("Malformed command frame");
+            return;
+        }
+        count++;
+    }
+    for (int i = 0; i < count; i++) {
+        if (commands[i][0] == CMD_TYPE_VALVE && commands[i][1] >= 1 && commands[i][1] <= NUM_VALVES) {
+            controlValve(commands[i][1] - 1, commands[i][2] != 0);
+        }
+    }
+}
+
+void parseCommand(String cmd, uint32_t receivedAt) {
+    // Time beacon: T,<UTC ms in hex> at the end of the frame
+    if (cmd.startsWith("T,")) {
+        nodeClock.onBeacon(strtoull(cmd.c_str() + 2, NULL, 16), receivedAt);
+        if (rtcSetAt == 0 || millis() - rtcSetAt >= RTC_SET_INTERVAL) {
+            rtcSetPending = true;
+        }
+        return;
+    }
     // Example: CMD,VALVE,1,ON
     if (cmd.startsWith("CMD,VALVE,")) {
         int idx1 = cmd.indexOf(',', 10);
@@ -100,24 +290,48 @@ void parseCommand(String cmd) {
         int valve = cmd.substring(10, idx1).toInt();
         String action = cmd.substring(idx1 + 1, idx2 > 0 ? idx2 : cmd.length());
         controlValve(valve, action == "ON");
+        return;
+    }
+    if (cmd.startsWith("CMD,")) {
+        applyCommandFrame(cmd.c_str());
+        return;
+    }
+    if (cmd.startsWith("CFG,")) {
+        applyConfigFrame(cmd.c_str());
     }
 }
 
 void loop()
 {
-    // Send sensor data periodically
+    // Read at the sensor interval, send the latest reading at the tx interval
     static unsigned long lastSend = 0;
-    if (millis() - lastSend > 5000) { // Every 5 seconds
+    if (millis() - sampledAt >= settings.sensorIntervalMs) {
+        readSensors(soilMoisture, temperature);
+        sampledAt = millis();
+    }
+    if (millis() - lastSend >= settings.txIntervalMs) {
         sendSensorData();
         lastSend = millis();
     }
+    checkValves();
 
     // Listen for commands from Edge
     if (LoRa.parsePacket()) {
+        uint32_t receivedAt = millis();
         String recv = "";
         while (LoRa.available()) {
             recv += (char)LoRa.read();
         }
-        parseCommand(recv);
+        parseCommand(recv, receivedAt);
+    }
+
+    // Set the DS3231 right as a second starts
+    if (rtcSetPending) {
+        uint64_t now = nodeClock.toUtc(millis());
+        if (now % 1000 < 20) {
+            ds3231_write_unix(now / 1000);
+            rtcSetPending = false;
+            rtcSetAt = millis() | 1;
+        }
     }
 }
@@ -8,6 +8,9 @@
 #define LORA_SENDER 0
 // #define LORA_SENDER 1
 
+// Address for settings the Edge pushes to this Node, unique per Edge
+#define NODE_ID 1
+
 // #define LORA_PERIOD 868  
 // #define LORA_PERIOD 915     
 #define LORA_PERIOD 433  
@@ -46,4 +46,27 @@ String ds3231_test()
 
     return String(datestring);
 }
+
+// Whole seconds since 1970, false if the RTC lost its time
+bool ds3231_read_unix(uint32_t *seconds)
+{
+    rtc.Begin();
+    if (!rtc.IsDateTimeValid() || !rtc.GetIsRunning()) {
+        return false;
+    }
+    *seconds = rtc.GetDateTime().Unix32Time();
+    return true;
+}
+
+// Writing the seconds register restarts the RTC's countdown, so call this
+// right on a second boundary
+void ds3231_write_unix(uint32_t seconds)
+{
+    RtcDateTime now;
+    now.InitWithUnix32Time(seconds);
+    rtc.SetDateTime(now);
+    if (!rtc.GetIsRunning()) {
+        rtc.SetIsRunning(true);
+    }
+}
 #endif
\ No newline at end of file
@@ -2,6 +2,10 @@
 #include "board_def.h"
 #ifdef ENABLE_DS3231
 String ds3231_test();
+bool ds3231_read_unix(uint32_t *seconds);
+void ds3231_write_unix(uint32_t seconds);
 #else
 #define ds3231_test() ""
+#define ds3231_read_unix(seconds) false
+#define ds3231_write_unix(seconds)
 #endif
\ No newline at end of file
@@ -0,0 +1,57 @@
+#include "node_clock.h"
+
+NodeClock::NodeClock()
+{
+    synced = false;
+    coarse = false;
+    refLocal = 0;
+    refUtc = 0;
+    anchorLocal = 0;
+    anchorUtc = 0;
+    rateKnown = false;
+    rate = 0;
+}
+
+void NodeClock::onBeacon(uint64_t utcMs, uint32_t localMs)
+{
+    if (!synced) {
+        anchorLocal = localMs;
+        anchorUtc = utcMs;
+    } else {
+        uint32_t span = localMs - anchorLocal;
+        if (span >= NODE_CLOCK_RATE_SPAN) {
+            float measured = (float)((int64_t)(utcMs - anchorUtc) - (int64_t)span) / span;
+            const float limit = NODE_CLOCK_MAX_PPM / 1e6f;
+            if (measured > limit) measured = limit;
+            if (measured < -limit) measured = -limit;
+            rate = rateKnown ? rate + (measured - rate) / 2 : measured;
+            rateKnown = true;
+            anchorLocal = localMs;
+            anchorUtc = utcMs;
+        }
+    }
+
+    refLocal = localMs;
+    refUtc = utcMs;
+    synced = true;
+    coarse = false;
+}
+
+void NodeClock::setCoarse(uint64_t utcMs, uint32_t localMs)
+{
+    if (synced) {
+        return;
+    }
+    refLocal = localMs;
+    refUtc = utcMs;
+    coarse = true;
+}
+
+uint64_t NodeClock::toUtc(uint32_t localMs) const
+{
+    if (!isSet()) {
+        return 0;
+    }
+    int32_t elapsed = (int32_t)(localMs - refLocal);
+    return refUtc + elapsed + (int64_t)(elapsed * rate);
+}
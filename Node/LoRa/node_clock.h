@@ -0,0 +1,34 @@
+#pragma once
+#include <Arduino.h>
+
+// UTC on the Node, set by the Edge's time beacons. Each beacon steps the
+// clock to the Edge's time; beacons at least NODE_CLOCK_RATE_SPAN apart
+// also measure how fast millis() runs, so the oscillator's drift is taken
+// out between beacons.
+#define NODE_CLOCK_RATE_SPAN    3600000UL   // ms
+#define NODE_CLOCK_MAX_PPM      200
+
+class NodeClock {
+public:
+    NodeClock();
+
+    // Beacon received at local time localMs, utcMs is UTC at the end of the frame
+    void onBeacon(uint64_t utcMs, uint32_t localMs);
+    // Time good to about a second, e.g. the DS3231 at boot, until the first beacon
+    void setCoarse(uint64_t utcMs, uint32_t localMs);
+
+    bool isSynced() const { return synced; }
+    bool isSet() const { return synced || coarse; }
+    uint64_t toUtc(uint32_t localMs) const;
+    float getDriftPpm() const { return rate * 1e6f; }
+
+private:
+    bool synced;
+    bool coarse;
+    uint32_t refLocal;
+    uint64_t refUtc;
+    uint32_t anchorLocal;       // Beacon the rate is measured from
+    uint64_t anchorUtc;
+    bool rateKnown;
+    float rate;                 // UTC ms per millis() ms, less one
+};
@@ -23,6 +23,7 @@ extern "C" {
 // --- Node Configuration ---
 #define NODE_IS_SENDER  0  // 0 = Receiver, 1 = Sender
 #define LORA_FREQUENCY  433  // 433, 868, or 915 MHz
+#define NODE_ID         1    // Address used by the Edge in CFG frames, 1-255
 
 // --- Hardware Pin Definitions ---
 #if LORA_V1_0_OLED
@@ -109,6 +110,8 @@ extern "C" {
 // --- Sensor Configuration ---
 #define SOIL_MOISTURE_THRESHOLD_LOW     30  // %
 #define SOIL_MOISTURE_THRESHOLD_HIGH    70  // %
+#define SOIL_MOISTURE_RAW_DRY           4095    // ADC reading in dry air
+#define SOIL_MOISTURE_RAW_WET           1500    // ADC reading in water
 #define TEMPERATURE_THRESHOLD_LOW       10  // °C
 #define TEMPERATURE_THRESHOLD_HIGH      40  // °C
 
@@ -66,6 +66,9 @@ typedef struct {
     int soil_moisture[NUM_VALVES];
     int temperature;
     bool valve_states[NUM_VALVES];
+    bool valve_auto[NUM_VALVES];        // Opened by the moisture check rather than a command
+    int64_t valve_opened_ms[NUM_VALVES];
+    int64_t valve_closed_ms[NUM_VALVES]; // End of the last automatic run, 0 if none
     bool wifi_connected;
     bool lora_initialized;
 } node_state_t;
@@ -78,6 +81,10 @@ static QueueHandle_t lora_command_queue = NULL;
 static EventGroupHandle_t wifi_event_group = NULL;
 static const int WIFI_CONNECTED_BIT = BIT0;
 
+// Runtime configuration, replaced as a whole when the Edge pushes settings
+static node_config_t g_node_config;
+static portMUX_TYPE g_config_lock = portMUX_INITIALIZER_UNLOCKED;
+
 // --- Function Prototypes ---
 static void gpio_init(void);
 static void adc_init(void);
@@ -95,6 +102,9 @@ static void read_sensors(void);
 static void send_sensor_data(void);
 static void control_valve(int valve_index, bool open);
 static void parse_lora_command(const char* command);
+static void apply_config_frame(const char* frame);
+static void get_node_config(node_config_t* config);
+static int moisture_percent(int raw);
 
 // --- Main Application ---
 void app_main(void)
@@ -109,6 +119,20 @@ void app_main(void)
     }
     ESP_ERROR_CHECK(ret);
 
+    // Start from the compiled-in defaults until the Edge sends settings
+    g_node_config.sensor_read_interval_ms = SENSOR_READ_INTERVAL_MS;
+    g_node_config.lora_tx_interval_ms = LORA_TX_INTERVAL;
+    g_node_config.soil_moisture_threshold_low = SOIL_MOISTURE_THRESHOLD_LOW;
+    g_node_config.soil_moisture_threshold_high = SOIL_MOISTURE_THRESHOLD_HIGH;
+    g_node_config.temperature_threshold_low = TEMPERATURE_THRESHOLD_LOW;
+    g_node_config.temperature_threshold_high = TEMPERATURE_THRESHOLD_HIGH;
+    g_node_config.valve_open_duration_ms = VALVE_OPEN_DURATION_DEFAULT;
+    g_node_config.valve_cooldown_period_ms = VALVE_COOLDOWN_PERIOD;
+    g_node_config.auto_irrigation_enabled = false;     // Only Edge commands move valves until ai=1
+    g_node_config.wifi_enabled = true;
+    g_node_config.lora_enabled = true;
+    g_node_config.oled_enabled = true;
+
     // Initialize hardware
     gpio_init();
     adc_init();
@@ -292,10 +316,19 @@ static void sensor_task(void* pvParameters)
 {
     ESP_LOGI(TAG, "Sensor task started");
     
+    int64_t last_send_ms = 0;
+    node_config_t config;
     while (1) {
         read_sensors();
-        send_sensor_data();
-        vTaskDelay(pdMS_TO_TICKS(SENSOR_READ_INTERVAL_MS));
+
+        // Readings go out at the tx interval, the latest one each time
+        get_node_config(&config);
+        int64_t now_ms = esp_timer_get_time() / 1000;
+        if (last_send_ms == 0 || now_ms - last_send_ms >= config.lora_tx_interval_ms) {
+            send_sensor_data();
+            last_send_ms = now_ms;
+        }
+        vTaskDelay(pdMS_TO_TICKS(config.sensor_read_interval_ms));
     }
 }
 
@@ -318,9 +351,29 @@ static void valve_control_task(void* pvParameters)
 {
     ESP_LOGI(TAG, "Valve control task started");
     
+    node_config_t config;
     while (1) {
-        // TODO: Implement automatic valve control logic based on sensor readings
-        // For now, just wait
+        // Open below the low threshold, close at the high one or after the
+        // open duration. Valves opened by a command are left to the Edge.
+        get_node_config(&config);
+        int64_t now_ms = esp_timer_get_time() / 1000;
+        for (int i = 0; i < NUM_VALVES; i++) {
+            int moisture = moisture_percent(g_node_state.soil_moisture[i]);
+            if (g_node_state.valve_auto[i]) {
+                if (!config.auto_irrigation_enabled || moisture >= config.soil_moisture_threshold_high ||
+                    now_ms - g_node_state.valve_opened_ms[i] >= config.valve_open_duration_ms) {
+                    control_valve(i, false);
+                    g_node_state.valve_closed_ms[i] = now_ms;
+                }
+            } else if (config.auto_irrigation_enabled && !g_node_state.valve_states[i] &&
+                       moisture < config.soil_moisture_threshold_low &&
+                       (g_node_state.valve_closed_ms[i] == 0 ||
+                        now_ms - g_node_state.valve_closed_ms[i] >= config.valve_cooldown_period_ms)) {
+                control_valve(i, true);
+                g_node_state.valve_auto[i] = true;
+                g_node_state.valve_opened_ms[i] = now_ms;
+            }
+        }
         vTaskDelay(pdMS_TO_TICKS(1000));
     }
 }
@@ -379,6 +432,7 @@ static void control_valve(int valve_index, bool open)
     const int valve_pins[] = VALVE_PINS;
     gpio_set_level(valve_pins[valve_index], open ? 1 : 0);
     g_node_state.valve_states[valve_index] = open;
+    g_node_state.valve_auto[valve_index] = false;
     
     ESP_LOGI(TAG, "Valve %d %s", valve_index, open ? "OPENED" : "CLOSED");
 }
@@ -398,5 +452,95 @@ static void parse_lora_command(const char* command)
             bool open = (strcmp(action_start, "ON") == 0);
             control_valve(valve_index, open);
         }
+    } else if (strncmp(command, "CFG,", 4) == 0) {
+        apply_config_frame(command);
+    }
+}
+
+static void get_node_config(node_config_t* config)
+{
+    taskENTER_CRITICAL(&g_config_lock);
+    *config = g_node_config;
+    taskEXIT_CRITICAL(&g_config_lock);
+}
+
+static int moisture_percent(int raw)
+{
+    int percent = (SOIL_MOISTURE_RAW_DRY - raw) * 100 / (SOIL_MOISTURE_RAW_DRY - SOIL_MOISTURE_RAW_WET);
+    return percent < 0 ? 0 : percent > 100 ? 100 : percent;
+}
+
+static bool set_config_value(node_config_t* config, const char* key, size_t key_len, uint32_t value)
+{
+    if (key_len != 2) {
+        return false;
+    }
+
+    if (strncmp(key, "si", 2) == 0 && value >= 1000) {
+        config->sensor_read_interval_ms = value;
+    } else if (strncmp(key, "tx", 2) == 0 && value >= 1000) {
+        config->lora_tx_interval_ms = value;
+    } else if (strncmp(key, "lo", 2) == 0 && value <= 100) {
+        config->soil_moisture_threshold_low = value;
+    } else if (strncmp(key, "hi", 2) == 0 && value <= 100) {
+        config->soil_moisture_threshold_high = value;
+    } else if (strncmp(key, "vd", 2) == 0 && value >= 1000) {
+        config->valve_open_duration_ms = value;
+    } else if (strncmp(key, "ai", 2) == 0 && value <= 1) {
+        config->auto_irrigation_enabled = value != 0;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static void apply_config_frame(const char* frame)
+{
+    // Parse format: "CFG,etag;target:key=value,...;..." with target NODE_ID or *
+    node_config_t config;
+    taskENTER_CRITICAL(&g_config_lock);
+    config = g_node_config;
+    taskEXIT_CRITICAL(&g_config_lock);
+
+    const char* section = strchr(frame, ';');
+    while (section != NULL) {
+        section++;
+        const char* end = strchr(section, ';');
+        if (end == NULL) {
+            end = section + strlen(section);
+        }
+        const char* colon = memchr(section, ':', end - section);
+        if (colon == NULL) {
+            ESP_LOGW(TAG, "Malformed config frame");
+            return;
+        }
+
+        bool for_us = (colon - section == 1 && section[0] == '*') || atoi(section) == NODE_ID;
+        const char* p = colon + 1;
+        while (for_us && p < end) {
+            const char* eq = memchr(p, '=', end - p);
+            char* next = NULL;
+            uint32_t value = eq != NULL ? strtoul(eq + 1, &next, 10) : 0;
+            if (eq == NULL || next == eq + 1 || !set_config_value(&config, p, eq - p, value)) {
+                ESP_LOGW(TAG, "Rejected config frame: bad setting");
+                return;
+            }
+            p = (*next == ',') ? next + 1 : next;
+        }
+        section = (*end != '\0') ? end : NULL;
     }
+
+    if (config.soil_moisture_threshold_low >= config.soil_moisture_threshold_high) {
+        ESP_LOGW(TAG, "Rejected config frame: thresholds out of order");
+        return;
+    }
+
+    // Swap only after the whole frame parsed so tasks never see half a change
+    taskENTER_CRITICAL(&g_config_lock);
+    g_node_config = config;
+    taskEXIT_CRITICAL(&g_config_lock);
+
+    ESP_LOGI(TAG, "Config applied: read %" PRIu32 " ms, moisture %u-%u%%, auto %d",
+             config.sensor_read_interval_ms, config.soil_moisture_threshold_low,
+             config.soil_moisture_threshold_high, config.auto_irrigation_enabled);
 }
@@ -1,7 +1,13 @@
 #include "EdgeCellular.h"
+#include "uplink_deflate.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_http_client.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 static const char* TAG = "EdgeCellular";
@@ -10,6 +16,28 @@ static bool cellular_connected = false;
 static cellular_config_t cellular_config;
 static cellular_info_t cellular_info;
 
+// HTTP client, kept between requests so HTTP/1.1 keep-alive reuses the connection
+typedef struct {
+    char* buf;
+    size_t max;
+    size_t len;
+} http_response_t;
+
+static esp_http_client_handle_t http_client = NULL;
+static http_response_t http_response;
+
+// Batched uplink: samples are stored comma separated, so the first n of
+// them are already the inside of the request's JSON array
+static uplink_config_t uplink_config;
+static bool uplink_configured = false;
+static SemaphoreHandle_t uplink_lock = NULL;   // Queue contents
+static SemaphoreHandle_t flush_lock = NULL;    // One request at a time
+static char uplink_queue[EDGE_UPLINK_QUEUE_BYTES];
+static uint16_t uplink_ends[EDGE_UPLINK_MAX_SAMPLES];  // End offset of each sample
+static uint16_t uplink_count = 0;
+static int64_t uplink_oldest_us = 0;
+static uplink_stats_t uplink_stats;
+
 esp_err_t edge_cellular_init(cellular_config_t* config)
 {
     ESP_LOGI(TAG, "Initializing cellular...");
@@ -25,6 +53,15 @@ esp_err_t edge_cellular_init(cellular_config_t* config)
     // Initialize cellular info
     memset(&cellular_info, 0, sizeof(cellular_info_t));
     
+    if (uplink_lock == NULL) {
+        uplink_lock = xSemaphoreCreateMutex();
+        flush_lock = xSemaphoreCreateMutex();
+        if (uplink_lock == NULL || flush_lock == NULL) {
+            ESP_LOGE(TAG, "Failed to create uplink locks");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    
     // TODO: Initialize SIM7000G modem
     // This is a placeholder implementation
     
@@ -55,6 +92,11 @@ esp_err_t edge_cellular_deinit(void)
     
     // TODO: Deinitialize SIM7000G modem
     
+    if (http_client != NULL) {
+        esp_http_client_cleanup(http_client);
+        http_client = NULL;
+    }
+    
     cellular_initialized = false;
     ESP_LOGI(TAG, "Cellular deinitialized");
     
@@ -115,6 +157,11 @@ esp_err_t edge_cellular_disconnect(void)
     
     // TODO: Implement actual cellular disconnection
     
+    // The kept-alive connection does not survive the link
+    if (http_client != NULL) {
+        esp_http_client_close(http_client);
+    }
+    
     cellular_info.connected = false;
     cellular_connected = false;
     
@@ -139,6 +186,111 @@ esp_err_t edge_cellular_get_info(cellular_info_t* info)
     return ESP_OK;
 }
 
+static esp_err_t http_event_handler(esp_http_client_event_t* evt)
+{
+    switch (evt->event_id) {
+        case HTTP_EVENT_ON_CONNECTED:
+            uplink_stats.connections++;
+            break;
+            
+        case HTTP_EVENT_ON_DATA:
+            if (http_response.buf != NULL && http_response.len + 1 < http_response.max) {
+                size_t n = http_response.max - 1 - http_response.len;
+                if (n > (size_t)evt->data_len) {
+                    n = evt->data_len;
+                }
+                memcpy(http_response.buf + http_response.len, evt->data, n);
+                http_response.len += n;
+                http_response.buf[http_response.len] = '\0';
+            }
+            break;
+            
+        default:
+            break;
+    }
+    return ESP_OK;
+}
+
+// One request on the shared client. Headers are "Name: value" lines.
+static esp_err_t http_perform(const char* url, esp_http_client_method_t method, const char* headers,
+                              const char* body, size_t body_len, int timeout_ms,
+                              char* response, size_t max_response_len, int* status)
+{
+    if (http_client == NULL) {
+        esp_http_client_config_t config = {
+            .url = url,
+            .timeout_ms = timeout_ms,
+            .keep_alive_enable = true,
+            .event_handler = http_event_handler,
+        };
+        http_client = esp_http_client_init(&config);
+        if (http_client == NULL) {
+            ESP_LOGE(TAG, "Failed to create HTTP client");
+            return ESP_ERR_NO_MEM;
+        }
+    } else {
+        // Same host and port keep the open connection
+        esp_http_client_set_url(http_client, url);
+        esp_http_client_set_timeout_ms(http_client, timeout_ms);
+    }
+    
+    esp_http_client_set_method(http_client, method);
+    esp_http_client_set_post_field(http_client, body, body_len);
+    
+    // Set this request's headers, remembering their names to remove afterwards
+    char names[512];
+    size_t names_len = 0;
+    const char* line = headers;
+    while (line != NULL && *line) {
+        const char* end = strstr(line, "\r\n");
+        size_t len = end ? (size_t)(end - line) : strlen(line);
+        const char* colon = memchr(line, ':', len);
+        if (colon != NULL && (size_t)(colon - line) + 1 < sizeof(names) - names_len) {
+            char value[256];
+            const char* v = colon + 1;
+            while (v < line + len && *v == ' ') v++;
+            size_t value_len = line + len - v;
+            if (value_len >= sizeof(value)) {
+                value_len = sizeof(value) - 1;
+            }
+            memcpy(value, v, value_len);
+            value[value_len] = '\0';
+            
+            char* name = names + names_len;
+            memcpy(name, line, colon - line);
+            name[colon - line] = '\0';
+            names_len += colon - line + 1;
+            esp_http_client_set_header(http_client, name, value);
+        }
+        line = end ? end + 2 : NULL;
+    }
+    
+    http_response.buf = response;
+    http_response.max = max_response_len;
+    http_response.len = 0;
+    if (response != NULL && max_response_len > 0) {
+        response[0] = '\0';
+    }
+    
+    esp_err_t ret = esp_http_client_perform(http_client);
+    http_response.buf = NULL;
+    
+    for (size_t off = 0; off < names_len; off += strlen(names + off) + 1) {
+        esp_http_client_delete_header(http_client, names + off);
+    }
+    
+    if (ret != ESP_OK) {
+        // Start the next request on a fresh connection
+        esp_http_client_close(http_client);
+        return ret;
+    }
+    
+    *status = esp_http_client_get_status_code(http_client);
+    cellular_info.bytes_sent += body_len;
+    cellular_info.bytes_received += http_response.len;
+    return ESP_OK;
+}
+
 esp_err_t edge_cellular_send_http_request(http_request_t* request, char* response, size_t max_response_len)
 {
     if (!cellular_initialized) {
@@ -161,24 +313,282 @@ esp_err_t edge_cellular_send_http_request(http_request_t* request, char* respons
     ESP_LOGI(TAG, "  URL: %s", request->url);
     ESP_LOGI(TAG, "  Timeout: %d ms", request->timeout_ms);
     
-    // TODO: Implement actual HTTP request via SIM7000G
-    // This is a placeholder implementation
-    
-    // Simulate HTTP request
-    vTaskDelay(pdMS_TO_TICKS(2000));
+    esp_http_client_method_t method = HTTP_METHOD_GET;
+    if (strcmp(request->method, "POST") == 0) {
+        method = HTTP_METHOD_POST;
+    } else if (strcmp(request->method, "PUT") == 0) {
+        method = HTTP_METHOD_PUT;
+    } else if (strcmp(request->method, "DELETE") == 0) {
+        method = HTTP_METHOD_DELETE;
+    }
     
-    // Simulate response
-    const char* test_response = "{\"status\":\"success\",\"message\":\"Data received\"}";
-    strncpy(response, test_response, max_response_len - 1);
-    response[max_response_len - 1] = '\0';
+    xSemaphoreTake(flush_lock, portMAX_DELAY);
+    int status = 0;
+    esp_err_t ret = http_perform(request->url, method, request->headers,
+                                 request->body, strlen(request->body), request->timeout_ms,
+                                 response, max_response_len, &status);
+    xSemaphoreGive(flush_lock);
     
-    // Update statistics
-    cellular_info.bytes_sent += strlen(request->body);
-    cellular_info.bytes_received += strlen(response);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "HTTP request failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
     
     ESP_LOGI(TAG, "HTTP request completed");
+    ESP_LOGI(TAG, "  Status: %d", status);
     ESP_LOGI(TAG, "  Response: %s", response);
     
+    return (status >= 200 && status < 300) ? ESP_OK : ESP_ERR_INVALID_RESPONSE;
+}
+
+esp_err_t edge_cellular_uplink_config(const uplink_config_t* config)
+{
+    if (config == NULL) {
+        ESP_LOGE(TAG, "Config is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    uplink_config = *config;
+    if (uplink_config.max_body_bytes == 0 || uplink_config.max_body_bytes > EDGE_UPLINK_BODY_MAX) {
+        uplink_config.max_body_bytes = EDGE_UPLINK_BODY_MAX;
+    }
+    uplink_configured = true;
+    
+    ESP_LOGI(TAG, "Uplink configured:");
+    ESP_LOGI(TAG, "  URL: %s", uplink_config.url);
+    ESP_LOGI(TAG, "  Batch: %u bytes or %lu ms", (unsigned)uplink_config.max_body_bytes,
+             (unsigned long)uplink_config.max_age_ms);
+    
+    return ESP_OK;
+}
+
+esp_err_t edge_cellular_queue_sample(const char* json, size_t len)
+{
+    if (json == NULL || len == 0 || len > EDGE_UPLINK_SAMPLE_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (uplink_lock == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    xSemaphoreTake(uplink_lock, portMAX_DELAY);
+    
+    size_t used = uplink_count ? uplink_ends[uplink_count - 1] : 0;
+    size_t need = len + (uplink_count ? 1 : 0);
+    
+    // A request may be reading the front of the queue, so a full queue
+    // turns away the new sample rather than the oldest
+    if (uplink_count >= EDGE_UPLINK_MAX_SAMPLES || used + need > sizeof(uplink_queue)) {
+        uplink_stats.samples_dropped++;
+        xSemaphoreGive(uplink_lock);
+        ESP_LOGW(TAG, "Uplink queue full, sample dropped");
+        return ESP_ERR_NO_MEM;
+    }
+    
+    if (uplink_count) {
+        uplink_queue[used++] = ',';
+    } else {
+        uplink_oldest_us = esp_timer_get_time();
+    }
+    memcpy(uplink_queue + used, json, len);
+    uplink_ends[uplink_count++] = used + len;
+    
+    xSemaphoreGive(uplink_lock);
+    return ESP_OK;
+}
+
+// Remove the first n samples; the caller holds uplink_lock
+static void uplink_pop(uint16_t n)
+{
+    if (n >= uplink_count) {
+        uplink_count = 0;
+        return;
+    }
+    
+    size_t cut = uplink_ends[n - 1] + 1;    // Including the comma
+    size_t used = uplink_ends[uplink_count - 1];
+    memmove(uplink_queue, uplink_queue + cut, used - cut);
+    for (uint16_t i = n; i < uplink_count; i++) {
+        uplink_ends[i - n] = uplink_ends[i] - cut;
+    }
+    uplink_count -= n;
+    
+    // Age is not tracked per sample, the rest count from now
+    uplink_oldest_us = esp_timer_get_time();
+}
+
+static bool uplink_due(void)
+{
+    if (uplink_count == 0) {
+        return false;
+    }
+    
+    size_t used = uplink_ends[uplink_count - 1];
+    int64_t age_ms = (esp_timer_get_time() - uplink_oldest_us) / 1000;
+    
+    return used + 64 >= uplink_config.max_body_bytes ||
+           uplink_count >= EDGE_UPLINK_MAX_SAMPLES ||
+           age_ms >= (int64_t)uplink_config.max_age_ms;
+}
+
+// Send one batch from the front of the queue, returns samples accepted
+static esp_err_t uplink_send_batch(char* body, uint8_t* wire, uint16_t* accepted_out)
+{
+    *accepted_out = 0;
+    
+    // Take as many whole samples as fit in one body
+    char prefix[80];
+    int prefix_len = snprintf(prefix, sizeof(prefix), "{\"device_id\":\"%s\",\"samples\":[",
+                              uplink_config.device_id);
+    const char suffix[] = "]}";
+    size_t room = uplink_config.max_body_bytes - prefix_len - (sizeof(suffix) - 1);
+    
+    xSemaphoreTake(uplink_lock, portMAX_DELAY);
+    uint16_t n = 0;
+    while (n < uplink_count && uplink_ends[n] <= room) {
+        n++;
+    }
+    if (n == 0) {
+        n = 1;  // EDGE_UPLINK_SAMPLE_MAX fits in any body
+    }
+    size_t samples_len = uplink_ends[n - 1];
+    size_t body_len = prefix_len + samples_len + sizeof(suffix) - 1;
+    memcpy(body, prefix, prefix_len);
+    memcpy(body + prefix_len, uplink_queue, samples_len);
+    memcpy(body + prefix_len + samples_len, suffix, sizeof(suffix) - 1);
+    xSemaphoreGive(uplink_lock);
+    
+    // Encode, falling back to the plain body if that is not smaller
+    const char* encoding = NULL;
+    const char* payload = body;
+    size_t payload_len = body_len;
+    if (uplink_config.encoding != UPLINK_ENCODING_IDENTITY) {
+        size_t n_wire = uplink_compress(uplink_config.encoding, (const uint8_t*)body, body_len,
+                                        wire, EDGE_UPLINK_BODY_MAX);
+        if (n_wire > 0 && n_wire < body_len) {
+            encoding = (uplink_config.encoding == UPLINK_ENCODING_GZIP) ? "gzip" : "deflate";
+            payload = (const char*)wire;
+            payload_len = n_wire;
+        }
+    }
+    
+    char headers[160];
+    int headers_len = snprintf(headers, sizeof(headers), "Content-Type: application/json\r\n");
+    if (encoding != NULL) {
+        headers_len += snprintf(headers + headers_len, sizeof(headers) - headers_len,
+                                "Content-Encoding: %s\r\n", encoding);
+    }
+    if (uplink_config.api_key[0]) {
+        snprintf(headers + headers_len, sizeof(headers) - headers_len,
+                 "Authorization: Bearer %s\r\n", uplink_config.api_key);
+    }
+    
+    char response[128];
+    int status = 0;
+    esp_err_t ret = http_perform(uplink_config.url, HTTP_METHOD_POST, headers, payload, payload_len,
+                                 uplink_config.timeout_ms, response, sizeof(response), &status);
+    
+    uplink_stats.requests++;
+    uplink_stats.body_bytes += body_len;
+    uplink_stats.wire_bytes += payload_len;
+    
+    xSemaphoreTake(uplink_lock, portMAX_DELAY);
+    if (ret != ESP_OK || status == 408 || status == 429 || status >= 500) {
+        // Nothing was stored, the whole batch goes again
+        uplink_stats.samples_requeued += n;
+        if (ret == ESP_OK) {
+            ret = ESP_ERR_INVALID_RESPONSE;
+        }
+    } else if (status >= 200 && status < 300) {
+        // {"accepted":k} means only the first k samples were stored
+        uint16_t accepted = n;
+        const char* field = strstr(response, "\"accepted\":");
+        if (field != NULL) {
+            long k = strtol(field + 11, NULL, 10);
+            if (k >= 0 && k < n) {
+                accepted = (uint16_t)k;
+            }
+        }
+        if (accepted) {
+            uplink_pop(accepted);
+        }
+        uplink_stats.samples_sent += accepted;
+        uplink_stats.samples_requeued += n - accepted;
+        *accepted_out = accepted;
+    } else {
+        // Retrying a rejected batch would only block the queue behind it
+        ESP_LOGE(TAG, "Uplink batch of %u samples rejected, status %d", n, status);
+        uplink_pop(n);
+        uplink_stats.samples_dropped += n;
+        ret = ESP_ERR_INVALID_RESPONSE;
+    }
+    xSemaphoreGive(uplink_lock);
+    
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "Uplink sent %u/%u samples, %u bytes (%u before encoding)",
+                 *accepted_out, n, (unsigned)payload_len, (unsigned)body_len);
+    }
+    return ret;
+}
+
+esp_err_t edge_cellular_flush(bool force)
+{
+    if (!cellular_initialized || !uplink_configured) {
+        ESP_LOGE(TAG, "Uplink not configured");
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    if (!cellular_connected) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    xSemaphoreTake(flush_lock, portMAX_DELAY);
+    
+    char* body = malloc(EDGE_UPLINK_BODY_MAX);
+    uint8_t* wire = malloc(EDGE_UPLINK_BODY_MAX);
+    if (body == NULL || wire == NULL) {
+        free(body);
+        free(wire);
+        xSemaphoreGive(flush_lock);
+        return ESP_ERR_NO_MEM;
+    }
+    
+    esp_err_t ret = ESP_OK;
+    while (true) {
+        xSemaphoreTake(uplink_lock, portMAX_DELAY);
+        bool send = force ? (uplink_count > 0) : uplink_due();
+        xSemaphoreGive(uplink_lock);
+        if (!send) {
+            break;
+        }
+        
+        uint16_t accepted = 0;
+        ret = uplink_send_batch(body, wire, &accepted);
+        if (ret != ESP_OK || accepted == 0) {
+            break;
+        }
+    }
+    
+    free(body);
+    free(wire);
+    xSemaphoreGive(flush_lock);
+    return ret;
+}
+
+esp_err_t edge_cellular_get_uplink_stats(uplink_stats_t* stats)
+{
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    if (uplink_lock != NULL) {
+        xSemaphoreTake(uplink_lock, portMAX_DELAY);
+    }
+    *stats = uplink_stats;
+    stats->queued_samples = uplink_count;
+    if (uplink_lock != NULL) {
+        xSemaphoreGive(uplink_lock);
+    }
     return ESP_OK;
 }
 
@@ -189,8 +599,6 @@ esp_err_t edge_cellular_transmit_data(void)
         return ESP_ERR_INVALID_STATE;
     }
     
-    ESP_LOGI(TAG, "Transmitting sensor data via cellular...");
-    
     // Connect if not connected
     if (!cellular_connected) {
         esp_err_t ret = edge_cellular_connect();
@@ -200,24 +608,11 @@ esp_err_t edge_cellular_transmit_data(void)
         }
     }
     
-    // TODO: Get actual sensor data and transmit
-    // This is a placeholder implementation
-    
-    http_request_t request = {
-        .method = "POST",
-        .url = "https://api.smartirrigation.com/v1/sensor-data",
-        .headers = "Content-Type: application/json\r\nAuthorization: Bearer YOUR_API_KEY\r\n",
-        .body = "{\"device_id\":\"edge_001\",\"temperature\":25.5,\"humidity\":60.2,\"soil_moisture\":45.8}",
-        .timeout_ms = 10000
-    };
-    
-    char response[512];
-    esp_err_t ret = edge_cellular_send_http_request(&request, response, sizeof(response));
+    // Sends only once a batch is full or old enough, see edge_cellular_uplink_config()
+    esp_err_t ret = edge_cellular_flush(false);
     
-    if (ret == ESP_OK) {
-        ESP_LOGI(TAG, "Data transmitted successfully via cellular");
-    } else {
-        ESP_LOGE(TAG, "Failed to transmit data via cellular");
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to transmit data via cellular: %s", esp_err_to_name(ret));
     }
     
     return ret;
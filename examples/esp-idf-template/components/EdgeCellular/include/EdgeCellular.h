@@ -36,6 +36,48 @@ typedef struct {
     int timeout_ms;            // Request timeout
 } http_request_t;
 
+// Batched uplink limits
+#ifndef EDGE_UPLINK_QUEUE_BYTES
+#define EDGE_UPLINK_QUEUE_BYTES   16384   // Samples waiting to be sent
+#endif
+#ifndef EDGE_UPLINK_MAX_SAMPLES
+#define EDGE_UPLINK_MAX_SAMPLES   128
+#endif
+#ifndef EDGE_UPLINK_BODY_MAX
+#define EDGE_UPLINK_BODY_MAX      8192    // Largest request body before encoding
+#endif
+#define EDGE_UPLINK_SAMPLE_MAX    512     // Largest single sample
+
+// Content-Encoding of batched request bodies
+typedef enum {
+    UPLINK_ENCODING_IDENTITY,
+    UPLINK_ENCODING_DEFLATE,
+    UPLINK_ENCODING_GZIP
+} uplink_encoding_t;
+
+// Batched uplink configuration
+typedef struct {
+    char url[256];             // Collector endpoint
+    char api_key[64];          // Sent as a Bearer token (optional)
+    char device_id[32];
+    size_t max_body_bytes;     // Send once the batch body reaches this size
+    uint32_t max_age_ms;       // Send once the oldest sample is this old
+    uplink_encoding_t encoding;
+    int timeout_ms;            // Request timeout
+} uplink_config_t;
+
+// Batched uplink statistics
+typedef struct {
+    uint32_t requests;         // Requests sent
+    uint32_t connections;      // Connections opened, below requests with keep-alive
+    uint32_t samples_sent;     // Samples the server accepted
+    uint32_t samples_requeued; // Samples re-queued after a failed or partial request
+    uint32_t samples_dropped;  // Samples dropped: queue full or rejected by the server
+    uint32_t body_bytes;       // Request bodies before encoding
+    uint32_t wire_bytes;       // Request bodies as sent
+    uint16_t queued_samples;   // Samples waiting now
+} uplink_stats_t;
+
 // Function declarations
 esp_err_t edge_cellular_init(cellular_config_t* config);
 esp_err_t edge_cellular_deinit(void);
@@ -44,6 +86,13 @@ esp_err_t edge_cellular_disconnect(void);
 esp_err_t edge_cellular_get_info(cellular_info_t* info);
 esp_err_t edge_cellular_send_http_request(http_request_t* request, char* response, size_t max_response_len);
 esp_err_t edge_cellular_transmit_data(void);
+
+// Batched uplink: samples accumulate and go out as one request per batch
+esp_err_t edge_cellular_uplink_config(const uplink_config_t* config);
+esp_err_t edge_cellular_queue_sample(const char* json, size_t len);
+esp_err_t edge_cellular_flush(bool force);
+esp_err_t edge_cellular_get_uplink_stats(uplink_stats_t* stats);
+
 bool edge_cellular_is_connected(void);
 int8_t edge_cellular_get_signal_strength(void);
 
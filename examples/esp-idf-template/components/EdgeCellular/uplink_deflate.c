@@ -0,0 +1,237 @@
+#include "uplink_deflate.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * A small DEFLATE encoder for uplink bodies: one block with the fixed
+ * Huffman codes and greedy LZ77 matching over the whole body. A batch of
+ * JSON samples repeats the same keys in every sample, which is where most
+ * of the gain is. The match tables take 4 KB + 2 bytes per body byte while
+ * compressing, instead of the ~160 KB compressor state of the ROM miniz.
+ */
+
+#define HASH_BITS   11
+#define HASH_SIZE   (1 << HASH_BITS)
+#define MIN_MATCH   3
+#define MAX_MATCH   258
+#define MAX_DIST    32768
+#define MAX_CHAIN   16      // Earlier occurrences tried per position
+
+static const uint16_t length_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t length_extra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t dist_base[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const uint8_t dist_extra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+typedef struct {
+    uint8_t* out;
+    size_t cap;
+    size_t pos;
+    uint32_t bits;
+    uint8_t count;
+    bool overflow;
+} bit_writer_t;
+
+static void put_bits(bit_writer_t* w, uint32_t value, uint8_t n)
+{
+    w->bits |= value << w->count;
+    w->count += n;
+    while (w->count >= 8) {
+        if (w->pos < w->cap) {
+            w->out[w->pos++] = (uint8_t)w->bits;
+        } else {
+            w->overflow = true;
+        }
+        w->bits >>= 8;
+        w->count -= 8;
+    }
+}
+
+// Huffman codes go out most significant bit first
+static void put_code(bit_writer_t* w, uint32_t code, uint8_t n)
+{
+    uint32_t rev = 0;
+    for (uint8_t i = 0; i < n; i++) {
+        rev = (rev << 1) | ((code >> i) & 1);
+    }
+    put_bits(w, rev, n);
+}
+
+static void put_literal(bit_writer_t* w, uint16_t sym)
+{
+    if (sym < 144) {
+        put_code(w, 0x30 + sym, 8);
+    } else if (sym < 256) {
+        put_code(w, 0x190 + sym - 144, 9);
+    } else if (sym < 280) {
+        put_code(w, sym - 256, 7);
+    } else {
+        put_code(w, 0xC0 + sym - 280, 8);
+    }
+}
+
+static void put_match(bit_writer_t* w, size_t len, size_t dist)
+{
+    uint8_t l = 28;
+    while (length_base[l] > len) l--;
+    put_literal(w, 257 + l);
+    put_bits(w, len - length_base[l], length_extra[l]);
+
+    uint8_t d = 29;
+    while (dist_base[d] > dist) d--;
+    put_code(w, d, 5);
+    put_bits(w, dist - dist_base[d], dist_extra[d]);
+}
+
+static inline uint32_t hash3(const uint8_t* p)
+{
+    return ((p[0] << 16 | p[1] << 8 | p[2]) * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// head: position + 1 of the last occurrence of each 3-byte hash, 0 if none.
+// prev: the same for the occurrence before each position.
+static void deflate_block(bit_writer_t* w, const uint8_t* in, size_t len,
+                          uint16_t* head, uint16_t* prev)
+{
+    memset(head, 0, HASH_SIZE * sizeof(uint16_t));
+
+    put_bits(w, 1, 1);  // Final block
+    put_bits(w, 1, 2);  // Fixed Huffman codes
+
+    size_t i = 0;
+    while (i < len && !w->overflow) {
+        size_t best = 0;
+        size_t dist = 0;
+        if (i + MIN_MATCH <= len) {
+            const uint32_t h = hash3(in + i);
+            size_t cand = head[h];
+            prev[i] = cand;
+            head[h] = (uint16_t)(i + 1);
+
+            const size_t limit = (len - i < MAX_MATCH) ? len - i : MAX_MATCH;
+            for (int c = 0; c < MAX_CHAIN && cand && i - (cand - 1) <= MAX_DIST; c++) {
+                const uint8_t* a = in + cand - 1;
+                const uint8_t* b = in + i;
+                size_t n = 0;
+                while (n < limit && a[n] == b[n]) n++;
+                if (n > best) {
+                    best = n;
+                    dist = i - (cand - 1);
+                    if (n == limit) break;
+                }
+                cand = prev[cand - 1];
+            }
+            if (best < MIN_MATCH) {
+                best = 0;
+            }
+        }
+
+        if (best) {
+            put_match(w, best, dist);
+            // Positions inside the match are candidates for later ones
+            const size_t end = i + best;
+            for (i++; i < end; i++) {
+                if (i + MIN_MATCH <= len) {
+                    const uint32_t h = hash3(in + i);
+                    prev[i] = head[h];
+                    head[h] = (uint16_t)(i + 1);
+                }
+            }
+        } else {
+            put_literal(w, in[i]);
+            i++;
+        }
+    }
+
+    put_literal(w, 256);    // End of block
+    if (w->count) {
+        put_bits(w, 0, 8 - w->count);   // Pad to a byte boundary
+    }
+}
+
+static uint32_t adler32(const uint8_t* p, size_t len)
+{
+    uint32_t a = 1, b = 0;
+    while (len) {
+        size_t n = (len < 5552) ? len : 5552;
+        len -= n;
+        while (n--) {
+            a += *p++;
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    return (b << 16) | a;
+}
+
+static uint32_t crc32(const uint8_t* p, size_t len)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    while (len--) {
+        crc ^= *p++;
+        for (int k = 0; k < 8; k++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+static void put_bytes(bit_writer_t* w, const uint8_t* p, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        put_bits(w, p[i], 8);
+    }
+}
+
+size_t uplink_compress(uplink_encoding_t encoding, const uint8_t* in, size_t len,
+                       uint8_t* out, size_t out_cap)
+{
+    // Matches are found by 16-bit position
+    if (encoding == UPLINK_ENCODING_IDENTITY || len >= 0xFFFF) {
+        return 0;
+    }
+
+    uint16_t* tables = malloc((HASH_SIZE + len) * sizeof(uint16_t));
+    if (tables == NULL) {
+        return 0;
+    }
+    uint16_t* head = tables;
+    uint16_t* prev = tables + HASH_SIZE;
+
+    bit_writer_t w = { .out = out, .cap = out_cap };
+
+    if (encoding == UPLINK_ENCODING_GZIP) {
+        static const uint8_t header[10] = { 0x1F, 0x8B, 8, 0, 0, 0, 0, 0, 0, 0xFF };
+        put_bytes(&w, header, sizeof(header));
+        deflate_block(&w, in, len, head, prev);
+        const uint32_t crc = crc32(in, len);
+        const uint8_t trailer[8] = {
+            crc, crc >> 8, crc >> 16, crc >> 24,
+            len, len >> 8, len >> 16, len >> 24
+        };
+        put_bytes(&w, trailer, sizeof(trailer));
+    } else {
+        // HTTP "deflate" is the zlib format
+        static const uint8_t header[2] = { 0x78, 0x01 };
+        put_bytes(&w, header, sizeof(header));
+        deflate_block(&w, in, len, head, prev);
+        const uint32_t sum = adler32(in, len);
+        const uint8_t trailer[4] = { sum >> 24, sum >> 16, sum >> 8, sum };
+        put_bytes(&w, trailer, sizeof(trailer));
+    }
+
+    free(tables);
+    return w.overflow ? 0 : w.pos;
+}
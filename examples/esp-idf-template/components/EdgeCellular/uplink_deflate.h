@@ -0,0 +1,13 @@
+#ifndef UPLINK_DEFLATE_H
+#define UPLINK_DEFLATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "EdgeCellular.h"
+
+// Compress a request body for the given Content-Encoding.
+// Returns the encoded size, or 0 if it did not fit in out_cap.
+size_t uplink_compress(uplink_encoding_t encoding, const uint8_t* in, size_t len,
+                       uint8_t* out, size_t out_cap);
+
+#endif // UPLINK_DEFLATE_H
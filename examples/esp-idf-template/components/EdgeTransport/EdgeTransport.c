@@ -0,0 +1,387 @@
+#include "EdgeTransport.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Messages wait in one queue until a path takes them. Each send scores the
+ * usable paths for the message's class:
+ *
+ *   score = success * (0.25 + 0.75 * link) - latency_weight * latency
+ *           - cost_weight * cost - energy_weight * energy
+ *
+ * success is the recent success rate and link the RSSI/SNR mapped to 0..1.
+ * latency, cost and energy are scaled to 0..1 as well, and energy weighs
+ * more as the battery runs down. A failed send lowers the path's success
+ * rate and rests it for a while, so the same message goes to the next path
+ * in the same call. A message leaves the queue only once a path has taken
+ * it.
+ */
+
+static const char* TAG = "EdgeTransport";
+
+#define SUCCESS_ALPHA       0.25f
+#define LATENCY_ALPHA       0.25f
+#define LATENCY_REF_MS      2000.0f     // Latency scoring 0.5
+#define BACKOFF_BASE_MS     1000
+#define BACKOFF_MAX_SHIFT   6           // Up to 64 s
+
+// How each class trades latency against cost
+typedef struct {
+    float latency_weight;
+    float cost_weight;
+    uint32_t hold_ms;          // Wait this long for a free path before paying
+} class_policy_t;
+
+static const class_policy_t class_policy[MSG_CLASS_COUNT] = {
+    [MSG_CLASS_ALARM]     = { 1.0f, 0.05f, 0 },
+    [MSG_CLASS_TELEMETRY] = { 0.2f, 0.5f, 0 },
+    [MSG_CLASS_BULK]      = { 0.0f, 1.0f, 6 * 60 * 60 * 1000 },
+};
+
+static const char* class_names[MSG_CLASS_COUNT] = { "alarm", "telemetry", "bulk" };
+
+typedef struct {
+    bool registered;
+    bool available;
+    transport_desc_t desc;
+    bool have_link;
+    int8_t rssi;
+    float snr;
+    float success;
+    float latency_ms;
+    uint8_t failures_in_row;
+    int64_t rest_until_us;
+    transport_stats_t stats;
+} transport_t;
+
+typedef struct {
+    msg_class_t msg_class;
+    uint8_t* data;
+    size_t len;
+    int64_t queued_us;
+} message_t;
+
+static bool transport_initialized = false;
+static transport_t transports[TRANSPORT_COUNT];
+static uint8_t battery_percent = 100;
+static float max_cost_per_kb = 0.0f;
+
+static SemaphoreHandle_t queue_lock = NULL;     // Queue contents
+static SemaphoreHandle_t process_lock = NULL;   // One delivery pass at a time
+static message_t queue[EDGE_TRANSPORT_QUEUE_LEN];
+static size_t queue_count = 0;
+static msg_class_stats_t class_stats[MSG_CLASS_COUNT];
+
+esp_err_t edge_transport_init(void)
+{
+    ESP_LOGI(TAG, "Initializing transport selector...");
+    
+    if (queue_lock == NULL) {
+        queue_lock = xSemaphoreCreateMutex();
+        process_lock = xSemaphoreCreateMutex();
+        if (queue_lock == NULL || process_lock == NULL) {
+            ESP_LOGE(TAG, "Failed to create transport locks");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    
+    memset(transports, 0, sizeof(transports));
+    memset(class_stats, 0, sizeof(class_stats));
+    transport_initialized = true;
+    
+    return ESP_OK;
+}
+
+esp_err_t edge_transport_register(transport_id_t id, const transport_desc_t* desc)
+{
+    if (!transport_initialized) {
+        ESP_LOGE(TAG, "Transport selector not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    if (id >= TRANSPORT_COUNT || desc == NULL || desc->send == NULL) {
+        ESP_LOGE(TAG, "Invalid transport");
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    transport_t* t = &transports[id];
+    memset(t, 0, sizeof(*t));
+    t->registered = true;
+    t->available = true;
+    t->desc = *desc;
+    t->success = 0.8f;  // Trusted until shown otherwise
+    t->latency_ms = desc->latency_ms;
+    
+    if (desc->cost_per_kb > max_cost_per_kb) {
+        max_cost_per_kb = desc->cost_per_kb;
+    }
+    
+    ESP_LOGI(TAG, "Transport %s registered (MTU %u, cost %.3f/KB)",
+             desc->name, (unsigned)desc->mtu, desc->cost_per_kb);
+    
+    return ESP_OK;
+}
+
+void edge_transport_set_available(transport_id_t id, bool available)
+{
+    if (id < TRANSPORT_COUNT) {
+        transports[id].available = available;
+    }
+}
+
+void edge_transport_report_link(transport_id_t id, int8_t rssi, float snr)
+{
+    if (id < TRANSPORT_COUNT) {
+        transports[id].have_link = true;
+        transports[id].rssi = rssi;
+        transports[id].snr = snr;
+    }
+}
+
+void edge_transport_set_battery(uint8_t percent)
+{
+    battery_percent = percent > 100 ? 100 : percent;
+}
+
+static float clamp01(float x)
+{
+    return x < 0.0f ? 0.0f : (x > 1.0f ? 1.0f : x);
+}
+
+static float link_quality(const transport_t* t)
+{
+    if (!t->have_link || t->desc.rssi_max <= t->desc.rssi_min) {
+        return 0.5f;
+    }
+    
+    float q = clamp01((float)(t->rssi - t->desc.rssi_min) / (t->desc.rssi_max - t->desc.rssi_min));
+    if (t->desc.snr_max > t->desc.snr_min) {
+        q = 0.5f * (q + clamp01((t->snr - t->desc.snr_min) / (t->desc.snr_max - t->desc.snr_min)));
+    }
+    return q;
+}
+
+static float score(const transport_t* t, msg_class_t msg_class, size_t len)
+{
+    const class_policy_t* policy = &class_policy[msg_class];
+    
+    float energy_weight = battery_percent < 30 ? 0.5f : (battery_percent < 60 ? 0.2f : 0.05f);
+    float energy = t->desc.energy_per_kb * len / 1024.0f;
+    float cost = max_cost_per_kb > 0.0f ? t->desc.cost_per_kb / max_cost_per_kb : 0.0f;
+    
+    return t->success * (0.25f + 0.75f * link_quality(t))
+           - policy->latency_weight * t->latency_ms / (t->latency_ms + LATENCY_REF_MS)
+           - policy->cost_weight * cost
+           - energy_weight * energy / (energy + 1.0f);
+}
+
+static bool usable(const transport_t* t, size_t len, int64_t now)
+{
+    return t->registered && t->available && len <= t->desc.mtu && now >= t->rest_until_us;
+}
+
+static transport_id_t select_at(msg_class_t msg_class, size_t len, uint32_t age_ms, int64_t now)
+{
+    // Until its hold time runs out, a message that some free path could
+    // carry waits for it, even while that path is out of range
+    bool hold = false;
+    if (age_ms < class_policy[msg_class].hold_ms) {
+        for (int i = 0; i < TRANSPORT_COUNT; i++) {
+            const transport_t* t = &transports[i];
+            if (t->registered && len <= t->desc.mtu && t->desc.cost_per_kb == 0.0f) {
+                hold = true;
+                break;
+            }
+        }
+    }
+    
+    transport_id_t best = TRANSPORT_NONE;
+    float best_score = 0.0f;
+    for (int i = 0; i < TRANSPORT_COUNT; i++) {
+        const transport_t* t = &transports[i];
+        if (!usable(t, len, now) || (hold && t->desc.cost_per_kb > 0.0f)) {
+            continue;
+        }
+        float s = score(t, msg_class, len);
+        if (best == TRANSPORT_NONE || s > best_score) {
+            best = (transport_id_t)i;
+            best_score = s;
+        }
+    }
+    return best;
+}
+
+transport_id_t edge_transport_select(msg_class_t msg_class, size_t len, uint32_t age_ms)
+{
+    if (!transport_initialized || msg_class >= MSG_CLASS_COUNT) {
+        return TRANSPORT_NONE;
+    }
+    return select_at(msg_class, len, age_ms, esp_timer_get_time());
+}
+
+esp_err_t edge_transport_send(msg_class_t msg_class, const uint8_t* data, size_t len)
+{
+    if (!transport_initialized) {
+        ESP_LOGE(TAG, "Transport selector not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    if (msg_class >= MSG_CLASS_COUNT || data == NULL || len == 0 || len > EDGE_TRANSPORT_MSG_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    uint8_t* copy = malloc(len);
+    if (copy == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(copy, data, len);
+    
+    xSemaphoreTake(queue_lock, portMAX_DELAY);
+    if (queue_count >= EDGE_TRANSPORT_QUEUE_LEN) {
+        class_stats[msg_class].rejected++;
+        xSemaphoreGive(queue_lock);
+        free(copy);
+        ESP_LOGW(TAG, "Transport queue full, %s message rejected", class_names[msg_class]);
+        return ESP_ERR_NO_MEM;
+    }
+    
+    message_t* m = &queue[queue_count++];
+    m->msg_class = msg_class;
+    m->data = copy;
+    m->len = len;
+    m->queued_us = esp_timer_get_time();
+    class_stats[msg_class].queued++;
+    xSemaphoreGive(queue_lock);
+    
+    return ESP_OK;
+}
+
+static void record(transport_t* t, bool ok, size_t len, int64_t start, int64_t now)
+{
+    float elapsed_ms = (now - start) / 1000.0f;
+    t->latency_ms += LATENCY_ALPHA * (elapsed_ms - t->latency_ms);
+    t->success += SUCCESS_ALPHA * ((ok ? 1.0f : 0.0f) - t->success);
+    
+    if (ok) {
+        t->failures_in_row = 0;
+        t->stats.messages++;
+        t->stats.bytes += len;
+    } else {
+        uint8_t shift = t->failures_in_row < BACKOFF_MAX_SHIFT ? t->failures_in_row : BACKOFF_MAX_SHIFT;
+        t->rest_until_us = now + (int64_t)(BACKOFF_BASE_MS << shift) * 1000;
+        t->failures_in_row++;
+        t->stats.failures++;
+    }
+}
+
+// Try every usable path in score order; true once one took the message
+static bool deliver(const message_t* m)
+{
+    int64_t now = esp_timer_get_time();
+    uint32_t age_ms = (uint32_t)((now - m->queued_us) / 1000);
+    
+    for (int attempt = 0; attempt < TRANSPORT_COUNT; attempt++) {
+        transport_id_t id = select_at(m->msg_class, m->len, age_ms, now);
+        if (id == TRANSPORT_NONE) {
+            return false;
+        }
+    
+        transport_t* t = &transports[id];
+        int64_t start = esp_timer_get_time();
+        esp_err_t ret = t->desc.send(m->msg_class, m->data, m->len, t->desc.ctx);
+        now = esp_timer_get_time();
+        record(t, ret == ESP_OK, m->len, start, now);
+    
+        if (ret == ESP_OK) {
+            msg_class_stats_t* cs = &class_stats[m->msg_class];
+            uint32_t latency_ms = (uint32_t)((now - m->queued_us) / 1000);
+            cs->delivered++;
+            cs->latency_sum_ms += latency_ms;
+            if (latency_ms > cs->latency_max_ms) {
+                cs->latency_max_ms = latency_ms;
+            }
+            return true;
+        }
+    
+        ESP_LOGW(TAG, "%s send over %s failed: %s", class_names[m->msg_class],
+                 t->desc.name, esp_err_to_name(ret));
+        class_stats[m->msg_class].failovers++;
+    }
+    return false;
+}
+
+esp_err_t edge_transport_process(void)
+{
+    if (!transport_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    xSemaphoreTake(process_lock, portMAX_DELAY);
+    
+    // Alarms first, each class in arrival order. New messages only go on
+    // the end, so the entries looked at here stay put while unlocked.
+    for (int c = 0; c < MSG_CLASS_COUNT; c++) {
+        xSemaphoreTake(queue_lock, portMAX_DELAY);
+        size_t count = queue_count;
+        xSemaphoreGive(queue_lock);
+    
+        for (size_t i = 0; i < count; ) {
+            if (queue[i].msg_class != (msg_class_t)c || !deliver(&queue[i])) {
+                i++;
+                continue;
+            }
+    
+            xSemaphoreTake(queue_lock, portMAX_DELAY);
+            free(queue[i].data);
+            memmove(&queue[i], &queue[i + 1], (queue_count - i - 1) * sizeof(message_t));
+            queue_count--;
+            xSemaphoreGive(queue_lock);
+            count--;
+        }
+    }
+    
+    xSemaphoreGive(process_lock);
+    
+    return ESP_OK;
+}
+
+size_t edge_transport_pending(void)
+{
+    if (queue_lock == NULL) {
+        return 0;
+    }
+    
+    xSemaphoreTake(queue_lock, portMAX_DELAY);
+    size_t n = queue_count;
+    xSemaphoreGive(queue_lock);
+    return n;
+}
+
+esp_err_t edge_transport_get_stats(transport_id_t id, transport_stats_t* stats)
+{
+    if (id >= TRANSPORT_COUNT || stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    const transport_t* t = &transports[id];
+    *stats = t->stats;
+    stats->available = t->registered && t->available;
+    stats->score = t->registered ? score(t, MSG_CLASS_TELEMETRY, 256) : 0.0f;
+    stats->success_rate = t->success;
+    stats->latency_ms = (uint32_t)t->latency_ms;
+    return ESP_OK;
+}
+
+esp_err_t edge_transport_get_class_stats(msg_class_t msg_class, msg_class_stats_t* stats)
+{
+    if (msg_class >= MSG_CLASS_COUNT || stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    *stats = class_stats[msg_class];
+    return ESP_OK;
+}
@@ -0,0 +1,93 @@
+#ifndef EDGE_TRANSPORT_H
+#define EDGE_TRANSPORT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Queue limits
+#ifndef EDGE_TRANSPORT_QUEUE_LEN
+#define EDGE_TRANSPORT_QUEUE_LEN  32      // Messages waiting for a path
+#endif
+#define EDGE_TRANSPORT_MSG_MAX    4096    // Largest single message
+
+// Paths out of the device
+typedef enum {
+    TRANSPORT_LORA,
+    TRANSPORT_CELLULAR,
+    TRANSPORT_WIFI,
+    TRANSPORT_COUNT,
+    TRANSPORT_NONE = TRANSPORT_COUNT
+} transport_id_t;
+
+// Message classes, in delivery priority
+typedef enum {
+    MSG_CLASS_ALARM,           // Deliver now, whatever it costs
+    MSG_CLASS_TELEMETRY,       // Regular readings
+    MSG_CLASS_BULK,            // Logs, may wait for a free path
+    MSG_CLASS_COUNT
+} msg_class_t;
+
+// Sends one message, returns ESP_OK once the path has taken it
+typedef esp_err_t (*transport_send_fn)(msg_class_t msg_class, const uint8_t* data, size_t len, void* ctx);
+
+// Transport description
+typedef struct {
+    const char* name;
+    transport_send_fn send;
+    void* ctx;
+    size_t mtu;                // Largest message the path carries
+    float cost_per_kb;         // Money per KB, 0 for free paths
+    float energy_per_kb;       // Relative radio energy per KB
+    uint32_t latency_ms;       // Typical send time, until measured
+    int8_t rssi_min;           // RSSI range mapped to link quality 0..1
+    int8_t rssi_max;
+    float snr_min;             // SNR range, unused if snr_min >= snr_max
+    float snr_max;
+} transport_desc_t;
+
+// Per-transport statistics
+typedef struct {
+    bool available;
+    float score;               // Score for a 256-byte telemetry message
+    float success_rate;        // Recent success rate (EWMA)
+    uint32_t latency_ms;       // Recent send time (EWMA)
+    uint32_t messages;
+    uint32_t bytes;
+    uint32_t failures;
+} transport_stats_t;
+
+// Per-class statistics
+typedef struct {
+    uint32_t queued;
+    uint32_t delivered;
+    uint32_t rejected;         // Turned away with the queue full
+    uint32_t failovers;        // Sends retried on another path
+    uint64_t latency_sum_ms;   // Queue to delivery
+    uint32_t latency_max_ms;
+} msg_class_stats_t;
+
+// Function declarations
+esp_err_t edge_transport_init(void);
+esp_err_t edge_transport_register(transport_id_t id, const transport_desc_t* desc);
+void edge_transport_set_available(transport_id_t id, bool available);
+void edge_transport_report_link(transport_id_t id, int8_t rssi, float snr);
+void edge_transport_set_battery(uint8_t percent);
+// Queue a message; edge_transport_process() delivers it
+esp_err_t edge_transport_send(msg_class_t msg_class, const uint8_t* data, size_t len);
+esp_err_t edge_transport_process(void);
+transport_id_t edge_transport_select(msg_class_t msg_class, size_t len, uint32_t age_ms);
+size_t edge_transport_pending(void);
+esp_err_t edge_transport_get_stats(transport_id_t id, transport_stats_t* stats);
+esp_err_t edge_transport_get_class_stats(msg_class_t msg_class, msg_class_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // EDGE_TRANSPORT_H
@@ -0,0 +1,279 @@
+/*
+ * Batched cellular uplink
+ *
+ * Runs EdgeCellular.c's uplink against a collector on a loopback socket.
+ * The collector is a thread in this process that speaks HTTP/1.1 with
+ * keep-alive, decodes gzip and deflate bodies with zlib and stores each
+ * sample by its timestamp. 1000 samples go out one request per sample on a
+ * fresh connection each, then in 4096-byte batches with each encoding. The
+ * fault runs answer every 7th request with 503, accept all but the last two
+ * samples of every 5th and close the connection after every 11th. Every run
+ * must leave each sample stored exactly once.
+ *
+ *    make bench_uplink && ./bench_uplink
+ */
+
+#define _GNU_SOURCE
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <zlib.h>
+#include "EdgeCellular.h"
+#include "host_port.h"
+
+#define SAMPLES         1000
+#define TS_BASE         1760000000UL
+#define TS_STEP         300UL
+
+typedef struct {
+    const char *name;
+    uplink_encoding_t encoding;
+    size_t max_body_bytes;
+    bool one_per_request;       // Force a request per sample, no keep-alive
+    bool faults;
+} run_t;
+
+typedef struct {
+    int listener;
+    bool faults;
+    int requests;
+    int stored;
+    int duplicates;
+    int bad_bodies;
+    unsigned char seen[SAMPLES];
+} collector_t;
+
+static int decode(const char *encoding, const unsigned char *in, size_t len, char *out, size_t cap)
+{
+    if (encoding[0] == '\0') {
+        if (len >= cap) {
+            return -1;
+        }
+        memcpy(out, in, len);
+        out[len] = '\0';
+        return (int)len;
+    }
+    z_stream z = { .next_in = (unsigned char *)in, .avail_in = len,
+                   .next_out = (unsigned char *)out, .avail_out = cap - 1 };
+    // 15 + 32 accepts both the zlib and the gzip wrapper
+    if (inflateInit2(&z, 15 + 32) != Z_OK) {
+        return -1;
+    }
+    int ret = inflate(&z, Z_FINISH);
+    int n = (int)z.total_out;
+    inflateEnd(&z);
+    if (ret != Z_STREAM_END) {
+        return -1;
+    }
+    out[n] = '\0';
+    return n;
+}
+
+// Stores the first accept samples of a batch, returns how many it holds
+static int store(collector_t *c, const char *body, int accept)
+{
+    int count = 0;
+    for (const char *p = strstr(body, "{\"ts\":"); p != NULL; p = strstr(p + 1, "{\"ts\":")) {
+        if (count++ >= accept) {
+            continue;
+        }
+        unsigned long ts = strtoul(p + 6, NULL, 10);
+        unsigned long i = (ts - TS_BASE) / TS_STEP;
+        if (ts < TS_BASE || i >= SAMPLES) {
+            c->bad_bodies++;
+        } else if (c->seen[i]++) {
+            c->duplicates++;
+        } else {
+            c->stored++;
+        }
+    }
+    return count;
+}
+
+static bool reply(int fd, int status, const char *body, bool close)
+{
+    char head[256];
+    int len = snprintf(head, sizeof(head), "HTTP/1.1 %d %s\r\nContent-Type: application/json\r\n"
+                       "Content-Length: %zu\r\n%s\r\n", status, status == 200 ? "OK" : "Service Unavailable",
+                       strlen(body), close ? "Connection: close\r\n" : "");
+    return send(fd, head, len, MSG_NOSIGNAL) == len &&
+           send(fd, body, strlen(body), MSG_NOSIGNAL) == (ssize_t)strlen(body);
+}
+
+// Serves one connection until either side closes it
+static void serve(collector_t *c, int fd)
+{
+    static char in[65536];
+    static char json[65536];
+    size_t have = 0;
+
+    for (;;) {
+        char *end = memmem(in, have, "\r\n\r\n", 4);
+        if (end == NULL) {
+            ssize_t n = have < sizeof(in) - 1 ? recv(fd, in + have, sizeof(in) - 1 - have, 0) : -1;
+            if (n <= 0) {
+                return;
+            }
+            have += n;
+            continue;
+        }
+        *end = '\0';
+        const char *length = strcasestr(in, "\r\nContent-Length:");
+        size_t body_len = length != NULL ? strtoul(length + 17, NULL, 10) : 0;
+        char encoding[16] = "";
+        const char *coding = strcasestr(in, "\r\nContent-Encoding:");
+        if (coding != NULL) {
+            sscanf(coding + 19, " %15[a-z]", encoding);
+        }
+        bool client_close = strcasestr(in, "\r\nConnection: close") != NULL;
+        size_t head_len = end + 4 - in;
+        while (have < head_len + body_len) {
+            ssize_t n = have < sizeof(in) ? recv(fd, in + have, sizeof(in) - have, 0) : -1;
+            if (n <= 0) {
+                return;
+            }
+            have += n;
+        }
+
+        int request = ++c->requests;
+        bool close_after = client_close || (c->faults && request % 11 == 0);
+        bool ok;
+        if (decode(encoding, (unsigned char *)in + head_len, body_len, json, sizeof(json)) < 0) {
+            c->bad_bodies++;
+            ok = reply(fd, 400, "{\"error\":\"body\"}", close_after);
+        } else if (c->faults && request % 7 == 0) {
+            ok = reply(fd, 503, "{\"error\":\"busy\"}", close_after);
+        } else {
+            int accept = SAMPLES;
+            if (c->faults && request % 5 == 0) {
+                int n = store(c, json, 0);
+                accept = n > 2 ? n - 2 : n;
+            }
+            int held = store(c, json, accept);
+            char answer[48];
+            snprintf(answer, sizeof(answer), "{\"accepted\":%d}", held < accept ? held : accept);
+            ok = reply(fd, 200, answer, close_after);
+        }
+
+        have -= head_len + body_len;
+        memmove(in, in + head_len + body_len, have);
+        if (!ok || close_after) {
+            return;
+        }
+    }
+}
+
+static void *collector_task(void *arg)
+{
+    collector_t *c = arg;
+    int fd;
+    while ((fd = accept(c->listener, NULL, NULL)) >= 0) {
+        serve(c, fd);
+        close(fd);
+    }
+    return NULL;
+}
+
+static int sample(unsigned i, char *buf, size_t size)
+{
+    return snprintf(buf, size, "{\"ts\":%lu,\"temperature\":%.2f,\"humidity\":%.2f,\"soil_moisture\":%.2f,"
+                    "\"light\":%.1f,\"ph\":%.2f,\"conductivity\":%.1f,\"pressure\":%.1f,\"battery\":%.2f}",
+                    TS_BASE + i * TS_STEP, 20 + (rand() % 1000) / 100.0, 40 + (rand() % 3000) / 100.0,
+                    30 + (rand() % 2000) / 100.0, 12000 + (rand() % 5000) / 10.0, 6.5 + (rand() % 50) / 100.0,
+                    850 + (rand() % 400) / 10.0, 1013 + (rand() % 100) / 10.0, 3.9 + (rand() % 30) / 100.0);
+}
+
+// Runs in a child process, EdgeCellular keeps static state
+static int run(const run_t *r)
+{
+    collector_t c = { .faults = r->faults };
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t addr_len = sizeof(addr);
+    c.listener = socket(AF_INET, SOCK_STREAM, 0);
+    if (c.listener < 0 || bind(c.listener, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(c.listener, 4) != 0 || getsockname(c.listener, (struct sockaddr *)&addr, &addr_len) != 0) {
+        perror("listen");
+        return 1;
+    }
+    pthread_t collector;
+    pthread_create(&collector, NULL, collector_task, &c);
+
+    cellular_config_t cellular = { .apn = "internet" };
+    ESP_ERROR_CHECK(edge_cellular_init(&cellular));
+    ESP_ERROR_CHECK(edge_cellular_connect());
+    uplink_config_t uplink = {
+        .device_id = "EDGE_001",
+        .max_body_bytes = r->max_body_bytes,
+        .max_age_ms = UINT32_MAX,
+        .encoding = r->encoding,
+        .timeout_ms = 5000,
+    };
+    snprintf(uplink.url, sizeof(uplink.url), "http://127.0.0.1:%d/v1/sensor-data", ntohs(addr.sin_port));
+    ESP_ERROR_CHECK(edge_cellular_uplink_config(&uplink));
+    host_http_set_keep_alive(!r->one_per_request);
+
+    srand(1);
+    for (unsigned i = 0; i < SAMPLES; i++) {
+        char json[EDGE_UPLINK_SAMPLE_MAX];
+        edge_cellular_queue_sample(json, sample(i, json, sizeof(json)));
+        edge_cellular_flush(r->one_per_request);
+    }
+    uplink_stats_t stats;
+    for (int i = 0; i < 50; i++) {
+        edge_cellular_get_uplink_stats(&stats);
+        if (stats.queued_samples == 0) {
+            break;
+        }
+        edge_cellular_flush(true);
+    }
+    edge_cellular_get_uplink_stats(&stats);
+    edge_cellular_deinit();
+    shutdown(c.listener, SHUT_RDWR);
+    pthread_join(collector, NULL);
+    close(c.listener);
+
+    double sent = stats.samples_sent ? stats.samples_sent : 1;
+    printf("  %-26s %6.1f %6u %8.1f %8.1f %8.1f   %4d stored, %d duplicate, %u requeued\n",
+           r->name, stats.samples_sent / (double)stats.requests, stats.connections, stats.body_bytes / sent,
+           stats.wire_bytes / sent, host_http_tx_bytes() / sent, c.stored, c.duplicates, stats.samples_requeued);
+    return c.stored == SAMPLES && c.duplicates == 0 && c.bad_bodies == 0 && stats.samples_dropped == 0 ? 0 : 1;
+}
+
+int main(void)
+{
+    static const run_t runs[] = {
+        { "1 request/sample, close", UPLINK_ENCODING_IDENTITY, 256, true, false },
+        { "batched identity", UPLINK_ENCODING_IDENTITY, 4096, false, false },
+        { "batched deflate", UPLINK_ENCODING_DEFLATE, 4096, false, false },
+        { "batched gzip", UPLINK_ENCODING_GZIP, 4096, false, false },
+        { "faults, identity", UPLINK_ENCODING_IDENTITY, 4096, false, true },
+        { "faults, deflate", UPLINK_ENCODING_DEFLATE, 4096, false, true },
+        { "faults, gzip", UPLINK_ENCODING_GZIP, 4096, false, true },
+    };
+
+    printf("%d samples to a loopback collector\n", SAMPLES);
+    printf("  %-26s %6s %6s %8s %8s %8s\n", "", "smp/rq", "conns", "body B", "wire B", "TCP B");
+    int failures = 0;
+    for (size_t i = 0; i < sizeof(runs) / sizeof(runs[0]); i++) {
+        fflush(stdout);
+        pid_t pid = fork();
+        if (pid == 0) {
+            exit(run(&runs[i]));
+        }
+        int status = 0;
+        if (pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            printf("  %s FAILED\n", runs[i].name);
+            failures++;
+        }
+    }
+    printf("  bytes are per sample stored: JSON body, body as sent, TCP payload with HTTP headers\n");
+    return failures != 0;
+}
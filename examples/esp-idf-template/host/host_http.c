@@ -0,0 +1,268 @@
+/*
+ * esp_http_client over plain TCP sockets: HTTP/1.1 requests with a
+ * Content-Length body and keep-alive, to a loopback server. The connection
+ * stays open between requests to the same host and port until the server
+ * answers "Connection: close" or the caller closes it.
+ */
+
+#define _GNU_SOURCE
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "esp_http_client.h"
+#include "host_port.h"
+
+#define HOST_HTTP_HEADERS       16
+#define HOST_HTTP_NAME_LEN      64
+#define HOST_HTTP_VALUE_LEN     256
+#define HOST_HTTP_RX_BUFFER     8192
+
+struct esp_http_client {
+    char host[64];
+    int port;
+    char path[256];
+    int fd;
+    esp_http_client_method_t method;
+    const char *body;
+    int body_len;
+    char names[HOST_HTTP_HEADERS][HOST_HTTP_NAME_LEN];
+    char values[HOST_HTTP_HEADERS][HOST_HTTP_VALUE_LEN];
+    int header_count;
+    int status;
+    http_event_handle_cb handler;
+    void *user_data;
+    char rx[HOST_HTTP_RX_BUFFER];
+    int rx_len;
+};
+
+static uint64_t s_tx_bytes;
+static bool s_keep_alive = true;
+
+static void parse_url(esp_http_client_handle_t client, const char *url)
+{
+    const char *host = strstr(url, "://");
+    host = host != NULL ? host + 3 : url;
+    const char *path = strchr(host, '/');
+    if (path == NULL) {
+        path = host + strlen(host);
+    }
+    const char *colon = memchr(host, ':', path - host);
+    const char *host_end = colon != NULL ? colon : path;
+    snprintf(client->host, sizeof(client->host), "%.*s", (int)(host_end - host), host);
+    client->port = colon != NULL ? atoi(colon + 1) : 80;
+    snprintf(client->path, sizeof(client->path), "%s", *path ? path : "/");
+}
+
+static void emit(esp_http_client_handle_t client, esp_http_client_event_id_t id, void *data, int len)
+{
+    if (client->handler == NULL) {
+        return;
+    }
+    esp_http_client_event_t event = {
+        .event_id = id,
+        .client = client,
+        .data = data,
+        .data_len = len,
+        .user_data = client->user_data,
+    };
+    client->handler(&event);
+}
+
+static int fill(esp_http_client_handle_t client)
+{
+    if (client->rx_len == sizeof(client->rx)) {
+        return -1;
+    }
+    ssize_t n = recv(client->fd, client->rx + client->rx_len, sizeof(client->rx) - client->rx_len, 0);
+    if (n > 0) {
+        client->rx_len += n;
+    }
+    return (int)n;
+}
+
+static bool send_all(int fd, const char *data, size_t len)
+{
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return false;
+        }
+        s_tx_bytes += n;
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *config)
+{
+    esp_http_client_handle_t client = calloc(1, sizeof(*client));
+    if (client == NULL) {
+        return NULL;
+    }
+    client->fd = -1;
+    client->handler = config->event_handler;
+    client->user_data = config->user_data;
+    parse_url(client, config->url);
+    return client;
+}
+
+esp_err_t esp_http_client_set_url(esp_http_client_handle_t client, const char *url)
+{
+    char host[sizeof(client->host)];
+    int port = client->port;
+    memcpy(host, client->host, sizeof(host));
+    parse_url(client, url);
+    if (strcmp(host, client->host) != 0 || port != client->port) {
+        esp_http_client_close(client);
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_timeout_ms(esp_http_client_handle_t client, int timeout_ms)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_method(esp_http_client_handle_t client, esp_http_client_method_t method)
+{
+    client->method = method;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_post_field(esp_http_client_handle_t client, const char *data, int len)
+{
+    client->body = data;
+    client->body_len = len;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_header(esp_http_client_handle_t client, const char *key, const char *value)
+{
+    int i = 0;
+    while (i < client->header_count && strcasecmp(client->names[i], key) != 0) {
+        i++;
+    }
+    if (i == HOST_HTTP_HEADERS) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (i == client->header_count) {
+        client->header_count++;
+    }
+    snprintf(client->names[i], HOST_HTTP_NAME_LEN, "%s", key);
+    snprintf(client->values[i], HOST_HTTP_VALUE_LEN, "%s", value);
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_delete_header(esp_http_client_handle_t client, const char *key)
+{
+    for (int i = 0; i < client->header_count; i++) {
+        if (strcasecmp(client->names[i], key) == 0) {
+            client->header_count--;
+            memmove(client->names[i], client->names[i + 1], (client->header_count - i) * HOST_HTTP_NAME_LEN);
+            memmove(client->values[i], client->values[i + 1], (client->header_count - i) * HOST_HTTP_VALUE_LEN);
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t esp_http_client_perform(esp_http_client_handle_t client)
+{
+    static const char *methods[] = { "GET", "POST", "PUT", "DELETE" };
+
+    if (client->fd < 0) {
+        struct sockaddr_in addr = {
+            .sin_family = AF_INET,
+            .sin_port = htons(client->port),
+            .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+        };
+        client->fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (client->fd < 0 || connect(client->fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+            esp_http_client_close(client);
+            return ESP_FAIL;
+        }
+        emit(client, HTTP_EVENT_ON_CONNECTED, NULL, 0);
+    }
+
+    char head[2048];
+    int len = snprintf(head, sizeof(head), "%s %s HTTP/1.1\r\nHost: %s\r\nUser-Agent: ESP32 HTTP Client/1.0\r\n"
+                       "Content-Length: %d\r\n%s", methods[client->method], client->path, client->host,
+                       client->body_len, s_keep_alive ? "" : "Connection: close\r\n");
+    for (int i = 0; i < client->header_count; i++) {
+        len += snprintf(head + len, sizeof(head) - len, "%s: %s\r\n", client->names[i], client->values[i]);
+    }
+    len += snprintf(head + len, sizeof(head) - len, "\r\n");
+    if (!send_all(client->fd, head, len) || !send_all(client->fd, client->body, client->body_len)) {
+        esp_http_client_close(client);
+        return ESP_FAIL;
+    }
+
+    char *end;
+    while ((end = memmem(client->rx, client->rx_len, "\r\n\r\n", 4)) == NULL) {
+        if (fill(client) <= 0) {
+            esp_http_client_close(client);
+            return ESP_FAIL;
+        }
+    }
+    *end = '\0';
+    client->status = atoi(client->rx + 9);
+    const char *length = strcasestr(client->rx, "\r\nContent-Length:");
+    int body_len = length != NULL ? atoi(length + 17) : 0;
+    bool closing = !s_keep_alive || strcasestr(client->rx, "\r\nConnection: close") != NULL;
+
+    int body = end + 4 - client->rx;
+    while (client->rx_len - body < body_len) {
+        if (fill(client) <= 0) {
+            esp_http_client_close(client);
+            return ESP_FAIL;
+        }
+    }
+    if (body_len > 0) {
+        emit(client, HTTP_EVENT_ON_DATA, client->rx + body, body_len);
+    }
+    client->rx_len -= body + body_len;
+    memmove(client->rx, client->rx + body + body_len, client->rx_len);
+
+    if (closing) {
+        esp_http_client_close(client);
+    }
+    return ESP_OK;
+}
+
+int esp_http_client_get_status_code(esp_http_client_handle_t client)
+{
+    return client->status;
+}
+
+esp_err_t esp_http_client_close(esp_http_client_handle_t client)
+{
+    if (client->fd >= 0) {
+        close(client->fd);
+        client->fd = -1;
+    }
+    client->rx_len = 0;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client)
+{
+    esp_http_client_close(client);
+    free(client);
+    return ESP_OK;
+}
+
+uint64_t host_http_tx_bytes(void)
+{
+    return s_tx_bytes;
+}
+
+void host_http_set_keep_alive(bool enable)
+{
+    s_keep_alive = enable;
+}
@@ -0,0 +1,77 @@
+/*
+ * The ESP-IDF and FreeRTOS calls behind stubs/: a simulated esp_timer clock,
+ * vTaskDelay() that moves it, and pthread mutexes.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "host_port.h"
+
+struct host_mutex {
+    pthread_mutex_t mutex;
+};
+
+int host_log_enabled;
+
+static int64_t s_now_us;
+
+__attribute__((constructor)) static void host_port_init(void)
+{
+    host_log_enabled = getenv("HOST_LOG") != NULL;
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+    case ESP_OK: return "ESP_OK";
+    case ESP_FAIL: return "ESP_FAIL";
+    case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+    case ESP_ERR_INVALID_RESPONSE: return "ESP_ERR_INVALID_RESPONSE";
+    default: return "ESP_ERR";
+    }
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return __atomic_load_n(&s_now_us, __ATOMIC_RELAXED);
+}
+
+void host_advance_us(int64_t us)
+{
+    __atomic_add_fetch(&s_now_us, us, __ATOMIC_RELAXED);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    host_advance_us((int64_t)ticks * portTICK_PERIOD_MS * 1000);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    SemaphoreHandle_t mutex = malloc(sizeof(*mutex));
+    if (mutex != NULL) {
+        pthread_mutex_init(&mutex->mutex, NULL);
+    }
+    return mutex;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t mutex, TickType_t ticks)
+{
+    return pthread_mutex_lock(&mutex->mutex) == 0 ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t mutex)
+{
+    return pthread_mutex_unlock(&mutex->mutex) == 0 ? pdTRUE : pdFALSE;
+}
@@ -0,0 +1,32 @@
+/*
+ * Controls the benchmarks use to drive the host port: the simulated clock
+ * and the HTTP client's socket counters, which a device build has no
+ * equivalent for.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Move simulated esp_timer time forward
+ */
+void host_advance_us(int64_t us);
+
+/**
+ * @brief Bytes the HTTP client wrote to its sockets, request lines and headers included
+ */
+uint64_t host_http_tx_bytes(void);
+
+/**
+ * @brief Send "Connection: close" with every request, as a client without keep-alive would
+ */
+void host_http_set_keep_alive(bool enable);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,269 @@
+/*
+ * Transport selection under scripted link degradation
+ *
+ * Three simulated days of the template's traffic: telemetry every 5 min, an
+ * hourly bulk log and alarms at random 40 min to 2.7 h apart. LoRa degrades
+ * from 02 to 06 h and drops out from 14 to 15 h, cellular drops out from 09
+ * to 10 h, and WiFi is in range only from 18 to 01 h. Every send moves the
+ * simulated clock by the link's latency, or by its timeout when the message
+ * is lost. The paths are registered as main.c registers them.
+ *
+ * HYBRID is the fallback main.c uses without EdgeTransport: LoRa, then
+ * cellular, no retry. AUTO is EdgeTransport. The second scenario also makes
+ * cellular lose half its packets during the LoRa outage. Each run is a
+ * separate process, EdgeTransport keeps static state.
+ *
+ *    make sim_transport && ./sim_transport
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "esp_timer.h"
+#include "EdgeTransport.h"
+#include "host_port.h"
+
+#define DAY_S           (24 * 3600)
+#define DAYS            3
+#define STEP_S          10
+#define MAX_MESSAGES    4000
+
+typedef struct {
+    const char *name;
+    int latency_ms;
+    int timeout_ms;
+} link_t;
+
+typedef struct {
+    int msg_class;
+    int64_t created_us;
+    int64_t delivered_us;       // -1 until delivered
+} record_t;
+
+static const link_t s_links[TRANSPORT_COUNT] = {
+    [TRANSPORT_LORA]     = { "LoRa", 400, 2000 },
+    [TRANSPORT_CELLULAR] = { "Cellular", 1500, 10000 },
+    [TRANSPORT_WIFI]     = { "WiFi", 150, 5000 },
+};
+
+static const int s_sizes[MSG_CLASS_COUNT] = { 80, 190, 480 };
+
+static record_t s_records[MAX_MESSAGES];
+static int s_record_count;
+static long s_cellular_bytes[MSG_CLASS_COUNT];
+static long s_attempts[TRANSPORT_COUNT];
+static int s_scenario;
+
+static int hour(void)
+{
+    return (int)(esp_timer_get_time() / 1000000 % DAY_S) / 3600;
+}
+
+// Packet loss, RSSI, SNR and whether the link is up, by time of day
+static void conditions(int id, double *loss, int *rssi, float *snr, bool *up)
+{
+    int h = hour();
+    *up = true;
+    *snr = 0.0f;
+    if (id == TRANSPORT_LORA) {
+        *loss = 0.02;
+        *rssi = -90;
+        *snr = 6.0f;
+        if (h >= 2 && h < 6) {
+            *loss = 0.7;
+            *rssi = -117;
+            *snr = -12.0f;
+        } else if (h == 14) {
+            *loss = 1.0;
+            *rssi = -125;
+            *snr = -20.0f;
+        }
+    } else if (id == TRANSPORT_CELLULAR) {
+        *loss = 0.01;
+        *rssi = -85;
+        if (h == 9) {
+            *loss = 1.0;
+            *rssi = -111;
+        } else if (h == 14 && s_scenario == 1) {
+            *loss = 0.5;
+            *rssi = -105;
+        }
+    } else {
+        *loss = 0.03;
+        *rssi = -60;
+        *up = h >= 18 || h < 1;
+    }
+}
+
+static bool try_link(int id, const uint8_t *data, size_t len)
+{
+    double loss;
+    int rssi;
+    float snr;
+    bool up;
+    conditions(id, &loss, &rssi, &snr, &up);
+    s_attempts[id]++;
+
+    bool ok = up && rand() / (double)RAND_MAX >= loss;
+    host_advance_us((int64_t)(ok ? s_links[id].latency_ms : s_links[id].timeout_ms) * 1000);
+    if (ok) {
+        record_t *r = &s_records[atoi((const char *)data + 3)];
+        r->delivered_us = esp_timer_get_time();
+        if (id == TRANSPORT_CELLULAR) {
+            s_cellular_bytes[r->msg_class] += len;
+        }
+    }
+    return ok;
+}
+
+static esp_err_t path_send(msg_class_t msg_class, const uint8_t *data, size_t len, void *ctx)
+{
+    return try_link((int)(intptr_t)ctx, data, len) ? ESP_OK : ESP_FAIL;
+}
+
+// A message of the class's size that starts with its record number
+static int make_message(int msg_class, char *buf)
+{
+    int id = s_record_count++;
+    s_records[id] = (record_t){ msg_class, esp_timer_get_time(), -1 };
+    memset(buf, 'x', s_sizes[msg_class]);
+    int n = sprintf(buf, "id=%d;", id);
+    buf[n] = 'x';
+    return s_sizes[msg_class];
+}
+
+static void register_paths(void)
+{
+    // As main.c registers them
+    const transport_desc_t paths[TRANSPORT_COUNT] = {
+        [TRANSPORT_LORA] = { "LoRa", path_send, (void *)TRANSPORT_LORA, 255, 0.0f, 4.0f, 400,
+                             -120, -70, -15.0f, 10.0f },
+        [TRANSPORT_CELLULAR] = { "Cellular", path_send, (void *)TRANSPORT_CELLULAR, 512, 0.01f, 1.0f, 2000,
+                                 -110, -60, 0.0f, 0.0f },
+        [TRANSPORT_WIFI] = { "WiFi", path_send, (void *)TRANSPORT_WIFI, EDGE_TRANSPORT_MSG_MAX, 0.0f, 0.5f, 300,
+                             -90, -50, 0.0f, 0.0f },
+    };
+    edge_transport_init();
+    for (int id = 0; id < TRANSPORT_COUNT; id++) {
+        edge_transport_register(id, &paths[id]);
+    }
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void report(const char *mode)
+{
+    static const char *names[MSG_CLASS_COUNT] = { "alarm", "telemetry", "bulk" };
+    static double latency[MAX_MESSAGES];
+
+    long cellular = 0;
+    for (int c = 0; c < MSG_CLASS_COUNT; c++) {
+        int n = 0;
+        int total = 0;
+        for (int i = 0; i < s_record_count; i++) {
+            if (s_records[i].msg_class != c) {
+                continue;
+            }
+            total++;
+            if (s_records[i].delivered_us >= 0) {
+                latency[n++] = (s_records[i].delivered_us - s_records[i].created_us) / 1e6;
+            }
+        }
+        qsort(latency, n, sizeof(latency[0]), compare_double);
+        printf("  %-6s %-9s %4d/%4d delivered  latency p50 %7.1f s  p99 %8.1f s  max %8.1f s  cellular %6ld B\n",
+               mode, names[c], n, total, n ? latency[n / 2] : 0.0, n ? latency[n * 99 / 100] : 0.0,
+               n ? latency[n - 1] : 0.0, s_cellular_bytes[c]);
+        cellular += s_cellular_bytes[c];
+    }
+    printf("  %-6s cellular %ld B, attempts LoRa %ld, cellular %ld, WiFi %ld\n", mode, cellular,
+           s_attempts[TRANSPORT_LORA], s_attempts[TRANSPORT_CELLULAR], s_attempts[TRANSPORT_WIFI]);
+}
+
+static void run(bool automatic)
+{
+    char buf[EDGE_TRANSPORT_MSG_MAX];
+    int64_t next_telemetry = 0;
+    int64_t next_bulk = 1800;
+    int64_t next_alarm = 600;
+    unsigned traffic_seed = 1;      // Apart from the link losses, so every run sees the same traffic
+
+    srand(7);
+    if (automatic) {
+        register_paths();
+    }
+    for (int64_t t = 0; t < (int64_t)DAYS * DAY_S; t += STEP_S) {
+        int64_t behind = t * 1000000 - esp_timer_get_time();
+        if (behind > 0) {
+            host_advance_us(behind);
+        }
+
+        int msg_class = -1;
+        if (t >= next_alarm) {
+            msg_class = MSG_CLASS_ALARM;
+            next_alarm += 2400 + rand_r(&traffic_seed) % 7200;
+        } else if (t >= next_telemetry) {
+            msg_class = MSG_CLASS_TELEMETRY;
+            next_telemetry += 300;
+        } else if (t >= next_bulk) {
+            msg_class = MSG_CLASS_BULK;
+            next_bulk += 3600;
+        }
+
+        if (automatic) {
+            for (int id = 0; id < TRANSPORT_COUNT; id++) {
+                double loss;
+                int rssi;
+                float snr;
+                bool up;
+                conditions(id, &loss, &rssi, &snr, &up);
+                edge_transport_report_link(id, rssi, snr);
+                edge_transport_set_available(id, up);
+            }
+            if (msg_class >= 0) {
+                int len = make_message(msg_class, buf);
+                edge_transport_send(msg_class, (const uint8_t *)buf, len);
+            }
+            edge_transport_process();
+        } else if (msg_class >= 0) {
+            int len = make_message(msg_class, buf);
+            if (len > 255 || !try_link(TRANSPORT_LORA, (const uint8_t *)buf, len)) {
+                try_link(TRANSPORT_CELLULAR, (const uint8_t *)buf, len);
+            }
+        }
+    }
+
+    report(automatic ? "AUTO" : "HYBRID");
+    if (automatic) {
+        printf("  %-6s still queued %u\n", "AUTO", (unsigned)edge_transport_pending());
+    }
+}
+
+int main(void)
+{
+    static const char *scenarios[] = {
+        "LoRa 02-06 h degraded, 14-15 h out; cellular 09-10 h out; WiFi 18-01 h",
+        "as above, and cellular loses half its packets 14-15 h",
+    };
+
+    for (int scenario = 0; scenario < 2; scenario++) {
+        printf("%s, %d days\n", scenarios[scenario], DAYS);
+        for (int automatic = 0; automatic < 2; automatic++) {
+            fflush(stdout);
+            pid_t pid = fork();
+            if (pid == 0) {
+                s_scenario = scenario;
+                run(automatic);
+                exit(0);
+            }
+            waitpid(pid, NULL, 0);
+        }
+    }
+    return 0;
+}
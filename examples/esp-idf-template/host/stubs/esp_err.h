@@ -0,0 +1,26 @@
+/*
+ * Host stand-in for the ESP-IDF header of the same name, enough for the
+ * components under ../components to build against host_port.c.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+typedef int esp_err_t;
+
+#define ESP_OK                      0
+#define ESP_FAIL                    -1
+#define ESP_ERR_NO_MEM              0x101
+#define ESP_ERR_INVALID_ARG         0x102
+#define ESP_ERR_INVALID_STATE       0x103
+#define ESP_ERR_INVALID_SIZE        0x104
+#define ESP_ERR_NOT_FOUND           0x105
+#define ESP_ERR_NOT_SUPPORTED       0x106
+#define ESP_ERR_TIMEOUT             0x107
+#define ESP_ERR_INVALID_RESPONSE    0x108
+
+#define ESP_ERROR_CHECK(x)          do { esp_err_t err_ = (x); if (err_ != ESP_OK) abort(); } while (0)
+
+const char *esp_err_to_name(esp_err_t code);
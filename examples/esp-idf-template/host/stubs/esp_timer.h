@@ -0,0 +1,9 @@
+/*
+ * Host stand-in for esp_timer.h. Time is simulated: it only moves when the
+ * benchmark calls host_advance_us() or a task calls vTaskDelay().
+ */
+#pragma once
+
+#include "esp_err.h"
+
+int64_t esp_timer_get_time(void);
@@ -0,0 +1,12 @@
+/*
+ * Host stand-in for FreeRTOS mutexes, on pthreads
+ */
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct host_mutex *SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t mutex, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t mutex);
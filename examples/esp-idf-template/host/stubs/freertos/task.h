@@ -0,0 +1,9 @@
+/*
+ * Host stand-in for FreeRTOS tasks. vTaskDelay() moves the simulated clock
+ * instead of sleeping.
+ */
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+void vTaskDelay(TickType_t ticks);
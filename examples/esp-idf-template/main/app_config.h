@@ -60,6 +60,12 @@
 #define DEFAULT_LORA_SPREADING_FACTOR 7
 #define DEFAULT_LORA_BANDWIDTH 125000
 #define DEFAULT_LORA_TX_POWER 14
+#define DEFAULT_UPLINK_URL "https://api.smartirrigation.com/v1/sensor-data"
+#define DEFAULT_DEVICE_ID "EDGE_001"
+#define DEFAULT_WIFI_SSID ""                       // Empty leaves the WiFi path out
+#define DEFAULT_WIFI_PASSWORD ""
+#define DEFAULT_UPLINK_MAX_BODY_BYTES 4096
+#define DEFAULT_UPLINK_MAX_AGE_MS (DEFAULT_TRANSMISSION_INTERVAL_S * 1000)
 
 // Application states
 typedef enum {
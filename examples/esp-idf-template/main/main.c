@@ -11,11 +11,16 @@
 #include "nvs_flash.h"
 #include "esp_sleep.h"
 #include "esp_timer.h"
+#include "esp_event.h"
+#include "esp_netif.h"
+#include "esp_wifi.h"
+#include "esp_http_client.h"
 
 #include "board_config.h"
 #include "app_config.h"
 #include "EdgeLoRa.h"
 #include "EdgeCellular.h"
+#include "EdgeTransport.h"
 #include "Sensors.h"
 
 static const char* TAG = "SMART_IRRIGATION";
@@ -33,6 +38,10 @@ static TaskHandle_t system_monitor_task_handle = NULL;
 // Event group for task synchronization
 static EventGroupHandle_t app_event_group;
 
+// Latest reading, handed from the sensor task to the communication task
+static sensor_data_t latest_sensor_data;
+static portMUX_TYPE sensor_data_lock = portMUX_INITIALIZER_UNLOCKED;
+
 // Event bits
 #define SENSOR_READY_BIT        BIT0
 #define LORA_READY_BIT          BIT1
@@ -52,6 +61,11 @@ static void init_components(void);
 static void handle_error(const char* error_msg);
 static void enter_deep_sleep(void);
 static void print_system_info(void);
+static int format_reading(const sensor_data_t* data, char* buf, size_t size);
+static esp_err_t cellular_send_reading(void);
+static esp_err_t auto_send_reading(void);
+static void init_transports(void);
+static bool init_wifi(void);
 
 void app_main(void)
 {
@@ -174,6 +188,10 @@ static void sensor_task(void *parameter)
                          sensor_data.humidity, 
                          sensor_data.soil_moisture);
                 
+                taskENTER_CRITICAL(&sensor_data_lock);
+                latest_sensor_data = sensor_data;
+                taskEXIT_CRITICAL(&sensor_data_lock);
+                
                 // Set data ready bit
                 xEventGroupSetBits(app_event_group, DATA_READY_BIT);
             } else {
@@ -215,7 +233,7 @@ static void communication_task(void *parameter)
                     break;
                     
                 case COMM_MODE_CELLULAR_ONLY:
-                    ret = edge_cellular_transmit_data();
+                    ret = cellular_send_reading();
                     break;
                     
                 case COMM_MODE_HYBRID:
@@ -223,14 +241,13 @@ static void communication_task(void *parameter)
                     ret = edge_lora_transmit_data();
                     if (ret != ESP_OK) {
                         ESP_LOGW(TAG, "LoRa transmission failed, trying cellular...");
-                        ret = edge_cellular_transmit_data();
+                        ret = cellular_send_reading();
                     }
                     break;
                     
                 case COMM_MODE_AUTO:
-                    // Auto-select based on conditions
-                    // TODO: Implement auto-selection logic
-                    ret = edge_lora_transmit_data();
+                    // Best path per message, see EdgeTransport
+                    ret = auto_send_reading();
                     break;
             }
             
@@ -253,6 +270,258 @@ static void communication_task(void *parameter)
     }
 }
 
+static int format_reading(const sensor_data_t* data, char* buf, size_t size)
+{
+    return snprintf(buf, size,
+                    "{\"ts\":%lu,\"temperature\":%.2f,\"humidity\":%.2f,"
+                    "\"soil_moisture\":%.2f,\"light\":%.1f,\"ph\":%.2f,"
+                    "\"conductivity\":%.1f,\"pressure\":%.1f,\"battery\":%.2f}",
+                    (unsigned long)data->timestamp, data->temperature, data->humidity,
+                    data->soil_moisture, data->light, data->ph,
+                    data->conductivity, data->pressure, data->battery_voltage);
+}
+
+// Queue the latest reading for the batched uplink; it goes out once the batch is due
+static esp_err_t cellular_send_reading(void)
+{
+    sensor_data_t data;
+    taskENTER_CRITICAL(&sensor_data_lock);
+    data = latest_sensor_data;
+    taskEXIT_CRITICAL(&sensor_data_lock);
+    
+    char sample[EDGE_UPLINK_SAMPLE_MAX];
+    int len = format_reading(&data, sample, sizeof(sample));
+    
+    esp_err_t ret = edge_cellular_queue_sample(sample, len);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to queue reading: %s", esp_err_to_name(ret));
+    }
+    
+    return edge_cellular_transmit_data();
+}
+
+static esp_err_t lora_path_send(msg_class_t msg_class, const uint8_t* data, size_t len, void* ctx)
+{
+    return edge_lora_send_data(0xFF, data, len);
+}
+
+static esp_err_t cellular_path_send(msg_class_t msg_class, const uint8_t* data, size_t len, void* ctx)
+{
+    if (!edge_cellular_is_connected()) {
+        esp_err_t ret = edge_cellular_connect();
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+    
+    // Alarms skip the batch, so a failure here is a failure to deliver
+    if (msg_class == MSG_CLASS_ALARM) {
+        static http_request_t request;
+        static char response[256];
+        snprintf(request.url, sizeof(request.url), "%s", DEFAULT_UPLINK_URL);
+        snprintf(request.method, sizeof(request.method), "POST");
+        snprintf(request.headers, sizeof(request.headers), "Content-Type: application/json\r\n");
+        snprintf(request.body, sizeof(request.body), "{\"device_id\":\"%s\",\"samples\":[%.*s]}",
+                 DEFAULT_DEVICE_ID, (int)len, (const char*)data);
+        request.timeout_ms = 10000;
+        return edge_cellular_send_http_request(&request, response, sizeof(response));
+    }
+    
+    // Once in the batch the uplink owns it and re-queues it on failure
+    esp_err_t ret = edge_cellular_queue_sample((const char*)data, len);
+    if (ret == ESP_OK) {
+        edge_cellular_flush(msg_class == MSG_CLASS_BULK);
+    }
+    return ret;
+}
+
+static void wifi_event_handler(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
+        esp_wifi_connect();
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
+        // Out of range is the normal case for a field unit, keep trying
+        edge_transport_set_available(TRANSPORT_WIFI, false);
+        esp_wifi_connect();
+    } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
+        ESP_LOGI(TAG, "WiFi connected");
+        edge_transport_set_available(TRANSPORT_WIFI, true);
+    }
+}
+
+// Bring up the station, the event handler marks the path available
+static bool init_wifi(void)
+{
+    esp_err_t ret = esp_netif_init();
+    if (ret == ESP_OK) {
+        ret = esp_event_loop_create_default();
+    }
+    if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
+        ESP_LOGE(TAG, "Failed to start the network stack: %s", esp_err_to_name(ret));
+        return false;
+    }
+    esp_netif_create_default_wifi_sta();
+    
+    wifi_init_config_t init_config = WIFI_INIT_CONFIG_DEFAULT();
+    ret = esp_wifi_init(&init_config);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize WiFi: %s", esp_err_to_name(ret));
+        return false;
+    }
+    esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID, wifi_event_handler, NULL);
+    esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, wifi_event_handler, NULL);
+    
+    wifi_config_t wifi_config = { 0 };
+    strncpy((char*)wifi_config.sta.ssid, DEFAULT_WIFI_SSID, sizeof(wifi_config.sta.ssid));
+    strncpy((char*)wifi_config.sta.password, DEFAULT_WIFI_PASSWORD, sizeof(wifi_config.sta.password));
+    esp_wifi_set_mode(WIFI_MODE_STA);
+    esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
+    ret = esp_wifi_start();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start WiFi: %s", esp_err_to_name(ret));
+        return false;
+    }
+    
+    ESP_LOGI(TAG, "WiFi started, SSID: %s", DEFAULT_WIFI_SSID);
+    return true;
+}
+
+// One POST per message, on a connection kept open between sends
+static esp_err_t wifi_path_send(msg_class_t msg_class, const uint8_t* data, size_t len, void* ctx)
+{
+    static esp_http_client_handle_t client = NULL;
+    static char body[EDGE_TRANSPORT_MSG_MAX + 64];
+    
+    if (client == NULL) {
+        esp_http_client_config_t config = {
+            .url = DEFAULT_UPLINK_URL,
+            .method = HTTP_METHOD_POST,
+            .timeout_ms = 5000,
+            .keep_alive_enable = true,
+        };
+        client = esp_http_client_init(&config);
+        if (client == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+        esp_http_client_set_header(client, "Content-Type", "application/json");
+    }
+    
+    int body_len = snprintf(body, sizeof(body), "{\"device_id\":\"%s\",\"samples\":[%.*s]}",
+                            DEFAULT_DEVICE_ID, (int)len, (const char*)data);
+    esp_http_client_set_post_field(client, body, body_len);
+    
+    esp_err_t ret = esp_http_client_perform(client);
+    if (ret != ESP_OK) {
+        esp_http_client_close(client);
+        return ret;
+    }
+    
+    int status = esp_http_client_get_status_code(client);
+    return (status >= 200 && status < 300) ? ESP_OK : ESP_ERR_INVALID_RESPONSE;
+}
+
+static void init_transports(void)
+{
+    edge_transport_init();
+    
+    transport_desc_t lora = {
+        .name = "LoRa",
+        .send = lora_path_send,
+        .mtu = LORA_MAX_PAYLOAD_SIZE,
+        .cost_per_kb = 0.0f,
+        .energy_per_kb = 4.0f,      // Long airtime at high spreading factors
+        .latency_ms = 400,
+        .rssi_min = -120,
+        .rssi_max = -70,
+        .snr_min = -15.0f,
+        .snr_max = 10.0f
+    };
+    if (edge_lora_is_initialized()) {
+        edge_transport_register(TRANSPORT_LORA, &lora);
+    }
+    
+    transport_desc_t cellular = {
+        .name = "Cellular",
+        .send = cellular_path_send,
+        .mtu = EDGE_UPLINK_SAMPLE_MAX,
+        .cost_per_kb = 0.01f,       // Metered data plan
+        .energy_per_kb = 1.0f,
+        .latency_ms = 2000,
+        .rssi_min = -110,
+        .rssi_max = -60
+    };
+    edge_transport_register(TRANSPORT_CELLULAR, &cellular);
+    
+    transport_desc_t wifi = {
+        .name = "WiFi",
+        .send = wifi_path_send,
+        .mtu = EDGE_TRANSPORT_MSG_MAX,
+        .cost_per_kb = 0.0f,
+        .energy_per_kb = 0.5f,
+        .latency_ms = 300,
+        .rssi_min = -90,
+        .rssi_max = -50
+    };
+    if (strlen(DEFAULT_WIFI_SSID) > 0) {
+        // Unavailable until the station has an address
+        edge_transport_register(TRANSPORT_WIFI, &wifi);
+        edge_transport_set_available(TRANSPORT_WIFI, false);
+        init_wifi();
+    } else {
+        ESP_LOGI(TAG, "No WiFi network configured, WiFi path not registered");
+    }
+}
+
+// Route the latest reading, and a low-battery alarm on the way down
+static esp_err_t auto_send_reading(void)
+{
+    static bool battery_alarm_sent = false;
+    
+    sensor_data_t data;
+    taskENTER_CRITICAL(&sensor_data_lock);
+    data = latest_sensor_data;
+    taskEXIT_CRITICAL(&sensor_data_lock);
+    
+    // Link and battery state for the scoring
+    if (edge_lora_is_initialized()) {
+        edge_transport_report_link(TRANSPORT_LORA, edge_lora_get_rssi(), edge_lora_get_snr());
+    }
+    edge_transport_report_link(TRANSPORT_CELLULAR, edge_cellular_get_signal_strength(), 0.0f);
+    wifi_ap_record_t ap;
+    if (esp_wifi_sta_get_ap_info(&ap) == ESP_OK) {
+        edge_transport_report_link(TRANSPORT_WIFI, ap.rssi, 0.0f);
+    }
+    
+    int battery_mv = (int)(data.battery_voltage * 1000.0f);
+    int percent = (battery_mv - BATTERY_CRITICAL_THRESHOLD_MV) * 100 / (4200 - BATTERY_CRITICAL_THRESHOLD_MV);
+    edge_transport_set_battery(percent < 0 ? 0 : (uint8_t)(percent > 100 ? 100 : percent));
+    
+    char msg[EDGE_UPLINK_SAMPLE_MAX];
+    int len;
+    if (battery_mv < BATTERY_LOW_THRESHOLD_MV && !battery_alarm_sent) {
+        len = snprintf(msg, sizeof(msg), "{\"ts\":%lu,\"alarm\":\"LOW_BATTERY\",\"battery\":%.2f}",
+                       (unsigned long)data.timestamp, data.battery_voltage);
+        battery_alarm_sent = edge_transport_send(MSG_CLASS_ALARM, (const uint8_t*)msg, len) == ESP_OK;
+    } else if (battery_mv >= BATTERY_LOW_THRESHOLD_MV) {
+        battery_alarm_sent = false;
+    }
+    
+    len = format_reading(&data, msg, sizeof(msg));
+    esp_err_t ret = edge_transport_send(MSG_CLASS_TELEMETRY, (const uint8_t*)msg, len);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to queue reading: %s", esp_err_to_name(ret));
+    }
+    
+    // Undelivered messages stay queued for the next pass
+    edge_transport_process();
+    size_t pending = edge_transport_pending();
+    if (pending) {
+        ESP_LOGW(TAG, "%u messages waiting for a transport", (unsigned)pending);
+    }
+    
+    return ret;
+}
+
 static void system_monitor_task(void *parameter)
 {
     ESP_LOGI(TAG, "System monitor task started");
@@ -358,11 +627,23 @@ static void init_components(void)
     ret = edge_cellular_init(&cellular_config);
     if (ret == ESP_OK) {
         ESP_LOGI(TAG, "Cellular initialized");
+        
+        uplink_config_t uplink_config = {
+            .url = DEFAULT_UPLINK_URL,
+            .device_id = DEFAULT_DEVICE_ID,
+            .max_body_bytes = DEFAULT_UPLINK_MAX_BODY_BYTES,
+            .max_age_ms = DEFAULT_UPLINK_MAX_AGE_MS,
+            .encoding = UPLINK_ENCODING_GZIP,
+            .timeout_ms = 30000
+        };
+        edge_cellular_uplink_config(&uplink_config);
         xEventGroupSetBits(app_event_group, CELLULAR_READY_BIT);
     } else {
         ESP_LOGE(TAG, "Failed to initialize cellular: %s", esp_err_to_name(ret));
     }
     
+    init_transports();
+    
     ESP_LOGI(TAG, "Components initialized");
 }
 